@@ -12,6 +12,7 @@
 #define MK_WEBRTC_H
 #include "mk_common.h"
 #include "mk_proxyplayer.h"
+#include "mk_events_objects.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -32,6 +33,10 @@ typedef void(API_CALL *on_mk_webrtc_room_keeper_info_cb)(void *user_data, const
 //获取WebRTC-Peer查看注册信息、WebRTC-信令服务器查看注册信息回调函数
 typedef void(API_CALL *on_mk_webrtc_room_keeper_data_cb)(const char *data);
 
+// 收到datachannel消息回调函数
+// Callback function for receiving datachannel messages
+typedef void(API_CALL *on_mk_rtc_datachannel_message)(void *user_data, mk_rtc_transport rtc_transport, uint16_t streamId, uint32_t ppid, const char *msg, size_t len);
+
 
 /**
  * webrtc交换sdp，根据offer sdp生成answer sdp
@@ -104,6 +109,62 @@ API_EXPORT void API_CALL mk_webrtc_list_room_keeper(on_mk_webrtc_room_keeper_dat
  */
 API_EXPORT void API_CALL mk_webrtc_list_rooms(on_mk_webrtc_room_keeper_data_cb cb);
 
+/**
+ * 向某个流的所有webrtc播放器广播datachannel消息，消息只拷贝一次并在所有播放器间共享
+ * 各播放器排队批量发送，发送缓存超过rtc.datachannel_max_buffer时丢弃该播放器的本条消息
+ * @param vhost 虚拟主机
+ * @param app 应用名
+ * @param stream 流id
+ * @param streamId datachannel stream id
+ * @param ppid 协议id, 51: 文本, 53: 二进制
+ * @param msg 数据
+ * @param len 数据长度
+ * @return 0: 已投递到该流的所有播放器(在各播放器的poller线程异步排队)，-1: 流不存在
+ * Broadcast a datachannel message to all webrtc players of a stream, the message is copied only once and shared among all players
+ * Each player queues and sends in batches, and drops this message when the send buffer exceeds rtc.datachannel_max_buffer
+ * @param vhost Virtual host
+ * @param app Application name
+ * @param stream Stream id
+ * @param streamId Datachannel stream id
+ * @param ppid Protocol id, 51: text, 53: binary
+ * @param msg Data
+ * @param len Data length
+ * @return 0: posted to all players of the stream (queued asynchronously in the poller thread of each player), -1: the stream does not exist
+ */
+API_EXPORT int API_CALL mk_webrtc_broadcast_datachannel(const char *vhost, const char *app, const char *stream, uint16_t streamId, uint32_t ppid, const char *msg, size_t len);
+
+/**
+ * 排队批量发送datachannel消息，可跨线程调用
+ * @param ctx webrtc连接对象
+ * @return 0: 成功, -1: 发送缓存已满(背压)，请稍后重试
+ * Queue the datachannel message for batched sending, can be called across threads
+ * @param ctx Webrtc transport object
+ * @return 0: success, -1: the send buffer is full (backpressure), please retry later
+ */
+API_EXPORT int API_CALL mk_rtc_send_datachannel2(const mk_rtc_transport ctx, uint16_t streamId, uint32_t ppid, const char *msg, size_t len);
+
+/**
+ * 获取datachannel发送缓存中尚未发送的字节数
+ * Get the number of bytes not yet sent in the datachannel send buffer
+ */
+API_EXPORT size_t API_CALL mk_rtc_get_datachannel_buffered_amount(const mk_rtc_transport ctx);
+
+/**
+ * 设置该连接的datachannel消息回调，直接回调不经过全局事件广播
+ * 回调在该连接的poller线程触发
+ * @param ctx webrtc连接对象
+ * @param cb 回调函数，置空则取消监听
+ * @param user_data 用户数据指针
+ * @param user_data_free 用户数据释放函数
+ * Set the datachannel message callback of this transport, called directly without the global event broadcast
+ * The callback is triggered in the poller thread of the transport
+ * @param ctx Webrtc transport object
+ * @param cb Callback function, set to null to cancel listening
+ * @param user_data User data pointer
+ * @param user_data_free User data free function
+ */
+API_EXPORT void API_CALL mk_rtc_set_on_datachannel_message(const mk_rtc_transport ctx, on_mk_rtc_datachannel_message cb, void *user_data, on_user_data_free user_data_free);
+
 #ifdef __cplusplus
 }
 #endif
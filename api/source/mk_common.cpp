@@ -266,11 +266,11 @@ API_EXPORT uint16_t API_CALL mk_rtc_server_start(uint16_t port) {
         // 创建rtc udp服务器  [AUTO-TRANSLATED:9287972e]
         // Create RTC UDP server
         rtcServer_udp = std::make_shared<UdpServer>();
-        rtcServer_udp->setOnCreateSocket([](const EventPoller::Ptr &poller, const Buffer::Ptr &buf, struct sockaddr *, int) {
+        rtcServer_udp->setOnCreateSocket([](const EventPoller::Ptr &poller, const Buffer::Ptr &buf, struct sockaddr *addr, int) {
             if (!buf) {
                 return Socket::createSocket(poller, false);
             }
-            auto new_poller = WebRtcSession::queryPoller(buf);
+            auto new_poller = WebRtcSession::queryPoller(buf, addr, poller);
             if (!new_poller) {
                 // 该数据对应的webrtc对象未找到，丢弃之  [AUTO-TRANSLATED:d401f8cb]
                 // The WebRTC object corresponding to this data was not found, discard it
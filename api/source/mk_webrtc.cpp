@@ -25,6 +25,8 @@
 #include "Http/HttpSession.h"
 #include "Shell/ShellSession.h"
 #include "Player/PlayerProxy.h"
+#include "Common/config.h"
+#include "Rtsp/RtspMediaSource.h"
 
 using namespace std;
 using namespace toolkit;
@@ -32,6 +34,8 @@ using namespace mediakit;
 
 #ifdef ENABLE_WEBRTC
 
+#include "webrtc/WebRtcTransport.h"
+#include "webrtc/WebRtcPlayer.h"
 #include "webrtc/WebRtcProxyPlayer.h"
 #include "webrtc/WebRtcProxyPlayerImp.h"
 #include "webrtc/WebRtcSignalingPeer.h"
@@ -188,3 +192,69 @@ API_EXPORT void API_CALL mk_webrtc_list_rooms(on_mk_webrtc_room_keeper_data_cb c
     WarnL << "未启用webrtc功能, 编译时请开启ENABLE_WEBRTC";
 #endif
 }
+
+API_EXPORT int API_CALL mk_webrtc_broadcast_datachannel(const char *vhost, const char *app, const char *stream, uint16_t streamId, uint32_t ppid, const char *msg, size_t len) {
+#ifdef ENABLE_WEBRTC
+    assert(vhost && app && stream && msg);
+    auto src = std::dynamic_pointer_cast<RtspMediaSource>(MediaSource::find(RTSP_SCHEMA, vhost, app, stream));
+    if (!src) {
+        return -1;
+    }
+    Buffer::Ptr buffer = std::make_shared<BufferLikeString>(std::string(msg, len));
+    return WebRtcPlayer::broadcastDatachannel(src, streamId, ppid, buffer) ? 0 : -1;
+#else
+    WarnL << "未启用webrtc功能, 编译时请开启ENABLE_WEBRTC";
+    return -1;
+#endif
+}
+
+API_EXPORT int API_CALL mk_rtc_send_datachannel2(const mk_rtc_transport ctx, uint16_t streamId, uint32_t ppid, const char *msg, size_t len) {
+#ifdef ENABLE_WEBRTC
+    assert(ctx && msg);
+    WebRtcTransport *transport = (WebRtcTransport *)ctx;
+    // 在调用线程原子预留发送缓存，投递到poller线程后不会再被丢弃
+    // Reserve the send buffer atomically in the calling thread, it will not be discarded after being delivered to the poller thread
+    if (!transport->tryReserveDatachannelBuffer(len)) {
+        return -1;
+    }
+    transport->sendReservedDatachannel(streamId, ppid, std::make_shared<BufferLikeString>(std::string(msg, len)));
+    return 0;
+#else
+    WarnL << "未启用webrtc功能, 编译时请开启ENABLE_WEBRTC";
+    return -1;
+#endif
+}
+
+API_EXPORT size_t API_CALL mk_rtc_get_datachannel_buffered_amount(const mk_rtc_transport ctx) {
+#ifdef ENABLE_WEBRTC
+    assert(ctx);
+    return ((WebRtcTransport *)ctx)->getDatachannelBufferedAmount();
+#else
+    return 0;
+#endif
+}
+
+API_EXPORT void API_CALL mk_rtc_set_on_datachannel_message(const mk_rtc_transport ctx, on_mk_rtc_datachannel_message cb, void *user_data, on_user_data_free user_data_free) {
+#ifdef ENABLE_WEBRTC
+    assert(ctx);
+    WebRtcTransport *transport = (WebRtcTransport *)ctx;
+    std::shared_ptr<void> ptr(user_data, user_data_free ? user_data_free : [](void *) {});
+    std::weak_ptr<WebRtcTransport> weak_trans = transport->shared_from_this();
+    transport->getPoller()->async([cb, ptr, weak_trans]() {
+        auto trans = weak_trans.lock();
+        if (!trans) {
+            return;
+        }
+        if (!cb) {
+            trans->setOnDatachannelMessage(nullptr);
+            return;
+        }
+        auto raw = trans.get();
+        trans->setOnDatachannelMessage([cb, ptr, raw](uint16_t streamId, uint32_t ppid, const uint8_t *msg, size_t len) {
+            cb(ptr.get(), (mk_rtc_transport)raw, streamId, ppid, (const char *)msg, len);
+        });
+    });
+#else
+    WarnL << "未启用webrtc功能, 编译时请开启ENABLE_WEBRTC";
+#endif
+}
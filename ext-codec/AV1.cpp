@@ -78,7 +78,7 @@ RtmpCodec::Ptr getRtmpDecoderByTrack(const Track::Ptr &track) {
 }
 
 Frame::Ptr getFrameFromPtr(const char *data, size_t bytes, uint64_t dts, uint64_t pts) {
-    return std::make_shared<AV1FrameNoCacheAble>((char *)data, bytes, dts, pts, 0);
+    return makeFrame<AV1FrameNoCacheAble>((char *)data, bytes, dts, pts, 0);
 }
 
 } // namespace
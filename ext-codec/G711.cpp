@@ -125,7 +125,7 @@ RtmpCodec::Ptr getRtmpDecoderByTrack(const Track::Ptr &track) {
 }
 
 Frame::Ptr getFrameFromPtr_l(CodecId codec, const char *data, size_t bytes, uint64_t dts, uint64_t pts) {
-    return std::make_shared<FrameFromPtr>(codec, (char *)data, bytes, dts, pts);
+    return makeFrame<FrameFromPtr>(codec, (char *)data, bytes, dts, pts);
 }
 
 Frame::Ptr getFrameFromPtrA(const char *data, size_t bytes, uint64_t dts, uint64_t pts) {
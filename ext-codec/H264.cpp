@@ -161,7 +161,7 @@ bool H264Track::inputFrame(const Frame::Ptr &frame) {
     // In the case of non-I/B/P frames, split it to prevent multiple frames from sticking together
     bool ret = false;
     splitH264(frame->data(), frame->size(), frame->prefixSize(), [&](const char *ptr, size_t len, size_t prefix) {
-        H264FrameInternal::Ptr sub_frame = std::make_shared<H264FrameInternal>(frame, (char *)ptr, len, prefix);
+        H264FrameInternal::Ptr sub_frame = makeFrame<H264FrameInternal>(frame, (char *)ptr, len, prefix);
         if (inputFrame_l(sub_frame)) {
             ret = true;
         }
@@ -220,7 +220,7 @@ void H264Track::setExtraData(const uint8_t *data, size_t bytes) {
         int size = mpeg4_avc_to_nalu(&avc, config.data(), bytes * 2);
         if (size > 4) {
             splitH264((char *)config.data(), size, 4, [&](const char *ptr, size_t len, size_t prefix) {
-                inputFrame_l(std::make_shared<H264FrameNoCacheAble>((char *)ptr, len, 0, 0, prefix));
+                inputFrame_l(makeFrame<H264FrameNoCacheAble>((char *)ptr, len, 0, 0, prefix));
             });
             update();
         }
@@ -285,7 +285,7 @@ bool H264Track::inputFrame_l(const Frame::Ptr &frame) {
             // Avoid not being able to recognize keyframes
             if (latestIsConfigFrame() && !frame->dropAble()) {
                 if (!frame->keyFrame()) {
-                    const_cast<Frame::Ptr &>(frame) = std::make_shared<FrameCacheAble>(frame, true);
+                    const_cast<Frame::Ptr &>(frame) = makeFrame<FrameCacheAble>(frame, true);
                 }
             }
             // 判断是否是I帧, 并且如果是,那判断前面是否插入过config帧, 如果插入过就不插入了  [AUTO-TRANSLATED:40733cd8]
@@ -411,7 +411,7 @@ RtmpCodec::Ptr getRtmpDecoderByTrack(const Track::Ptr &track) {
 }
 
 Frame::Ptr getFrameFromPtr(const char *data, size_t bytes, uint64_t dts, uint64_t pts) {
-    return std::make_shared<H264FrameNoCacheAble>((char *)data, bytes, dts, pts, prefixSize(data, bytes));
+    return makeFrame<H264FrameNoCacheAble>((char *)data, bytes, dts, pts, prefixSize(data, bytes));
 }
 
 } // namespace
@@ -97,7 +97,7 @@ bool H265Track::inputFrame(const Frame::Ptr &frame) {
     bool ret = false;
     splitH264(frame->data(), frame->size(), frame->prefixSize(), [&](const char *ptr, size_t len, size_t prefix) {
         using H265FrameInternal = FrameInternal<H265FrameNoCacheAble>;
-        H265FrameInternal::Ptr sub_frame = std::make_shared<H265FrameInternal>(frame, (char *) ptr, len, prefix);
+        H265FrameInternal::Ptr sub_frame = makeFrame<H265FrameInternal>(frame, (char *) ptr, len, prefix);
         if (inputFrame_l(sub_frame)) {
             ret = true;
         }
@@ -177,7 +177,7 @@ void H265Track::setExtraData(const uint8_t *data, size_t bytes) {
         int size = mpeg4_hevc_to_nalu(&hevc, config.data(), bytes * 2);
         if (size > 4) {
             splitH264((char *)config.data(), size, 4, [&](const char *ptr, size_t len, size_t prefix) {
-                inputFrame_l(std::make_shared<H265FrameNoCacheAble>((char *)ptr, len, 0, 0, prefix));
+                inputFrame_l(makeFrame<H265FrameNoCacheAble>((char *)ptr, len, 0, 0, prefix));
             });
             update();
         }
@@ -415,7 +415,7 @@ RtmpCodec::Ptr getRtmpDecoderByTrack(const Track::Ptr &track) {
 }
 
 Frame::Ptr getFrameFromPtr(const char *data, size_t bytes, uint64_t dts, uint64_t pts) {
-    return std::make_shared<H265FrameNoCacheAble>((char *)data, bytes, dts, pts, prefixSize(data, bytes));
+    return makeFrame<H265FrameNoCacheAble>((char *)data, bytes, dts, pts, prefixSize(data, bytes));
 }
 
 } // namespace
@@ -58,7 +58,7 @@ RtmpCodec::Ptr getRtmpDecoderByTrack(const Track::Ptr &track) {
 }
 
 Frame::Ptr getFrameFromPtr(const char *data, size_t bytes, uint64_t dts, uint64_t pts) {
-    return std::make_shared<FrameFromPtr>(CodecMP3, (char *)data, bytes, dts, pts);
+    return makeFrame<FrameFromPtr>(CodecMP3, (char *)data, bytes, dts, pts);
 }
 
 } // namespace
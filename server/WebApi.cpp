@@ -42,12 +42,14 @@
 
 #include "Common/config.h"
 #include "Common/MediaSource.h"
+#include "Common/JemallocUtil.h"
 #include "Http/HttpSession.h"
 #include "Http/HttpRequester.h"
 #include "Player/PlayerProxy.h"
 #include "Pusher/PusherProxy.h"
 #include "Rtp/RtpProcess.h"
 #include "Record/MP4Reader.h"
+#include "Rtsp/RtspSession.h"
 
 #if defined(ENABLE_RTPPROXY)
 #include "Rtp/RtpServer.h"
@@ -517,6 +519,9 @@ void getStatisticJson(const function<void(Value &val)> &cb) {
 
     val["RtpPacket"] = (Json::UInt64)(ObjectStatistic<RtpPacket>::count());
     val["RtmpPacket"] = (Json::UInt64)(ObjectStatistic<RtmpPacket>::count());
+#ifdef ENABLE_WEBRTC
+    WebRtcTransportManager::Instance().getDemuxStatistic(val["WebRtcDemux"]);
+#endif
 #ifdef ENABLE_MEM_DEBUG
     auto bytes = getTotalMemUsage();
     val["totalMemUsage"] = (Json::UInt64) bytes;
@@ -579,6 +584,48 @@ void getStatisticJson(const function<void(Value &val)> &cb) {
 #endif
 }
 
+static void getAllocatorStatisticJson(const function<void(Value &val)> &cb) {
+    auto obj = std::make_shared<Value>(objectValue);
+    auto &val = *obj;
+    val["pollerArena"] = mINI::Instance()[General::kPollerArena].as<bool>();
+    val["arenas"] = Value(arrayValue);
+    JemallocUtil::get_arena_stats([&](const JemallocUtil::ArenaStats &stats) {
+        Value item;
+        item["arena"] = stats.index;
+        item["threads"] = (Json::UInt64)stats.threads;
+        item["activeBytes"] = (Json::UInt64)stats.active_bytes;
+        item["dirtyBytes"] = (Json::UInt64)stats.dirty_bytes;
+        item["residentBytes"] = (Json::UInt64)stats.resident_bytes;
+        item["smallAllocated"] = (Json::UInt64)stats.small_allocated;
+        item["smallMalloc"] = (Json::UInt64)stats.small_nmalloc;
+        item["smallFree"] = (Json::UInt64)stats.small_ndalloc;
+        item["largeAllocated"] = (Json::UInt64)stats.large_allocated;
+        item["largeMalloc"] = (Json::UInt64)stats.large_nmalloc;
+        item["largeFree"] = (Json::UInt64)stats.large_ndalloc;
+        item["binLockWait"] = (Json::UInt64)stats.bin_lock_wait;
+        val["arenas"].append(item);
+    });
+
+    // 在各poller线程中获取其使用的arena
+    // Get the arena used by each poller thread in its own thread
+    auto thread_arena = std::make_shared<vector<Value>>(EventPollerPool::Instance().getExecutorSize());
+    shared_ptr<void> finished(nullptr, [thread_arena, cb, obj](void *) {
+        (*obj)["threads"] = Value(arrayValue);
+        for (auto &val : *thread_arena) {
+            (*obj)["threads"].append(val);
+        }
+        cb(*obj);
+    });
+    auto pos = 0;
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        auto &val = (*thread_arena)[pos++];
+        executor->async([finished, &val]() {
+            val["threadName"] = getThreadName();
+            val["arena"] = JemallocUtil::get_thread_arena();
+        });
+    });
+}
+
 void addStreamProxy(const MediaTuple &tuple, const string &url, int retry_count,
                     const ProtocolOption &option, int rtp_type, float timeout_sec, const mINI &args,
                     const function<void(const SockException &ex, const string &key)> &cb) {
@@ -986,6 +1033,19 @@ void installWebApi() {
         }
         Any any;
         Buffer::Ptr buffer = std::make_shared<BufferLikeString>(allArgs["msg"]);
+#ifdef ENABLE_WEBRTC
+        if (!allArgs["stream_id"].empty() || !allArgs["ppid"].empty()) {
+            // 指定了datachannel stream id或ppid
+            // The datachannel stream id or ppid is specified
+            WebRtcDatachannelMessage msg;
+            msg.stream_id = allArgs["stream_id"].empty() ? 0 : allArgs["stream_id"].as<uint16_t>();
+            msg.ppid = allArgs["ppid"].empty() ? 51 : allArgs["ppid"].as<uint32_t>();
+            msg.data = std::move(buffer);
+            any.set<WebRtcDatachannelMessage>(std::move(msg));
+            src->broadcastMessage(any);
+            return;
+        }
+#endif
         any.set(std::move(buffer));
         src->broadcastMessage(any);
     });
@@ -1080,6 +1140,16 @@ void installWebApi() {
             fillSockInfo(jsession, session.get());
             jsession["id"] = id;
             jsession["typeid"] = toolkit::demangle(typeid(*session).name());
+            jsession.removeMember("rtpTcpSend");
+            if (auto rtsp = dynamic_pointer_cast<RtspSession>(session)) {
+                // rtsp over tcp播放的发送调用次数、rtp个数与发送缓存满次数
+                // The number of send calls, rtp and full send buffer times of rtsp over tcp playback
+                if (auto calls = rtsp->getTcpSendCalls()) {
+                    jsession["rtpTcpSend"]["calls"] = (Json::UInt64)calls;
+                    jsession["rtpTcpSend"]["packets"] = (Json::UInt64)rtsp->getTcpSendPackets();
+                    jsession["rtpTcpSend"]["blocked"] = (Json::UInt64)rtsp->getTcpSendBlocked();
+                }
+            }
             val["data"].append(jsession);
         });
     });
@@ -1333,7 +1403,7 @@ void installWebApi() {
     });
 
 #if defined(ENABLE_RTPPROXY)
-    api_regist("/index/api/getRtpInfo",[](API_ARGS_MAP){
+    api_regist("/index/api/getRtpInfo",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
         CHECK_ARGS("stream_id");
         std::string vhost = DEFAULT_VHOST;
@@ -1348,10 +1418,28 @@ void installWebApi() {
         auto process = src ? src->getRtpProcess() : nullptr;
         if (!process) {
             val["exist"] = false;
+            invoker(200, headerOut, val.toStyledString());
             return;
         }
-        val["exist"] = true;
-        fillSockInfo(val, process.get());
+        // 在归属线程获取抖动与去抖动缓存状态
+        // Get the jitter and de-jitter buffer status in the owner thread
+        src->getOwnerPoller()->async([=]() mutable {
+            val["exist"] = true;
+            fillSockInfo(val, process.get());
+            val["jitter_ms"] = process->getJitterMS();
+            if (auto &jitter_buffer = process->getJitterBuffer()) {
+                auto statistic = jitter_buffer->getStatistic();
+                auto &obj = val["jitter_buffer"];
+                obj["delay_ms"] = statistic.delay_ms;
+                obj["target_ms"] = statistic.target_ms;
+                obj["max_delay_ms"] = statistic.max_delay_ms;
+                obj["cached_frames"] = (Json::UInt64)statistic.cached_frames;
+                obj["output_frames"] = (Json::UInt64)statistic.output_frames;
+                obj["late_frames"] = (Json::UInt64)statistic.late_frames;
+                obj["resync_count"] = (Json::UInt64)statistic.resync_count;
+            }
+            invoker(200, headerOut, val.toStyledString());
+        });
     });
 
     api_regist("/index/api/openRtpServer",[](API_ARGS_MAP){
@@ -1636,6 +1724,17 @@ void installWebApi() {
                 val["data"].append(ssrc);
                 val["bytesSpeed"] = (Json::UInt64)sender.getSendSpeed();
                 val["totalBytes"] = (Json::UInt64)sender.getSendTotalBytes();
+                // ps透传转发时省去复用的帧数
+                // Number of frames whose remuxing was saved by ps passthrough forwarding
+                val["passthrough"] = sender.isPassthrough();
+                val["passthroughBytes"] = (Json::UInt64)sender.getPassthroughBytes();
+                val["passthroughFrames"] = (Json::UInt64)sender.getPassthroughFrames();
+                // 估算省去的cpu时间(毫秒)
+                // Estimated cpu time saved (milliseconds)
+                val["passthroughCpuSavedMS"] = (Json::UInt64)sender.getPassthroughCpuSavedMS();
+                // 共用一份打包输出的发送目标: {"ps/96/mtu1400": ["ssrc1", "ssrc2"]}
+                // Sending targets sharing one packing output: {"ps/96/mtu1400": ["ssrc1", "ssrc2"]}
+                val["groups"][sender.getGroupKey()].append(ssrc);
             });
             invoker(200, headerOut, val.toStyledString());
         });
@@ -1776,7 +1875,12 @@ void installWebApi() {
 
     api_regist("/index/api/seekRecordStamp", [](API_ARGS_MAP_ASYNC) {
         CHECK_SECRET();
-        CHECK_ARGS("schema", "vhost", "app", "stream", "stamp");
+        CHECK_ARGS("schema", "vhost", "app", "stream");
+        // stamp为时间轴位置(毫秒)；wall_clock为录制时的unix时间戳(毫秒)，仅对mp4录像点播有效
+        // stamp is the timeline position (milliseconds); wall_clock is the unix timestamp (milliseconds) at recording time, only valid for mp4 recording on demand
+        if (allArgs["stamp"].empty() && allArgs["wall_clock"].empty()) {
+            throw InvalidArgsException("Required parameter missed: stamp or wall_clock");
+        }
         auto src = MediaSource::find(allArgs["schema"],
                                      allArgs["vhost"],
                                      allArgs["app"],
@@ -1786,7 +1890,39 @@ void installWebApi() {
         }
 
         auto stamp = allArgs["stamp"].as<size_t>();
+        auto wall_clock = allArgs["wall_clock"].as<uint64_t>();
         src->getOwnerPoller()->async([=]() mutable {
+#if defined(ENABLE_MP4)
+            if (wall_clock) {
+                auto muxer = dynamic_pointer_cast<MediaSourceEventInterceptor>(src->getListener().lock());
+                auto reader = muxer ? dynamic_pointer_cast<MP4Reader>(muxer->getDelegate()) : nullptr;
+                if (!reader) {
+                    val["code"] = API::OtherFailed;
+                    val["msg"] = "wall_clock is only supported by mp4 recording on demand";
+                    invoker(200, headerOut, val.toStyledString());
+                    return;
+                }
+                // 等后台线程解析完所有文件的时长后再换算，不阻塞读取线程
+                // Convert after the background thread parses the durations of all files, without blocking the reading thread
+                auto demuxer = reader->getDemuxer();
+                demuxer->whenResolved([=]() mutable {
+                    uint64_t stamp_ms = 0;
+                    if (!demuxer->getStampByWallClock(wall_clock, stamp_ms)) {
+                        val["code"] = API::OtherFailed;
+                        val["msg"] = "wall_clock is out of the recording range";
+                        invoker(200, headerOut, val.toStyledString());
+                        return;
+                    }
+                    val["stamp"] = (Json::UInt64)stamp_ms;
+                    bool flag = src->seekTo(stamp_ms);
+                    val["result"] = flag ? 0 : -1;
+                    val["msg"] = flag ? "success" : "seek failed";
+                    val["code"] = flag ? API::Success : API::OtherFailed;
+                    invoker(200, headerOut, val.toStyledString());
+                });
+                return;
+            }
+#endif
             bool flag = src->seekTo(stamp);
             val["result"] = flag ? 0 : -1;
             val["msg"] = flag ? "success" : "seek failed";
@@ -2071,6 +2207,16 @@ void installWebApi() {
         });
     });
 
+    // 获取jemalloc各arena的内存统计以及各poller线程使用的arena
+    // Get the memory statistics of each jemalloc arena and the arena used by each poller thread
+    api_regist("/index/api/getAllocatorStatistic",[](API_ARGS_MAP_ASYNC){
+        CHECK_SECRET();
+        getAllocatorStatisticJson([headerOut, val, invoker](const Value &data) mutable{
+            val["data"] = data;
+            invoker(200, headerOut, val.toStyledString());
+        });
+    });
+
 #ifdef ENABLE_WEBRTC
     api_regist("/index/api/webrtc",[](API_ARGS_STRING_ASYNC){
         CHECK_ARGS("type");
@@ -2248,7 +2394,7 @@ void installWebApi() {
 #endif
 
 #if ENABLE_MP4
-    api_regist("/index/api/loadMP4File", [](API_ARGS_MAP) {
+    api_regist("/index/api/loadMP4File", [](API_ARGS_MAP_ASYNC) {
         CHECK_SECRET();
         CHECK_ARGS("vhost", "app", "stream", "file_path");
 
@@ -2283,7 +2429,15 @@ void installWebApi() {
                 }
             });
         }
-        val["data"]["duration_ms"] = (Json::UInt64)reader->getDemuxer()->getDurationMS();
+        // 后台线程解析完所有文件的时长后再在读取线程回复总时长，不阻塞读取线程
+        // Reply the total duration in the reading thread after the background thread parses the durations of all files, without blocking the reading thread
+        auto demuxer = reader->getDemuxer();
+        reader->getOwnerPoller(MediaSource::NullMediaSource())->async([demuxer, invoker, headerOut, val]() mutable {
+            demuxer->whenResolved([demuxer, invoker, headerOut, val]() mutable {
+                val["data"]["duration_ms"] = (Json::UInt64)demuxer->getDurationMS();
+                invoker(200, headerOut, val.toStyledString());
+            });
+        });
     });
 #endif
 
@@ -19,6 +19,8 @@
 #include "Network/UdpServer.h"
 #include "Poller/EventPoller.h"
 #include "Common/config.h"
+#include "Common/KTls.h"
+#include "Common/JemallocUtil.h"
 #include "Rtsp/RtspSession.h"
 #include "Rtmp/RtmpSession.h"
 #include "Shell/ShellSession.h"
@@ -218,6 +220,21 @@ string g_ini_file;
 // 加载ssl证书函数对象
 std::function<void()> g_reload_certificates;
 
+// 开启kTLS时，同时把证书加载到kTLS专用的ssl上下文
+// When kTLS is enabled, also load the certificates into the ssl context dedicated to kTLS
+static void reloadKTlsCertificates(const vector<string> &files) {
+    GET_CONFIG(bool, enable_ktls, General::kEnableKTls);
+    if (!enable_ktls) {
+        return;
+    }
+    if (!KTls::isSupported()) {
+        WarnL << "Kernel tls is not supported, fallback to user mode tls";
+        return;
+    }
+    auto count = KTls::setCertificates(files);
+    InfoL << "Kernel tls certificates loaded: " << count << "/" << files.size();
+}
+
 int start_main(int argc,char *argv[]) {
     {
         CMD_main cmd_main;
@@ -290,19 +307,23 @@ int start_main(int argc,char *argv[]) {
             // Not a folder, load certificate, certificate contains public key and private key
             g_reload_certificates = [ssl_file] () {
                 SSL_Initor::Instance().loadCertificate(ssl_file.data());
+                reloadKTlsCertificates({ ssl_file });
             };
         } else {
             // 加载文件夹下的所有证书  [AUTO-TRANSLATED:0e1f9b20]
             // Load all certificates under the folder
             g_reload_certificates = [ssl_file]() {
-                File::scanDir(ssl_file, [](const string &path, bool isDir) {
+                vector<string> files;
+                File::scanDir(ssl_file, [&](const string &path, bool isDir) {
                     if (!isDir) {
                         // 最后的一个证书会当做默认证书(客户端ssl握手时未指定主机)  [AUTO-TRANSLATED:b242685c]
                         // The last certificate will be used as the default certificate (client ssl handshake does not specify the host)
                         SSL_Initor::Instance().loadCertificate(path.data());
+                        files.emplace_back(path);
                     }
                     return true;
                 });
+                reloadKTlsCertificates(files);
             };
         }
         g_reload_certificates();
@@ -326,6 +347,17 @@ int start_main(int argc,char *argv[]) {
         WorkThreadPool::setPoolSize(threads);
         EventPollerPool::enableCpuAffinity(affinity);
 
+        if (mINI::Instance()[General::kPollerArena].as<bool>()) {
+            // 每个poller线程绑定独立的jemalloc arena
+            // Bind an independent jemalloc arena for each poller thread
+            EventPollerPool::Instance().for_each([](const TaskExecutor::Ptr &executor) {
+                executor->async([]() {
+                    auto arena = JemallocUtil::bind_thread_arena();
+                    InfoL << "Bind poller thread " << getThreadName() << " to jemalloc arena: " << arena;
+                });
+            });
+        }
+
         // 简单的telnet服务器，可用于服务器调试，但是不能使用23端口，否则telnet上了莫名其妙的现象  [AUTO-TRANSLATED:f9324c6e]
         // Simple telnet server, can be used for server debugging, but cannot use port 23, otherwise telnet will have inexplicable phenomena
         // 测试方法:telnet 127.0.0.1 9000  [AUTO-TRANSLATED:de0ac883]
@@ -358,11 +390,11 @@ int start_main(int argc,char *argv[]) {
         // webrtc udp服务器  [AUTO-TRANSLATED:157a64e5]
         // webrtc udp server
         auto rtcSrv_udp = std::make_shared<UdpServer>();
-        rtcSrv_udp->setOnCreateSocket([](const EventPoller::Ptr &poller, const Buffer::Ptr &buf, struct sockaddr *, int) {
+        rtcSrv_udp->setOnCreateSocket([](const EventPoller::Ptr &poller, const Buffer::Ptr &buf, struct sockaddr *addr, int) {
             if (!buf) {
                 return Socket::createSocket(poller, false);
             }
-            auto new_poller = WebRtcSession::queryPoller(buf);
+            auto new_poller = WebRtcSession::queryPoller(buf, addr, poller);
             if (!new_poller) {
                 // 该数据对应的webrtc对象未找到，丢弃之  [AUTO-TRANSLATED:d401f8cb]
                 // The webrtc object corresponding to this data is not found, discard it
@@ -413,21 +445,39 @@ int start_main(int argc,char *argv[]) {
             if (rtspPort) { rtspSrv->start<RtspSession>(rtspPort, listen_ip); }
             // rtsps服务器，端口默认322  [AUTO-TRANSLATED:e8a9fd71]
             // rtsps server, default port 322
-            if (rtspsPort) { rtspSSLSrv->start<RtspSessionWithSSL>(rtspsPort, listen_ip); }
+            if (rtspsPort) {
+                if (KTls::isEnabled()) {
+                    rtspSSLSrv->start<SessionWithKTls<RtspSession> >(rtspsPort, listen_ip);
+                } else {
+                    rtspSSLSrv->start<RtspSessionWithSSL>(rtspsPort, listen_ip);
+                }
+            }
 
             // rtmp服务器，端口默认1935  [AUTO-TRANSLATED:58324c74]
             // rtmp server, default port 1935
             if (rtmpPort) { rtmpSrv->start<RtmpSession>(rtmpPort, listen_ip); }
             // rtmps服务器，端口默认19350  [AUTO-TRANSLATED:c565ff4e]
             // rtmps server, default port 19350
-            if (rtmpsPort) { rtmpsSrv->start<RtmpSessionWithSSL>(rtmpsPort, listen_ip); }
+            if (rtmpsPort) {
+                if (KTls::isEnabled()) {
+                    rtmpsSrv->start<SessionWithKTls<RtmpSession> >(rtmpsPort, listen_ip);
+                } else {
+                    rtmpsSrv->start<RtmpSessionWithSSL>(rtmpsPort, listen_ip);
+                }
+            }
 
             // http服务器，端口默认80  [AUTO-TRANSLATED:8899e852]
             // http server, default port 80
             if (httpPort) { httpSrv->start<HttpSession>(httpPort, listen_ip); }
             // https服务器，端口默认443  [AUTO-TRANSLATED:24999616]
             // https server, default port 443
-            if (httpsPort) { httpsSrv->start<HttpsSession>(httpsPort, listen_ip); }
+            if (httpsPort) {
+                if (KTls::isEnabled()) {
+                    httpsSrv->start<SessionWithKTls<HttpSession> >(httpsPort, listen_ip);
+                } else {
+                    httpsSrv->start<HttpsSession>(httpsPort, listen_ip);
+                }
+            }
 
             // telnet远程调试服务器  [AUTO-TRANSLATED:577cb7cf]
             // telnet remote debug server
@@ -73,4 +73,108 @@ void JemallocUtil::some_malloc_stats(const std::function<void(const char *, uint
     }
 #endif
 }
+
+#ifdef USE_JEMALLOC
+template <typename T>
+static bool read_mallctl(const std::string &name, T &value) {
+    size_t len = sizeof(value);
+    return mallctl(name.data(), &value, &len, nullptr, 0) == 0;
+}
+#endif
+
+int JemallocUtil::bind_thread_arena() {
+#ifdef USE_JEMALLOC
+    static thread_local int s_arena = -1;
+    if (s_arena != -1) {
+        return s_arena;
+    }
+    unsigned arena = 0;
+    if (!read_mallctl("arenas.create", arena)) {
+        WarnL << "Create jemalloc arena failed";
+        return -1;
+    }
+    auto err = mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+    if (err != 0) {
+        WarnL << "Bind jemalloc arena " << arena << " failed: " << err;
+        return -1;
+    }
+    // 线程缓存中还留有旧arena的内存块，归还后线程缓存只缓存本arena的内存
+    // There are still memory blocks of the old arena in the thread cache, after returning them, the thread cache only caches the memory of this arena
+    mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+    s_arena = (int)arena;
+    return s_arena;
+#else
+    return -1;
+#endif
+}
+
+int JemallocUtil::get_thread_arena() {
+#ifdef USE_JEMALLOC
+    unsigned arena = 0;
+    if (!read_mallctl("thread.arena", arena)) {
+        return -1;
+    }
+    return (int)arena;
+#else
+    return -1;
+#endif
+}
+
+void JemallocUtil::get_arena_stats(const std::function<void(const ArenaStats &)> &fn) {
+#ifdef USE_JEMALLOC
+    // 刷新统计数据缓存
+    // Refresh the statistics cache
+    uint64_t epoch = 1;
+    size_t len = sizeof(epoch);
+    mallctl("epoch", &epoch, &len, &epoch, len);
+
+    unsigned narenas = 0;
+    unsigned nbins = 0;
+    size_t page = 4096;
+    if (!read_mallctl("arenas.narenas", narenas)) {
+        return;
+    }
+    read_mallctl("arenas.nbins", nbins);
+    read_mallctl("arenas.page", page);
+
+    for (unsigned i = 0; i < narenas; ++i) {
+        bool initialized = false;
+        if (!read_mallctl("arena." + std::to_string(i) + ".initialized", initialized) || !initialized) {
+            continue;
+        }
+        auto prefix = "stats.arenas." + std::to_string(i) + ".";
+        unsigned nthreads = 0;
+        if (!read_mallctl(prefix + "nthreads", nthreads)) {
+            // 未开启统计功能
+            // Statistics are not enabled
+            return;
+        }
+        size_t pactive = 0, pdirty = 0, resident = 0, small_allocated = 0, large_allocated = 0;
+        ArenaStats stats;
+        stats.index = i;
+        stats.threads = nthreads;
+        read_mallctl(prefix + "pactive", pactive);
+        read_mallctl(prefix + "pdirty", pdirty);
+        read_mallctl(prefix + "resident", resident);
+        read_mallctl(prefix + "small.allocated", small_allocated);
+        read_mallctl(prefix + "small.nmalloc", stats.small_nmalloc);
+        read_mallctl(prefix + "small.ndalloc", stats.small_ndalloc);
+        read_mallctl(prefix + "large.allocated", large_allocated);
+        read_mallctl(prefix + "large.nmalloc", stats.large_nmalloc);
+        read_mallctl(prefix + "large.ndalloc", stats.large_ndalloc);
+        stats.active_bytes = (uint64_t)pactive * page;
+        stats.dirty_bytes = (uint64_t)pdirty * page;
+        stats.resident_bytes = resident;
+        stats.small_allocated = small_allocated;
+        stats.large_allocated = large_allocated;
+        for (unsigned bin = 0; bin < nbins; ++bin) {
+            uint64_t num_wait = 0;
+            if (read_mallctl(prefix + "bins." + std::to_string(bin) + ".mutex.num_wait", num_wait)) {
+                stats.bin_lock_wait += num_wait;
+            }
+        }
+        fn(stats);
+    }
+#endif
+}
 } // namespace mediakit
\ No newline at end of file
@@ -23,6 +23,47 @@ public:
     static void dump(const std::string &file_name);
     static std::string get_malloc_stats();
     static void some_malloc_stats(const std::function<void(const char *, uint64_t)> &fn);
+
+    /**
+     * 为当前线程创建并绑定独立的arena，同一线程重复调用返回已绑定的arena
+     * 只隔离本线程的分配；其他线程释放本线程分配的内存时仍需获取本arena的bin锁，跨线程释放的竞争不会因此消失
+     * 返回arena编号，未启用jemalloc或者失败时返回-1
+     * Create and bind an independent arena for the current thread, repeated calls in the same thread return the bound arena
+     * Only the allocations of this thread are isolated; other threads freeing memory allocated by this thread still take the bin lock of this arena, so the contention of cross-thread frees does not go away
+     * Return the arena index, return -1 if jemalloc is not enabled or failed
+     */
+    static int bind_thread_arena();
+
+    /**
+     * 获取当前线程正在使用的arena编号，未启用jemalloc时返回-1
+     * Get the arena index currently used by the current thread, return -1 if jemalloc is not enabled
+     */
+    static int get_thread_arena();
+
+    struct ArenaStats {
+        unsigned index = 0;
+        // 绑定该arena的线程数
+        // Number of threads bound to this arena
+        uint64_t threads = 0;
+        uint64_t active_bytes = 0;
+        uint64_t dirty_bytes = 0;
+        uint64_t resident_bytes = 0;
+        uint64_t small_allocated = 0;
+        uint64_t small_nmalloc = 0;
+        uint64_t small_ndalloc = 0;
+        uint64_t large_allocated = 0;
+        uint64_t large_nmalloc = 0;
+        uint64_t large_ndalloc = 0;
+        // 小内存bin锁的等待次数，跨线程释放越多竞争越激烈
+        // Wait times of the small memory bin locks, the more cross-thread frees, the more intense the contention
+        uint64_t bin_lock_wait = 0;
+    };
+
+    /**
+     * 遍历已初始化的arena的统计信息，jemalloc编译时未开启统计功能时不回调
+     * Traverse the statistics of the initialized arenas, no callback if jemalloc is compiled without statistics
+     */
+    static void get_arena_stats(const std::function<void(const ArenaStats &)> &fn);
 };
 } // namespace mediakit
 #endif // ZLMEDIAKIT_JEMALLOCUTIL_H
@@ -0,0 +1,550 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <mutex>
+#include <cstring>
+#include <stdexcept>
+#include "KTls.h"
+#include "Common/config.h"
+#include "Util/logger.h"
+#include "Util/onceToken.h"
+
+#if defined(ENABLE_OPENSSL)
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/pkcs12.h>
+#include <openssl/x509v3.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#endif
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__) && defined(TLS_TX) && defined(TLS_RX)
+#define ENABLE_KTLS
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+#if defined(ENABLE_OPENSSL)
+
+static mutex s_ctx_mtx;
+// 最后一个为默认证书
+// The last one is the default certificate
+static vector<std::shared_ptr<SSL_CTX>> s_ctx_list;
+
+static string getSSLError() {
+    auto err = ERR_get_error();
+    if (!err) {
+        return "unknown error";
+    }
+    char buf[256] = { 0 };
+    ERR_error_string_n(err, buf, sizeof(buf));
+    return buf;
+}
+
+static int onServerName(SSL *ssl, int *, void *) {
+    auto host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (!host) {
+        return SSL_TLSEXT_ERR_OK;
+    }
+    lock_guard<mutex> lck(s_ctx_mtx);
+    for (auto it = s_ctx_list.rbegin(); it != s_ctx_list.rend(); ++it) {
+        auto cert = SSL_CTX_get0_certificate(it->get());
+        if (cert && X509_check_host(cert, host, 0, 0, nullptr) == 1) {
+            SSL_set_SSL_CTX(ssl, it->get());
+            break;
+        }
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+static bool loadPem(SSL_CTX *ctx, const string &file) {
+    return SSL_CTX_use_certificate_chain_file(ctx, file.data()) == 1 && SSL_CTX_use_PrivateKey_file(ctx, file.data(), SSL_FILETYPE_PEM) == 1;
+}
+
+static bool loadP12(SSL_CTX *ctx, const string &file, const string &password) {
+    std::shared_ptr<FILE> fp(fopen(file.data(), "rb"), [](FILE *fp) {
+        if (fp) {
+            fclose(fp);
+        }
+    });
+    if (!fp) {
+        return false;
+    }
+    std::shared_ptr<PKCS12> p12(d2i_PKCS12_fp(fp.get(), nullptr), PKCS12_free);
+    if (!p12) {
+        return false;
+    }
+    EVP_PKEY *pkey = nullptr;
+    X509 *cert = nullptr;
+    STACK_OF(X509) *ca = nullptr;
+    if (PKCS12_parse(p12.get(), password.data(), &pkey, &cert, &ca) != 1) {
+        return false;
+    }
+    bool ret = SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, pkey) == 1;
+    while (ret && ca && sk_X509_num(ca) > 0) {
+        // SSL_CTX_add_extra_chain_cert会接管证书所有权
+        // SSL_CTX_add_extra_chain_cert takes ownership of the certificate
+        auto chain = sk_X509_shift(ca);
+        if (SSL_CTX_add_extra_chain_cert(ctx, chain) != 1) {
+            X509_free(chain);
+            ret = false;
+        }
+    }
+    sk_X509_pop_free(ca, X509_free);
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+    return ret;
+}
+
+static std::shared_ptr<SSL_CTX> makeContext(const string &file, const string &password) {
+    std::shared_ptr<SSL_CTX> ctx(SSL_CTX_new(TLS_server_method()), SSL_CTX_free);
+    if (!ctx) {
+        return nullptr;
+    }
+    if (!loadPem(ctx.get(), file)) {
+        ERR_clear_error();
+        if (!loadP12(ctx.get(), file, password)) {
+            WarnL << "Load certificate failed: " << file << ", " << getSSLError();
+            return nullptr;
+        }
+    }
+    if (SSL_CTX_check_private_key(ctx.get()) != 1) {
+        WarnL << "Certificate and private key mismatch: " << file;
+        return nullptr;
+    }
+    SSL_CTX_set_min_proto_version(ctx.get(), TLS1_2_VERSION);
+    // 内核只支持AES-GCM，优先协商AES-GCM；禁止重协商，确保安装密钥后会话密钥不变
+    // The kernel only supports AES-GCM, prefer to negotiate AES-GCM; renegotiation is forbidden to ensure the session keys do not change after installation
+    SSL_CTX_set_options(ctx.get(), SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_RENEGOTIATION);
+    SSL_CTX_set_cipher_list(ctx.get(), "ECDHE+AESGCM:ECDHE+CHACHA20:DHE+AESGCM:HIGH:!aNULL:!MD5:!RC4");
+    SSL_CTX_set_ciphersuites(ctx.get(), "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256");
+    SSL_CTX_set_tlsext_servername_callback(ctx.get(), onServerName);
+    return ctx;
+}
+
+size_t KTls::setCertificates(const vector<string> &files, const string &password) {
+    vector<std::shared_ptr<SSL_CTX>> ctx_list;
+    for (auto &file : files) {
+        auto ctx = makeContext(file, password);
+        if (ctx) {
+            ctx_list.emplace_back(std::move(ctx));
+        }
+    }
+    lock_guard<mutex> lck(s_ctx_mtx);
+    s_ctx_list.swap(ctx_list);
+    return s_ctx_list.size();
+}
+
+std::shared_ptr<SSL> KTls::makeSSL() {
+    std::shared_ptr<SSL_CTX> ctx;
+    {
+        lock_guard<mutex> lck(s_ctx_mtx);
+        if (s_ctx_list.empty()) {
+            return nullptr;
+        }
+        ctx = s_ctx_list.back();
+    }
+    std::shared_ptr<SSL> ssl(SSL_new(ctx.get()), SSL_free);
+    if (!ssl) {
+        return nullptr;
+    }
+    SSL_set_accept_state(ssl.get());
+    return ssl;
+}
+
+#else
+
+size_t KTls::setCertificates(const vector<string> &files, const string &password) {
+    return 0;
+}
+
+std::shared_ptr<SSL> KTls::makeSSL() {
+    return nullptr;
+}
+
+#endif // defined(ENABLE_OPENSSL)
+
+#if defined(ENABLE_KTLS)
+
+// 安装到内核的单向密钥信息
+// One-way key information installed into the kernel
+struct KTlsKeyInfo {
+    int version = 0;
+    string key;
+    // 隐式iv(4字节)
+    // Implicit iv (4 bytes)
+    string salt;
+    // 显式iv(8字节)
+    // Explicit iv (8 bytes)
+    string iv;
+    uint64_t seq = 0;
+
+    ~KTlsKeyInfo() {
+        OPENSSL_cleanse((void *)key.data(), key.size());
+        OPENSSL_cleanse((void *)salt.data(), salt.size());
+        OPENSSL_cleanse((void *)iv.data(), iv.size());
+    }
+};
+
+static void setBE64(char *ptr, uint64_t val) {
+    for (int i = 7; i >= 0; --i) {
+        ptr[i] = (char)(val & 0xFF);
+        val >>= 8;
+    }
+}
+
+// rfc5246 6.3 key_block = PRF(master_secret, "key expansion", server_random + client_random)
+static bool tls12KeyBlock(const EVP_MD *md, SSL *ssl, size_t out_len, string &out) {
+    unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+    auto master_len = SSL_SESSION_get_master_key(SSL_get_session(ssl), master, sizeof(master));
+    string seed = "key expansion";
+    seed.resize(seed.size() + 2 * SSL3_RANDOM_SIZE);
+    SSL_get_server_random(ssl, (unsigned char *)&seed[seed.size() - 2 * SSL3_RANDOM_SIZE], SSL3_RANDOM_SIZE);
+    SSL_get_client_random(ssl, (unsigned char *)&seed[seed.size() - SSL3_RANDOM_SIZE], SSL3_RANDOM_SIZE);
+
+    std::shared_ptr<EVP_PKEY_CTX> ctx(EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr), EVP_PKEY_CTX_free);
+    out.resize(out_len);
+    size_t len = out_len;
+    auto ret = master_len > 0 && ctx && EVP_PKEY_derive_init(ctx.get()) > 0 && EVP_PKEY_CTX_set_tls1_prf_md(ctx.get(), md) > 0
+        && EVP_PKEY_CTX_set1_tls1_prf_secret(ctx.get(), master, (int)master_len) > 0
+        && EVP_PKEY_CTX_add1_tls1_prf_seed(ctx.get(), (unsigned char *)seed.data(), (int)seed.size()) > 0
+        && EVP_PKEY_derive(ctx.get(), (unsigned char *)&out[0], &len) > 0 && len == out_len;
+    OPENSSL_cleanse(master, sizeof(master));
+    return ret;
+}
+
+// 获取服务器tx或rx方向的密钥，握手刚结束时tls1.2双方的Finished都已经占用序号0
+// Get the key of the server tx or rx direction, when the handshake has just ended the Finished of both sides of tls1.2 have occupied sequence 0
+// 只支持tls1.2：tls1.3的KeyUpdate会更换密钥，而KeyUpdate等控制记录需要通过recvmsg的cmsg收发，toolkit的socket读写无法处理
+// Only tls1.2 is supported: KeyUpdate of tls1.3 changes the keys, and control records such as KeyUpdate must be sent and received through
+// recvmsg cmsg, which the toolkit socket reads and writes cannot handle
+static bool getKeyInfo(SSL *ssl, bool tx, KTlsKeyInfo &info) {
+    auto cipher = SSL_get_current_cipher(ssl);
+    if (!cipher) {
+        return false;
+    }
+    size_t key_len;
+    switch (SSL_CIPHER_get_cipher_nid(cipher)) {
+        case NID_aes_128_gcm: key_len = 16; break;
+        case NID_aes_256_gcm: key_len = 32; break;
+        default: return false;
+    }
+    auto md = SSL_CIPHER_get_handshake_digest(cipher);
+    if (!md) {
+        return false;
+    }
+
+    info.version = SSL_version(ssl);
+    if (info.version != TLS1_2_VERSION) {
+        return false;
+    }
+    // client_write_key + server_write_key + client_write_iv(4) + server_write_iv(4)
+    string key_block;
+    if (!tls12KeyBlock(md, ssl, 2 * key_len + 8, key_block)) {
+        return false;
+    }
+    info.key = key_block.substr(tx ? key_len : 0, key_len);
+    info.salt = key_block.substr(2 * key_len + (tx ? 4 : 0), 4);
+    info.seq = 1;
+    // 显式nonce只需要唯一，跟随序号即可
+    // The explicit nonce only needs to be unique, just follow the sequence number
+    info.iv.resize(8);
+    setBE64(&info.iv[0], info.seq);
+    OPENSSL_cleanse(&key_block[0], key_block.size());
+    return true;
+}
+
+template <typename CryptoInfo>
+static bool installKey(int fd, int direction, int cipher_type, const KTlsKeyInfo &info) {
+    CryptoInfo crypto_info;
+    memset(&crypto_info, 0, sizeof(crypto_info));
+    crypto_info.info.version = info.version;
+    crypto_info.info.cipher_type = cipher_type;
+    memcpy(crypto_info.key, info.key.data(), sizeof(crypto_info.key));
+    memcpy(crypto_info.salt, info.salt.data(), sizeof(crypto_info.salt));
+    memcpy(crypto_info.iv, info.iv.data(), sizeof(crypto_info.iv));
+    setBE64((char *)crypto_info.rec_seq, info.seq);
+    auto ret = setsockopt(fd, SOL_TLS, direction, &crypto_info, sizeof(crypto_info));
+    OPENSSL_cleanse(&crypto_info, sizeof(crypto_info));
+    return ret == 0;
+}
+
+static bool enableKTls(int fd, SSL *ssl, bool tx) {
+    KTlsKeyInfo info;
+    if (!getKeyInfo(ssl, tx, info)) {
+        return false;
+    }
+    // 发送和接收共用一个ulp，重复设置返回EEXIST
+    // Send and receive share one ulp, setting it repeatedly returns EEXIST
+    if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0 && errno != EEXIST) {
+        return false;
+    }
+    auto direction = tx ? TLS_TX : TLS_RX;
+    if (info.key.size() == 16) {
+        return installKey<tls12_crypto_info_aes_gcm_128>(fd, direction, TLS_CIPHER_AES_GCM_128, info);
+    }
+    return installKey<tls12_crypto_info_aes_gcm_256>(fd, direction, TLS_CIPHER_AES_GCM_256, info);
+}
+
+bool KTls::isSupported() {
+    static bool supported = []() {
+        // 未连接的socket设置tls ulp时，内核支持则返回ENOTCONN，不支持则返回ENOENT
+        // When setting tls ulp on an unconnected socket, the kernel returns ENOTCONN if supported, ENOENT if not supported
+        auto fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        auto ret = setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 || errno != ENOENT;
+        close(fd);
+        return ret;
+    }();
+    return supported;
+}
+
+bool KTls::enableTx(int fd, SSL *ssl) {
+    return enableKTls(fd, ssl, true);
+}
+
+bool KTls::enableRx(int fd, SSL *ssl) {
+    return enableKTls(fd, ssl, false);
+}
+
+#else
+
+bool KTls::isSupported() {
+    return false;
+}
+
+bool KTls::enableTx(int fd, SSL *ssl) {
+    return false;
+}
+
+bool KTls::enableRx(int fd, SSL *ssl) {
+    return false;
+}
+
+#endif // defined(ENABLE_KTLS)
+
+bool KTls::isEnabled() {
+    GET_CONFIG(bool, enable, General::kEnableKTls);
+    if (!enable || !isSupported()) {
+        return false;
+    }
+#if defined(ENABLE_OPENSSL)
+    lock_guard<mutex> lck(s_ctx_mtx);
+    return !s_ctx_list.empty();
+#else
+    return false;
+#endif
+}
+
+///////////////////////////////////////////KTlsBox///////////////////////////////////////////
+
+#if defined(ENABLE_OPENSSL)
+
+KTlsBox::KTlsBox() {
+    _ssl = KTls::makeSSL();
+    if (!_ssl) {
+        throw std::runtime_error("create ssl failed, no certificate loaded");
+    }
+    _read_bio = BIO_new(BIO_s_mem());
+    _write_bio = BIO_new(BIO_s_mem());
+    // SSL对象接管bio的所有权
+    // The SSL object takes ownership of the bio
+    SSL_set_bio(_ssl.get(), _read_bio, _write_bio);
+}
+
+KTlsBox::~KTlsBox() = default;
+
+void KTlsBox::setOnEncData(onData cb) {
+    _on_enc = std::move(cb);
+}
+
+void KTlsBox::setOnDecData(onData cb) {
+    _on_dec = std::move(cb);
+}
+
+void KTlsBox::onRecv(const Buffer::Ptr &buffer, int fd) {
+    if (_rx_offload) {
+        // 内核已经解密
+        // Already decrypted by the kernel
+        _on_dec(buffer);
+        return;
+    }
+    _fd = fd;
+    size_t offset = 0;
+    while (offset < buffer->size()) {
+        auto size = BIO_write(_read_bio, buffer->data() + offset, (int)(buffer->size() - offset));
+        if (size <= 0) {
+            throw std::runtime_error("BIO_write failed: " + getSSLError());
+        }
+        offset += size;
+        process();
+    }
+}
+
+void KTlsBox::onSend(Buffer::Ptr buffer) {
+    if (!_handshake_done) {
+        _buffer_send.emplace_back(std::move(buffer));
+        return;
+    }
+    sendPlain(buffer);
+}
+
+void KTlsBox::sendPlain(const Buffer::Ptr &buffer) {
+    if (_tx_offload) {
+        // 内核加密，明文直接写socket
+        // Encrypted by the kernel, the plaintext is written to the socket directly
+        _on_enc(buffer);
+        return;
+    }
+    size_t offset = 0;
+    while (offset < buffer->size()) {
+        auto size = SSL_write(_ssl.get(), buffer->data() + offset, (int)(buffer->size() - offset));
+        if (size <= 0) {
+            throw std::runtime_error("SSL_write failed: " + getSSLError());
+        }
+        offset += size;
+    }
+    flushWriteBio();
+}
+
+void KTlsBox::process() {
+    if (!_handshake_done) {
+        auto ret = SSL_do_handshake(_ssl.get());
+        flushWriteBio();
+        if (ret != 1) {
+            auto err = SSL_get_error(_ssl.get(), ret);
+            if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+                return;
+            }
+            throw std::runtime_error("ssl handshake failed: " + getSSLError());
+        }
+        onHandshakeDone();
+    }
+
+    char buf[32 * 1024];
+    while (true) {
+        auto size = SSL_read(_ssl.get(), buf, sizeof(buf));
+        if (size > 0) {
+            auto buffer = BufferRaw::create();
+            buffer->assign(buf, size);
+            _on_dec(buffer);
+            continue;
+        }
+        auto err = SSL_get_error(_ssl.get(), size);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+            break;
+        }
+        if (err == SSL_ERROR_ZERO_RETURN) {
+            throw std::runtime_error("ssl closed by peer");
+        }
+        throw std::runtime_error("SSL_read failed: " + getSSLError());
+    }
+    // 例如tls1.3的KeyUpdate回复(tls1.3不会卸载发送方向)
+    // For example, the KeyUpdate reply of tls1.3 (the send direction of tls1.3 is never offloaded)
+    flushWriteBio();
+}
+
+void KTlsBox::onHandshakeDone() {
+    _handshake_done = true;
+    // tls1.3会话可能在任意时刻收到KeyUpdate，卸载后无法更换内核中的密钥，因此只卸载tls1.2
+    // A tls1.3 session may receive KeyUpdate at any time, and the keys in the kernel cannot be changed after offload, so only tls1.2 is offloaded
+    if (_direct_write && SSL_version(_ssl.get()) == TLS1_2_VERSION) {
+        _tx_offload = KTls::enableTx(_fd, _ssl.get());
+        // 握手数据之后已经收到的密文只能由openssl解密，此时接收方向的序号无法确定，不卸载接收方向
+        // The ciphertext received after the handshake data can only be decrypted by openssl, the sequence of the receive direction
+        // cannot be determined at this time, so the receive direction is not offloaded
+        if (_tx_offload && BIO_ctrl_pending(_read_bio) == 0 && SSL_pending(_ssl.get()) == 0) {
+            _rx_offload = KTls::enableRx(_fd, _ssl.get());
+        }
+    }
+    _direct_write = false;
+    DebugL << "ssl handshake done, version: " << SSL_get_version(_ssl.get()) << ", cipher: " << SSL_get_cipher_name(_ssl.get())
+           << ", ktls tx: " << _tx_offload << ", ktls rx: " << _rx_offload;
+
+    auto buffer_send = std::move(_buffer_send);
+    for (auto &buffer : buffer_send) {
+        sendPlain(buffer);
+    }
+}
+
+void KTlsBox::flushWriteBio() {
+    while (auto pending = BIO_ctrl_pending(_write_bio)) {
+        if (_tx_offload) {
+            // 发送方向已经卸载给内核，openssl再产生的记录(例如拒绝重协商的告警)无法正确发送，只能断开连接
+            // The send direction has been offloaded to the kernel, records generated by openssl later (such as the alert refusing renegotiation)
+            // cannot be sent correctly, so the connection can only be closed
+            throw std::runtime_error("unexpected tls record after ktls tx offload");
+        }
+        auto buffer = BufferRaw::create();
+        buffer->setCapacity(pending);
+        auto size = BIO_read(_write_bio, buffer->data(), (int)pending);
+        if (size <= 0) {
+            break;
+        }
+        buffer->setSize(size);
+        sendRaw(std::move(buffer));
+    }
+}
+
+void KTlsBox::sendRaw(Buffer::Ptr buffer) {
+    if (_direct_write && _fd >= 0) {
+        auto sent = ::send(_fd, buffer->data(), buffer->size(), MSG_NOSIGNAL);
+        if (sent == (ssize_t)buffer->size()) {
+            return;
+        }
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw std::runtime_error(string("send handshake data failed: ") + strerror(errno));
+        }
+        // 发送缓存已满，剩余数据交给socket缓存发送，本会话放弃kTLS卸载
+        // The send buffer is full, the remaining data is sent through the socket cache, this session gives up kTLS offload
+        _direct_write = false;
+        if (sent > 0) {
+            auto remain = BufferRaw::create();
+            remain->assign(buffer->data() + sent, buffer->size() - sent);
+            buffer = std::move(remain);
+        }
+    }
+    _on_enc(buffer);
+}
+
+#else
+
+KTlsBox::KTlsBox() {
+    throw std::runtime_error("ktls requires ENABLE_OPENSSL");
+}
+
+KTlsBox::~KTlsBox() = default;
+void KTlsBox::setOnEncData(onData cb) {}
+void KTlsBox::setOnDecData(onData cb) {}
+void KTlsBox::onRecv(const Buffer::Ptr &buffer, int fd) {}
+void KTlsBox::onSend(Buffer::Ptr buffer) {}
+
+#endif // defined(ENABLE_OPENSSL)
+
+} // namespace mediakit
@@ -0,0 +1,172 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_KTLS_H
+#define ZLMEDIAKIT_KTLS_H
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include "Network/Buffer.h"
+#include "Network/Session.h"
+
+typedef struct ssl_st SSL;
+typedef struct bio_st BIO;
+
+namespace mediakit {
+
+/**
+ * linux内核tls(kTLS)工具类
+ * 握手由openssl完成，握手结束后把会话密钥安装到socket，此后socket的读写由内核完成加解密
+ * Linux kernel tls (kTLS) utility class
+ * The handshake is done by openssl, after the handshake the session keys are installed on the socket, then the kernel encrypts and decrypts socket reads and writes
+ */
+class KTls {
+public:
+    /**
+     * 内核是否支持tls ulp(会尝试触发tls模块自动加载)
+     * Whether the kernel supports tls ulp (will try to trigger automatic loading of the tls module)
+     */
+    static bool isSupported();
+
+    /**
+     * 配置开启、内核支持且已加载证书时返回true
+     * Return true when enabled by config, supported by the kernel and certificates have been loaded
+     */
+    static bool isEnabled();
+
+    /**
+     * 加载服务器证书(pem或p12，包含公钥与私钥)，替换之前加载的所有证书
+     * 最后一个证书为默认证书，其他证书根据sni选择
+     * Load server certificates (pem or p12, including public and private keys), replacing all previously loaded certificates
+     * The last certificate is the default certificate, other certificates are selected by sni
+     * @return 成功加载的证书个数
+     * @return Number of certificates loaded successfully
+     */
+    static size_t setCertificates(const std::vector<std::string> &files, const std::string &password = "");
+
+    /**
+     * 创建服务器模式的SSL对象，未加载证书时返回nullptr
+     * Create a server mode SSL object, return nullptr when no certificate is loaded
+     */
+    static std::shared_ptr<SSL> makeSSL();
+
+    /**
+     * 安装发送/接收方向的会话密钥，必须在握手完成后、收发任何应用数据之前调用
+     * 仅支持TLS1.2的AES-128-GCM与AES-256-GCM；TLS1.3的KeyUpdate会更换密钥，卸载后无法处理，所以TLS1.3会话保持在用户态
+     * 卸载接收方向后，对端发来的告警等控制记录会使socket读取失败并断开连接
+     * Install the session keys of the send/receive direction, must be called after the handshake is completed and before any application data is sent or received
+     * Only AES-128-GCM and AES-256-GCM of TLS1.2 are supported; KeyUpdate of TLS1.3 changes the keys and cannot be handled after offload, so TLS1.3 sessions stay in user mode
+     * After the receive direction is offloaded, control records such as alerts from the peer make the socket read fail and close the connection
+     */
+    static bool enableTx(int fd, SSL *ssl);
+    static bool enableRx(int fd, SSL *ssl);
+};
+
+/**
+ * 服务器模式的tls会话，握手完成后尽量把加解密卸载到内核，不支持时与SSL_Box一样在用户态加解密
+ * Server mode tls session, try to offload encryption and decryption to the kernel after the handshake, when not supported encrypt and decrypt in user mode like SSL_Box
+ */
+class KTlsBox {
+public:
+    using onData = std::function<void(const toolkit::Buffer::Ptr &)>;
+
+    KTlsBox();
+    ~KTlsBox();
+
+    /**
+     * 设置发送到socket的数据(握手数据、用户态加密数据或卸载后的明文)回调
+     * Set the callback of data sent to the socket (handshake data, user mode encrypted data or plaintext after offload)
+     */
+    void setOnEncData(onData cb);
+
+    /**
+     * 设置解密后的明文回调
+     * Set the callback of decrypted plaintext
+     */
+    void setOnDecData(onData cb);
+
+    /**
+     * 收到socket数据
+     * Socket data received
+     * @param fd socket fd，握手完成时用于安装密钥
+     * @param fd Socket fd, used to install keys when the handshake is completed
+     */
+    void onRecv(const toolkit::Buffer::Ptr &buffer, int fd);
+
+    /**
+     * 发送明文
+     * Send plaintext
+     */
+    void onSend(toolkit::Buffer::Ptr buffer);
+
+    bool isTxOffloaded() const { return _tx_offload; }
+    bool isRxOffloaded() const { return _rx_offload; }
+
+private:
+    void process();
+    void onHandshakeDone();
+    void flushWriteBio();
+    void sendRaw(toolkit::Buffer::Ptr buffer);
+    void sendPlain(const toolkit::Buffer::Ptr &buffer);
+
+private:
+    int _fd = -1;
+    bool _handshake_done = false;
+    // 握手阶段直接写socket，确保安装发送密钥时没有握手数据残留在用户态发送缓存
+    // Write the socket directly during the handshake to ensure that no handshake data remains in the user mode send cache when installing the send key
+    bool _direct_write = true;
+    bool _tx_offload = false;
+    bool _rx_offload = false;
+    BIO *_read_bio = nullptr;
+    BIO *_write_bio = nullptr;
+    std::shared_ptr<SSL> _ssl;
+    onData _on_enc;
+    onData _on_dec;
+    std::list<toolkit::Buffer::Ptr> _buffer_send;
+};
+
+/**
+ * 与toolkit::SessionWithSSL用法相同，但是支持kTLS卸载
+ * Same usage as toolkit::SessionWithSSL, but supports kTLS offload
+ */
+template <typename SessionType>
+class SessionWithKTls : public SessionType {
+public:
+    template <typename... ArgsType>
+    SessionWithKTls(ArgsType &&...args) : SessionType(std::forward<ArgsType>(args)...) {
+        _box.setOnEncData([&](const toolkit::Buffer::Ptr &buf) { public_send(buf); });
+        _box.setOnDecData([&](const toolkit::Buffer::Ptr &buf) { public_onRecv(buf); });
+    }
+
+    void onRecv(const toolkit::Buffer::Ptr &buf) override { _box.onRecv(buf, this->getSock()->rawFD()); }
+
+    // 添加public_onRecv和public_send函数是为了解决较低版本gcc在lambda中访问protected方法导致的编译错误
+    // public_onRecv and public_send are added to solve the compilation error of accessing protected methods in lambda with lower versions of gcc
+    inline void public_onRecv(const toolkit::Buffer::Ptr &buf) { SessionType::onRecv(buf); }
+    inline void public_send(const toolkit::Buffer::Ptr &buf) { SessionType::send(buf); }
+
+    bool overSsl() const override { return true; }
+
+protected:
+    ssize_t send(toolkit::Buffer::Ptr buf) override {
+        auto size = buf->size();
+        _box.onSend(std::move(buf));
+        return size;
+    }
+
+private:
+    KTlsBox _box;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_KTLS_H
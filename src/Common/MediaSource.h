@@ -227,6 +227,10 @@ public:
     // This configuration can solve some problems where the stream is not sent smoothly, resulting in zlmediakit forwarding not being smooth
     uint32_t paced_sender_ms;
 
+    // rtp推流(含国标ps/ts推流)自适应去抖动缓存的最大时长，单位毫秒，置0则关闭
+    // Maximum duration of the adaptive de-jitter buffer for rtp push streams (including GB28181 ps/ts push streams), in milliseconds, set to 0 to close
+    uint32_t jitter_buffer_ms;
+
     // 是否开启转换为hls(mpegts)  [AUTO-TRANSLATED:bfc1167a]
     // Whether to enable conversion to hls(mpegts)
     bool enable_hls;
@@ -301,6 +305,7 @@ public:
         GET_OPT_VALUE(auto_close);
         GET_OPT_VALUE(continue_push_ms);
         GET_OPT_VALUE(paced_sender_ms);
+        GET_OPT_VALUE(jitter_buffer_ms);
 
         GET_OPT_VALUE(enable_hls);
         GET_OPT_VALUE(enable_hls_fmp4);
@@ -11,6 +11,7 @@
 #include <math.h>
 #include "Common/config.h"
 #include "MultiMediaSourceMuxer.h"
+#include "Record/MP4Recorder.h"
 #include "Thread/WorkThreadPool.h"
 
 using namespace std;
@@ -135,6 +136,19 @@ private:
     std::multimap<uint64_t, Frame::Ptr> _cache;
 };
 
+void MultiMediaSourceMuxer::attachMP4Recorder() {
+    _mp4_fmp4 = nullptr;
+#if defined(ENABLE_MP4)
+    auto recorder = dynamic_pointer_cast<MP4Recorder>(_mp4);
+    if (recorder && recorder->isFMP4Append()) {
+        // fmp4录制直接追加共享复用器产生的分片
+        // fmp4 recording appends the fragments generated by the shared muxer directly
+        _mp4_fmp4 = recorder;
+        _fmp4_muxer->addConsumer(recorder);
+    }
+#endif
+}
+
 std::shared_ptr<MediaSinkInterface> MultiMediaSourceMuxer::makeRecorder(Recorder::type type) {
     auto recorder = Recorder::createRecorder(type, getMediaTuple(), _option);
     for (auto &track : getTracks()) {
@@ -223,20 +237,31 @@ MultiMediaSourceMuxer::MultiMediaSourceMuxer(const MediaTuple& tuple, float dur_
     if (option.enable_rtsp) {
         _rtsp = std::make_shared<RtspMediaSourceMuxer>(_tuple, option, std::make_shared<TitleSdp>(dur_sec));
     }
+    // http-ts与hls共享同一个ts复用器，每帧只复用一次
+    // http-ts and hls share the same ts muxer, each frame is muxed only once
+    _ts_muxer = std::make_shared<SharedTSMuxer>();
     if (option.enable_hls) {
-        _hls = dynamic_pointer_cast<HlsRecorder>(Recorder::createRecorder(Recorder::type_hls, _tuple, option));
+        _hls = dynamic_pointer_cast<HlsRecorder>(Recorder::createMpegConsumer(Recorder::type_hls, _tuple, option));
+        _ts_muxer->addConsumer(_hls);
     }
+    // http/ws-fmp4、hls-fmp4与fmp4录制共享同一个fmp4复用器
+    // http/ws-fmp4, hls-fmp4 and fmp4 recording share the same fmp4 muxer
+    _fmp4_muxer = std::make_shared<SharedFMP4Muxer>();
     if (option.enable_hls_fmp4) {
-        _hls_fmp4 = dynamic_pointer_cast<HlsFMP4Recorder>(Recorder::createRecorder(Recorder::type_hls_fmp4, _tuple, option));
+        _hls_fmp4 = dynamic_pointer_cast<HlsFMP4Recorder>(Recorder::createFMP4Consumer(Recorder::type_hls_fmp4, _tuple, option));
+        _fmp4_muxer->addConsumer(_hls_fmp4);
     }
     if (option.enable_mp4) {
         _mp4 = Recorder::createRecorder(Recorder::type_mp4, _tuple, option);
+        attachMP4Recorder();
     }
     if (option.enable_ts) {
-        _ts = dynamic_pointer_cast<TSMediaSourceMuxer>(Recorder::createRecorder(Recorder::type_ts, _tuple, option));
+        _ts = dynamic_pointer_cast<TSMediaSourceMuxer>(Recorder::createMpegConsumer(Recorder::type_ts, _tuple, option));
+        _ts_muxer->addConsumer(_ts);
     }
     if (option.enable_fmp4) {
-        _fmp4 = dynamic_pointer_cast<FMP4MediaSourceMuxer>(Recorder::createRecorder(Recorder::type_fmp4, _tuple, option));
+        _fmp4 = dynamic_pointer_cast<FMP4MediaSourceMuxer>(Recorder::createFMP4Consumer(Recorder::type_fmp4, _tuple, option));
+        _fmp4_muxer->addConsumer(_fmp4);
     }
 
     // 音频相关设置  [AUTO-TRANSLATED:6ee58d57]
@@ -326,16 +351,20 @@ bool MultiMediaSourceMuxer::setupRecord(Recorder::type type, bool start, const s
                 // 开始录制  [AUTO-TRANSLATED:36d99250]
                 // Start recording
                 _option.hls_save_path = custom_path;
-                auto hls = dynamic_pointer_cast<HlsRecorder>(makeRecorder(type));
+                // ts由共享复用器产生，无需再添加轨道
+                // The ts is generated by the shared muxer, no need to add tracks
+                auto hls = dynamic_pointer_cast<HlsRecorder>(Recorder::createMpegConsumer(type, getMediaTuple(), _option));
                 if (hls) {
                     // 设置HlsMediaSource的事件监听器  [AUTO-TRANSLATED:69990c92]
                     // Set the event listener for HlsMediaSource
                     hls->setListener(shared_from_this());
+                    _ts_muxer->addConsumer(hls);
                 }
                 _hls = hls;
             } else if (!start && _hls) {
                 // 停止录制  [AUTO-TRANSLATED:3dee9292]
                 // Stop recording
+                _ts_muxer->removeConsumer(_hls);
                 _hls = nullptr;
             }
             return true;
@@ -347,9 +376,14 @@ bool MultiMediaSourceMuxer::setupRecord(Recorder::type type, bool start, const s
                 _option.mp4_save_path = custom_path;
                 _option.mp4_max_second = max_second;
                 _mp4 = makeRecorder(type);
+                attachMP4Recorder();
             } else if (!start && _mp4) {
                 // 停止录制  [AUTO-TRANSLATED:3dee9292]
                 // Stop recording
+                if (_mp4_fmp4) {
+                    _fmp4_muxer->removeConsumer(_mp4_fmp4);
+                    _mp4_fmp4 = nullptr;
+                }
                 _mp4 = nullptr;
             }
             return true;
@@ -359,40 +393,48 @@ bool MultiMediaSourceMuxer::setupRecord(Recorder::type type, bool start, const s
                 // 开始录制  [AUTO-TRANSLATED:36d99250]
                 // Start recording
                 _option.hls_save_path = custom_path;
-                auto hls = dynamic_pointer_cast<HlsFMP4Recorder>(makeRecorder(type));
+                // fmp4分片由共享复用器产生，无需再添加轨道
+                // The fmp4 fragments are generated by the shared muxer, no need to add tracks
+                auto hls = dynamic_pointer_cast<HlsFMP4Recorder>(Recorder::createFMP4Consumer(type, getMediaTuple(), _option));
                 if (hls) {
                     // 设置HlsMediaSource的事件监听器  [AUTO-TRANSLATED:69990c92]
                     // Set the event listener for HlsMediaSource
                     hls->setListener(shared_from_this());
+                    _fmp4_muxer->addConsumer(hls);
                 }
                 _hls_fmp4 = hls;
             } else if (!start && _hls_fmp4) {
                 // 停止录制  [AUTO-TRANSLATED:3dee9292]
                 // Stop recording
+                _fmp4_muxer->removeConsumer(_hls_fmp4);
                 _hls_fmp4 = nullptr;
             }
             return true;
         }
         case Recorder::type_fmp4: {
             if (start && !_fmp4) {
-                auto fmp4 = dynamic_pointer_cast<FMP4MediaSourceMuxer>(makeRecorder(type));
+                auto fmp4 = dynamic_pointer_cast<FMP4MediaSourceMuxer>(Recorder::createFMP4Consumer(type, getMediaTuple(), _option));
                 if (fmp4) {
                     fmp4->setListener(shared_from_this());
+                    _fmp4_muxer->addConsumer(fmp4);
                 }
                 _fmp4 = fmp4;
             } else if (!start && _fmp4) {
+                _fmp4_muxer->removeConsumer(_fmp4);
                 _fmp4 = nullptr;
             }
             return true;
         }
         case Recorder::type_ts: {
             if (start && !_ts) {
-                auto ts = dynamic_pointer_cast<TSMediaSourceMuxer>(makeRecorder(type));
+                auto ts = dynamic_pointer_cast<TSMediaSourceMuxer>(Recorder::createMpegConsumer(type, getMediaTuple(), _option));
                 if (ts) {
                     ts->setListener(shared_from_this());
+                    _ts_muxer->addConsumer(ts);
                 }
                 _ts = ts;
             } else if (!start && _ts) {
+                _ts_muxer->removeConsumer(_ts);
                 _ts = nullptr;
             }
             return true;
@@ -524,31 +566,32 @@ void MultiMediaSourceMuxer::startSendRtp(const MediaSourceEvent::SendRtpArgs &ar
         }
     });
 
-    rtp_sender->startSend(*this, args, [ssrc,ssrc_multi_send, weak_self, rtp_sender, cb, tracks, ring, poller](uint16_t local_port, const SockException &ex) mutable {
+    rtp_sender->startSend(*this, args, [ssrc,ssrc_multi_send, weak_self, rtp_sender, cb, tracks, ring, poller, args](uint16_t local_port, const SockException &ex) mutable {
         cb(local_port, ex);
         auto strong_self = weak_self.lock();
         if (!strong_self || ex) {
             return;
         }
 
-        for (auto &track : tracks) {
-            rtp_sender->addTrack(track);
-        }
-        rtp_sender->addTrackCompleted();
-
-        auto reader = ring->attach(poller);
-        reader->setReadCB([rtp_sender](const Frame::Ptr &frame) {
-            rtp_sender->inputFrame(frame);
-        });
-
         // 可能归属线程发生变更  [AUTO-TRANSLATED:2b379e30]
         // The owning thread may change
         strong_self->getOwnerPoller(MediaSource::NullMediaSource())->async([=]() {
             if (!ssrc_multi_send) {
                 strong_self->_rtp_sender.erase(ssrc);
             }
+            auto group = strong_self->getRtpSenderGroup(args, poller);
+            if (!group) {
+                // 新建共享组，从环形缓存读取数据(会回放gop缓存)
+                // Create a new sharing group, read data from the ring buffer (the gop cache will be replayed)
+                group = std::make_shared<RtpSenderGroup>(args, poller);
+                group->start(tracks, ring);
+                GET_CONFIG(bool, share_send_encoder, RtpProxy::kShareSendEncoder);
+                if (share_send_encoder) {
+                    strong_self->_rtp_sender_group[group->getKey()] = group;
+                }
+            }
             std::weak_ptr<RtpSender> sender = rtp_sender;
-            strong_self->_rtp_sender.emplace(ssrc, make_tuple(reader, sender));
+            strong_self->_rtp_sender.emplace(ssrc, make_tuple(group->addSender(rtp_sender), sender));
         });
     });
 #else
@@ -556,6 +599,32 @@ void MultiMediaSourceMuxer::startSendRtp(const MediaSourceEvent::SendRtpArgs &ar
 #endif//ENABLE_RTPPROXY
 }
 
+#if defined(ENABLE_RTPPROXY)
+RtpSenderGroup::Ptr MultiMediaSourceMuxer::getRtpSenderGroup(const MediaSourceEvent::SendRtpArgs &args, const EventPoller::Ptr &poller) {
+    for (auto it = _rtp_sender_group.begin(); it != _rtp_sender_group.end();) {
+        if (it->second.expired()) {
+            // 共享组的成员都已退出
+            // All members of the sharing group have left
+            it = _rtp_sender_group.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    GET_CONFIG(bool, share_send_encoder, RtpProxy::kShareSendEncoder);
+    if (!share_send_encoder) {
+        return nullptr;
+    }
+    auto it = _rtp_sender_group.find(RtpSenderGroup::makeKey(args));
+    if (it == _rtp_sender_group.end()) {
+        return nullptr;
+    }
+    auto group = it->second.lock();
+    // 发送目标与共享组必须在同一个线程
+    // The sending target and the sharing group must be in the same thread
+    return group && group->getPoller() == poller ? group : nullptr;
+}
+#endif // ENABLE_RTPPROXY
+
 bool MultiMediaSourceMuxer::stopSendRtp(const string &ssrc) {
 #if defined(ENABLE_RTPPROXY)
     if (ssrc.empty()) {
@@ -604,8 +673,10 @@ bool MultiMediaSourceMuxer::close(MediaSource &sender) {
     _mp4 = nullptr;
     _hls = nullptr;
     _hls_fmp4 = nullptr;
+    _mp4_fmp4 = nullptr;
 #if defined(ENABLE_RTPPROXY)
     _rtp_sender.clear();
+    _rtp_sender_group.clear();
 #endif // ENABLE_RTPPROXY
     return true;
 }
@@ -629,17 +700,15 @@ bool MultiMediaSourceMuxer::onTrackReady(const Track::Ptr &track) {
     if (_rtsp) {
         ret = _rtsp->addTrack(track) ? true : ret;
     }
-    if (_ts) {
-        ret = _ts->addTrack(track) ? true : ret;
-    }
-    if (_fmp4) {
-        ret = _fmp4->addTrack(track) ? true : ret;
+    // 共享ts复用器总是添加轨道，以便中途开启http-ts/hls
+    // The shared ts muxer always adds tracks, so that http-ts/hls can be enabled midway
+    if (_ts_muxer->addTrack(track) && (_ts || _hls)) {
+        ret = true;
     }
-    if (_hls) {
-        ret = _hls->addTrack(track) ? true : ret;
-    }
-    if (_hls_fmp4) {
-        ret = _hls_fmp4->addTrack(track) ? true : ret;
+    // 共享fmp4复用器总是添加轨道，以便中途开启fmp4相关协议
+    // The shared fmp4 muxer always adds tracks, so that fmp4 related protocols can be enabled midway
+    if (_fmp4_muxer->addTrack(track) && (_fmp4 || _hls_fmp4)) {
+        ret = true;
     }
     if (_mp4) {
         ret = _mp4->addTrack(track) ? true : ret;
@@ -667,21 +736,11 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
     if (_rtsp) {
         _rtsp->addTrackCompleted();
     }
-    if (_ts) {
-        _ts->addTrackCompleted();
-    }
+    _ts_muxer->addTrackCompleted();
     if (_mp4) {
         _mp4->addTrackCompleted();
     }
-    if (_fmp4) {
-        _fmp4->addTrackCompleted();
-    }
-    if (_hls) {
-        _hls->addTrackCompleted();
-    }
-    if (_hls_fmp4) {
-        _hls_fmp4->addTrackCompleted();
-    }
+    _fmp4_muxer->addTrackCompleted();
 
     auto listener = _track_listener.lock();
     if (listener) {
@@ -721,6 +780,10 @@ void MultiMediaSourceMuxer::createGopCacheIfNeed(size_t gop_count) {
             });
         }
     }, gop_count);
+    // 中途开启的http-ts/hls从共享复用器的ts gop缓存秒开
+    // http-ts/hls enabled midway start quickly from the ts gop cache of the shared muxer
+    _ts_muxer->enableGopCache(true);
+    _fmp4_muxer->enableGopCache(true);
 }
 
 void MultiMediaSourceMuxer::resetTracks() {
@@ -732,18 +795,8 @@ void MultiMediaSourceMuxer::resetTracks() {
     if (_rtsp) {
         _rtsp->resetTracks();
     }
-    if (_ts) {
-        _ts->resetTracks();
-    }
-    if (_fmp4) {
-        _fmp4->resetTracks();
-    }
-    if (_hls_fmp4) {
-        _hls_fmp4->resetTracks();
-    }
-    if (_hls) {
-        _hls->resetTracks();
-    }
+    _ts_muxer->resetTracks();
+    _fmp4_muxer->resetTracks();
     if (_mp4) {
         _mp4->resetTracks();
     }
@@ -754,13 +807,18 @@ bool MultiMediaSourceMuxer::onTrackFrame(const Frame::Ptr &frame_in) {
     if (_option.modify_stamp != ProtocolOption::kModifyStampOff) {
         // 时间戳不采用原始的绝对时间戳  [AUTO-TRANSLATED:8beb3bf7]
         // Timestamp does not use the original absolute timestamp
-        frame = std::make_shared<FrameStamp>(frame, _stamps[frame->getIndex()], _option.modify_stamp);
+        frame = makeFrame<FrameStamp>(frame, _stamps[frame->getIndex()], _option.modify_stamp);
     }
     return _paced_sender ? _paced_sender->inputFrame(frame) : onTrackFrame_l(frame);
 }
 
 bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     auto frame = frame_in;
+    if (!frame->cacheAble()) {
+        // 各复用器需要缓存该帧时共用一份拷贝
+        // Each muxer shares one copy when it needs to cache this frame
+        frame = makeFrame<FrameBorrowed>(std::move(frame));
+    }
     bool ret = false;
     if (_rtmp) {
         ret = _rtmp->inputFrame(frame) ? true : ret;
@@ -768,24 +826,27 @@ bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     if (_rtsp) {
         ret = _rtsp->inputFrame(frame) ? true : ret;
     }
-    if (_ts) {
-        ret = _ts->inputFrame(frame) ? true : ret;
-    }
-
-    if (_hls) {
-        ret = _hls->inputFrame(frame) ? true : ret;
+    if ((_ts && _ts->isEnabled()) || (_hls && _hls->isEnabled())) {
+        // 有任一消费者启用时才复用ts
+        // Mux ts only when any consumer is enabled
+        ret = _ts_muxer->inputFrame(frame) ? true : ret;
+    } else {
+        // 停止输入期间gop缓存会过期
+        // The gop cache becomes stale while the input is stopped
+        _ts_muxer->pauseInput();
     }
 
-    if (_hls_fmp4) {
-        ret = _hls_fmp4->inputFrame(frame) ? true : ret;
+    if ((_fmp4 && _fmp4->isEnabled()) || (_hls_fmp4 && _hls_fmp4->isEnabled()) || _mp4_fmp4) {
+        // 有任一消费者启用时才生成fmp4分片
+        // Generate fmp4 fragments only when any consumer is enabled
+        ret = _fmp4_muxer->inputFrame(frame) ? true : ret;
+    } else {
+        _fmp4_muxer->pauseInput();
     }
 
-    if (_mp4) {
+    if (_mp4 && !_mp4_fmp4) {
         ret = _mp4->inputFrame(frame) ? true : ret;
     }
-    if (_fmp4) {
-        ret = _fmp4->inputFrame(frame) ? true : ret;
-    }
     if (_ring) {
         // 此场景由于直接转发，可能存在切换线程引起的数据被缓存在管道，所以需要CacheAbleFrame  [AUTO-TRANSLATED:528afbb7]
         // In this scenario, due to direct forwarding, there may be data cached in the pipeline due to thread switching, so CacheAbleFrame is needed
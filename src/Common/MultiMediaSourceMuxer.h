@@ -15,7 +15,7 @@
 #include "Common/MediaSource.h"
 #include "Common/MediaSink.h"
 #include "Record/Recorder.h"
-#include "Rtp/RtpSender.h"
+#include "Rtp/RtpSenderGroup.h"
 #include "Record/HlsRecorder.h"
 #include "Record/HlsMediaSource.h"
 #include "Rtsp/RtspMediaSourceMuxer.h"
@@ -224,6 +224,10 @@ protected:
 private:
     void createGopCacheIfNeed(size_t gop_count);
     std::shared_ptr<MediaSinkInterface> makeRecorder(Recorder::type type);
+    void attachMP4Recorder();
+#if defined(ENABLE_RTPPROXY)
+    RtpSenderGroup::Ptr getRtpSenderGroup(const MediaSourceEvent::SendRtpArgs &args, const toolkit::EventPoller::Ptr &poller);
+#endif // ENABLE_RTPPROXY
 
 private:
     bool _is_enable = false;
@@ -237,7 +241,10 @@ private:
     std::unordered_map<int, Stamp> _stamps;
     std::weak_ptr<Listener> _track_listener;
 #if defined(ENABLE_RTPPROXY)
-    std::unordered_multimap<std::string, std::tuple<RingType::RingReader::Ptr, std::weak_ptr<RtpSender>>> _rtp_sender;
+    // 元组第一个元素为共享组成员凭证，释放后退出共享组
+    // The first element of the tuple is the member token of the sharing group, leave the sharing group after it is released
+    std::unordered_multimap<std::string, std::tuple<std::shared_ptr<toolkit::onceToken>, std::weak_ptr<RtpSender>>> _rtp_sender;
+    std::unordered_map<std::string, std::weak_ptr<RtpSenderGroup>> _rtp_sender_group;
 #endif // ENABLE_RTPPROXY
     FMP4MediaSourceMuxer::Ptr _fmp4;
     RtmpMediaSourceMuxer::Ptr _rtmp;
@@ -246,6 +253,13 @@ private:
     MediaSinkInterface::Ptr _mp4;
     HlsRecorder::Ptr _hls;
     HlsFMP4Recorder::Ptr _hls_fmp4;
+    // 声明在各消费者之后，确保析构时先于消费者刷新输出
+    // Declared after the consumers, to ensure they flush the output before the consumers are destroyed
+    SharedTSMuxer::Ptr _ts_muxer;
+    SharedFMP4Muxer::Ptr _fmp4_muxer;
+    // fmp4追加模式的mp4录制，为空时mp4录制自行复用
+    // mp4 recording in fmp4 append mode, when empty the mp4 recording muxes by itself
+    std::shared_ptr<FMP4Consumer> _mp4_fmp4;
     toolkit::EventPoller::Ptr _poller;
     RingType::Ptr _ring;
 
@@ -0,0 +1,279 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include "TimerWheel.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+constexpr uint64_t TimerWheel::kTickMS;
+
+struct TimerWheel::Node : public TimerWheel::ListHook, public std::enable_shared_from_this<TimerWheel::Node> {
+    // 可能在其他线程取消
+    // May be canceled in other threads
+    std::atomic<bool> cancelled { false };
+    uint64_t expire = 0;
+    uint64_t interval = 1;
+    std::function<bool()> cb;
+};
+
+TimerWheel::TimerWheel(EventPoller::Ptr poller) {
+    _poller = std::move(poller);
+    _start_ms = getCurrentMillisecond();
+}
+
+TimerWheel::~TimerWheel() {
+    if (_delay_task) {
+        _delay_task->cancel();
+    }
+}
+
+const TimerWheel::Ptr &TimerWheel::getInstance(const EventPoller::Ptr &poller) {
+    // poller线程不会退出，每个线程一个时间轮
+    // The poller thread will not exit, one timer wheel per thread
+    static thread_local TimerWheel::Ptr s_wheel;
+    if (!s_wheel) {
+        s_wheel = std::make_shared<TimerWheel>(poller);
+    }
+    return s_wheel;
+}
+
+size_t TimerWheel::size() const {
+    return _size;
+}
+
+uint64_t TimerWheel::wakeups() const {
+    return _wakeups;
+}
+
+uint64_t TimerWheel::currentTick() const {
+    return (getCurrentMillisecond() - _start_ms) / kTickMS;
+}
+
+void TimerWheel::add(const std::shared_ptr<Node> &node) {
+    if (node->cancelled || node->next != node.get()) {
+        return;
+    }
+    // 时间轮空闲时不走动，以当前时间为准计算触发时间
+    // The timer wheel does not move when idle, calculate the trigger time based on the current time
+    node->expire = std::max(currentTick(), _now) + node->interval;
+    insert(node.get());
+    ++_size;
+    schedule(node->expire);
+}
+
+void TimerWheel::remove(Node *node) {
+    if (node->next == node) {
+        // 未添加、已触发或已删除
+        // Not added, triggered or removed
+        return;
+    }
+    unlink(node);
+    --_size;
+}
+
+void TimerWheel::insert(Node *node) {
+    auto expire = node->expire;
+    auto delta = expire - _now;
+    ListHook *head;
+    if (delta < (1ULL << kLevel0Bits)) {
+        head = &_level0[expire & ((1 << kLevel0Bits) - 1)];
+    } else if (delta < (1ULL << (kLevel0Bits + kLevelBits))) {
+        head = &_levels[0][(expire >> kLevel0Bits) & ((1 << kLevelBits) - 1)];
+    } else if (delta < (1ULL << (kLevel0Bits + 2 * kLevelBits))) {
+        head = &_levels[1][(expire >> (kLevel0Bits + kLevelBits)) & ((1 << kLevelBits) - 1)];
+    } else {
+        constexpr uint64_t max_delta = (1ULL << (kLevel0Bits + 3 * kLevelBits)) - 1;
+        if (delta > max_delta) {
+            // 超出时间轮跨度，先放到最远的槽，到期后重新计算
+            // Beyond the span of the timer wheel, put it in the farthest slot first, recalculated after expiration
+            expire = _now + max_delta;
+        }
+        head = &_levels[2][(expire >> (kLevel0Bits + 2 * kLevelBits)) & ((1 << kLevelBits) - 1)];
+    }
+    link(head, node);
+}
+
+void TimerWheel::schedule(uint64_t tick) {
+    if (_delay_task && _wake_tick <= tick) {
+        // 已经会在此之前唤醒
+        // Will wake up before this
+        return;
+    }
+    if (_delay_task) {
+        _delay_task->cancel();
+    }
+    _wake_tick = tick;
+    auto wake_ms = _start_ms + tick * kTickMS;
+    auto now_ms = getCurrentMillisecond();
+    weak_ptr<TimerWheel> weak_self = shared_from_this();
+    _delay_task = _poller->doDelayTask(wake_ms > now_ms ? wake_ms - now_ms : 1, [weak_self]() -> uint64_t {
+        auto strong_self = weak_self.lock();
+        return strong_self ? strong_self->onWake() : 0;
+    });
+}
+
+uint64_t TimerWheel::onWake() {
+    ++_wakeups;
+    advance(currentTick());
+    if (!_size) {
+        // 没有定时任务时停止唤醒
+        // Stop waking up when there is no timed task
+        _delay_task = nullptr;
+        return 0;
+    }
+    _wake_tick = nextTick();
+    auto wake_ms = _start_ms + _wake_tick * kTickMS;
+    auto now_ms = getCurrentMillisecond();
+    return wake_ms > now_ms ? wake_ms - now_ms : 1;
+}
+
+uint64_t TimerWheel::nextTick() const {
+    // 合并唤醒：跳过空槽，最迟在第一层转完一圈(需要降级上层定时任务)时唤醒
+    // Coalesced wakeup: skip empty slots, wake up at the latest when the first level completes a round (need to cascade upper level timed tasks)
+    constexpr uint64_t mask = (1 << kLevel0Bits) - 1;
+    auto tick = _now + 1;
+    for (; tick & mask; ++tick) {
+        auto head = &_level0[tick & mask];
+        if (head->next != head) {
+            break;
+        }
+    }
+    return tick;
+}
+
+void TimerWheel::advance(uint64_t tick) {
+    constexpr uint64_t mask0 = (1 << kLevel0Bits) - 1;
+    constexpr uint64_t mask = (1 << kLevelBits) - 1;
+    while (_now < tick) {
+        ++_now;
+        auto index = _now & mask0;
+        if (!index) {
+            // 第一层转完一圈，把上层即将到期的定时任务降级
+            // The first level completes a round, cascade the upper level timed tasks that are about to expire
+            auto index1 = (_now >> kLevel0Bits) & mask;
+            cascade(&_levels[0][index1]);
+            if (!index1) {
+                auto index2 = (_now >> (kLevel0Bits + kLevelBits)) & mask;
+                cascade(&_levels[1][index2]);
+                if (!index2) {
+                    cascade(&_levels[2][(_now >> (kLevel0Bits + 2 * kLevelBits)) & mask]);
+                }
+            }
+        }
+        fire(&_level0[index]);
+    }
+}
+
+void TimerWheel::cascade(ListHook *head) {
+    ListHook list;
+    moveList(head, &list);
+    while (list.next != &list) {
+        auto node = static_cast<Node *>(list.next);
+        unlink(node);
+        insert(node);
+    }
+}
+
+void TimerWheel::fire(ListHook *head) {
+    ListHook list;
+    moveList(head, &list);
+    // 回调中可能删除其他定时任务(包括list中的)，所以每次都从头部取
+    // Other timed tasks (including those in the list) may be removed in the callback, so take from the head every time
+    while (list.next != &list) {
+        auto node = static_cast<Node *>(list.next);
+        unlink(node);
+        if (node->expire > _now) {
+            // 超出时间轮跨度的定时任务还未到期
+            // The timed task beyond the span of the timer wheel has not expired yet
+            insert(node);
+            continue;
+        }
+        --_size;
+        if (node->cancelled) {
+            continue;
+        }
+        // 回调中可能销毁定时器
+        // The timer may be destroyed in the callback
+        auto strong_node = node->shared_from_this();
+        bool repeat = true;
+        try {
+            repeat = node->cb();
+        } catch (std::exception &ex) {
+            WarnL << "Exception occurred when do timer task: " << ex.what();
+        }
+        if (repeat && !node->cancelled && node->next == node) {
+            node->expire = _now + node->interval;
+            insert(node);
+            ++_size;
+        } else if (node->next == node) {
+            // 不再触发，释放回调捕获的对象，防止循环引用
+            // No longer triggered, release the objects captured by the callback to prevent circular references
+            node->cb = nullptr;
+        }
+    }
+}
+
+void TimerWheel::link(ListHook *head, ListHook *hook) {
+    hook->prev = head->prev;
+    hook->next = head;
+    head->prev->next = hook;
+    head->prev = hook;
+}
+
+void TimerWheel::unlink(ListHook *hook) {
+    hook->prev->next = hook->next;
+    hook->next->prev = hook->prev;
+    hook->prev = hook->next = hook;
+}
+
+void TimerWheel::moveList(ListHook *from, ListHook *to) {
+    if (from->next == from) {
+        return;
+    }
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    from->prev = from->next = from;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+WheelTimer::WheelTimer(float second, std::function<bool()> cb, const EventPoller::Ptr &poller) {
+    _poller = poller ? poller : EventPollerPool::Instance().getPoller();
+    _node = std::make_shared<TimerWheel::Node>();
+    _node->interval = std::max<uint64_t>(1, (uint64_t)(second * 1000 / TimerWheel::kTickMS));
+    _node->cb = std::move(cb);
+    auto node = _node;
+    auto poller_copy = _poller;
+    _poller->async([node, poller_copy]() { TimerWheel::getInstance(poller_copy)->add(node); });
+}
+
+WheelTimer::~WheelTimer() {
+    cancel();
+}
+
+void WheelTimer::cancel() {
+    if (!_node) {
+        return;
+    }
+    _node->cancelled = true;
+    auto node = std::move(_node);
+    auto poller = _poller;
+    _poller->async([node, poller]() { TimerWheel::getInstance(poller)->remove(node.get()); });
+}
+
+} // namespace mediakit
@@ -0,0 +1,136 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_TIMERWHEEL_H
+#define ZLMEDIAKIT_TIMERWHEEL_H
+
+#include <memory>
+#include <functional>
+#include "Poller/EventPoller.h"
+
+namespace mediakit {
+
+/**
+ * 分层时间轮，每个poller线程一个，所有定时任务共用该poller的一个延时任务，添加与删除定时任务为O(1)
+ * 适用于大量低精度的超时检测(例如上万路rtp推流)，相比每个对象一个toolkit::Timer，大幅减少poller定时器数量与唤醒次数
+ * 只在所属poller线程访问，请通过WheelTimer使用
+ * Hierarchical timer wheel, one per poller thread, all timed tasks share one delayed task of the poller, adding and removing timed tasks is O(1)
+ * Suitable for a large number of low-precision timeout checks (such as tens of thousands of rtp push streams), compared with one toolkit::Timer per object,
+ * greatly reduces the number of poller timers and wakeups
+ * Only accessed in the owner poller thread, please use it through WheelTimer
+ */
+class TimerWheel : public std::enable_shared_from_this<TimerWheel> {
+public:
+    using Ptr = std::shared_ptr<TimerWheel>;
+    struct Node;
+
+    // 时间轮精度(毫秒)，定时任务的触发时间误差不超过该值(poller繁忙时除外)
+    // Timer wheel precision (milliseconds), the trigger time error of timed tasks does not exceed this value (except when the poller is busy)
+    static constexpr uint64_t kTickMS = 100;
+
+    TimerWheel(toolkit::EventPoller::Ptr poller);
+    ~TimerWheel();
+
+    /**
+     * 获取poller对应的时间轮，必须在该poller线程调用
+     * Get the timer wheel of the poller, must be called in the poller thread
+     */
+    static const Ptr &getInstance(const toolkit::EventPoller::Ptr &poller);
+
+    void add(const std::shared_ptr<Node> &node);
+    void remove(Node *node);
+
+    /**
+     * 定时任务个数
+     * Number of timed tasks
+     */
+    size_t size() const;
+
+    /**
+     * 时间轮被唤醒的次数
+     * Number of times the timer wheel was woken up
+     */
+    uint64_t wakeups() const;
+
+private:
+    struct ListHook {
+        ListHook *prev = this;
+        ListHook *next = this;
+    };
+
+    uint64_t currentTick() const;
+    uint64_t onWake();
+    void schedule(uint64_t tick);
+    void insert(Node *node);
+    void advance(uint64_t tick);
+    void cascade(ListHook *head);
+    void fire(ListHook *head);
+    uint64_t nextTick() const;
+
+    static void link(ListHook *head, ListHook *hook);
+    static void unlink(ListHook *hook);
+    static void moveList(ListHook *from, ListHook *to);
+
+private:
+    // 第一层256个槽(25.6秒)，之后每层64个槽，总跨度约77天
+    // The first level has 256 slots (25.6 seconds), then 64 slots per level, the total span is about 77 days
+    static constexpr int kLevel0Bits = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevels = 3;
+
+    size_t _size = 0;
+    uint64_t _wakeups = 0;
+    // 已经处理到的tick
+    // The tick that has been processed
+    uint64_t _now = 0;
+    // 已预约的唤醒tick
+    // Scheduled wake up tick
+    uint64_t _wake_tick = 0;
+    uint64_t _start_ms;
+    ListHook _level0[1 << kLevel0Bits];
+    ListHook _levels[kLevels][1 << kLevelBits];
+    toolkit::EventPoller::Ptr _poller;
+    toolkit::EventPoller::DelayTask::Ptr _delay_task;
+};
+
+/**
+ * 基于时间轮的定时器，用法同toolkit::Timer，精度为TimerWheel::kTickMS
+ * Timer based on timer wheel, the usage is the same as toolkit::Timer, the precision is TimerWheel::kTickMS
+ */
+class WheelTimer {
+public:
+    using Ptr = std::shared_ptr<WheelTimer>;
+
+    /**
+     * 构造定时器
+     * @param second 定时器重复秒数
+     * @param cb 定时器任务，返回true表示重复下次任务，否则不重复，如果任务中抛异常，则默认重复下次任务
+     * @param poller EventPoller对象，可以为nullptr
+     * Construct timer
+     * @param second Timer repeat seconds
+     * @param cb Timer task, return true to repeat the next task, otherwise do not repeat, if an exception is thrown in the task, the next task is repeated by default
+     * @param poller EventPoller object, can be nullptr
+     */
+    WheelTimer(float second, std::function<bool()> cb, const toolkit::EventPoller::Ptr &poller);
+    ~WheelTimer();
+
+    /**
+     * 取消定时器，可以在任意线程调用
+     * Cancel the timer, can be called in any thread
+     */
+    void cancel();
+
+private:
+    toolkit::EventPoller::Ptr _poller;
+    std::shared_ptr<TimerWheel::Node> _node;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_TIMERWHEEL_H
@@ -88,6 +88,8 @@ const string kWaitAddTrackMS = GENERAL_FIELD "wait_add_track_ms";
 const string kUnreadyFrameCache = GENERAL_FIELD "unready_frame_cache";
 const string kBroadcastPlayerCountChanged = GENERAL_FIELD "broadcast_player_count_changed";
 const string kListenIP = GENERAL_FIELD "listen_ip";
+const string kEnableKTls = GENERAL_FIELD "enable_ktls";
+const string kPollerArena = GENERAL_FIELD "poller_arena";
 
 static onceToken token([]() {
     mINI::Instance()[kFlowThreshold] = 1024;
@@ -105,6 +107,8 @@ static onceToken token([]() {
     mINI::Instance()[kUnreadyFrameCache] = 100;
     mINI::Instance()[kBroadcastPlayerCountChanged] = 0;
     mINI::Instance()[kListenIP] = "::";
+    mINI::Instance()[kEnableKTls] = 0;
+    mINI::Instance()[kPollerArena] = 0;
 });
 
 } // namespace General
@@ -116,6 +120,7 @@ const string kAddMuteAudio = string(kFieldName) + "add_mute_audio";
 const string kAutoClose = string(kFieldName) + "auto_close";
 const string kContinuePushMS = string(kFieldName) + "continue_push_ms";
 const string kPacedSenderMS = string(kFieldName) + "paced_sender_ms";
+const string kJitterBufferMS = string(kFieldName) + "jitter_buffer_ms";
 
 const string kEnableHls = string(kFieldName) + "enable_hls";
 const string kEnableHlsFmp4 = string(kFieldName) + "enable_hls_fmp4";
@@ -143,6 +148,7 @@ static onceToken token([]() {
     mINI::Instance()[kAddMuteAudio] = 1;
     mINI::Instance()[kContinuePushMS] = 15000;
     mINI::Instance()[kPacedSenderMS] = 0;
+    mINI::Instance()[kJitterBufferMS] = 0;
     mINI::Instance()[kAutoClose] = 0;
 
     mINI::Instance()[kEnableHls] = 1;
@@ -230,6 +236,8 @@ const string kKeepAliveSecond = RTSP_FIELD "keepAliveSecond";
 const string kDirectProxy = RTSP_FIELD "directProxy";
 const string kLowLatency = RTSP_FIELD"lowLatency";
 const string kRtpTransportType = RTSP_FIELD"rtpTransportType";
+const string kTcpBatchMaxPackets = RTSP_FIELD "tcpBatchMaxPackets";
+const string kTcpBatchMaxBytes = RTSP_FIELD "tcpBatchMaxBytes";
 
 static onceToken token([]() {
     // 默认Md5方式认证  [AUTO-TRANSLATED:6155d989]
@@ -240,6 +248,10 @@ static onceToken token([]() {
     mINI::Instance()[kDirectProxy] = 1;
     mINI::Instance()[kLowLatency] = 0;
     mINI::Instance()[kRtpTransportType] = -1;
+    // 与linux IOV_MAX保持一致
+    // Consistent with linux IOV_MAX
+    mINI::Instance()[kTcpBatchMaxPackets] = 1024;
+    mINI::Instance()[kTcpBatchMaxBytes] = 1024 * 1024;
 });
 } // namespace Rtsp
 
@@ -314,6 +326,10 @@ const string kFileBufSize = RECORD_FIELD "fileBufSize";
 const string kFastStart = RECORD_FIELD "fastStart";
 const string kFileRepeat = RECORD_FIELD "fileRepeat";
 const string kEnableFmp4 = RECORD_FIELD "enableFmp4";
+const string kFmp4Append = RECORD_FIELD "fmp4Append";
+const string kIndexCacheSize = RECORD_FIELD "indexCacheSize";
+const string kIndexSidecar = RECORD_FIELD "indexSidecar";
+const string kKeyFrameOnlySpeed = RECORD_FIELD "keyFrameOnlySpeed";
 
 static onceToken token([]() {
     mINI::Instance()[kAppName] = "record";
@@ -322,6 +338,10 @@ static onceToken token([]() {
     mINI::Instance()[kFastStart] = false;
     mINI::Instance()[kFileRepeat] = false;
     mINI::Instance()[kEnableFmp4] = false;
+    mINI::Instance()[kFmp4Append] = false;
+    mINI::Instance()[kIndexCacheSize] = 32;
+    mINI::Instance()[kIndexSidecar] = false;
+    mINI::Instance()[kKeyFrameOnlySpeed] = 4;
 });
 } // namespace Record
 
@@ -338,6 +358,9 @@ const string kFileBufSize = HLS_FIELD "fileBufSize";
 const string kBroadcastRecordTs = HLS_FIELD "broadcastRecordTs";
 const string kDeleteDelaySec = HLS_FIELD "deleteDelaySec";
 const string kFastRegister = HLS_FIELD "fastRegister";
+const string kEncrypt = HLS_FIELD "encrypt";
+const string kKeyRotateSegNum = HLS_FIELD "keyRotateSegNum";
+const string kKeyUriPrefix = HLS_FIELD "keyUriPrefix";
 
 static onceToken token([]() {
     mINI::Instance()[kSegmentDuration] = 2;
@@ -349,6 +372,9 @@ static onceToken token([]() {
     mINI::Instance()[kBroadcastRecordTs] = false;
     mINI::Instance()[kDeleteDelaySec] = 10;
     mINI::Instance()[kFastRegister] = false;
+    mINI::Instance()[kEncrypt] = false;
+    mINI::Instance()[kKeyRotateSegNum] = 0;
+    mINI::Instance()[kKeyUriPrefix] = "";
 });
 } // namespace Hls
 
@@ -367,6 +393,9 @@ const string kGopCache = RTP_PROXY_FIELD "gop_cache";
 const string kRtpG711DurMs = RTP_PROXY_FIELD "rtp_g711_dur_ms";
 const string kUdpRecvSocketBuffer = RTP_PROXY_FIELD "udp_recv_socket_buffer";
 const std::string kMergeFrame = RTP_PROXY_FIELD "merge_frame";
+const std::string kNativePSDemuxer = RTP_PROXY_FIELD "native_ps_demuxer";
+const std::string kPSPassthrough = RTP_PROXY_FIELD "ps_passthrough";
+const std::string kShareSendEncoder = RTP_PROXY_FIELD "share_send_encoder";
 
 static onceToken token([]() {
     mINI::Instance()[kDumpDir] = "";
@@ -380,6 +409,9 @@ static onceToken token([]() {
     mINI::Instance()[kRtpG711DurMs] = 100;
     mINI::Instance()[kUdpRecvSocketBuffer] = 4 * 1024 * 1024;
     mINI::Instance()[kMergeFrame] = 1;
+    mINI::Instance()[kNativePSDemuxer] = 1;
+    mINI::Instance()[kPSPassthrough] = 1;
+    mINI::Instance()[kShareSendEncoder] = 1;
 });
 } // namespace RtpProxy
 
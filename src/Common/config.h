@@ -262,6 +262,12 @@ extern const std::string kBroadcastPlayerCountChanged;
 // 绑定的本地网卡ip  [AUTO-TRANSLATED:daa90832]
 // Bound local network card ip
 extern const std::string kListenIP;
+// 是否启用linux内核tls(kTLS)卸载https/rtmps/rtsps的加密，内核不支持时自动回退为用户态ssl
+// Whether to enable linux kernel tls (kTLS) to offload the encryption of https/rtmps/rtsps, automatically fall back to user mode ssl when the kernel does not support it
+extern const std::string kEnableKTls;
+// 是否为每个poller线程绑定独立的jemalloc arena，减少多线程分配释放内存时的锁竞争(需要jemalloc)
+// Whether to bind an independent jemalloc arena for each poller thread to reduce lock contention when multiple threads allocate and free memory (jemalloc required)
+extern const std::string kPollerArena;
 } // namespace General
 
 namespace Protocol {
@@ -290,6 +296,12 @@ extern const std::string kContinuePushMS;
 // 该配置开启后可以解决一些流发送不平滑导致zlmediakit转发也不平滑的问题  [AUTO-TRANSLATED:0f2b1657]
 // Enabling this configuration can solve some problems where the stream is not sent smoothly, resulting in ZLMediaKit forwarding not being smooth
 extern const std::string kPacedSenderMS;
+// rtp推流(含国标ps/ts推流)自适应去抖动缓存的最大时长，单位毫秒，置0则关闭
+// 开启后根据到达抖动动态调整缓存时长并匀速输出帧，可以解决4G等网络下推流突发到达导致的转协议卡顿问题，但是会增加延时
+// Maximum duration of the adaptive de-jitter buffer for rtp push streams (including GB28181 ps/ts push streams), in milliseconds, set to 0 to close
+// When enabled, the buffer duration is dynamically adjusted according to the arrival jitter and frames are output evenly,
+// which can solve the stutter of protocol conversion caused by bursty arrival of push streams under 4G networks, but will increase latency
+extern const std::string kJitterBufferMS;
 
 // 是否开启转换为hls(mpegts)  [AUTO-TRANSLATED:bfc1167a]
 // Whether to enable conversion to HLS (MPEGTS)
@@ -419,6 +431,13 @@ extern const std::string kLowLatency;
 // 迫使客户端重新SETUP并切换到对应协议。目前支持FFMPEG和VLC  [AUTO-TRANSLATED:45f9cddb]
 // Force the client to re-SETUP and switch to the corresponding protocol. Currently supports FFMPEG and VLC
 extern const std::string kRtpTransportType;
+
+// rtsp over tcp播放时，单次批量发送(一次writev/sendmsg)的最大rtp包个数，0为不限制
+// Maximum number of rtp packets in one batch send (one writev/sendmsg) for rtsp over tcp playback, 0 means no limit
+extern const std::string kTcpBatchMaxPackets;
+// rtsp over tcp播放时，单次批量发送的最大字节数，0为不限制
+// Maximum bytes of one batch send for rtsp over tcp playback, 0 means no limit
+extern const std::string kTcpBatchMaxBytes;
 } // namespace Rtsp
 
 // //////////RTMP服务器配置///////////  [AUTO-TRANSLATED:8de6f41f]
@@ -493,6 +512,20 @@ extern const std::string kFileRepeat;
 // mp4录制文件是否采用fmp4格式  [AUTO-TRANSLATED:12559ae0]
 // Whether to use fmp4 format for MP4 recording files
 extern const std::string kEnableFmp4;
+// mp4录制是否直接追加写入fmp4直播共享复用器产生的分片(录制文件为fmp4格式)，不再单独复用一份
+// Whether mp4 recording appends the fragments generated by the shared fmp4 live muxer directly (the recording file is in fmp4 format), instead of muxing a separate copy
+extern const std::string kFmp4Append;
+// 内存中缓存mp4样本索引的文件个数，0代表不缓存
+// Number of files whose mp4 sample index is cached in memory, 0 means no cache
+extern const std::string kIndexCacheSize;
+// 是否把mp4样本索引保存为同目录下的.idx文件，重启后也无需重新解析moov
+// Whether to save the mp4 sample index as a .idx file in the same directory, so moov does not need to be parsed again after restart
+extern const std::string kIndexSidecar;
+// mp4点播倍速大于等于该值时只读取视频关键帧(音频丢弃)，以免按倍速读取全部数据导致磁盘与网络带宽暴涨，0代表关闭
+// 倒放(负倍速)总是只读取关键帧
+// When the mp4 vod speed is greater than or equal to this value, only video key frames are read (audio is dropped), to avoid disk and network bandwidth surges caused by reading all data at multiple speed, 0 means disabled
+// Reverse playback (negative speed) always reads only key frames
+extern const std::string kKeyFrameOnlySpeed;
 } // namespace Record
 
 // //////////HLS相关配置///////////  [AUTO-TRANSLATED:873cc84c]
@@ -525,6 +558,15 @@ extern const std::string kDeleteDelaySec;
 // 如果设置为1，则第一个切片长度强制设置为1个GOP  [AUTO-TRANSLATED:fbbb651d]
 // If set to 1, the length of the first slice is forced to be 1 GOP
 extern const std::string kFastRegister;
+// 是否对hls切片进行AES-128加密(需要ENABLE_OPENSSL)
+// Whether to encrypt hls segments with AES-128 (ENABLE_OPENSSL required)
+extern const std::string kEncrypt;
+// 每隔多少个切片更换一次密钥，0代表不更换
+// Rotate the key every N segments, 0 means never rotate
+extern const std::string kKeyRotateSegNum;
+// m3u8中密钥URI的前缀，置空则为相对m3u8的路径
+// Prefix of the key URI in m3u8, relative to the m3u8 if empty
+extern const std::string kKeyUriPrefix;
 } // namespace Hls
 
 // //////////Rtp代理相关配置///////////  [AUTO-TRANSLATED:7b285587]
@@ -565,6 +607,17 @@ extern const std::string kRtpG711DurMs;
 extern const std::string kUdpRecvSocketBuffer;
 // ps/ts解析后是否等待下一帧以判断本帧是否完整，开启后提高兼容性，但是可能增加延时
 extern const std::string kMergeFrame;
+// 是否使用内置的流式ps解复用器(直接解析rtp负载，减少内存拷贝)，关闭时使用libmpeg解复用
+// Whether to use the built-in streaming ps demuxer (parse rtp payloads directly, reduce memory copies), use libmpeg to demux when disabled
+extern const std::string kNativePSDemuxer;
+// startSendRtp发送ps且源为国标ps推流时，是否直接转发原始rtp包(只改写ssrc/seq/时间戳)，省去ps解复用后再复用
+// When startSendRtp sends ps and the source is a GB28181 ps stream, whether to forward the original rtp packets directly (only rewrite ssrc/seq/stamp), saving ps remuxing after demuxing
+extern const std::string kPSPassthrough;
+// 同一路流的多个startSendRtp目标，负载类型、打包模式与mtu相同时是否共用一份打包输出，每个目标只改写ssrc与seq
+// 开启后，加入已有共享组的目标从下一个关键帧开始发送(不再回放gop缓存)
+// Whether multiple startSendRtp targets of the same stream share one packetization output when the payload type, packing mode and mtu are the same, each target only rewrites ssrc and seq
+// When enabled, a target that joins an existing sharing group starts sending from the next key frame (the gop cache is no longer replayed)
+extern const std::string kShareSendEncoder;
 } // namespace RtpProxy
 
 /**
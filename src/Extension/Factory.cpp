@@ -218,7 +218,7 @@ Frame::Ptr Factory::getFrameFromPtr(CodecId codec, const char *data, size_t byte
     if (it == s_plugins.end()) {
         // 创建不支持codec的frame  [AUTO-TRANSLATED:00936c6c]
         // Create a frame that does not support the codec
-        return std::make_shared<FrameFromPtr>(codec, (char *)data, bytes, dts, pts);
+        return makeFrame<FrameFromPtr>(codec, (char *)data, bytes, dts, pts);
     }
     return it->second->getFrameFromPtr(data, bytes, dts, pts);
 }
@@ -228,7 +228,7 @@ Frame::Ptr Factory::getFrameFromBuffer(CodecId codec, Buffer::Ptr data, uint64_t
     if (!frame) {
         return nullptr;
     }
-    return std::make_shared<FrameCacheAble>(frame, false, std::move(data));
+    return makeFrame<FrameCacheAble>(frame, false, std::move(data));
 }
 
 } // namespace mediakit
@@ -35,7 +35,24 @@ Frame::Ptr Frame::getCacheAbleFrame(const Frame::Ptr &frame){
     if(frame->cacheAble()){
         return frame;
     }
-    return std::make_shared<FrameCacheAble>(frame);
+    if (auto borrowed = dynamic_cast<FrameBorrowed *>(frame.get())) {
+        // 多个复用器共用一份拷贝
+        // Multiple muxers share one copy
+        return borrowed->getCacheAble();
+    }
+    return makeFrame<FrameCacheAble>(frame);
+}
+
+FrameBorrowed::FrameBorrowed(Frame::Ptr frame) {
+    setIndex(frame->getIndex());
+    _frame = std::move(frame);
+}
+
+const Frame::Ptr &FrameBorrowed::getCacheAble() const {
+    if (!_cache_able) {
+        _cache_able = makeFrame<FrameCacheAble>(_frame);
+    }
+    return _cache_able;
 }
 
 FrameStamp::FrameStamp(Frame::Ptr frame) {
@@ -18,6 +18,7 @@
 #include "Util/TimeTicker.h"
 #include "Common/Stamp.h"
 #include "Network/Buffer.h"
+#include "FramePool.h"
 
 namespace mediakit {
 
@@ -315,20 +316,10 @@ public:
 
     template <typename C = FrameImp>
     static std::shared_ptr<C> create() {
-#if 0
-        static ResourcePool<C> packet_pool;
-        static onceToken token([]() {
-            packet_pool.setSize(1024);
-        });
-        auto ret = packet_pool.obtain2();
-        ret->_buffer.clear();
-        ret->_prefix_size = 0;
-        ret->_dts = 0;
-        ret->_pts = 0;
-        return ret;
-#else
-        return std::shared_ptr<C>(new C());
-#endif
+        // 构造函数为protected，通过派生类构造；对象与引用计数从帧内存池分配
+        // The constructor is protected, constructed through a derived class; the object and reference count are allocated from the frame memory pool
+        struct PooledFrame : public C {};
+        return makeFrame<PooledFrame>();
     }
 
     char *data() const override { return (char *)_buffer.data(); }
@@ -494,7 +485,7 @@ public:
             _ptr = frame->data();
             _buffer = std::move(buf);
         } else {
-            auto buffer = std::make_shared<toolkit::BufferLikeString>();
+            auto buffer = std::allocate_shared<toolkit::BufferLikeString>(FramePoolAllocator<toolkit::BufferLikeString>());
             buffer->assign(frame->data(), frame->size());
             _ptr = buffer->data();
             _buffer = std::move(buffer);
@@ -558,6 +549,43 @@ private:
     Frame::Ptr _frame;
 };
 
+/**
+ * 同步分发过程中借用的不可缓存帧
+ * 第一个需要缓存的消费者通过Frame::getCacheAbleFrame拷贝一份，之后的消费者共用该拷贝，不会每个复用器各拷贝一次
+ * 该对象只能在同步分发过程中使用，不可跨线程或者异步保存
+ * Non-cacheable frame borrowed during synchronous dispatch
+ * The first consumer that needs to cache copies it through Frame::getCacheAbleFrame, and subsequent consumers share the copy,
+ * instead of each muxer copying it once
+ * This object can only be used during synchronous dispatch, and cannot be saved across threads or asynchronously
+ */
+class FrameBorrowed : public Frame {
+public:
+    using Ptr = std::shared_ptr<FrameBorrowed>;
+    FrameBorrowed(Frame::Ptr frame);
+
+    uint64_t dts() const override { return _frame->dts(); }
+    uint64_t pts() const override { return _frame->pts(); }
+    size_t prefixSize() const override { return _frame->prefixSize(); }
+    bool keyFrame() const override { return _frame->keyFrame(); }
+    bool configFrame() const override { return _frame->configFrame(); }
+    bool cacheAble() const override { return false; }
+    bool dropAble() const override { return _frame->dropAble(); }
+    bool decodeAble() const override { return _frame->decodeAble(); }
+    char *data() const override { return _frame->data(); }
+    size_t size() const override { return _frame->size(); }
+    CodecId getCodecId() const override { return _frame->getCodecId(); }
+
+    /**
+     * 获取可缓存的拷贝，只拷贝一次
+     * Get the cacheable copy, only copied once
+     */
+    const Frame::Ptr &getCacheAble() const;
+
+private:
+    Frame::Ptr _frame;
+    mutable Frame::Ptr _cache_able;
+};
+
 /**
  * 该对象可以把Buffer对象转换成可缓存的Frame对象
  * This object can convert a Buffer object into a cacheable Frame object
@@ -0,0 +1,219 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_FRAMEPOOL_H
+#define ZLMEDIAKIT_FRAMEPOOL_H
+
+#include <new>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace mediakit {
+
+/**
+ * 按块大小区分的线程本地内存块缓存，用于回收每帧都会创建的小对象
+ * 块缓存在释放它的线程；跨poller扇出时释放线程的缓存会满而分配线程的缓存为空，
+ * 所以满了之后按批转移到全局仓库，缓存为空的线程再从仓库整批取回，加锁开销按批摊薄
+ * Thread-local memory block cache distinguished by block size, used to recycle small objects created for each frame
+ * The block is cached in the thread that releases it; with cross-poller fan-out, the cache of the releasing thread fills up while the cache of the allocating thread stays empty,
+ * so once full, blocks are moved to a global depot in batches, and threads with an empty cache take a whole batch back from the depot, the lock cost is amortized per batch
+ */
+template <size_t Size>
+class FrameBlockPool {
+public:
+    // 每个线程每种块大小最多缓存的个数
+    // The maximum number of blocks cached per thread per block size
+    static constexpr size_t kMaxCache = 1024;
+    // 线程与全局仓库之间每次转移的块个数
+    // The number of blocks transferred between a thread and the global depot at a time
+    static constexpr size_t kBatch = 64;
+    // 全局仓库最多缓存的批数，超出后直接释放
+    // The maximum number of batches cached in the global depot, released directly when exceeded
+    static constexpr size_t kMaxDepot = 256;
+
+    static void *allocate() {
+        auto &list = freeList();
+        if (!list.head) {
+            if (list.spill) {
+                // 先取回本线程尚未转移的块
+                // Take back the blocks of this thread that have not been transferred yet
+                list.head = list.spill;
+                list.count = list.spill_count;
+                list.spill = nullptr;
+                list.spill_count = 0;
+            } else if (!list.closed && (list.head = popBatch())) {
+                list.count = kBatch;
+            } else {
+                return ::operator new(Size);
+            }
+        }
+        auto ret = list.head;
+        list.head = ret->next;
+        --list.count;
+        return ret;
+    }
+
+    static void deallocate(void *ptr) {
+        auto &list = freeList();
+        if (list.closed) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto block = (Block *)ptr;
+        if (list.count < kMaxCache) {
+            block->next = list.head;
+            list.head = block;
+            ++list.count;
+            return;
+        }
+        // 本线程缓存已满，凑满一批后转移到全局仓库，供只分配不释放的线程使用
+        // The cache of this thread is full, transfer to the global depot after a batch is gathered, for the threads that only allocate and do not release
+        block->next = list.spill;
+        list.spill = block;
+        if (++list.spill_count == kBatch) {
+            pushBatch(list.spill);
+            list.spill = nullptr;
+            list.spill_count = 0;
+        }
+    }
+
+private:
+    struct Block {
+        Block *next;
+    };
+
+    // 平凡析构，线程退出时其他线程局部对象析构过程中释放帧也可以安全访问
+    // Trivially destructible, it can be accessed safely when frames are released during the destruction of other thread-local objects when the thread exits
+    struct FreeList {
+        Block *head;
+        size_t count;
+        // 正在凑批的溢出块
+        // The overflow blocks being gathered into a batch
+        Block *spill;
+        size_t spill_count;
+        bool closed;
+    };
+
+    // 每批为以nullptr结尾的kBatch个块的链表
+    // Each batch is a nullptr-terminated list of kBatch blocks
+    struct Depot {
+        std::mutex mtx;
+        std::vector<Block *> batches;
+    };
+
+    struct Drainer {
+        ~Drainer() {
+            auto &list = freeList();
+            freeBlocks(list.head);
+            freeBlocks(list.spill);
+            list.head = list.spill = nullptr;
+            list.count = list.spill_count = 0;
+            list.closed = true;
+        }
+    };
+
+    static void freeBlocks(Block *head) {
+        while (head) {
+            auto next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+
+    static Depot &depot() {
+        // 不析构，其他线程退出时仍可能访问
+        // Never destructed, other threads may still access it when exiting
+        static Depot *s_depot = new Depot;
+        return *s_depot;
+    }
+
+    static void pushBatch(Block *batch) {
+        auto &dp = depot();
+        {
+            std::lock_guard<std::mutex> lck(dp.mtx);
+            if (dp.batches.size() < kMaxDepot) {
+                dp.batches.emplace_back(batch);
+                return;
+            }
+        }
+        freeBlocks(batch);
+    }
+
+    static Block *popBatch() {
+        auto &dp = depot();
+        std::lock_guard<std::mutex> lck(dp.mtx);
+        if (dp.batches.empty()) {
+            return nullptr;
+        }
+        auto ret = dp.batches.back();
+        dp.batches.pop_back();
+        return ret;
+    }
+
+    static FreeList &freeList() {
+        static thread_local FreeList s_list;
+        static thread_local Drainer s_drainer;
+        (void)s_drainer;
+        return s_list;
+    }
+};
+
+/**
+ * 配合std::allocate_shared使用的分配器，引用计数与对象位于同一个内存块，并由FrameBlockPool回收
+ * Allocator used with std::allocate_shared, the reference count and the object are in the same memory block, and recycled by FrameBlockPool
+ */
+template <typename T>
+class FramePoolAllocator {
+public:
+    using value_type = T;
+
+    FramePoolAllocator() = default;
+    template <typename U>
+    FramePoolAllocator(const FramePoolAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        if (n != 1) {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T *>(Pool::allocate());
+    }
+
+    void deallocate(T *ptr, size_t n) {
+        if (n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        Pool::deallocate(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const FramePoolAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const FramePoolAllocator<U> &) const { return false; }
+
+private:
+    // 按16字节对齐归并块大小，让大小相近的帧类型共用缓存
+    // Merge the block size aligned by 16 bytes, so that frame types of similar size share the cache
+    using Pool = FrameBlockPool<(sizeof(T) + 15) / 16 * 16>;
+};
+
+/**
+ * 创建帧等每帧都会分配的小对象，稳定运行后不再申请堆内存
+ * Create small objects allocated for each frame such as frames, no more heap memory is requested after stable operation
+ */
+template <typename T, typename... ARGS>
+std::shared_ptr<T> makeFrame(ARGS &&...args) {
+    return std::allocate_shared<T>(FramePoolAllocator<T>(), std::forward<ARGS>(args)...);
+}
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_FRAMEPOOL_H
@@ -12,11 +12,15 @@
 #define ZLMEDIAKIT_FMP4MEDIASOURCEMUXER_H
 
 #include "FMP4MediaSource.h"
-#include "Record/MP4Muxer.h"
+#include "SharedFMP4Muxer.h"
 
 namespace mediakit {
 
-class FMP4MediaSourceMuxer final : public MP4MuxerMemory, public MediaSourceEventInterceptor,
+/**
+ * http/ws-fmp4直播源，只消费共享fmp4复用器的输出，自身不复用
+ * http/ws-fmp4 live source, only consumes the output of the shared fmp4 muxer and does not mux by itself
+ */
+class FMP4MediaSourceMuxer final : public FMP4Consumer, public MediaSourceEventInterceptor,
                                    public std::enable_shared_from_this<FMP4MediaSourceMuxer> {
 public:
     using Ptr = std::shared_ptr<FMP4MediaSourceMuxer>;
@@ -26,14 +30,6 @@ public:
         _media_src = std::make_shared<FMP4MediaSource>(tuple);
     }
 
-    ~FMP4MediaSourceMuxer() override {
-        try {
-            MP4MuxerMemory::flush();
-        } catch (std::exception &ex) {
-            WarnL << ex.what();
-        }
-    }
-
     void setListener(const std::weak_ptr<MediaSourceEvent> &listener){
         setDelegate(listener);
         _media_src->setListener(shared_from_this());
@@ -51,15 +47,16 @@ public:
         MediaSourceEventInterceptor::onReaderChanged(sender, size);
     }
 
-    bool inputFrame(const Frame::Ptr &frame) override {
-        if (_clear_cache && _option.fmp4_demand) {
-            _clear_cache = false;
-            _media_src->clearCache();
-        }
-        if (_enabled || !_option.fmp4_demand) {
-            return MP4MuxerMemory::inputFrame(frame);
+    void inputInitSegment(const std::string &init_segment) override {
+        _media_src->setInitSegment(init_segment);
+    }
+
+    bool inputFMP4(const FMP4Packet::Ptr &packet, bool key_frame) override {
+        if (!packet || !checkEnabled()) {
+            return false;
         }
-        return false;
+        _media_src->onWrite(packet, key_frame);
+        return true;
     }
 
     bool isEnabled() {
@@ -68,19 +65,13 @@ public:
         return _option.fmp4_demand ? (_clear_cache ? true : _enabled) : true;
     }
 
-    void addTrackCompleted() override {
-        MP4MuxerMemory::addTrackCompleted();
-        _media_src->setInitSegment(getInitSegment());
-    }
-
-protected:
-    void onSegmentData(std::string string, uint64_t stamp, bool key_frame) override {
-        if (string.empty()) {
-            return;
+private:
+    bool checkEnabled() {
+        if (_clear_cache && _option.fmp4_demand) {
+            _clear_cache = false;
+            _media_src->clearCache();
         }
-        FMP4Packet::Ptr packet = std::make_shared<FMP4Packet>(std::move(string));
-        packet->time_stamp = stamp;
-        _media_src->onWrite(std::move(packet), key_frame);
+        return _enabled || !_option.fmp4_demand;
     }
 
 private:
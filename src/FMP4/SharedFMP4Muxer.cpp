@@ -0,0 +1,126 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "SharedFMP4Muxer.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 单个gop最多缓存的分片个数，防止无关键帧时无限增长
+// Maximum number of cached fragments in one gop, to prevent unlimited growth when there is no key frame
+static constexpr size_t kMaxGopCacheSize = 1024;
+
+SharedFMP4Muxer::~SharedFMP4Muxer() {
+    try {
+        flush();
+    } catch (std::exception &ex) {
+        WarnL << ex.what();
+    }
+}
+
+void SharedFMP4Muxer::addTrackCompleted() {
+    MP4MuxerMemory::addTrackCompleted();
+    _track_completed = true;
+    auto &init_segment = getInitSegment();
+    for (auto it = _consumers.begin(); it != _consumers.end();) {
+        if (auto strong = it->lock()) {
+            strong->inputInitSegment(init_segment);
+            ++it;
+        } else {
+            it = _consumers.erase(it);
+        }
+    }
+}
+
+void SharedFMP4Muxer::resetTracks() {
+    MP4MuxerMemory::resetTracks();
+    _track_completed = false;
+    _gop.clear();
+    // 通知分片中断
+    // Notify fragment interruption
+    dispatch(nullptr, false);
+}
+
+void SharedFMP4Muxer::addConsumer(const FMP4Consumer::Ptr &consumer) {
+    if (!consumer) {
+        return;
+    }
+    _consumers.emplace_back(consumer);
+    if (!_track_completed) {
+        return;
+    }
+    consumer->inputInitSegment(getInitSegment());
+    for (auto &pkt : _gop) {
+        consumer->inputFMP4(pkt.packet, pkt.key_frame);
+    }
+}
+
+void SharedFMP4Muxer::removeConsumer(const FMP4Consumer::Ptr &consumer) {
+    for (auto it = _consumers.begin(); it != _consumers.end();) {
+        auto strong = it->lock();
+        if (!strong || strong == consumer) {
+            it = _consumers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SharedFMP4Muxer::enableGopCache(bool enable) {
+    _gop_cache = enable;
+    if (!enable) {
+        _gop.clear();
+    }
+}
+
+void SharedFMP4Muxer::pauseInput() {
+    _gop.clear();
+    _wait_key = true;
+}
+
+void SharedFMP4Muxer::onSegmentData(std::string string, uint64_t stamp, bool key_frame) {
+    if (string.empty()) {
+        return;
+    }
+    if (_wait_key) {
+        if (!key_frame) {
+            // 暂停输入后恢复，从关键帧开始输出
+            // Resumed after the input was paused, output from a key frame
+            return;
+        }
+        _wait_key = false;
+    }
+    // 分片只构造一次，各消费者共享引用
+    // The fragment is constructed only once, and the consumers share the reference
+    auto packet = std::make_shared<FMP4Packet>(std::move(string));
+    packet->time_stamp = stamp;
+    if (_gop_cache) {
+        if (key_frame || _gop.size() >= kMaxGopCacheSize) {
+            _gop.clear();
+        }
+        _gop.emplace_back(Packet { packet, key_frame });
+    }
+    dispatch(packet, key_frame);
+}
+
+void SharedFMP4Muxer::dispatch(const FMP4Packet::Ptr &packet, bool key_frame) {
+    for (auto it = _consumers.begin(); it != _consumers.end();) {
+        if (auto strong = it->lock()) {
+            strong->inputFMP4(packet, key_frame);
+            ++it;
+        } else {
+            it = _consumers.erase(it);
+        }
+    }
+}
+
+} // namespace mediakit
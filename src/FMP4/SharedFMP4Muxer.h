@@ -0,0 +1,108 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SHAREDFMP4MUXER_H
+#define ZLMEDIAKIT_SHAREDFMP4MUXER_H
+
+#include <vector>
+#include "FMP4MediaSource.h"
+#include "Record/MP4Muxer.h"
+
+namespace mediakit {
+
+/**
+ * 共享fmp4复用结果的消费者
+ * Consumer of the shared fmp4 muxer output
+ */
+class FMP4Consumer {
+public:
+    using Ptr = std::shared_ptr<FMP4Consumer>;
+    virtual ~FMP4Consumer() = default;
+
+    /**
+     * 输入fmp4 init segment，所有track就绪或者新加入时触发
+     * Input the fmp4 init segment, triggered when all tracks are ready or when the consumer is added
+     */
+    virtual void inputInitSegment(const std::string &init_segment) = 0;
+
+    /**
+     * 输入共享复用器产生的moof+mdat分片
+     * Input the moof+mdat fragment generated by the shared muxer
+     * @param packet 分片数据，nullptr代表轨道重置
+     * @param key_frame 是否有关键帧
+     * @return 未启用(按需模式下无人观看)时返回false
+     * @param packet Fragment data, nullptr means the tracks are reset
+     * @param key_frame Whether there is a key frame
+     * @return Returns false when disabled (no viewers in on-demand mode)
+     */
+    virtual bool inputFMP4(const FMP4Packet::Ptr &packet, bool key_frame) = 0;
+};
+
+/**
+ * 一路流只生成一次fmp4分片，分片由http/ws-fmp4、hls-fmp4与fmp4录制共享
+ * Generate fmp4 fragments only once per stream, the fragments are shared by http/ws-fmp4, hls-fmp4 and fmp4 recording
+ */
+class SharedFMP4Muxer final : public MP4MuxerMemory {
+public:
+    using Ptr = std::shared_ptr<SharedFMP4Muxer>;
+
+    ~SharedFMP4Muxer() override;
+
+    void addTrackCompleted() override;
+    void resetTracks() override;
+
+    /**
+     * 添加消费者，track已就绪时立即输出init segment，开启gop缓存时再补发最近一个gop
+     * Add a consumer, the init segment is output immediately if the tracks are ready, and the latest gop is sent if the gop cache is enabled
+     */
+    void addConsumer(const FMP4Consumer::Ptr &consumer);
+
+    /**
+     * 移除消费者
+     * Remove a consumer
+     */
+    void removeConsumer(const FMP4Consumer::Ptr &consumer);
+
+    /**
+     * 是否缓存最近一个gop的分片，用于中途加入的消费者
+     * Whether to cache the fragments of the latest gop, used for consumers added midway
+     */
+    void enableGopCache(bool enable);
+
+    /**
+     * 没有启用的消费者、停止输入帧期间调用；清空gop缓存，恢复输入后丢弃第一个关键帧之前的输出，
+     * 避免之后加入的消费者收到过期的gop或者从gop中间开始的数据
+     * Called while there is no enabled consumer and frames are not input; clear the gop cache, and drop the output before the first key frame after the input resumes,
+     * to prevent consumers added later from receiving a stale gop or data starting from the middle of a gop
+     */
+    void pauseInput();
+
+protected:
+    void onSegmentData(std::string string, uint64_t stamp, bool key_frame) override;
+
+private:
+    struct Packet {
+        FMP4Packet::Ptr packet;
+        bool key_frame;
+    };
+
+    void dispatch(const FMP4Packet::Ptr &packet, bool key_frame);
+
+private:
+    bool _gop_cache = false;
+    bool _wait_key = false;
+    bool _track_completed = false;
+    std::vector<std::weak_ptr<FMP4Consumer>> _consumers;
+    std::vector<Packet> _gop;
+};
+
+} // namespace mediakit
+
+#endif // ZLMEDIAKIT_SHAREDFMP4MUXER_H
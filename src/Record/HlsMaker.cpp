@@ -12,10 +12,80 @@
 #include "HlsMaker.h"
 #include "Common/config.h"
 
+#if defined(ENABLE_OPENSSL)
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#endif
+
 using namespace std;
 
 namespace mediakit {
 
+#if defined(ENABLE_OPENSSL)
+// AES-128-CBC加密上下文，EVP接口会自动使用AES-NI等硬件加速
+// AES-128-CBC encryption context, the EVP interface uses hardware acceleration such as AES-NI automatically
+class HlsCipher {
+public:
+    HlsCipher() {
+        _ctx = EVP_CIPHER_CTX_new();
+        if (!_ctx) {
+            throw std::runtime_error("EVP_CIPHER_CTX_new failed");
+        }
+    }
+
+    ~HlsCipher() {
+        EVP_CIPHER_CTX_free(_ctx);
+    }
+
+    static std::string makeKey() {
+        std::string key(16, '\0');
+        if (RAND_bytes((uint8_t *)&key[0], (int)key.size()) != 1) {
+            throw std::runtime_error("RAND_bytes failed");
+        }
+        return key;
+    }
+
+    // 以切片序号作为IV(大端128位)，与EXT-X-KEY中的IV属性一致
+    // Use the segment index as the IV (128 bits big endian), consistent with the IV attribute in EXT-X-KEY
+    bool init(const std::string &key, uint64_t index) {
+        uint8_t iv[16] = { 0 };
+        for (int i = 0; i < 8; ++i) {
+            iv[15 - i] = (index >> (8 * i)) & 0xFF;
+        }
+        return EVP_EncryptInit_ex(_ctx, EVP_aes_128_cbc(), nullptr, (const uint8_t *)key.data(), iv) == 1;
+    }
+
+    // 输出已经凑满整数个分组的密文，余下的字节留到下次或者final时输出
+    // Output the ciphertext of the complete blocks, the remaining bytes are output next time or at final
+    bool update(const char *data, size_t len, std::string &out) {
+        out.resize(len + 16);
+        int out_len = 0;
+        if (EVP_EncryptUpdate(_ctx, (uint8_t *)&out[0], &out_len, (const uint8_t *)data, (int)len) != 1) {
+            out.clear();
+            return false;
+        }
+        out.resize(out_len);
+        return true;
+    }
+
+    // 输出PKCS7填充后的最后一个分组
+    // Output the last block with PKCS7 padding
+    bool final(std::string &out) {
+        out.resize(16);
+        int out_len = 0;
+        if (EVP_EncryptFinal_ex(_ctx, (uint8_t *)&out[0], &out_len) != 1) {
+            out.clear();
+            return false;
+        }
+        out.resize(out_len);
+        return true;
+    }
+
+private:
+    EVP_CIPHER_CTX *_ctx = nullptr;
+};
+#endif // defined(ENABLE_OPENSSL)
+
 HlsMaker::HlsMaker(bool is_fmp4, float seg_duration, uint32_t seg_number, bool seg_keep) {
     _is_fmp4 = is_fmp4;
     // 最小允许设置为0，0个切片代表点播  [AUTO-TRANSLATED:19235e8e]
@@ -23,12 +93,23 @@ HlsMaker::HlsMaker(bool is_fmp4, float seg_duration, uint32_t seg_number, bool s
     _seg_number = seg_number;
     _seg_duration = seg_duration;
     _seg_keep = seg_keep;
+
+    GET_CONFIG(bool, encrypt, Hls::kEncrypt);
+    GET_CONFIG(uint32_t, key_rotate, Hls::kKeyRotateSegNum);
+#if defined(ENABLE_OPENSSL)
+    _encrypt = encrypt;
+#else
+    if (encrypt) {
+        WarnL << "ENABLE_OPENSSL is not defined, hls encryption disabled";
+    }
+#endif
+    _key_rotate = key_rotate;
 }
 
 void HlsMaker::makeIndexFile(bool include_delay, bool eof) {
     GET_CONFIG(uint32_t, segDelay, Hls::kSegmentDelay);
     GET_CONFIG(uint32_t, segRetain, Hls::kSegmentRetain);
-    std::deque<std::tuple<int, std::string>> temp(_seg_dur_list);
+    std::deque<std::tuple<int, std::string, std::string>> temp(_seg_dur_list);
     if (!include_delay && _seg_number) {
         while (temp.size() > _seg_number) {
             temp.pop_front();
@@ -77,7 +158,7 @@ void HlsMaker::makeIndexFile(bool include_delay, bool eof) {
 
     stringstream ss;
     for (auto &tp : temp) {
-        ss << "#EXTINF:" << std::setprecision(3) << std::get<0>(tp) / 1000.0 << ",\n" << std::get<1>(tp) << "\n";
+        ss << std::get<2>(tp) << "#EXTINF:" << std::setprecision(3) << std::get<0>(tp) / 1000.0 << ",\n" << std::get<1>(tp) << "\n";
     }
     index_str += ss.str();
 
@@ -110,6 +191,22 @@ void HlsMaker::inputData(const char *data, size_t len, uint64_t timestamp, bool
         if (!_last_file_name.empty()) {
             // 存在切片才写入ts数据  [AUTO-TRANSLATED:ddd46115]
             // Write ts data only if there are slices
+#if defined(ENABLE_OPENSSL)
+            if (_seg_encrypted) {
+                // 切片生成时加密一次，所有观看者共享密文
+                // Encrypt once when the segment is generated, all viewers share the ciphertext
+                if (!_cipher->update(data, len, _cipher_buf)) {
+                    // 已写入的密文无法恢复，丢弃本切片
+                    // The ciphertext already written can't be recovered, drop this segment
+                    WarnL << "EVP_EncryptUpdate failed, drop hls segment: " << _seg_index;
+                    dropLastSegment();
+                    return;
+                }
+                if (!_cipher_buf.empty()) {
+                    onWriteSegment(_cipher_buf.data(), _cipher_buf.size());
+                }
+            } else
+#endif
             onWriteSegment(data, len);
             _last_timestamp = timestamp;
         }
@@ -152,7 +249,9 @@ void HlsMaker::addNewSegment(uint64_t stamp) {
     flushLastSegment(false);
     // 新增切片  [AUTO-TRANSLATED:b8623419]
     // Add a new slice
-    _last_file_name = onOpenSegment(_file_index++);
+    auto index = _file_index++;
+    _last_file_name = onOpenSegment(index);
+    openCipher(index);
     // 记录本次切片的起始时间戳  [AUTO-TRANSLATED:8eb776e9]
     // Record the starting timestamp of this slice
     _last_seg_timestamp = _last_timestamp ? _last_timestamp : stamp;
@@ -165,13 +264,31 @@ void HlsMaker::flushLastSegment(bool eof){
         // There is no previous slice
         return;
     }
+#if defined(ENABLE_OPENSSL)
+    if (_seg_encrypted) {
+        if (!_cipher->final(_cipher_buf)) {
+            WarnL << "EVP_EncryptFinal_ex failed, drop hls segment: " << _seg_index;
+            dropLastSegment();
+            if (eof) {
+                // 更新m3u8的结束标记
+                // Update the end mark of the m3u8
+                makeIndexFile(false, eof);
+                if (segDelay) {
+                    makeIndexFile(true, eof);
+                }
+            }
+            return;
+        }
+        onWriteSegment(_cipher_buf.data(), _cipher_buf.size());
+    }
+#endif
     // 文件创建到最后一次数据写入的时间即为切片长度  [AUTO-TRANSLATED:1f85739c]
     // The time from file creation to the last data write is the slice length
     auto seg_dur = _last_timestamp - _last_seg_timestamp;
     if (seg_dur <= 0) {
         seg_dur = 100;
     }
-    _seg_dur_list.emplace_back(seg_dur, std::move(_last_file_name));
+    _seg_dur_list.emplace_back(seg_dur, std::move(_last_file_name), _key_tag);
     delOldSegment();
     // 先flush ts切片，否则可能存在ts文件未写入完毕就被访问的情况  [AUTO-TRANSLATED:f8d6dc87]
     // Flush the ts slice first, otherwise there may be a situation where the ts file is not written completely before it is accessed
@@ -198,12 +315,60 @@ bool HlsMaker::isFmp4() const {
     return _is_fmp4;
 }
 
+void HlsMaker::dropLastSegment() {
+    // 不写入m3u8，下一个切片复用该序号，保证media sequence连续；未flush的切片文件由onOpenSegment删除
+    // Not written to the m3u8, the next segment reuses the index to keep the media sequence continuous;
+    // the unflushed segment file is deleted by onOpenSegment
+    _last_file_name.clear();
+    _seg_encrypted = false;
+    --_file_index;
+}
+
 void HlsMaker::clear() {
     _file_index = 0;
     _last_timestamp = 0;
     _last_seg_timestamp = 0;
     _seg_dur_list.clear();
     _last_file_name.clear();
+    // 重新开始后换新密钥
+    // Use a new key after restarting
+    _key.clear();
+}
+
+void HlsMaker::openCipher(uint64_t index) {
+    if (!_encrypt) {
+        return;
+    }
+#if defined(ENABLE_OPENSSL)
+    if (!_cipher) {
+        _cipher = std::make_shared<HlsCipher>();
+    }
+    if (_key.empty() || (_key_rotate && index - _key_index >= _key_rotate)) {
+        _key = HlsCipher::makeKey();
+        _key_index = index;
+        _key_uri = onWriteKey(index, _key);
+    }
+    _seg_index = index;
+    _seg_encrypted = _cipher->init(_key, index);
+    if (!_seg_encrypted) {
+        WarnL << "EVP_EncryptInit_ex failed, write hls segment " << index << " in plaintext";
+    }
+    _key_tag = getKeyTag(_key_uri);
+#endif
+}
+
+std::string HlsMaker::getKeyTag(const std::string &uri) const {
+    if (!_encrypt) {
+        return "";
+    }
+    if (!_seg_encrypted) {
+        // 加密失败回退为明文，需要显式关闭前面切片的密钥
+        // Fall back to plaintext when encryption fails, the key of the previous segments must be turned off explicitly
+        return "#EXT-X-KEY:METHOD=NONE\n";
+    }
+    char iv[33];
+    snprintf(iv, sizeof(iv), "%032llx", (unsigned long long)_seg_index);
+    return "#EXT-X-KEY:METHOD=AES-128,URI=\"" + uri + "\",IV=0x" + iv + "\n";
 }
 
 }//namespace mediakit
@@ -14,6 +14,7 @@
 #include <string>
 #include <deque>
 #include <tuple>
+#include <memory>
 #include <cstdint>
 
 namespace mediakit {
@@ -160,6 +161,26 @@ protected:
      */
     virtual void onFlushLastSegment(uint64_t duration_ms) {};
 
+    /**
+     * 保存新的AES-128密钥回调，开启hls.encrypt时每次换密钥触发
+     * @param index 首个使用该密钥的切片序号
+     * @param key 16字节密钥
+     * @return 写入m3u8的密钥URI
+     * Save a new AES-128 key callback, triggered on every key change when hls.encrypt is enabled
+     * @param index Index of the first segment using this key
+     * @param key 16 bytes key
+     * @return Key URI written to the m3u8
+     */
+    virtual std::string onWriteKey(uint64_t index, const std::string &key) { return ""; };
+
+    /**
+     * 获取当前切片的EXT-X-KEY标签，未加密时返回空
+     * @param uri 密钥URI
+     * Get the EXT-X-KEY tag of the current segment, returns empty if not encrypted
+     * @param uri Key URI
+     */
+    std::string getKeyTag(const std::string &uri) const;
+
     /**
      * 关闭上个ts切片并且写入m3u8索引
      * @param eof HLS直播是否已结束
@@ -199,6 +220,18 @@ private:
      */
     void addNewSegment(uint64_t timestamp);
 
+    /**
+     * 为新切片准备加密上下文，必要时更换密钥
+     * Prepare the encryption context for a new segment, change the key if necessary
+     */
+    void openCipher(uint64_t index);
+
+    /**
+     * 丢弃当前切片(加密失败时)，不写入m3u8
+     * Drop the current segment (when encryption fails), it's not written to the m3u8
+     */
+    void dropLastSegment();
+
 private:
     bool _is_fmp4 = false;
     float _seg_duration = 0;
@@ -208,7 +241,22 @@ private:
     uint64_t _last_seg_timestamp = 0;
     uint64_t _file_index = 0;
     std::string _last_file_name;
-    std::deque<std::tuple<int,std::string> > _seg_dur_list;
+    // 切片时长、切片名、EXT-X-KEY标签
+    // Segment duration, segment name, EXT-X-KEY tag
+    std::deque<std::tuple<int, std::string, std::string> > _seg_dur_list;
+
+    bool _encrypt = false;
+    uint32_t _key_rotate = 0;
+    uint64_t _key_index = 0;
+    uint64_t _seg_index = 0;
+    // 当前切片是否加密
+    // Whether the current segment is encrypted
+    bool _seg_encrypted = false;
+    std::string _key;
+    std::string _key_uri;
+    std::string _key_tag;
+    std::string _cipher_buf;
+    std::shared_ptr<class HlsCipher> _cipher;
 };
 
 }//namespace mediakit
@@ -82,6 +82,9 @@ void HlsMakerImp::clearCache(bool immediately, bool eof) {
         if (!_path_init.empty() && eof) {
             lst.emplace_back(_path_init);
         }
+        for (auto &pr : _key_file_paths) {
+            lst.emplace_back(std::move(pr.second));
+        }
         for (auto &pr : _segment_file_paths) {
             lst.emplace_back(std::move(pr.second));
         }
@@ -102,6 +105,7 @@ void HlsMakerImp::clearCache(bool immediately, bool eof) {
     clear();
     _file = nullptr;
     _segment_file_paths.clear();
+    _key_file_paths.clear();
 }
 
 /** 写入该目录的init.mp4文件以及m3u8文件 **/
@@ -134,7 +138,7 @@ void HlsMakerImp::saveCurrentDir() {
     }
     stringstream ss;
     for (auto &t : _current_dir_seg_list) {
-        ss << "#EXTINF:" << std::setprecision(3) << std::get<0>(t) / 1000.0 << ",\n" << std::get<1>(t) << "\n";
+        ss << std::get<2>(t) << "#EXTINF:" << std::setprecision(3) << std::get<0>(t) / 1000.0 << ",\n" << std::get<1>(t) << "\n";
     }
     _current_dir_seg_list.clear();
     index_str += ss.str();
@@ -145,6 +149,13 @@ void HlsMakerImp::saveCurrentDir() {
 }
 
 string HlsMakerImp::onOpenSegment(uint64_t index) {
+    if (_file) {
+        // 上个切片未flush就被丢弃(加密失败)，本切片复用其序号，删除其文件
+        // The previous segment was dropped without flushing (encryption failed), this segment reuses its index, delete its file
+        _file = nullptr;
+        File::delete_file(_info.file_path.data(), true);
+        _segment_file_paths.erase(index);
+    }
     string segment_name, segment_path;
     {
         auto strDate = getTimeStr("%Y-%m-%d");
@@ -184,6 +195,17 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
 }
 
 void HlsMakerImp::onDelSegment(uint64_t index) {
+    // 删除所有切片都已删除的旧密钥
+    // Delete the old keys whose segments have all been deleted
+    while (_key_file_paths.size() > 1) {
+        auto next = std::next(_key_file_paths.begin());
+        if (next->first > index + 1) {
+            break;
+        }
+        File::delete_file(_key_file_paths.begin()->second.data(), true);
+        _key_file_paths.erase(_key_file_paths.begin());
+    }
+
     auto it = _segment_file_paths.find(index);
     if (it == _segment_file_paths.end()) {
         return;
@@ -234,7 +256,11 @@ void HlsMakerImp::onFlushLastSegment(uint64_t duration_ms) {
     // Close and flush file to disk
     _file = nullptr;
     if (!isLive() || isKeep()) {
-        _current_dir_seg_list.emplace_back(duration_ms, _info.file_name.erase(0, _current_dir.size()));
+        // 点播m3u8位于切片所在的日期/小时目录，密钥在上两级目录
+        // The vod m3u8 is in the date/hour directory of the segments, and the key is two levels up
+        GET_CONFIG(string, key_uri_prefix, Hls::kKeyUriPrefix);
+        auto key_tag = getKeyTag((key_uri_prefix.empty() ? "../../" : key_uri_prefix) + _key_name);
+        _current_dir_seg_list.emplace_back(duration_ms, _info.file_name.erase(0, _current_dir.size()), std::move(key_tag));
     }
     GET_CONFIG(bool, broadcastRecordTs, Hls::kBroadcastRecordTs);
     if (broadcastRecordTs) {
@@ -244,6 +270,28 @@ void HlsMakerImp::onFlushLastSegment(uint64_t duration_ms) {
     }
 }
 
+std::string HlsMakerImp::onWriteKey(uint64_t index, const std::string &key) {
+    GET_CONFIG(string, key_uri_prefix, Hls::kKeyUriPrefix);
+    // 文件名带上时间，防止重新推流后覆盖仍被录像引用的旧密钥
+    // The file name contains the time, to prevent overwriting the old keys still referenced by the records after republishing
+    _key_name = "key_" + getTimeStr("%Y-%m-%d_%H-%M-%S") + "_" + std::to_string(index) + ".key";
+    auto key_path = _path_prefix + "/" + _key_name;
+    auto file = makeFile(key_path);
+    if (file) {
+        fwrite(key.data(), key.size(), 1, file.get());
+    } else {
+        WarnL << "Create key file failed," << key_path << " " << get_uv_errmsg();
+    }
+    if (isLive() && !isKeep()) {
+        _key_file_paths.emplace(index, std::move(key_path));
+    }
+    auto uri = key_uri_prefix + _key_name;
+    if (_params.empty()) {
+        return uri;
+    }
+    return uri + "?" + _params;
+}
+
 std::shared_ptr<FILE> HlsMakerImp::makeFile(const string &file, bool setbuf) {
     auto file_buf = _file_buf;
     auto ret = shared_ptr<FILE>(File::create_file(file.data(), "wb"), [file_buf](FILE *fp) {
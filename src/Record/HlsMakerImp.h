@@ -59,6 +59,7 @@ protected:
     void onWriteSegment(const char *data, size_t len) override;
     void onWriteHls(const std::string &data, bool include_delay) override;
     void onFlushLastSegment(uint64_t duration_ms) override;
+    std::string onWriteKey(uint64_t index, const std::string &key) override;
 
 private:
     std::shared_ptr<FILE> makeFile(const std::string &file,bool setbuf = false);
@@ -74,13 +75,15 @@ private:
     std::string _path_prefix;
     std::string _current_dir;
     std::string _current_dir_init_file;
+    std::string _key_name;
     RecordInfo _info;
     std::shared_ptr<FILE> _file;
     std::shared_ptr<char> _file_buf;
     HlsMediaSource::Ptr _media_src;
     toolkit::EventPoller::Ptr _poller;
     std::map<uint64_t/*index*/,std::string/*file_path*/> _segment_file_paths;
-    std::deque<std::tuple<int,std::string> > _current_dir_seg_list;
+    std::map<uint64_t/*first segment index*/,std::string/*file_path*/> _key_file_paths;
+    std::deque<std::tuple<int, std::string, std::string> > _current_dir_seg_list;
 };
 
 }//namespace mediakit
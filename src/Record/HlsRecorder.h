@@ -13,13 +13,12 @@
 
 #include "HlsMakerImp.h"
 #include "MPEG.h"
-#include "MP4Muxer.h"
+#include "FMP4/SharedFMP4Muxer.h"
 #include "Common/config.h"
 
 namespace mediakit {
 
-template <typename Muxer>
-class HlsRecorderBase : public MediaSourceEventInterceptor, public Muxer, public std::enable_shared_from_this<HlsRecorderBase<Muxer> > {
+class HlsRecorderBase : public MediaSourceEventInterceptor, public std::enable_shared_from_this<HlsRecorderBase> {
 public:
     HlsRecorderBase(bool is_fmp4, const std::string &m3u8_file, const std::string &params, const ProtocolOption &option) {
         GET_CONFIG(uint32_t, hlsNum, Hls::kSegmentNum);
@@ -57,7 +56,14 @@ public:
         MediaSourceEventInterceptor::onReaderChanged(sender, size);
     }
 
-    bool inputFrame(const Frame::Ptr &frame) override {
+    bool isEnabled() {
+        // 缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存  [AUTO-TRANSLATED:7cfd4d49]
+        // When the cache has not been cleared, it is still allowed to trigger the inputFrame function to clear the cache in time
+        return _option.hls_demand ? (_clear_cache ? true : _enabled) : true;
+    }
+
+protected:
+    bool checkEnabled() {
         if (_clear_cache && _option.hls_demand) {
             _clear_cache = false;
             // 清空旧的m3u8索引文件于ts切片  [AUTO-TRANSLATED:a4ce0664]
@@ -65,16 +71,7 @@ public:
             _hls->clearCache();
             _hls->getMediaSource()->setIndexFile("");
         }
-        if (_enabled || !_option.hls_demand) {
-            return Muxer::inputFrame(frame);
-        }
-        return false;
-    }
-
-    bool isEnabled() {
-        // 缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存  [AUTO-TRANSLATED:7cfd4d49]
-        // When the cache has not been cleared, it is still allowed to trigger the inputFrame function to clear the cache in time
-        return _option.hls_demand ? (_clear_cache ? true : _enabled) : true;
+        return _enabled || !_option.hls_demand;
     }
 
 protected:
@@ -84,57 +81,57 @@ protected:
     std::shared_ptr<HlsMakerImp> _hls;
 };
 
-class HlsRecorder final : public HlsRecorderBase<MpegMuxer> {
+/**
+ * hls(ts)切片，只消费共享ts复用器的输出，自身不复用
+ * hls(ts) segmenter, only consumes the output of the shared ts muxer and does not mux by itself
+ */
+class HlsRecorder final : public HlsRecorderBase, public MpegConsumer {
 public:
     using Ptr = std::shared_ptr<HlsRecorder>;
     template <typename ...ARGS>
-    HlsRecorder(ARGS && ...args) : HlsRecorderBase<MpegMuxer>(false, std::forward<ARGS>(args)...) {}
-    ~HlsRecorder() override {
-        try {
-            this->flush();
-        } catch (std::exception &ex) {
-            WarnL << ex.what();
-        }
-    }
+    HlsRecorder(ARGS && ...args) : HlsRecorderBase(false, std::forward<ARGS>(args)...) {}
 
-private:
-    void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t timestamp, bool key_pos) override {
+    bool inputMpeg(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) override {
         if (!buffer) {
-            // reset tracks
+            // 轨道重置，不管是否启用都需要通知切片中断
+            // Tracks reset, notify the segment interruption whether enabled or not
             _hls->inputData(nullptr, 0, timestamp, key_pos);
-        } else {
-            _hls->inputData(buffer->data(), buffer->size(), timestamp, key_pos);
+            return true;
+        }
+        if (!checkEnabled()) {
+            return false;
         }
+        _hls->inputData(buffer->data(), buffer->size(), timestamp, key_pos);
+        return true;
     }
 };
 
-class HlsFMP4Recorder final : public HlsRecorderBase<MP4MuxerMemory> {
+/**
+ * hls(fmp4)切片，只消费共享fmp4复用器的输出，自身不复用
+ * hls(fmp4) segmenter, only consumes the output of the shared fmp4 muxer and does not mux by itself
+ */
+class HlsFMP4Recorder final : public HlsRecorderBase, public FMP4Consumer {
 public:
     using Ptr = std::shared_ptr<HlsFMP4Recorder>;
     template <typename ...ARGS>
-    HlsFMP4Recorder(ARGS && ...args) : HlsRecorderBase<MP4MuxerMemory>(true, std::forward<ARGS>(args)...) {}
-    ~HlsFMP4Recorder() override {
-        try {
-            this->flush();
-        } catch (std::exception &ex) {
-            WarnL << ex.what();
-        }
-    }
+    HlsFMP4Recorder(ARGS && ...args) : HlsRecorderBase(true, std::forward<ARGS>(args)...) {}
 
-    void addTrackCompleted() override {
-        HlsRecorderBase<MP4MuxerMemory>::addTrackCompleted();
-        auto data = getInitSegment();
-        _hls->inputInitSegment(data.data(), data.size());
+    void inputInitSegment(const std::string &init_segment) override {
+        _hls->inputInitSegment(init_segment.data(), init_segment.size());
     }
 
-private:
-    void onSegmentData(std::string buffer, uint64_t timestamp, bool key_pos) override {
-        if (buffer.empty()) {
-            // reset tracks
-            _hls->inputData(nullptr, 0, timestamp, key_pos);
-        } else {
-            _hls->inputData((char *)buffer.data(), buffer.size(), timestamp, key_pos);
+    bool inputFMP4(const FMP4Packet::Ptr &packet, bool key_frame) override {
+        if (!packet) {
+            // 轨道重置，不管是否启用都需要通知切片中断
+            // Tracks reset, notify the segment interruption whether enabled or not
+            _hls->inputData(nullptr, 0, 0, key_frame);
+            return true;
+        }
+        if (!checkEnabled()) {
+            return false;
         }
+        _hls->inputData(packet->data(), packet->size(), packet->time_stamp, key_frame);
+        return true;
     }
 };
 
@@ -10,10 +10,14 @@
 
 #ifdef ENABLE_MP4
 
+#include <ctime>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
 #include "MP4Demuxer.h"
 #include "Util/File.h"
 #include "Util/logger.h"
+#include "Thread/WorkThreadPool.h"
 #include "Extension/Factory.h"
 
 using namespace std;
@@ -30,14 +34,42 @@ void MP4Demuxer::openMP4(const string &file) {
 
     _mp4_file = std::make_shared<MP4FileDisk>();
     _mp4_file->openFile(file.data(), "rb+");
+    _index = MP4Index::get(file);
+    auto track_info = _index ? _index->getTrackInfo() : nullptr;
+    if (track_info) {
+        // 索引解析moov时已经生成track信息(或者命中缓存)，无需创建mov_reader再次解析moov
+        // The track information has been generated when the index parsed moov (or the cache is hit), no need to create mov_reader to parse moov again
+        for (auto &track : *track_info) {
+            if (track.video) {
+                onVideoTrack(track.track_id, track.object, track.width, track.height, track.extra.data(), track.extra.size());
+            } else {
+                onAudioTrack(track.track_id, track.object, track.channel_count, track.bit_per_sample, track.sample_rate, track.extra.data(), track.extra.size());
+            }
+        }
+        _duration_ms = _index->getDurationMS();
+        return;
+    }
+
     _mov_reader = _mp4_file->createReader();
     getAllTracks();
     _duration_ms = mov_reader_getduration(_mov_reader.get());
+    if (_index) {
+        // 索引无法识别样本描述(例如opus)，保存mov_reader解析的track信息后改为按索引读取样本
+        // The index cannot recognize the sample description (such as opus), read samples by index after saving the track information parsed by mov_reader
+        _index->setTrackInfo(std::move(_track_info));
+        _mov_reader.reset();
+    }
 }
 
 void MP4Demuxer::closeMP4() {
     _mov_reader.reset();
     _mp4_file.reset();
+    _index.reset();
+    _sample_pos = 0;
+    _key_only = false;
+    _reverse = false;
+    _file_offset = 0;
+    _track_info.clear();
 }
 
 int MP4Demuxer::getAllTracks() {
@@ -60,6 +92,16 @@ int MP4Demuxer::getAllTracks() {
 }
 
 void MP4Demuxer::onVideoTrack(uint32_t track, uint8_t object, int width, int height, const void *extra, size_t bytes) {
+    if (_mov_reader) {
+        MP4Index::TrackInfo info;
+        info.track_id = track;
+        info.video = true;
+        info.object = object;
+        info.width = width;
+        info.height = height;
+        info.extra.assign((const char *)extra, extra ? bytes : 0);
+        _track_info.emplace_back(std::move(info));
+    }
     auto video = Factory::getTrackByCodecId(getCodecByMovId(object));
     if (!video) {
         return;
@@ -72,6 +114,16 @@ void MP4Demuxer::onVideoTrack(uint32_t track, uint8_t object, int width, int hei
 }
 
 void MP4Demuxer::onAudioTrack(uint32_t track, uint8_t object, int channel_count, int bit_per_sample, int sample_rate, const void *extra, size_t bytes) {
+    if (_mov_reader) {
+        MP4Index::TrackInfo info;
+        info.track_id = track;
+        info.object = object;
+        info.channel_count = channel_count;
+        info.bit_per_sample = bit_per_sample;
+        info.sample_rate = sample_rate;
+        info.extra.assign((const char *)extra, extra ? bytes : 0);
+        _track_info.emplace_back(std::move(info));
+    }
     auto audio = Factory::getTrackByCodecId(getCodecByMovId(object), sample_rate, channel_count, bit_per_sample / channel_count);
     if (!audio) {
         return;
@@ -84,6 +136,20 @@ void MP4Demuxer::onAudioTrack(uint32_t track, uint8_t object, int channel_count,
 }
 
 int64_t MP4Demuxer::seekTo(int64_t stamp_ms) {
+    if (_index) {
+        if (_reverse) {
+            // 倒放时从不晚于该时间点的关键帧开始向前读
+            // When reversing, read backward from the key frame not later than the time point
+            auto &samples = _index->getSamples();
+            auto target = (uint32_t)std::max<int64_t>(0, std::min<int64_t>(stamp_ms, UINT32_MAX));
+            _sample_pos = std::upper_bound(samples.begin(), samples.end(), target, [](uint32_t stamp, const MP4Index::Sample &sample) {
+                return stamp < sample.dts;
+            }) - samples.begin();
+            return stamp_ms;
+        }
+        _sample_pos = _index->seek(stamp_ms);
+        return stamp_ms;
+    }
     if(0 != mov_reader_seek(_mov_reader.get(),&stamp_ms)){
         return -1;
     }
@@ -103,6 +169,9 @@ struct Context {
 Frame::Ptr MP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     keyFrame = false;
     eof = false;
+    if (_index) {
+        return readSample(keyFrame, eof);
+    }
 
     static mov_reader_onread2 mov_onalloc = [](void *param, uint32_t track_id, size_t bytes, int64_t pts, int64_t dts, int flags) -> void * {
         Context *ctx = (Context *) param;
@@ -138,6 +207,51 @@ Frame::Ptr MP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     }
 }
 
+bool MP4Demuxer::setKeyFrameOnly(bool enable, bool reverse) {
+    if (enable && (!_index || _index->getKeySamples().empty())) {
+        return false;
+    }
+    _key_only = enable;
+    _reverse = enable && reverse;
+    return true;
+}
+
+Frame::Ptr MP4Demuxer::readSample(bool &keyFrame, bool &eof) {
+    auto &samples = _index->getSamples();
+    size_t pos = _sample_pos;
+    if (_key_only) {
+        auto &keys = _index->getKeySamples();
+        auto it = std::lower_bound(keys.begin(), keys.end(), _sample_pos);
+        if (_reverse ? it == keys.begin() : it == keys.end()) {
+            eof = true;
+            return nullptr;
+        }
+        pos = _reverse ? *--it : *it;
+    }
+    if (pos >= samples.size()) {
+        eof = true;
+        return nullptr;
+    }
+    _sample_pos = _reverse ? pos : pos + 1;
+    auto &sample = samples[pos];
+    auto buffer = _buffer_pool.obtain2();
+    buffer->setCapacity(sample.size + 1);
+    buffer->setSize(sample.size);
+
+    MP4FileIO &io = *_mp4_file;
+    // 同一chunk内的样本是连续的，无需seek，可以利用文件io缓存
+    // Samples in the same chunk are continuous, no need to seek, the file io cache can be used
+    if ((_file_offset != sample.offset && 0 != io.onSeek(sample.offset)) || 0 != io.onRead(buffer->data(), sample.size)) {
+        _file_offset = 0;
+        eof = true;
+        WarnL << "读取mp4文件数据失败, offset: " << sample.offset << ", size: " << sample.size;
+        return nullptr;
+    }
+    _file_offset = sample.offset + sample.size;
+    keyFrame = sample.flags & MP4Index::kFlagKeyFrame;
+    return makeFrame(_index->getTrackId(sample), std::move(buffer), (int64_t)sample.dts + sample.cts, sample.dts);
+}
+
 Frame::Ptr MP4Demuxer::makeFrame(uint32_t track_id, Buffer::Ptr buf, int64_t pts, int64_t dts) {
     auto it = _tracks.find(track_id);
     if (it == _tracks.end()) {
@@ -194,11 +308,43 @@ uint64_t MP4Demuxer::getDurationMS() const {
 
 /////////////////////////////////////////////////////////////////////////////////
 
+// MP4Recorder生成的文件名：%Y-%m-%d-%H-%M-%S-序号.mp4
+// File name generated by MP4Recorder: %Y-%m-%d-%H-%M-%S-index.mp4
+static uint64_t getWallClockByFileName(const string &file) {
+    auto pos = file.find_last_of("/\\");
+    auto name = pos == string::npos ? file : file.substr(pos + 1);
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (6 != sscanf(name.data(), "%d-%d-%d-%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec)) {
+        return 0;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    auto ret = mktime(&tm);
+    return ret > 0 ? ret * 1000ULL : 0;
+}
+
+// 只获取文件时长，优先使用样本索引缓存，避免打开所有文件
+// Only get the file duration, use the sample index cache first to avoid opening all files
+static uint64_t getFileDuration(const string &file) {
+    auto index = MP4Index::get(file);
+    if (index) {
+        return index->getDurationMS();
+    }
+    MP4Demuxer demuxer;
+    demuxer.openMP4(file);
+    return demuxer.getDurationMS();
+}
+
 void MultiMP4Demuxer::openMP4(const string &files_string) {
+    closeMP4();
     std::vector<std::string> files;
     if (File::is_dir(files_string)) {
         File::scanDir(files_string, [&](const string &path, bool is_dir) {
-            if (!is_dir && end_with(path, ".mp4")) {
+            // 跳过正在录制的临时文件(以.开头)
+            // Skip the temporary file being recorded (starting with .)
+            if (!is_dir && end_with(path, ".mp4") && path[path.find_last_of("/\\") + 1] != '.') {
                 files.emplace_back(path);
             }
             return true;
@@ -208,16 +354,73 @@ void MultiMP4Demuxer::openMP4(const string &files_string) {
         files = split(files_string, ";");
     }
 
-    uint64_t duration_ms = 0;
     for (auto &file : files) {
-        auto demuxer = std::make_shared<MP4Demuxer>();
-        demuxer->openMP4(file);
-        _demuxers.emplace(duration_ms, demuxer);
-        duration_ms += demuxer->getDurationMS();
-    }
-    CHECK(!_demuxers.empty());
-    _it = _demuxers.begin();
-    for (auto &track : _it->second->getTracks(false)) {
+        Segment segment;
+        segment.file = file;
+        segment.wall_clock = getWallClockByFileName(file);
+        // 只查询内存缓存，不在调用者线程解析文件
+        // Only query the memory cache, do not parse the file in the caller thread
+        MP4Index::Ptr index;
+        if (MP4Index::getCached(file, index) && index) {
+            segment.duration = index->getDurationMS();
+            segment.resolved = true;
+        }
+        _segments.emplace_back(std::move(segment));
+    }
+    CHECK(!_segments.empty());
+    for (size_t i = 0; i < _segments.size(); ++i) {
+        if (_segments[i].wall_clock) {
+            _wall_clock_index.emplace_back(i);
+        }
+    }
+    std::stable_sort(_wall_clock_index.begin(), _wall_clock_index.end(), [&](size_t a, size_t b) {
+        return _segments[a].wall_clock < _segments[b].wall_clock;
+    });
+
+    // 打开第一个有效文件获取track信息
+    // Open the first valid file to get the track information
+    size_t first = 0;
+    while (first < _segments.size() && !openSegment(first)) {
+        _segments[first++].resolved = true;
+    }
+    CHECK(_demuxer, "No valid mp4 file: " + files_string);
+
+    // 其他文件的时长在后台线程解析
+    // The durations of other files are parsed in the background thread
+    std::vector<std::pair<size_t, std::string> > pending;
+    for (size_t i = 0; i < _segments.size(); ++i) {
+        if (!_segments[i].resolved) {
+            pending.emplace_back(i, _segments[i].file);
+        }
+    }
+    if (!pending.empty()) {
+        auto resolver = std::make_shared<Resolver>();
+        _resolver = resolver;
+        WorkThreadPool::Instance().getExecutor()->async([resolver, pending]() {
+            for (auto &pr : pending) {
+                uint64_t duration = 0;
+                try {
+                    duration = getFileDuration(pr.second);
+                } catch (std::exception &ex) {
+                    WarnL << "Skip invalid mp4 file: " << pr.second << ", " << ex.what();
+                }
+                lock_guard<mutex> lck(resolver->mtx);
+                resolver->durations.emplace_back(pr.first, duration);
+            }
+            decltype(resolver->waiters) waiters;
+            {
+                lock_guard<mutex> lck(resolver->mtx);
+                resolver->done = true;
+                waiters.swap(resolver->waiters);
+            }
+            for (auto &pr : waiters) {
+                pr.first->async(std::move(pr.second), false);
+            }
+        });
+    }
+    updateStart();
+
+    for (auto &track : _demuxer->getTracks(false)) {
         auto clone_track(track->clone());
         clone_track->setIndex(clone_track->getTrackType());
         _tracks.emplace(clone_track->getIndex(), clone_track);
@@ -226,45 +429,274 @@ void MultiMP4Demuxer::openMP4(const string &files_string) {
 }
 
 uint64_t MultiMP4Demuxer::getDurationMS() const {
-    return _demuxers.empty() ? 0 : _demuxers.rbegin()->first + _demuxers.rbegin()->second->getDurationMS();
+    return _segments.empty() ? 0 : _segments.back().start + _segments.back().duration;
+}
+
+uint64_t MultiMP4Demuxer::getResolvedDurationMS() const {
+    return _resolved_ms;
+}
+
+bool MultiMP4Demuxer::isResolved() const {
+    return !_resolver;
+}
+
+void MultiMP4Demuxer::updateTimeline() {
+    if (!_resolver) {
+        return;
+    }
+    bool done;
+    std::vector<std::pair<size_t, uint64_t> > durations;
+    {
+        lock_guard<mutex> lck(_resolver->mtx);
+        done = _resolver->done;
+        durations.swap(_resolver->durations);
+    }
+    if (done) {
+        _resolver = nullptr;
+    }
+    bool changed = false;
+    for (auto &pr : durations) {
+        auto &segment = _segments[pr.first];
+        if (!segment.resolved) {
+            segment.duration = pr.second;
+            segment.resolved = true;
+            changed = true;
+        }
+    }
+    if (changed) {
+        updateStart();
+    }
+}
+
+void MultiMP4Demuxer::whenResolved(const std::function<void()> &cb) {
+    updateTimeline();
+    auto resolver = _resolver;
+    if (resolver) {
+        std::weak_ptr<MultiMP4Demuxer> weak_self = shared_from_this();
+        lock_guard<mutex> lck(resolver->mtx);
+        if (!resolver->done) {
+            // 解析完成后在当前poller线程合并时长并回调，不阻塞当前线程
+            // After parsing is completed, merge the durations and call back in the current poller thread, without blocking the current thread
+            resolver->waiters.emplace_back(EventPoller::getCurrentPoller(), [weak_self, cb]() {
+                if (auto strong_self = weak_self.lock()) {
+                    strong_self->updateTimeline();
+                    cb();
+                }
+            });
+            return;
+        }
+    }
+    updateTimeline();
+    cb();
+}
+
+// 顺序播放时当前文件之前的时长都已知，所以更新时长不会改变当前文件的起始位置
+// During sequential playback the durations before the current file are all known, so updating durations does not change the start of the current file
+void MultiMP4Demuxer::updateStart() {
+    uint64_t start = 0;
+    bool resolved = true;
+    for (auto &segment : _segments) {
+        segment.start = start;
+        start += segment.duration;
+        resolved = resolved && segment.resolved;
+        if (resolved) {
+            _resolved_ms = start;
+        }
+    }
 }
 
 void MultiMP4Demuxer::closeMP4() {
-    _demuxers.clear();
-    _it = _demuxers.end();
+    _resolver = nullptr;
+    _resolved_ms = 0;
+    _wall_clock_index.clear();
+    _segments.clear();
+    _index = 0;
+    _demuxer = nullptr;
+    _prefetch = nullptr;
     _tracks.clear();
 }
 
+bool MultiMP4Demuxer::openSegment(size_t index) {
+    _index = index;
+    _demuxer = nullptr;
+    auto prefetch = std::move(_prefetch);
+    if (prefetch && prefetch->index == index) {
+        lock_guard<mutex> lck(prefetch->mtx);
+        if (prefetch->done) {
+            // 后台线程已经打开
+            // Already opened by the background thread
+            _demuxer = std::move(prefetch->demuxer);
+        }
+    }
+    if (!_demuxer) {
+        try {
+            auto demuxer = std::make_shared<MP4Demuxer>();
+            demuxer->openMP4(_segments[index].file);
+            _demuxer = std::move(demuxer);
+        } catch (std::exception &ex) {
+            WarnL << "Open mp4 file failed: " << _segments[index].file << ", " << ex.what();
+            return false;
+        }
+    }
+    auto &segment = _segments[index];
+    if (!segment.resolved) {
+        // 已经打开，无需等待后台线程
+        // Already opened, no need to wait for the background thread
+        segment.duration = _demuxer->getDurationMS();
+        segment.resolved = true;
+        updateStart();
+    }
+    if (_key_only && !_demuxer->setKeyFrameOnly(true, _reverse)) {
+        if (_reverse) {
+            // 无法倒放的文件(例如没有视频)直接跳过
+            // Skip files that cannot be reversed (for example without video)
+            WarnL << "Reverse playback is not supported: " << _segments[index].file;
+            _demuxer = nullptr;
+            startPrefetch();
+            return false;
+        }
+        // 快进时退化为读取全部样本
+        // Fall back to reading all samples when fast forwarding
+        WarnL << "Key frame only mode is not supported: " << _segments[index].file;
+    }
+    startPrefetch();
+    return true;
+}
+
+bool MultiMP4Demuxer::setKeyFrameOnly(bool enable, bool reverse) {
+    if (_demuxer && !_demuxer->setKeyFrameOnly(enable, reverse)) {
+        return false;
+    }
+    auto reverse_changed = _reverse != (enable && reverse);
+    _key_only = enable;
+    _reverse = enable && reverse;
+    if (reverse_changed && _demuxer) {
+        // 预读的方向变了
+        // The prefetch direction has changed
+        startPrefetch();
+    }
+    return true;
+}
+
+void MultiMP4Demuxer::startPrefetch() {
+    if (_reverse ? _index == 0 : _index + 1 >= _segments.size()) {
+        _prefetch = nullptr;
+        return;
+    }
+    auto index = _reverse ? _index - 1 : _index + 1;
+    auto prefetch = std::make_shared<Prefetch>();
+    prefetch->index = index;
+    _prefetch = prefetch;
+    auto file = _segments[index].file;
+    WorkThreadPool::Instance().getExecutor()->async([prefetch, file]() {
+        MP4Demuxer::Ptr demuxer;
+        try {
+            demuxer = std::make_shared<MP4Demuxer>();
+            demuxer->openMP4(file);
+        } catch (std::exception &ex) {
+            WarnL << "Prefetch mp4 file failed: " << file << ", " << ex.what();
+            demuxer = nullptr;
+        }
+        lock_guard<mutex> lck(prefetch->mtx);
+        prefetch->demuxer = std::move(demuxer);
+        prefetch->done = true;
+    });
+}
+
 int64_t MultiMP4Demuxer::seekTo(int64_t stamp_ms) {
-    if (stamp_ms >= (int64_t)getDurationMS()) {
+    updateTimeline();
+    // 目标位置之前的文件时长必须都已知，否则无法确定所在文件
+    // The durations of the files before the target position must all be known, otherwise the file cannot be determined
+    if (stamp_ms >= (int64_t)(isResolved() ? getDurationMS() : getResolvedDurationMS())) {
+        return -1;
+    }
+    // 二分查找所在文件
+    // Binary search for the file
+    auto it = std::upper_bound(_segments.begin(), _segments.end(), (uint64_t)std::max<int64_t>(stamp_ms, 0), [](uint64_t stamp, const Segment &segment) {
+        return stamp < segment.start;
+    });
+    size_t index = it == _segments.begin() ? 0 : it - _segments.begin() - 1;
+    if ((index != _index || !_demuxer) && !openSegment(index)) {
         return -1;
     }
-    _it = std::prev(_demuxers.upper_bound(stamp_ms));
-    return _it->first + _it->second->seekTo(stamp_ms - _it->first);
+    auto &segment = _segments[_index];
+    auto stamp = _demuxer->seekTo(stamp_ms - (int64_t)segment.start);
+    return stamp < 0 ? -1 : segment.start + stamp;
+}
+
+bool MultiMP4Demuxer::getStampByWallClock(uint64_t wall_clock_ms, uint64_t &stamp_ms) {
+    updateTimeline();
+    if (!isResolved()) {
+        return false;
+    }
+    // 只在有录制开始时间的文件中按录制开始时间二分查找，文件名无法解析的文件不参与
+    // Binary search by recording start time only among files with recording start time, files whose names cannot be parsed are excluded
+    auto it = std::upper_bound(_wall_clock_index.begin(), _wall_clock_index.end(), wall_clock_ms, [&](uint64_t wall_clock, size_t index) {
+        return wall_clock < _segments[index].wall_clock;
+    });
+    if (it != _wall_clock_index.begin()) {
+        auto &segment = _segments[*std::prev(it)];
+        if (wall_clock_ms < segment.wall_clock + segment.duration) {
+            stamp_ms = segment.start + (wall_clock_ms - segment.wall_clock);
+            return true;
+        }
+    }
+    if (it == _wall_clock_index.end()) {
+        return false;
+    }
+    // 落在空白处或者早于第一个文件
+    // Falls in the gap or earlier than the first file
+    stamp_ms = _segments[*it].start;
+    return true;
 }
 
 Frame::Ptr MultiMP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     for (;;) {
-        auto ret = _it->second->readFrame(keyFrame, eof);
+        Frame::Ptr ret;
+        if (_demuxer) {
+            ret = _demuxer->readFrame(keyFrame, eof);
+        } else {
+            eof = true;
+        }
         if (ret) {
             ret->setIndex(ret->getTrackType());
             auto it = _tracks.find(ret->getIndex());
             if (it != _tracks.end()) {
+                auto start = _segments[_index].start;
                 auto ret2 = std::make_shared<FrameStamp>(ret);
-                ret2->setStamp(_it->first + ret->dts(), _it->first + ret->pts());
+                ret2->setStamp(start + ret->dts(), start + ret->pts());
                 ret = std::move(ret2);
                 it->second->inputFrame(ret);
             }
         }
-        if (eof && _it != _demuxers.end()) {
-            // 切换到下一个文件
-            if (++_it == _demuxers.end()) {
+        if (eof) {
+            // 切换到下一个文件，关闭当前文件
+            // Switch to the next file, close the current file
+            _demuxer = nullptr;
+            updateTimeline();
+            if (_reverse) {
+                if (_index == 0) {
+                    // 已经倒放到第一个文件的开头了
+                    // Already reversed to the beginning of the first file
+                    return nullptr;
+                }
+                if (openSegment(_index - 1)) {
+                    // 上一个文件从末尾开始倒放
+                    // The previous file is reversed from the end
+                    _demuxer->seekTo(_demuxer->getDurationMS());
+                }
+                eof = false;
+                continue;
+            }
+            if (_index + 1 >= _segments.size()) {
                 // 已经是最后一个文件了
-                eof = true;
                 return nullptr;
             }
-            // 下一个文件从头开始播放
-            _it->second->seekTo(0);
+            if (openSegment(_index + 1)) {
+                // 下一个文件从头开始播放
+                _demuxer->seekTo(0);
+            }
+            eof = false;
             continue;
         }
         return ret;
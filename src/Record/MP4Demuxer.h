@@ -13,9 +13,13 @@
 #ifdef ENABLE_MP4
 
 #include <map>
+#include <mutex>
+#include <functional>
 #include "MP4.h"
+#include "MP4Index.h"
 #include "Extension/Track.h"
 #include "Util/ResourcePool.h"
+#include "Poller/EventPoller.h"
 
 namespace mediakit {
 
@@ -92,21 +96,50 @@ public:
      */
     uint64_t getDurationMS() const;
 
+    /**
+     * 设置是否只读取视频关键帧(快进/倒放)，依赖样本索引
+     * 倒放时readFrame按时间逆序返回关键帧，seekTo定位到不晚于该时间点的关键帧
+     * Set whether to read only video key frames (fast forward/reverse), depends on the sample index
+     * When reversing, readFrame returns key frames in reverse time order, seekTo locates the key frame not later than the time point
+     * @return 没有样本索引或者没有视频关键帧时返回false
+     * @return false when there is no sample index or no video key frame
+     */
+    bool setKeyFrameOnly(bool enable, bool reverse = false);
+
 private:
     int getAllTracks();
     void onVideoTrack(uint32_t track_id, uint8_t object, int width, int height, const void *extra, size_t bytes);
     void onAudioTrack(uint32_t track_id, uint8_t object, int channel_count, int bit_per_sample, int sample_rate, const void *extra, size_t bytes);
     Frame::Ptr makeFrame(uint32_t track_id, toolkit::Buffer::Ptr buf, int64_t pts, int64_t dts);
+    Frame::Ptr readSample(bool &keyFrame, bool &eof);
 
 private:
     MP4FileDisk::Ptr _mp4_file;
     MP4FileDisk::Reader _mov_reader;
     uint64_t _duration_ms = 0;
+    // 样本索引，不为空时直接按索引读取样本，不再使用mov_reader
+    // Sample index, read samples directly by index when not empty, mov_reader is no longer used
+    MP4Index::Ptr _index;
+    // 正序时为下一个读取的样本，倒放时为已读取的最早样本(只读取它之前的关键帧)
+    // The next sample to read in forward order, the earliest sample read when reversing (only key frames before it are read)
+    size_t _sample_pos = 0;
+    uint64_t _file_offset = 0;
+    bool _key_only = false;
+    bool _reverse = false;
+    // 首次打开文件时记录mov_reader解析得到的track信息，保存到索引中
+    // Record the track information parsed by mov_reader when the file is opened for the first time, and save it to the index
+    std::vector<MP4Index::TrackInfo> _track_info;
     std::unordered_map<int, Track::Ptr> _tracks;
     toolkit::ResourcePool<toolkit::BufferRaw> _buffer_pool;
 };
 
-class MultiMP4Demuxer : public TrackSource {
+/**
+ * 把多个mp4文件(例如一个目录下的录像切片)拼接为一条虚拟时间轴
+ * 只打开当前播放的文件，下一个文件在后台线程预先打开，切换文件时不阻塞
+ * Stitch multiple mp4 files (such as recording segments in a directory) into one virtual timeline
+ * Only the file currently playing is opened, the next file is opened in advance in the background thread, switching files does not block
+ */
+class MultiMP4Demuxer : public TrackSource, public std::enable_shared_from_this<MultiMP4Demuxer> {
 public:
     using Ptr = std::shared_ptr<MultiMP4Demuxer>;
 
@@ -146,15 +179,117 @@ public:
     std::vector<Track::Ptr> getTracks(bool trackReady) const override;
 
     /**
-     * 获取文件总长度
+     * 获取文件总长度，后台线程解析完所有文件的时长之前只包含已知的部分
+     * Get the total length of the files, only the known part is included before the background thread parses the durations of all files
      * @return 文件总长度，单位毫秒
      */
     uint64_t getDurationMS() const;
 
+    /**
+     * 获取时间轴上从头开始连续已知时长的部分，seek到该范围内无需等待后台线程
+     * Get the part of the timeline with continuous known durations from the beginning, seeking within this range does not need to wait for the background thread
+     * @return 单位毫秒
+     * @return In milliseconds
+     */
+    uint64_t getResolvedDurationMS() const;
+
+    /**
+     * 是否已经解析完所有文件的时长
+     * Whether the durations of all files have been parsed
+     */
+    bool isResolved() const;
+
+    /**
+     * 合并后台线程已经解析得到的文件时长，不阻塞；未命中索引缓存的文件时长在后台线程解析，避免打开时阻塞调用者所在的poller线程
+     * Merge the file durations already parsed by the background thread without blocking; the durations of files that miss the index cache are parsed in the background thread,
+     * to avoid blocking the poller thread of the caller when opening
+     */
+    void updateTimeline();
+
+    /**
+     * 所有文件的时长解析完成并合并后，在调用者所在的poller线程回调；已经完成时立即回调
+     * 必须在poller线程中调用，本对象销毁后不再回调
+     * After the durations of all files are parsed and merged, call back in the poller thread of the caller; call back immediately if already completed
+     * Must be called in a poller thread, no callback after this object is destroyed
+     */
+    void whenResolved(const std::function<void()> &cb);
+
+    /**
+     * 根据录像文件名(MP4Recorder生成的%Y-%m-%d-%H-%M-%S-序号.mp4)把本地时间转换为时间轴位置
+     * 落在两个文件之间的空白处时定位到下一个文件的开头；需要完整的时间轴，应该在whenResolved回调中调用
+     * Convert the local time to a timeline position according to the recording file name (%Y-%m-%d-%H-%M-%S-index.mp4 generated by MP4Recorder)
+     * When it falls in the gap between two files, locate the beginning of the next file; it needs the complete timeline, should be called in the whenResolved callback
+     * @param wall_clock_ms unix时间戳，单位毫秒
+     * @param wall_clock_ms Unix timestamp, in milliseconds
+     * @param stamp_ms 时间轴位置，单位毫秒
+     * @param stamp_ms Timeline position, in milliseconds
+     * @return 不在录像时间范围内或者时间轴未解析完成时返回false
+     * @return false when it is not within the recording time range or the timeline has not been parsed
+     */
+    bool getStampByWallClock(uint64_t wall_clock_ms, uint64_t &stamp_ms);
+
+    /**
+     * 设置是否只读取视频关键帧，倒放时到达文件开头后切换到上一个文件的末尾
+     * Set whether to read only video key frames, when reversing switch to the end of the previous file after reaching the beginning of the file
+     */
+    bool setKeyFrameOnly(bool enable, bool reverse = false);
+
+private:
+    struct Segment {
+        std::string file;
+        // 在时间轴上的起始位置与时长，单位毫秒
+        // Start position and duration on the timeline, in milliseconds
+        uint64_t start = 0;
+        uint64_t duration = 0;
+        // 文件名中的录制开始时间(unix时间戳，毫秒)，无法解析时为0
+        // Recording start time in the file name (unix timestamp, milliseconds), 0 when it cannot be parsed
+        uint64_t wall_clock = 0;
+        // 时长是否已知
+        // Whether the duration is known
+        bool resolved = false;
+    };
+
+    // 后台线程解析的文件时长
+    // File durations parsed by the background thread
+    struct Resolver {
+        bool done = false;
+        std::mutex mtx;
+        // 文件下标与时长，无效文件的时长为0
+        // File index and duration, the duration of invalid files is 0
+        std::vector<std::pair<size_t, uint64_t> > durations;
+        // 等待解析完成的回调及其所在poller
+        // Callbacks waiting for the parsing to complete and their pollers
+        std::vector<std::pair<toolkit::EventPoller::Ptr, std::function<void()> > > waiters;
+    };
+
+    // 后台线程打开的下一个文件
+    // The next file opened in the background thread
+    struct Prefetch {
+        size_t index = 0;
+        bool done = false;
+        std::mutex mtx;
+        MP4Demuxer::Ptr demuxer;
+    };
+
+    bool openSegment(size_t index);
+    void startPrefetch();
+    void updateStart();
+
 private:
+    bool _key_only = false;
+    bool _reverse = false;
+    size_t _index = 0;
+    // 从头开始连续已知时长的部分
+    // The part with continuous known durations from the beginning
+    uint64_t _resolved_ms = 0;
+    MP4Demuxer::Ptr _demuxer;
+    std::shared_ptr<Prefetch> _prefetch;
+    std::shared_ptr<Resolver> _resolver;
+    std::vector<Segment> _segments;
+    // 有录制开始时间的文件下标，按录制开始时间排序
+    // Indexes of files with recording start time, sorted by recording start time
+    std::vector<size_t> _wall_clock_index;
     std::map<int, Track::Ptr> _tracks;
-    std::map<uint64_t, MP4Demuxer::Ptr>::iterator _it;
-    std::map<uint64_t, MP4Demuxer::Ptr> _demuxers;
 };
 
 }//namespace mediakit
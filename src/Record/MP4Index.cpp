@@ -0,0 +1,1042 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_MP4)
+
+#include <list>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "MP4Index.h"
+#include "Util/File.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Common/config.h"
+#include "Poller/EventPoller.h"
+#include "Thread/WorkThreadPool.h"
+#include "mov-format.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+#if defined(_WIN32) || defined(_WIN64)
+    #define fseek64 _fseeki64
+#else
+    #define fseek64 fseek
+#endif
+
+static constexpr char kSidecarMagic[] = "ZLMP4IDX";
+static constexpr uint32_t kSidecarVersion = 2;
+
+static bool getFileStat(const string &file, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (0 != stat(file.data(), &st)) {
+        return false;
+    }
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+static string getSidecarPath(const string &file) {
+    return file + ".idx";
+}
+
+/////////////////////////////////////////////////////box解析/////////////////////////////////////////////////////////
+
+namespace {
+
+// 带越界检查的大端读取器
+// Big-endian reader with out-of-bounds check
+class BoxReader {
+public:
+    BoxReader(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+    bool ok() const { return _ok; }
+    size_t remain() const { return _size - _pos; }
+
+    void skip(size_t bytes) {
+        if (!check(bytes)) {
+            return;
+        }
+        _pos += bytes;
+    }
+
+    uint8_t u8() {
+        if (!check(1)) {
+            return 0;
+        }
+        return _data[_pos++];
+    }
+
+    uint16_t u16() {
+        uint16_t high = u8();
+        return (uint16_t)((high << 8) | u8());
+    }
+    uint32_t u32() {
+        uint32_t high = u16();
+        return (high << 16) | u16();
+    }
+
+    uint64_t u64() {
+        uint64_t high = u32();
+        return (high << 32) | u32();
+    }
+
+    string bytes(size_t size) {
+        if (!check(size)) {
+            return "";
+        }
+        string ret((const char *)_data + _pos, size);
+        _pos += size;
+        return ret;
+    }
+
+private:
+    bool check(size_t bytes) {
+        if (!_ok || _size - _pos < bytes) {
+            _ok = false;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool _ok = true;
+    size_t _pos = 0;
+    const uint8_t *_data;
+    size_t _size;
+};
+
+struct SampleToChunk {
+    uint32_t first_chunk;
+    uint32_t samples_per_chunk;
+};
+
+struct TimeToSample {
+    uint32_t count;
+    int32_t value;
+};
+
+struct TrakTables {
+    uint32_t track_id = 0;
+    uint32_t timescale = 0;
+    uint32_t handler = 0;
+    bool video = false;
+    // stsd是否只有一个可识别的样本描述，否则track信息交给mov_reader解析
+    // Whether stsd has only one recognizable sample description, otherwise the track information is parsed by mov_reader
+    bool has_info = false;
+    MP4Index::TrackInfo info;
+    // 空白编辑(media_time为-1)的时长，单位为mvhd timescale
+    // Duration of empty edit (media_time is -1), in mvhd timescale
+    uint64_t empty_edit = 0;
+    bool has_stss = false;
+    vector<uint32_t> sizes;
+    vector<uint64_t> chunks;
+    vector<SampleToChunk> stsc;
+    vector<TimeToSample> stts;
+    vector<TimeToSample> ctts;
+    vector<uint32_t> stss;
+};
+
+struct MoovTables {
+    uint32_t timescale = 0;
+    uint64_t duration = 0;
+    bool fragmented = false;
+    list<TrakTables> traks;
+};
+
+using onBox = function<bool(uint32_t type, const uint8_t *data, size_t size)>;
+
+static uint32_t makeType(const char *type) {
+    return ((uint32_t)type[0] << 24) | ((uint32_t)type[1] << 16) | ((uint32_t)type[2] << 8) | (uint32_t)type[3];
+}
+
+// 遍历容器box的子box
+// Traverse the child boxes of a container box
+static bool forEachBox(const uint8_t *data, size_t size, const onBox &cb) {
+    while (size >= 8) {
+        BoxReader reader(data, size);
+        uint64_t box_size = reader.u32();
+        auto type = reader.u32();
+        size_t header_size = 8;
+        if (box_size == 1) {
+            box_size = reader.u64();
+            header_size = 16;
+        } else if (box_size == 0) {
+            box_size = size;
+        }
+        if (!reader.ok() || box_size < header_size || box_size > size) {
+            return false;
+        }
+        if (!cb(type, data + header_size, (size_t)box_size - header_size)) {
+            return false;
+        }
+        data += box_size;
+        size -= (size_t)box_size;
+    }
+    return true;
+}
+
+static bool readTimeToSample(BoxReader &reader, vector<TimeToSample> &out) {
+    reader.skip(4);
+    auto count = reader.u32();
+    if (!reader.ok() || count > reader.remain() / 8) {
+        return false;
+    }
+    out.resize(count);
+    for (auto &item : out) {
+        item.count = reader.u32();
+        item.value = (int32_t)reader.u32();
+    }
+    return reader.ok();
+}
+
+// 读取mpeg4描述符的长度(每字节7位，最多4字节)
+// Read the length of mpeg4 descriptor (7 bits per byte, up to 4 bytes)
+static uint32_t readDescriptorLength(BoxReader &reader) {
+    uint32_t len = 0;
+    for (int i = 0; i < 4; ++i) {
+        auto byte = reader.u8();
+        len = (len << 7) | (byte & 0x7F);
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return len;
+}
+
+// 解析esds，获取object类型与AudioSpecificConfig，与mov_reader一致
+// Parse esds to get the object type and AudioSpecificConfig, consistent with mov_reader
+static bool parseEsds(const uint8_t *data, size_t size, MP4Index::TrackInfo &info) {
+    BoxReader reader(data, size);
+    reader.skip(4);
+    while (reader.ok() && reader.remain() > 1) {
+        auto tag = reader.u8();
+        auto len = readDescriptorLength(reader);
+        if (!reader.ok() || len > reader.remain()) {
+            return false;
+        }
+        switch (tag) {
+            case 0x03: {
+                // ES_Descriptor，子描述符紧随其后
+                // ES_Descriptor, followed by sub descriptors
+                reader.skip(2);
+                auto flags = reader.u8();
+                if (flags & 0x80) {
+                    reader.skip(2);
+                }
+                if (flags & 0x40) {
+                    reader.skip(reader.u8());
+                }
+                if (flags & 0x20) {
+                    reader.skip(2);
+                }
+                break;
+            }
+            case 0x04: {
+                // DecoderConfigDescriptor，DecoderSpecificInfo紧随其后
+                // DecoderConfigDescriptor, followed by DecoderSpecificInfo
+                if (len < 13) {
+                    return false;
+                }
+                info.object = reader.u8();
+                reader.skip(12);
+                break;
+            }
+            case 0x05: info.extra = reader.bytes(len); return reader.ok();
+            default: reader.skip(len); break;
+        }
+    }
+    return reader.ok() && info.object;
+}
+
+static bool parseStsd(const uint8_t *data, size_t size, TrakTables &trak) {
+    BoxReader reader(data, size);
+    reader.skip(4);
+    auto count = reader.u32();
+    if (!reader.ok() || count != 1 || (trak.handler != makeType("vide") && trak.handler != makeType("soun"))) {
+        // 多个样本描述或非音视频track，交给mov_reader处理
+        // Multiple sample descriptions or non audio/video track, handled by mov_reader
+        return true;
+    }
+    auto &info = trak.info;
+    info.track_id = trak.track_id;
+    return forEachBox(data + 8, size - 8, [&](uint32_t type, const uint8_t *data, size_t size) {
+        BoxReader reader(data, size);
+        // reserved(6) + data_reference_index(2)
+        reader.skip(8);
+        size_t header_size = 8;
+        if (trak.handler == makeType("vide")) {
+            if (type == makeType("avc1") || type == makeType("avc3")) {
+                info.object = MOV_OBJECT_H264;
+            } else if (type == makeType("hvc1") || type == makeType("hev1")) {
+                info.object = MOV_OBJECT_HEVC;
+            } else if (type == makeType("av01")) {
+                info.object = MOV_OBJECT_AV1;
+            } else {
+                return true;
+            }
+            info.video = true;
+            reader.skip(16);
+            info.width = reader.u16();
+            info.height = reader.u16();
+            reader.skip(50);
+            header_size += 70;
+        } else {
+            if (type == makeType("alaw")) {
+                info.object = MOV_OBJECT_G711a;
+            } else if (type == makeType("ulaw")) {
+                info.object = MOV_OBJECT_G711u;
+            } else if (type != makeType("mp4a")) {
+                return true;
+            }
+            auto version = reader.u16();
+            reader.skip(6);
+            info.channel_count = reader.u16();
+            info.bit_per_sample = reader.u16();
+            reader.skip(4);
+            info.sample_rate = reader.u32() >> 16;
+            header_size += 20;
+            if (version == 1) {
+                reader.skip(16);
+                header_size += 16;
+            } else if (version != 0) {
+                return true;
+            }
+        }
+        if (!reader.ok()) {
+            return true;
+        }
+        auto has_config = info.object == MOV_OBJECT_G711a || info.object == MOV_OBJECT_G711u;
+        auto ok = forEachBox(data + header_size, size - header_size, [&](uint32_t type, const uint8_t *data, size_t size) {
+            if (type == makeType("avcC") || type == makeType("hvcC") || type == makeType("av1C")) {
+                info.extra.assign((const char *)data, size);
+                has_config = true;
+            } else if (type == makeType("esds")) {
+                has_config = parseEsds(data, size, info);
+            }
+            return true;
+        });
+        trak.has_info = ok && has_config;
+        return true;
+    });
+}
+
+static bool parseStbl(const uint8_t *data, size_t size, TrakTables &trak) {
+    return forEachBox(data, size, [&](uint32_t type, const uint8_t *data, size_t size) {
+        BoxReader reader(data, size);
+        if (type == makeType("stsd")) {
+            return size < 8 || parseStsd(data, size, trak);
+        }
+        if (type == makeType("stts")) {
+            return readTimeToSample(reader, trak.stts);
+        }
+        if (type == makeType("ctts")) {
+            return readTimeToSample(reader, trak.ctts);
+        }
+        if (type == makeType("stss")) {
+            reader.skip(4);
+            auto count = reader.u32();
+            if (!reader.ok() || count > reader.remain() / 4) {
+                return false;
+            }
+            trak.has_stss = true;
+            trak.stss.resize(count);
+            for (auto &item : trak.stss) {
+                item = reader.u32();
+            }
+            return reader.ok();
+        }
+        if (type == makeType("stsz")) {
+            reader.skip(4);
+            auto sample_size = reader.u32();
+            auto count = reader.u32();
+            if (!reader.ok() || (!sample_size && count > reader.remain() / 4)) {
+                return false;
+            }
+            trak.sizes.resize(count, sample_size);
+            if (!sample_size) {
+                for (auto &item : trak.sizes) {
+                    item = reader.u32();
+                }
+            }
+            return reader.ok();
+        }
+        if (type == makeType("stz2")) {
+            reader.skip(7);
+            auto field_size = reader.u8();
+            auto count = reader.u32();
+            if (!reader.ok() || (field_size != 4 && field_size != 8 && field_size != 16) || count > reader.remain() * 8 / field_size) {
+                return false;
+            }
+            trak.sizes.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                if (field_size == 4) {
+                    if (i % 2 == 0) {
+                        auto byte = reader.u8();
+                        trak.sizes[i] = byte >> 4;
+                        if (i + 1 < count) {
+                            trak.sizes[i + 1] = byte & 0x0F;
+                        }
+                    }
+                } else {
+                    trak.sizes[i] = field_size == 8 ? reader.u8() : reader.u16();
+                }
+            }
+            return reader.ok();
+        }
+        if (type == makeType("stsc")) {
+            reader.skip(4);
+            auto count = reader.u32();
+            if (!reader.ok() || count > reader.remain() / 12) {
+                return false;
+            }
+            trak.stsc.resize(count);
+            for (auto &item : trak.stsc) {
+                item.first_chunk = reader.u32();
+                item.samples_per_chunk = reader.u32();
+                reader.skip(4);
+            }
+            return reader.ok();
+        }
+        if (type == makeType("stco") || type == makeType("co64")) {
+            auto is_64 = type == makeType("co64");
+            reader.skip(4);
+            auto count = reader.u32();
+            if (!reader.ok() || count > reader.remain() / (is_64 ? 8 : 4)) {
+                return false;
+            }
+            trak.chunks.resize(count);
+            for (auto &item : trak.chunks) {
+                item = is_64 ? reader.u64() : reader.u32();
+            }
+            return reader.ok();
+        }
+        return true;
+    });
+}
+
+static bool parseTrak(const uint8_t *data, size_t size, TrakTables &trak) {
+    return forEachBox(data, size, [&](uint32_t type, const uint8_t *data, size_t size) {
+        BoxReader reader(data, size);
+        if (type == makeType("mdia") || type == makeType("minf") || type == makeType("edts")) {
+            return parseTrak(data, size, trak);
+        }
+        if (type == makeType("stbl")) {
+            return parseStbl(data, size, trak);
+        }
+        if (type == makeType("tkhd")) {
+            auto version = reader.u8();
+            reader.skip(3 + (version == 1 ? 16 : 8));
+            trak.track_id = reader.u32();
+            return reader.ok();
+        }
+        if (type == makeType("mdhd")) {
+            auto version = reader.u8();
+            reader.skip(3 + (version == 1 ? 16 : 8));
+            trak.timescale = reader.u32();
+            return reader.ok();
+        }
+        if (type == makeType("hdlr")) {
+            reader.skip(8);
+            trak.handler = reader.u32();
+            trak.video = trak.handler == makeType("vide");
+            return reader.ok();
+        }
+        if (type == makeType("elst")) {
+            auto version = reader.u8();
+            reader.skip(3);
+            auto count = reader.u32();
+            for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+                uint64_t segment_duration = version == 1 ? reader.u64() : reader.u32();
+                int64_t media_time = version == 1 ? (int64_t)reader.u64() : (int32_t)reader.u32();
+                reader.skip(4);
+                if (media_time == -1) {
+                    trak.empty_edit += segment_duration;
+                }
+            }
+            return reader.ok();
+        }
+        return true;
+    });
+}
+
+static bool parseMoov(const uint8_t *data, size_t size, MoovTables &moov) {
+    return forEachBox(data, size, [&](uint32_t type, const uint8_t *data, size_t size) {
+        BoxReader reader(data, size);
+        if (type == makeType("mvhd")) {
+            auto version = reader.u8();
+            reader.skip(3 + (version == 1 ? 16 : 8));
+            moov.timescale = reader.u32();
+            moov.duration = version == 1 ? reader.u64() : reader.u32();
+            return reader.ok();
+        }
+        if (type == makeType("mvex")) {
+            moov.fragmented = true;
+            return true;
+        }
+        if (type == makeType("trak")) {
+            moov.traks.emplace_back();
+            return parseTrak(data, size, moov.traks.back());
+        }
+        return true;
+    });
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////MP4Index/////////////////////////////////////////////////////////
+
+bool MP4Index::parse(const string &file) {
+    std::shared_ptr<FILE> fp(fopen(file.data(), "rb"), [](FILE *fp) {
+        if (fp) {
+            fclose(fp);
+        }
+    });
+    if (!fp) {
+        return false;
+    }
+
+    // 只读取moov，跳过mdat等其他顶层box
+    // Only read moov, skip mdat and other top level boxes
+    string moov_data;
+    uint64_t offset = 0;
+    while (offset + 8 <= _file_size) {
+        uint8_t header[16];
+        if (0 != fseek64(fp.get(), offset, SEEK_SET) || 8 != fread(header, 1, 8, fp.get())) {
+            return false;
+        }
+        BoxReader reader(header, 8);
+        uint64_t box_size = reader.u32();
+        auto type = reader.u32();
+        size_t header_size = 8;
+        if (box_size == 1) {
+            if (8 != fread(header + 8, 1, 8, fp.get())) {
+                return false;
+            }
+            BoxReader reader64(header + 8, 8);
+            box_size = reader64.u64();
+            header_size = 16;
+        } else if (box_size == 0) {
+            box_size = _file_size - offset;
+        }
+        if (box_size < header_size || offset + box_size > _file_size) {
+            // 未完成录制的文件
+            // File not finished recording
+            return false;
+        }
+        if (type == makeType("moof")) {
+            return false;
+        }
+        if (type == makeType("moov")) {
+            moov_data.resize((size_t)box_size - header_size);
+            if (moov_data.size() != fread(&moov_data[0], 1, moov_data.size(), fp.get())) {
+                return false;
+            }
+        }
+        offset += box_size;
+    }
+
+    MoovTables moov;
+    if (moov_data.empty() || !parseMoov((uint8_t *)moov_data.data(), moov_data.size(), moov) || moov.fragmented || !moov.timescale) {
+        return false;
+    }
+
+    // 所有音视频track的样本描述都可识别时直接生成track信息，首次打开文件也无需再用mov_reader解析moov
+    // When the sample descriptions of all audio and video tracks are recognizable, generate the track information directly, so there is no need to parse moov again with mov_reader even when the file is opened for the first time
+    vector<TrackInfo> tracks;
+    for (auto &trak : moov.traks) {
+        if (trak.handler != makeType("vide") && trak.handler != makeType("soun")) {
+            continue;
+        }
+        if (!trak.has_info) {
+            tracks.clear();
+            break;
+        }
+        tracks.emplace_back(trak.info);
+    }
+
+    for (auto &trak : moov.traks) {
+        if (trak.sizes.empty() || !trak.timescale) {
+            continue;
+        }
+        if (_track_ids.size() >= UINT16_MAX) {
+            return false;
+        }
+        auto track = (uint16_t)_track_ids.size();
+        _track_ids.emplace_back(trak.track_id);
+        if (trak.video && _video_track == -1) {
+            _video_track = track;
+        }
+        auto start = _samples.size();
+        _samples.resize(start + trak.sizes.size());
+        auto samples = &_samples[start];
+        auto count = trak.sizes.size();
+
+        // 样本偏移量
+        // Sample offset
+        size_t index = 0;
+        for (size_t i = 0; i < trak.stsc.size() && index < count; ++i) {
+            auto &entry = trak.stsc[i];
+            uint64_t last_chunk = i + 1 < trak.stsc.size() ? trak.stsc[i + 1].first_chunk : trak.chunks.size() + 1;
+            for (uint64_t chunk = entry.first_chunk; chunk < last_chunk && chunk <= trak.chunks.size() && index < count; ++chunk) {
+                auto chunk_offset = trak.chunks[chunk - 1];
+                for (uint32_t j = 0; j < entry.samples_per_chunk && index < count; ++j) {
+                    samples[index].offset = chunk_offset;
+                    samples[index].size = trak.sizes[index];
+                    chunk_offset += trak.sizes[index];
+                    ++index;
+                }
+            }
+        }
+        if (index != count) {
+            WarnL << "Invalid sample table of track " << trak.track_id << ": " << file;
+            return false;
+        }
+
+        // 时间戳，与mov_reader一致：空白编辑推迟第一个样本的dts，时间戳换算为毫秒时向下取整
+        // Timestamp, consistent with mov_reader: empty edit delays the dts of the first sample, timestamps are rounded down when converted to milliseconds
+        vector<uint64_t> dts_list(count);
+        uint64_t dts = trak.empty_edit * trak.timescale / moov.timescale;
+        index = 0;
+        for (auto &entry : trak.stts) {
+            for (uint32_t j = 0; j < entry.count && index < count; ++j) {
+                dts_list[index++] = dts;
+                dts += (uint32_t)entry.value;
+            }
+        }
+        while (index < count) {
+            dts_list[index++] = dts;
+        }
+        index = 0;
+        for (size_t i = 0; i < count; ++i) {
+            samples[i].dts = (uint32_t)(dts_list[i] * 1000 / trak.timescale);
+            samples[i].cts = 0;
+        }
+        for (auto &entry : trak.ctts) {
+            for (uint32_t j = 0; j < entry.count && index < count; ++j, ++index) {
+                auto pts = (int64_t)dts_list[index] + entry.value;
+                samples[index].cts = (int32_t)(pts * 1000 / trak.timescale - samples[index].dts);
+            }
+        }
+
+        // 关键帧
+        // Key frames
+        for (size_t i = 0; i < count; ++i) {
+            samples[i].track = track;
+            samples[i].flags = trak.has_stss ? 0 : kFlagKeyFrame;
+        }
+        for (auto number : trak.stss) {
+            if (number >= 1 && number <= count) {
+                samples[number - 1].flags |= kFlagKeyFrame;
+            }
+        }
+    }
+    if (_samples.empty()) {
+        return false;
+    }
+
+    std::sort(_samples.begin(), _samples.end(), [](const Sample &a, const Sample &b) {
+        return a.dts != b.dts ? a.dts < b.dts : a.offset < b.offset;
+    });
+    _duration_ms = moov.duration * 1000 / moov.timescale;
+    if (!tracks.empty()) {
+        _track_info = std::make_shared<vector<TrackInfo> >(std::move(tracks));
+    }
+    makeKeySamples();
+    return true;
+}
+
+void MP4Index::makeKeySamples() {
+    _key_samples.clear();
+    if (_video_track == -1 || _samples.size() > UINT32_MAX) {
+        return;
+    }
+    for (size_t i = 0; i < _samples.size(); ++i) {
+        auto &sample = _samples[i];
+        if (sample.track == _video_track && (sample.flags & kFlagKeyFrame)) {
+            _key_samples.emplace_back((uint32_t)i);
+        }
+    }
+}
+
+size_t MP4Index::seek(int64_t &stamp_ms) const {
+    auto target = (uint32_t)std::max<int64_t>(0, std::min<int64_t>(stamp_ms, UINT32_MAX));
+    auto it = std::upper_bound(_samples.begin(), _samples.end(), target, [](uint32_t stamp, const Sample &sample) {
+        return stamp < sample.dts;
+    });
+    if (_video_track != -1) {
+        // 向前查找关键帧(最多一个gop)，找不到时向后查找第一个关键帧
+        // Search backward for the key frame (at most one gop), search forward for the first key frame if not found
+        auto is_key = [&](const Sample &sample) { return sample.track == _video_track && (sample.flags & kFlagKeyFrame); };
+        auto key = _samples.end();
+        for (auto pos = it; pos != _samples.begin();) {
+            if (is_key(*--pos)) {
+                key = pos;
+                break;
+            }
+        }
+        if (key == _samples.end()) {
+            key = std::find_if(it, _samples.end(), is_key);
+        }
+        if (key != _samples.end()) {
+            target = key->dts;
+        }
+    }
+    // 同一时间戳的音频样本也从头开始读
+    // Audio samples with the same timestamp are also read from the beginning
+    it = std::lower_bound(_samples.begin(), _samples.end(), target, [](const Sample &sample, uint32_t stamp) {
+        return sample.dts < stamp;
+    });
+    if (it != _samples.end()) {
+        stamp_ms = it->dts;
+    }
+    return it - _samples.begin();
+}
+
+std::shared_ptr<const vector<MP4Index::TrackInfo> > MP4Index::getTrackInfo() const {
+    return std::atomic_load(&_track_info);
+}
+
+void MP4Index::setTrackInfo(vector<TrackInfo> tracks) {
+    std::atomic_store(&_track_info, std::shared_ptr<const vector<TrackInfo> >(std::make_shared<vector<TrackInfo> >(std::move(tracks))));
+    GET_CONFIG(bool, enable_sidecar, Record::kIndexSidecar);
+    if (enable_sidecar) {
+        saveSidecar(getSidecarPath(_file));
+    }
+}
+
+/////////////////////////////////////////////////////索引文件/////////////////////////////////////////////////////////
+
+namespace {
+
+class SidecarWriter {
+public:
+    template <typename T>
+    void write(const T &value) {
+        _data.append((const char *)&value, sizeof(value));
+    }
+
+    template <typename T>
+    void writeVector(const vector<T> &items) {
+        write((uint32_t)items.size());
+        if (!items.empty()) {
+            _data.append((const char *)items.data(), items.size() * sizeof(T));
+        }
+    }
+
+    void writeBytes(const char *data, size_t size) { _data.append(data, size); }
+
+    void writeString(const string &str) {
+        write((uint32_t)str.size());
+        _data.append(str);
+    }
+
+    const string &data() const { return _data; }
+
+private:
+    string _data;
+};
+
+class SidecarReader {
+public:
+    SidecarReader(const string &data) : _data(data) {}
+
+    bool ok() const { return _ok; }
+
+    template <typename T>
+    T read() {
+        T value {};
+        if (check(sizeof(T))) {
+            memcpy(&value, _data.data() + _pos, sizeof(T));
+            _pos += sizeof(T);
+        }
+        return value;
+    }
+
+    template <typename T>
+    void readVector(vector<T> &items) {
+        auto count = read<uint32_t>();
+        if (!check((size_t)count * sizeof(T))) {
+            return;
+        }
+        items.resize(count);
+        if (count) {
+            memcpy(items.data(), _data.data() + _pos, count * sizeof(T));
+        }
+        _pos += count * sizeof(T);
+    }
+
+    string readBytes(size_t size) {
+        if (!check(size)) {
+            return "";
+        }
+        _pos += size;
+        return _data.substr(_pos - size, size);
+    }
+
+    string readString() {
+        auto size = read<uint32_t>();
+        if (!check(size)) {
+            return "";
+        }
+        _pos += size;
+        return _data.substr(_pos - size, size);
+    }
+
+private:
+    bool check(size_t bytes) {
+        if (!_ok || _data.size() - _pos < bytes) {
+            _ok = false;
+        }
+        return _ok;
+    }
+
+private:
+    bool _ok = true;
+    size_t _pos = 0;
+    const string &_data;
+};
+
+} // namespace
+
+void MP4Index::saveSidecar(const string &path) const {
+    SidecarWriter writer;
+    writer.writeBytes(kSidecarMagic, sizeof(kSidecarMagic) - 1);
+    writer.write(kSidecarVersion);
+    writer.write(_file_size);
+    writer.write(_mtime);
+    writer.write(_duration_ms);
+    writer.write(_video_track);
+    writer.writeVector(_track_ids);
+    writer.writeVector(_samples);
+    auto tracks = getTrackInfo();
+    writer.write((uint32_t)(tracks ? tracks->size() : 0));
+    if (tracks) {
+        for (auto &track : *tracks) {
+            writer.write(track.track_id);
+            writer.write(track.video);
+            writer.write(track.object);
+            writer.write(track.width);
+            writer.write(track.height);
+            writer.write(track.channel_count);
+            writer.write(track.bit_per_sample);
+            writer.write(track.sample_rate);
+            writer.writeString(track.extra);
+        }
+    }
+    // 先写临时文件再重命名，防止其他线程读到不完整的索引文件
+    // Write a temporary file first and then rename, to prevent other threads from reading an incomplete index file
+    auto tmp = path + ".tmp";
+    if (!File::saveFile(writer.data(), tmp.data()) || 0 != rename(tmp.data(), path.data())) {
+        WarnL << "Save mp4 index file failed: " << path;
+        File::delete_file(tmp);
+    }
+}
+
+bool MP4Index::loadSidecar(const string &path) {
+    if (!File::fileExist(path)) {
+        return false;
+    }
+    auto data = File::loadFile(path);
+    SidecarReader reader(data);
+    auto magic = reader.readBytes(sizeof(kSidecarMagic) - 1);
+    auto version = reader.read<uint32_t>();
+    auto file_size = reader.read<uint64_t>();
+    auto mtime = reader.read<int64_t>();
+    if (!reader.ok() || magic != kSidecarMagic || version != kSidecarVersion || file_size != _file_size || mtime != _mtime) {
+        // 文件已经修改或格式不一致
+        // The file has been modified or the format is inconsistent
+        return false;
+    }
+    _duration_ms = reader.read<uint64_t>();
+    _video_track = reader.read<int>();
+    reader.readVector(_track_ids);
+    reader.readVector(_samples);
+    auto count = reader.read<uint32_t>();
+    vector<TrackInfo> tracks;
+    for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+        TrackInfo track;
+        track.track_id = reader.read<uint32_t>();
+        track.video = reader.read<bool>();
+        track.object = reader.read<uint8_t>();
+        track.width = reader.read<int>();
+        track.height = reader.read<int>();
+        track.channel_count = reader.read<int>();
+        track.bit_per_sample = reader.read<int>();
+        track.sample_rate = reader.read<int>();
+        track.extra = reader.readString();
+        tracks.emplace_back(std::move(track));
+    }
+    if (!reader.ok() || _samples.empty()) {
+        _track_ids.clear();
+        _samples.clear();
+        return false;
+    }
+    if (!tracks.empty()) {
+        _track_info = std::make_shared<vector<TrackInfo> >(std::move(tracks));
+    }
+    makeKeySamples();
+    return true;
+}
+
+/////////////////////////////////////////////////////内存缓存/////////////////////////////////////////////////////////
+
+namespace {
+
+// 以文件路径为key的lru缓存，文件大小或修改时间变化时失效
+// Lru cache keyed by file path, invalidated when the file size or modification time changes
+class MP4IndexCache {
+public:
+    static MP4IndexCache &Instance() {
+        static MP4IndexCache instance;
+        return instance;
+    }
+
+    MP4Index::Ptr get(const string &file, const function<bool(const MP4Index::Ptr &)> &match) {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _map.find(file);
+        if (it == _map.end()) {
+            return nullptr;
+        }
+        if (!match(it->second->second)) {
+            _list.erase(it->second);
+            _map.erase(it);
+            return nullptr;
+        }
+        _list.splice(_list.begin(), _list, it->second);
+        return it->second->second;
+    }
+
+    void add(const string &file, const MP4Index::Ptr &index, size_t max_size) {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _map.find(file);
+        if (it != _map.end()) {
+            _list.erase(it->second);
+            _map.erase(it);
+        }
+        if (!max_size) {
+            return;
+        }
+        _list.emplace_front(file, index);
+        _map[file] = _list.begin();
+        while (_list.size() > max_size) {
+            // 淘汰最久未使用的索引
+            // Evict the least recently used index
+            _map.erase(_list.back().first);
+            _list.pop_back();
+        }
+    }
+
+    void clear() {
+        lock_guard<mutex> lck(_mtx);
+        _map.clear();
+        _list.clear();
+    }
+
+private:
+    mutex _mtx;
+    list<pair<string, MP4Index::Ptr> > _list;
+    unordered_map<string, list<pair<string, MP4Index::Ptr> >::iterator> _map;
+};
+
+} // namespace
+
+bool MP4Index::getCached(const string &file, Ptr &index) {
+    uint64_t file_size;
+    int64_t mtime;
+    if (!getFileStat(file, file_size, mtime)) {
+        // 文件不存在，无需解析
+        // The file does not exist, no need to parse
+        index = nullptr;
+        return true;
+    }
+    auto ret = MP4IndexCache::Instance().get(file, [&](const MP4Index::Ptr &index) {
+        return index->_file_size == file_size && index->_mtime == mtime;
+    });
+    if (!ret) {
+        return false;
+    }
+    index = ret->_failed ? nullptr : ret;
+    return true;
+}
+
+void MP4Index::getAsync(const string &file, const function<void(const Ptr &index)> &cb) {
+    Ptr index;
+    if (getCached(file, index)) {
+        cb(index);
+        return;
+    }
+    auto poller = EventPoller::getCurrentPoller();
+    WorkThreadPool::Instance().getExecutor()->async([file, cb, poller]() {
+        auto index = get(file);
+        if (!poller) {
+            cb(index);
+            return;
+        }
+        poller->async([cb, index]() { cb(index); }, false);
+    });
+}
+
+MP4Index::Ptr MP4Index::get(const string &file) {
+    GET_CONFIG(size_t, cache_size, Record::kIndexCacheSize);
+    GET_CONFIG(bool, enable_sidecar, Record::kIndexSidecar);
+
+    uint64_t file_size;
+    int64_t mtime;
+    if (!getFileStat(file, file_size, mtime)) {
+        return nullptr;
+    }
+    auto ret = MP4IndexCache::Instance().get(file, [&](const MP4Index::Ptr &index) {
+        return index->_file_size == file_size && index->_mtime == mtime;
+    });
+    if (ret) {
+        return ret->_failed ? nullptr : ret;
+    }
+
+    ret = std::make_shared<MP4Index>();
+    ret->_file = file;
+    ret->_file_size = file_size;
+    ret->_mtime = mtime;
+    auto sidecar = getSidecarPath(file);
+    if (!enable_sidecar || !ret->loadSidecar(sidecar)) {
+        Ticker ticker;
+        if (!ret->parse(file)) {
+            // 缓存失败结果，文件大小或修改时间变化后才会重新解析
+            // Cache the failure, it will be parsed again only after the file size or modification time changes
+            auto failed = std::make_shared<MP4Index>();
+            failed->_file = file;
+            failed->_file_size = file_size;
+            failed->_mtime = mtime;
+            failed->_failed = true;
+            MP4IndexCache::Instance().add(file, failed, cache_size);
+            return nullptr;
+        }
+        DebugL << "Parse mp4 index: " << file << ", samples: " << ret->_samples.size() << ", cost " << ticker.elapsedTime() << "ms";
+        if (enable_sidecar) {
+            ret->saveSidecar(sidecar);
+        }
+    }
+    MP4IndexCache::Instance().add(file, ret, cache_size);
+    return ret;
+}
+
+void MP4Index::clearCache() {
+    MP4IndexCache::Instance().clear();
+}
+
+} // namespace mediakit
+#endif // defined(ENABLE_MP4)
@@ -0,0 +1,172 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_MP4INDEX_H
+#define ZLMEDIAKIT_MP4INDEX_H
+
+#if defined(ENABLE_MP4)
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace mediakit {
+
+/**
+ * mp4文件的样本索引(解析自moov的sample table)，按路径+修改时间缓存，避免每次打开文件都重新解析moov
+ * 只支持普通mp4(非fmp4)
+ * Sample index of mp4 file (parsed from the sample table of moov), cached by path + modification time to avoid reparsing moov every time the file is opened
+ * Only normal mp4 (not fmp4) is supported
+ */
+class MP4Index {
+public:
+    using Ptr = std::shared_ptr<MP4Index>;
+
+    static constexpr uint16_t kFlagKeyFrame = 0x01;
+
+    // 24字节，2小时的录像(视频+音频约50万个样本)约占12MB内存
+    // 24 bytes, a 2-hour recording (about 500,000 video + audio samples) takes about 12MB of memory
+    struct Sample {
+        // 样本在文件中的偏移量
+        // Offset of the sample in the file
+        uint64_t offset;
+        uint32_t size;
+        // 解码时间戳，单位毫秒
+        // Decoding timestamp, in milliseconds
+        uint32_t dts;
+        // pts - dts，单位毫秒
+        // pts - dts, in milliseconds
+        int32_t cts;
+        // track下标，对应getTrackId()
+        // Track index, corresponding to getTrackId()
+        uint16_t track;
+        uint16_t flags;
+    };
+
+    /**
+     * track信息，与mov_reader_getinfo的回调参数一致，有track信息时打开文件无需创建mov_reader
+     * Track information, consistent with the callback parameters of mov_reader_getinfo, no need to create mov_reader to open the file when it is available
+     */
+    struct TrackInfo {
+        uint32_t track_id = 0;
+        bool video = false;
+        uint8_t object = 0;
+        int width = 0;
+        int height = 0;
+        int channel_count = 0;
+        int bit_per_sample = 0;
+        int sample_rate = 0;
+        std::string extra;
+    };
+
+    /**
+     * 获取文件的样本索引，优先从内存缓存与索引文件获取，都没有时解析moov
+     * Get the sample index of the file, from the memory cache and the index file first, parse moov if neither exists
+     * @param file mp4文件路径
+     * @param file mp4 file path
+     * @return 文件不存在、未完成录制或为fmp4时返回nullptr
+     * @return nullptr when the file does not exist, the recording is not finished or it is fmp4
+     */
+    static Ptr get(const std::string &file);
+
+    /**
+     * 只查询内存缓存，不解析文件；解析失败的结果同样会按文件大小+修改时间缓存
+     * Only query the memory cache without parsing the file; failed parsing results are also cached by file size + modification time
+     * @param index 命中时返回索引，缓存的是解析失败结果时为nullptr
+     * @param index Returns the index when hit, nullptr when the cached result is a parsing failure
+     * @return 是否命中缓存
+     * @return Whether the cache is hit
+     */
+    static bool getCached(const std::string &file, Ptr &index);
+
+    /**
+     * 异步获取文件的样本索引，未命中内存缓存时在后台线程解析，再切回调用者所在的poller线程回调
+     * Get the sample index of the file asynchronously, parse in the background thread when the memory cache is missed, and then switch back to the poller thread of the caller for callback
+     * @param cb 回调，命中缓存时同步回调，参数为nullptr代表获取失败
+     * @param cb Callback, called synchronously when the cache is hit, nullptr means failed
+     */
+    static void getAsync(const std::string &file, const std::function<void(const Ptr &index)> &cb);
+
+    /**
+     * 清空内存缓存
+     * Clear the memory cache
+     */
+    static void clearCache();
+
+    /**
+     * 所有track的样本，按dts排序(dts相同时按文件偏移量排序)，与mov_reader的读取顺序一致
+     * Samples of all tracks, sorted by dts (by file offset when dts is the same), consistent with the reading order of mov_reader
+     */
+    const std::vector<Sample> &getSamples() const { return _samples; }
+
+    uint32_t getTrackId(const Sample &sample) const { return _track_ids[sample.track]; }
+
+    /**
+     * 视频关键帧在getSamples()中的下标(递增)，用于快进快退时只读取关键帧
+     * Indexes (increasing) of video key frames in getSamples(), used to read only key frames when fast forwarding or rewinding
+     */
+    const std::vector<uint32_t> &getKeySamples() const { return _key_samples; }
+
+    /**
+     * 文件时长，单位毫秒，与mov_reader_getduration一致
+     * File duration, in milliseconds, consistent with mov_reader_getduration
+     */
+    uint64_t getDurationMS() const { return _duration_ms; }
+
+    /**
+     * 查找seek位置：有视频时定位到不晚于stamp_ms的关键帧，否则定位到不早于stamp_ms的第一个样本
+     * Find the seek position: locate the key frame not later than stamp_ms when there is video, otherwise locate the first sample not earlier than stamp_ms
+     * @param stamp_ms 预期的时间戳，返回实际定位到的时间戳
+     * @param stamp_ms Expected timestamp, returns the actual timestamp located
+     * @return 样本下标，等于getSamples().size()时代表已经到文件末尾
+     * @return Sample index, equal to getSamples().size() means the end of the file
+     */
+    size_t seek(int64_t &stamp_ms) const;
+
+    /**
+     * 获取track信息，解析moov时由stsd生成；存在无法识别的样本描述(例如opus、vp9)时为空，需要mov_reader解析后调用setTrackInfo
+     * Get the track information, generated from stsd when parsing moov; empty when there is an unrecognizable sample description (such as opus, vp9), setTrackInfo needs to be called after mov_reader parsing
+     */
+    std::shared_ptr<const std::vector<TrackInfo> > getTrackInfo() const;
+
+    /**
+     * 保存mov_reader解析得到的track信息，开启索引文件时同时更新索引文件
+     * Save the track information parsed by mov_reader, and update the index file at the same time when the index file is enabled
+     */
+    void setTrackInfo(std::vector<TrackInfo> tracks);
+
+private:
+    bool parse(const std::string &file);
+    bool loadSidecar(const std::string &path);
+    void saveSidecar(const std::string &path) const;
+    void makeKeySamples();
+
+private:
+    std::string _file;
+    uint64_t _file_size = 0;
+    int64_t _mtime = 0;
+    // 解析失败的占位缓存，避免反复解析同一个损坏或未完成的文件
+    // Placeholder cache of parsing failure, to avoid repeatedly parsing the same broken or unfinished file
+    bool _failed = false;
+    uint64_t _duration_ms = 0;
+    std::vector<uint32_t> _track_ids;
+    // 视频track的下标，没有视频时为-1
+    // Index of the video track, -1 when there is no video
+    int _video_track = -1;
+    std::vector<Sample> _samples;
+    std::vector<uint32_t> _key_samples;
+    std::shared_ptr<const std::vector<TrackInfo> > _track_info;
+};
+
+} // namespace mediakit
+#endif // defined(ENABLE_MP4)
+#endif // ZLMEDIAKIT_MP4INDEX_H
@@ -10,6 +10,7 @@
 
 #ifdef ENABLE_MP4
 
+#include <cmath>
 #include "MP4Reader.h"
 #include "Common/config.h"
 #include "Thread/WorkThreadPool.h"
@@ -87,15 +88,23 @@ bool MP4Reader::readSample() {
 
     bool keyFrame = false;
     bool eof = false;
-    while (!eof && _last_dts < getCurrentStamp()) {
+    // 倒放时时间轴向后走
+    // The timeline goes backward when reversing
+    while (!eof && (_speed < 0 ? _last_dts > getCurrentStamp() : _last_dts < getCurrentStamp())) {
         auto frame = _demuxer->readFrame(keyFrame, eof);
         if (!frame) {
             continue;
         }
         _last_dts = frame->dts();
-        if (_muxer) {
-            _muxer->inputFrame(frame);
-        }
+        inputFrame(frame);
+    }
+
+    if (eof && _speed < 0) {
+        // 倒放到开头后暂停，等待seek或者修改倍速
+        // Pause after reversing to the beginning, wait for seek or speed change
+        setCurrentStamp(getCurrentStamp());
+        _paused = true;
+        return true;
     }
 
     GET_CONFIG(bool, file_repeat, Record::kFileRepeat);
@@ -116,13 +125,35 @@ bool MP4Reader::readNextSample() {
     if (!frame) {
         return false;
     }
-    if (_muxer) {
-        _muxer->inputFrame(frame);
-    }
+    inputFrame(frame);
     setCurrentStamp(frame->dts());
     return true;
 }
 
+void MP4Reader::inputFrame(const Frame::Ptr &frame) {
+    if (!_muxer) {
+        return;
+    }
+    if (!_key_only) {
+        _last_out_stamp = frame->dts();
+        _muxer->inputFrame(frame);
+        return;
+    }
+    if (_trick_rebase) {
+        // seek或者切换模式后，从上一帧的输出时间戳继续递增
+        // After seek or mode switch, continue to increase from the output timestamp of the previous frame
+        _trick_rebase = false;
+        _trick_in_base = frame->dts();
+        _trick_out_base = _last_out_stamp + 1;
+    }
+    auto elapsed = std::abs((int64_t)frame->dts() - (int64_t)_trick_in_base);
+    auto stamp = _trick_out_base + (uint64_t)(elapsed / std::fabs(_speed));
+    auto ret = std::make_shared<FrameStamp>(frame);
+    ret->setStamp(stamp, stamp + ((int64_t)frame->pts() - (int64_t)frame->dts()));
+    _last_out_stamp = stamp;
+    _muxer->inputFrame(ret);
+}
+
 void MP4Reader::stopReadMP4() {
     _timer = nullptr;
 }
@@ -169,7 +200,8 @@ const MultiMP4Demuxer::Ptr &MP4Reader::getDemuxer() const {
 }
 
 uint32_t MP4Reader::getCurrentStamp() {
-    return (uint32_t) (_seek_to + !_paused * _speed * _seek_ticker.elapsedTime());
+    auto stamp = (int64_t)_seek_to + (int64_t)(!_paused * _speed * _seek_ticker.elapsedTime());
+    return (uint32_t)std::max<int64_t>(stamp, 0);
 }
 
 void MP4Reader::setCurrentStamp(uint32_t new_stamp) {
@@ -205,26 +237,83 @@ bool MP4Reader::pause(MediaSource &sender, bool pause) {
 }
 
 bool MP4Reader::speed(MediaSource &sender, float speed) {
-    if (speed < 0.1 || speed > 20) {
+    lock_guard<recursive_mutex> lck(_mtx);
+    // 负数代表倒放
+    // Negative value means reverse playback
+    if (std::fabs(speed) < 0.1 || std::fabs(speed) > 20) {
         WarnL << "播放速度取值范围非法:" << speed;
         return false;
     }
+    GET_CONFIG(float, key_frame_only_speed, Record::kKeyFrameOnlySpeed);
+    bool reverse = speed < 0;
+    bool key_only = _have_video && (reverse || (key_frame_only_speed > 0 && speed >= key_frame_only_speed));
+    if (key_only && !_demuxer->setKeyFrameOnly(true, reverse)) {
+        key_only = false;
+    }
+    if (reverse && !key_only) {
+        WarnL << "该文件不支持倒放(需要视频与mp4样本索引):" << getOriginUrl(sender);
+        return false;
+    }
+    if (!key_only) {
+        _demuxer->setKeyFrameOnly(false);
+    }
+
     // _seek_ticker重置，赋值_seek_to  [AUTO-TRANSLATED:b30a3f06]
     // _seek_ticker reset, assign _seek_to
-    setCurrentStamp(getCurrentStamp());
+    auto stamp = getCurrentStamp();
+    setCurrentStamp(stamp);
     // 设置播放速度后应该恢复播放  [AUTO-TRANSLATED:851fcde9]
     // Playback should resume after setting the playback speed
     _paused = false;
     if (_speed == speed) {
         return true;
     }
+    bool mode_changed = key_only != _key_only || (key_only && reverse != (_speed < 0));
     _speed = speed;
-    TraceL << getOriginUrl(sender) << ",speed:" << speed;
+    _key_only = key_only;
+    if (mode_changed) {
+        // 切换读取模式后从当前位置的关键帧重新开始读
+        // After switching the read mode, restart reading from the key frame at the current position
+        _demuxer->updateTimeline();
+        auto duration = _demuxer->getDurationMS();
+        seekTo((uint32_t)std::min<uint64_t>(stamp, duration ? duration - 1 : 0));
+    } else if (_key_only) {
+        // 只修改倍速，输出时间戳从上一帧处按新的倍速递增
+        // Only change the speed, the output timestamp increases from the previous frame at the new speed
+        _trick_in_base = _last_dts;
+        _trick_out_base = _last_out_stamp;
+    }
+    TraceL << getOriginUrl(sender) << ",speed:" << speed << ",key frame only:" << key_only;
     return true;
 }
 
 bool MP4Reader::seekTo(uint32_t stamp_seek) {
     lock_guard<recursive_mutex> lck(_mtx);
+    _trick_rebase = true;
+    auto seq = ++_seek_seq;
+    _demuxer->updateTimeline();
+    if (stamp_seek >= _demuxer->getResolvedDurationMS() && !_demuxer->isResolved()) {
+        // 目标位置之前还有文件时长未知，后台线程解析完成后再在读取线程seek，不阻塞当前poller
+        // The durations of some files before the target position are unknown, seek in the reading thread after the background thread finishes parsing, without blocking the current poller
+        std::weak_ptr<MP4Reader> weak_self = shared_from_this();
+        _poller->async([weak_self, stamp_seek, seq]() {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return;
+            }
+            strong_self->_demuxer->whenResolved([weak_self, stamp_seek, seq]() {
+                auto strong_self = weak_self.lock();
+                if (!strong_self) {
+                    return;
+                }
+                lock_guard<recursive_mutex> lck(strong_self->_mtx);
+                if (seq == strong_self->_seek_seq && !strong_self->seekTo(stamp_seek)) {
+                    WarnL << "Seek failed: " << strong_self->_file_path << ", stamp: " << stamp_seek;
+                }
+            });
+        }, false);
+        return true;
+    }
     if (stamp_seek > _demuxer->getDurationMS()) {
         // 超过文件长度  [AUTO-TRANSLATED:b4361054]
         // Exceeds the file length
@@ -257,9 +346,7 @@ bool MP4Reader::seekTo(uint32_t stamp_seek) {
         if (keyFrame || frame->keyFrame() || frame->configFrame()) {
             // 定位到key帧  [AUTO-TRANSLATED:0300901d]
             // Locate to the keyframe
-            if (_muxer) {
-                _muxer->inputFrame(frame);
-            }
+            inputFrame(frame);
             // 设置当前时间戳  [AUTO-TRANSLATED:88949974]
             // Set the current timestamp
             setCurrentStamp(frame->dts());
@@ -86,6 +86,7 @@ private:
     uint32_t getCurrentStamp();
     void setCurrentStamp(uint32_t stamp);
     bool seekTo(uint32_t stamp_seek);
+    void inputFrame(const Frame::Ptr &frame);
 
     void setup(const MediaTuple &tuple, const std::string &file_path, const ProtocolOption &option, toolkit::EventPoller::Ptr poller);
 
@@ -96,6 +97,16 @@ private:
     float _speed = 1.0;
     uint32_t _last_dts = 0;
     uint32_t _seek_to = 0;
+    // 每次seek递增，等待时间轴解析完成的seek被新的seek取代后不再执行
+    // Incremented on each seek, a seek waiting for the timeline to be parsed is not performed after being replaced by a new seek
+    uint64_t _seek_seq = 0;
+    // 只读取关键帧(快进/倒放)时，输出时间戳按倍速重新生成，确保单调递增
+    // When only key frames are read (fast forward/reverse), the output timestamp is regenerated according to the speed to ensure monotonic increase
+    bool _key_only = false;
+    bool _trick_rebase = false;
+    uint64_t _trick_in_base = 0;
+    uint64_t _trick_out_base = 0;
+    uint64_t _last_out_stamp = 0;
     std::string _file_path;
     std::recursive_mutex _mtx;
     toolkit::Ticker _seek_ticker;
@@ -28,7 +28,9 @@ MP4Recorder::MP4Recorder(const MediaTuple &tuple, const string &path, size_t max
     static_cast<MediaTuple &>(_info) = tuple;
     _info.folder = path;
     GET_CONFIG(uint32_t, s_max_second, Protocol::kMP4MaxSecond);
+    GET_CONFIG(bool, fmp4_append, Record::kFmp4Append);
     _max_second = max_second ? max_second : s_max_second;
+    _fmp4_append = fmp4_append;
 }
 
 MP4Recorder::~MP4Recorder() {
@@ -56,6 +58,25 @@ void MP4Recorder::createFile() {
     _info.url = appName + "/" + _info.app + "/" + _info.stream + "/" + date + "/" + file_name;
 
     try {
+        if (_fmp4_append) {
+            // fmp4追加模式，写入init segment后直接追加分片
+            // fmp4 append mode, append fragments directly after writing the init segment
+            TraceL << "Open tmp fmp4 file: " << full_path_tmp;
+            auto fp = File::create_file(full_path_tmp, "wb");
+            if (!fp) {
+                throw std::runtime_error(string("打开文件失败:") + full_path_tmp);
+            }
+            GET_CONFIG(uint32_t, file_buf_size, Record::kFileBufSize);
+            std::shared_ptr<char> file_buf(new char[file_buf_size], [](char *ptr) { delete[] ptr; });
+            setvbuf(fp, file_buf.get(), _IOFBF, file_buf_size);
+            _file.reset(fp, [file_buf](FILE *fp) {
+                fflush(fp);
+                fclose(fp);
+            });
+            fwrite(_init_segment.data(), 1, _init_segment.size(), _file.get());
+            _full_path_tmp = full_path_tmp;
+            return;
+        }
         _muxer = std::make_shared<MP4Muxer>();
         TraceL << "Open tmp mp4 file: " << full_path_tmp;
         _muxer->openMP4(full_path_tmp);
@@ -72,15 +93,22 @@ void MP4Recorder::createFile() {
 
 void MP4Recorder::asyncClose() {
     auto muxer = _muxer;
+    // 转移所有权，确保后台线程关闭文件后再获取文件大小
+    // Transfer the ownership, to ensure the file is closed in the background thread before getting its size
+    auto file = std::move(_file);
     auto full_path_tmp = _full_path_tmp;
     auto info = _info;
+    info.time_len = (_last_stamp - _first_stamp) / 1000.0f;
     TraceL << "Start close tmp mp4 file: " << full_path_tmp;
-    WorkThreadPool::Instance().getExecutor()->async([muxer, full_path_tmp, info]() mutable {
-        info.time_len = muxer->getDuration() / 1000.0f;
+    WorkThreadPool::Instance().getExecutor()->async([muxer, file, full_path_tmp, info]() mutable {
         // 关闭mp4可能非常耗时，所以要放在后台线程执行  [AUTO-TRANSLATED:a7378a11]
         // Closing mp4 can be very time-consuming, so it should be executed in the background thread
         TraceL << "Closing tmp mp4 file: " << full_path_tmp;
-        muxer->closeMP4();
+        if (muxer) {
+            info.time_len = muxer->getDuration() / 1000.0f;
+            muxer->closeMP4();
+        }
+        file = nullptr;
         TraceL << "Closed tmp mp4 file: " << full_path_tmp;
         if (!full_path_tmp.empty()) {
             // 获取文件大小  [AUTO-TRANSLATED:7b90eb41]
@@ -104,7 +132,7 @@ void MP4Recorder::asyncClose() {
 }
 
 void MP4Recorder::closeFile() {
-    if (_muxer) {
+    if (_muxer || _file) {
         asyncClose();
         _muxer = nullptr;
     }
@@ -117,6 +145,11 @@ void MP4Recorder::flush() {
 }
 
 bool MP4Recorder::inputFrame(const Frame::Ptr &frame) {
+    if (_fmp4_append) {
+        // 由共享复用器输入分片
+        // Fragments are input by the shared muxer
+        return false;
+    }
     auto stamp_inc = _delta_stamp[frame->getTrackType()].relativeStamp(frame->pts(), false);
     if (!_muxer || (stamp_inc > int64_t(_max_second) * 1000 && (!_have_video || frame->keyFrame()))) {
         // 成立条件  [AUTO-TRANSLATED:8c9c6083]
@@ -157,6 +190,40 @@ void MP4Recorder::resetTracks() {
     _have_video = false;
 }
 
+void MP4Recorder::inputInitSegment(const std::string &init_segment) {
+    if (_init_segment != init_segment) {
+        // track改变，新开文件
+        // Tracks changed, open a new file
+        closeFile();
+        _init_segment = init_segment;
+    }
+}
+
+bool MP4Recorder::inputFMP4(const FMP4Packet::Ptr &packet, bool key_frame) {
+    if (!packet) {
+        closeFile();
+        return true;
+    }
+    if (_init_segment.empty()) {
+        return false;
+    }
+    if (!_file || ((int64_t)(packet->time_stamp - _first_stamp) > int64_t(_max_second) * 1000 && key_frame)) {
+        if (!key_frame) {
+            // 文件必须以关键帧开始
+            // The file must start with a key frame
+            return false;
+        }
+        createFile();
+        if (!_file) {
+            return false;
+        }
+        _first_stamp = _last_stamp = packet->time_stamp;
+    }
+    fwrite(packet->data(), 1, packet->size(), _file.get());
+    _last_stamp = packet->time_stamp;
+    return true;
+}
+
 } /* namespace mediakit */
 
 #endif //ENABLE_MP4
@@ -16,13 +16,14 @@
 #include "Common/MediaSink.h"
 #include "Record/Recorder.h"
 #include "MP4Muxer.h"
+#include "FMP4/SharedFMP4Muxer.h"
 
 namespace mediakit {
 
 #ifdef ENABLE_MP4
 class MP4Muxer;
 
-class MP4Recorder final : public MediaSinkInterface {
+class MP4Recorder final : public MediaSinkInterface, public FMP4Consumer {
 public:
     using Ptr = std::shared_ptr<MP4Recorder>;
 
@@ -62,6 +63,15 @@ public:
      */
     bool addTrack(const Track::Ptr & track) override;
 
+    /**
+     * 是否为fmp4追加模式(record.fmp4Append)，该模式下直接追加写入共享复用器产生的分片，不再自行复用
+     * Whether it is fmp4 append mode (record.fmp4Append), in which the fragments generated by the shared muxer are appended directly without muxing by itself
+     */
+    bool isFMP4Append() const { return _fmp4_append; }
+
+    void inputInitSegment(const std::string &init_segment) override;
+    bool inputFMP4(const FMP4Packet::Ptr &packet, bool key_frame) override;
+
 private:
     void createFile();
     void closeFile();
@@ -69,6 +79,11 @@ private:
 
 private:
     bool _have_video = false;
+    bool _fmp4_append = false;
+    uint64_t _first_stamp = 0;
+    uint64_t _last_stamp = 0;
+    std::string _init_segment;
+    std::shared_ptr<FILE> _file;
     size_t _max_second;
     DeltaStamp _delta_stamp[TrackMax];
     std::atomic<uint64_t> _file_index { 0 };
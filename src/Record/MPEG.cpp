@@ -158,4 +158,194 @@ void MpegMuxer::flush() {
 
 }//mediakit
 
-#endif
\ No newline at end of file
+#endif
+
+using namespace toolkit;
+
+namespace mediakit {
+
+static constexpr size_t kTSPacketSize = 188;
+// 单个gop最多缓存的ts数据块个数，防止无关键帧时无限增长
+// Maximum number of cached ts chunks in one gop, to prevent unlimited growth when there is no key frame
+static constexpr size_t kMaxGopCacheSize = 1024;
+
+// 从PAT包中解析第一个节目的PMT pid，失败返回0
+// Parse the PMT pid of the first program from the PAT packet, returns 0 on failure
+static uint16_t getPmtPid(const uint8_t *pkt) {
+    if (!(pkt[1] & 0x40)) {
+        // 非section起始包
+        // Not the start packet of a section
+        return 0;
+    }
+    size_t offset = 4;
+    if (pkt[3] & 0x20) {
+        // 跳过adaptation field
+        // Skip the adaptation field
+        offset += 1 + pkt[4];
+    }
+    if (offset >= kTSPacketSize) {
+        return 0;
+    }
+    // 跳过pointer field
+    // Skip the pointer field
+    offset += 1 + pkt[offset];
+    // table_id(8) section_length(16) transport_stream_id(16) version(8) section_number(8) last_section_number(8)
+    if (offset + 8 > kTSPacketSize || pkt[offset] != 0x00) {
+        return 0;
+    }
+    size_t section_length = ((pkt[offset + 1] & 0x0F) << 8) | pkt[offset + 2];
+    if (section_length < 5 + 4) {
+        return 0;
+    }
+    // 去掉尾部4字节crc
+    // Remove the trailing 4 bytes crc
+    auto end = MIN(offset + 3 + section_length - 4, kTSPacketSize);
+    for (offset += 8; offset + 4 <= end; offset += 4) {
+        uint16_t program_number = (pkt[offset] << 8) | pkt[offset + 1];
+        if (program_number) {
+            return ((pkt[offset + 2] & 0x1F) << 8) | pkt[offset + 3];
+        }
+    }
+    return 0;
+}
+
+static uint16_t getPid(const char *pkt) {
+    return ((pkt[1] & 0x1F) << 8) | (uint8_t)pkt[2];
+}
+
+SharedTSMuxer::~SharedTSMuxer() {
+    try {
+        flush();
+    } catch (std::exception &ex) {
+        WarnL << ex.what();
+    }
+}
+
+void SharedTSMuxer::addConsumer(const MpegConsumer::Ptr &consumer) {
+    if (!consumer) {
+        return;
+    }
+    _consumers.emplace_back();
+    _consumers.back().consumer = consumer;
+    for (auto &pkt : _gop) {
+        dispatch(_consumers.back(), pkt);
+    }
+}
+
+void SharedTSMuxer::removeConsumer(const MpegConsumer::Ptr &consumer) {
+    for (auto it = _consumers.begin(); it != _consumers.end();) {
+        auto strong = it->consumer.lock();
+        if (!strong || strong == consumer) {
+            it = _consumers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SharedTSMuxer::enableGopCache(bool enable) {
+    _gop_cache = enable;
+    if (!enable) {
+        _gop.clear();
+    }
+}
+
+void SharedTSMuxer::pauseInput() {
+    _gop.clear();
+    _wait_key = true;
+}
+
+void SharedTSMuxer::onWrite(std::shared_ptr<Buffer> buffer, uint64_t timestamp, bool key_pos) {
+    Packet pkt { std::move(buffer), timestamp, key_pos };
+    if (pkt.buffer) {
+        savePsi(*pkt.buffer);
+        if (_wait_key) {
+            if (!key_pos) {
+                // 暂停输入后恢复，从关键帧开始输出
+                // Resumed after the input was paused, output from a key frame
+                return;
+            }
+            _wait_key = false;
+            for (auto &consumer : _consumers) {
+                consumer.need_psi = true;
+            }
+        }
+        if (_gop_cache) {
+            if (key_pos || _gop.size() >= kMaxGopCacheSize) {
+                _gop.clear();
+            }
+            _gop.emplace_back(pkt);
+        }
+    } else {
+        // 轨道重置，PAT/PMT可能改变
+        // Tracks reset, PAT/PMT may change
+        _pmt_pid = 0;
+        _pat.clear();
+        _pmt.clear();
+        _psi = nullptr;
+        _gop.clear();
+    }
+
+    for (auto it = _consumers.begin(); it != _consumers.end();) {
+        if (dispatch(*it, pkt)) {
+            ++it;
+        } else {
+            it = _consumers.erase(it);
+        }
+    }
+}
+
+bool SharedTSMuxer::dispatch(Consumer &consumer, const Packet &pkt) {
+    auto strong = consumer.consumer.lock();
+    if (!strong) {
+        return false;
+    }
+    if (!pkt.buffer) {
+        strong->inputMpeg(nullptr, pkt.timestamp, pkt.key_pos);
+        consumer.need_psi = true;
+        return true;
+    }
+
+    if (consumer.need_psi && pkt.key_pos && getPid(pkt.buffer->data()) != 0 && !_pat.empty() && !_pmt.empty()) {
+        // 该消费者错过了PAT/PMT，在关键帧前补发(内容与cc与最近一次发出的相同，属于合法的重复包)
+        // This consumer missed PAT/PMT, re-send them before the key frame (same content and cc as the latest ones, which are legal duplicate packets)
+        if (!_psi || _psi_changed) {
+            _psi = std::make_shared<BufferString>(_pat + _pmt);
+            _psi_changed = false;
+        }
+        if (!strong->inputMpeg(_psi, pkt.timestamp, true)) {
+            return true;
+        }
+        consumer.need_psi = !strong->inputMpeg(pkt.buffer, pkt.timestamp, false);
+        return true;
+    }
+
+    if (!strong->inputMpeg(pkt.buffer, pkt.timestamp, pkt.key_pos)) {
+        // 未启用期间丢弃的数据可能包含PAT/PMT
+        // The data dropped while disabled may contain PAT/PMT
+        consumer.need_psi = true;
+    } else if (pkt.key_pos) {
+        consumer.need_psi = false;
+    }
+    return true;
+}
+
+void SharedTSMuxer::savePsi(const Buffer &buffer) {
+    auto size = buffer.size();
+    for (size_t offset = 0; offset + kTSPacketSize <= size; offset += kTSPacketSize) {
+        auto pkt = buffer.data() + offset;
+        auto pid = getPid(pkt);
+        if (pid == 0) {
+            _pat.assign(pkt, kTSPacketSize);
+            _psi_changed = true;
+            if (auto pmt_pid = getPmtPid((uint8_t *)pkt)) {
+                _pmt_pid = pmt_pid;
+            }
+        } else if (_pmt_pid && pid == _pmt_pid) {
+            _pmt.assign(pkt, kTSPacketSize);
+            _psi_changed = true;
+        }
+    }
+}
+
+}//namespace mediakit
@@ -128,4 +128,103 @@ protected:
 
 #endif
 
+#include <vector>
+
+namespace mediakit {
+
+/**
+ * 共享ts复用结果的消费者
+ * Consumer of the shared ts muxer output
+ */
+class MpegConsumer {
+public:
+    using Ptr = std::shared_ptr<MpegConsumer>;
+    virtual ~MpegConsumer() = default;
+
+    /**
+     * 输入共享复用器产生的ts数据
+     * Input the ts data generated by the shared muxer
+     * @param buffer ts数据包(188字节对齐)，nullptr代表轨道重置
+     * @param timestamp 时间戳，单位毫秒
+     * @param key_pos 是否为关键帧的第一个ts包
+     * @return 未启用(按需模式下无人观看)时返回false
+     * @param buffer ts data packets (188 bytes aligned), nullptr means the tracks are reset
+     * @param timestamp Timestamp, in milliseconds
+     * @param key_pos Whether it is the first ts packet of a key frame
+     * @return Returns false when disabled (no viewers in on-demand mode)
+     */
+    virtual bool inputMpeg(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) = 0;
+};
+
+/**
+ * 一路流只复用一次ts，复用结果由http-ts、hls等消费者共享
+ * Mux ts only once per stream, the output is shared by consumers such as http-ts and hls
+ * 新加入或者暂停后恢复的消费者，在其第一个关键帧前补发PAT/PMT
+ * Consumers that are newly added or resumed after a pause get PAT/PMT re-sent before their first key frame
+ */
+class SharedTSMuxer final : public MpegMuxer {
+public:
+    using Ptr = std::shared_ptr<SharedTSMuxer>;
+
+    SharedTSMuxer() : MpegMuxer(false) {}
+    ~SharedTSMuxer() override;
+
+    /**
+     * 添加消费者，开启gop缓存时立即补发最近一个gop
+     * Add a consumer, the latest gop is sent immediately when the gop cache is enabled
+     */
+    void addConsumer(const MpegConsumer::Ptr &consumer);
+
+    /**
+     * 移除消费者
+     * Remove a consumer
+     */
+    void removeConsumer(const MpegConsumer::Ptr &consumer);
+
+    /**
+     * 是否缓存最近一个gop的ts数据，用于中途加入的消费者
+     * Whether to cache the ts data of the latest gop, used for consumers added midway
+     */
+    void enableGopCache(bool enable);
+
+    /**
+     * 没有启用的消费者、停止输入帧期间调用；清空gop缓存，恢复输入后丢弃第一个关键帧之前的输出，
+     * 避免之后加入的消费者收到过期的gop或者从gop中间开始的数据
+     * Called while there is no enabled consumer and frames are not input; clear the gop cache, and drop the output before the first key frame after the input resumes,
+     * to prevent consumers added later from receiving a stale gop or data starting from the middle of a gop
+     */
+    void pauseInput();
+
+protected:
+    void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t timestamp, bool key_pos) override;
+
+private:
+    struct Consumer {
+        std::weak_ptr<MpegConsumer> consumer;
+        bool need_psi = true;
+    };
+
+    struct Packet {
+        toolkit::Buffer::Ptr buffer;
+        uint64_t timestamp;
+        bool key_pos;
+    };
+
+    bool dispatch(Consumer &consumer, const Packet &pkt);
+    void savePsi(const toolkit::Buffer &buffer);
+
+private:
+    bool _gop_cache = false;
+    bool _wait_key = false;
+    bool _psi_changed = false;
+    uint16_t _pmt_pid = 0;
+    std::string _pat;
+    std::string _pmt;
+    toolkit::Buffer::Ptr _psi;
+    std::vector<Consumer> _consumers;
+    std::vector<Packet> _gop;
+};
+
+}//namespace mediakit
+
 #endif //ZLMEDIAKIT_MPEG_H
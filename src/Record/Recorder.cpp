@@ -15,6 +15,7 @@
 #include "MP4Recorder.h"
 #include "HlsRecorder.h"
 #include "FMP4/FMP4MediaSourceMuxer.h"
+#include "FMP4/SharedFMP4Muxer.h"
 #include "TS/TSMediaSourceMuxer.h"
 
 using namespace std;
@@ -72,7 +73,51 @@ string Recorder::getRecordPath(Recorder::type type, const MediaTuple& tuple, con
     }
 }
 
+/**
+ * 兼容createRecorder创建hls/http-ts/hls-fmp4/http-fmp4：自带一个共享复用器，只有一个消费者
+ * For createRecorder to create hls/http-ts/hls-fmp4/http-fmp4 compatibly: it has its own shared muxer with only one consumer
+ */
+template <typename Muxer, typename Consumer>
+class SharedMuxerSink : public MediaSinkInterface {
+public:
+    SharedMuxerSink(std::shared_ptr<Consumer> consumer) : _consumer(std::move(consumer)) {
+        _muxer = std::make_shared<Muxer>();
+        _muxer->addConsumer(_consumer);
+    }
+
+    bool inputFrame(const Frame::Ptr &frame) override { return _muxer->inputFrame(frame); }
+    bool addTrack(const Track::Ptr &track) override { return _muxer->addTrack(track); }
+    void addTrackCompleted() override { _muxer->addTrackCompleted(); }
+    void resetTracks() override { _muxer->resetTracks(); }
+    void flush() override { _muxer->flush(); }
+
+private:
+    std::shared_ptr<Consumer> _consumer;
+    std::shared_ptr<Muxer> _muxer;
+};
+
 std::shared_ptr<MediaSinkInterface> Recorder::createRecorder(type type, const MediaTuple& tuple, const ProtocolOption &option){
+    switch (type) {
+        case Recorder::type_mp4: {
+#if defined(ENABLE_MP4)
+            auto path = Recorder::getRecordPath(type, tuple, option.mp4_save_path);
+            return std::make_shared<MP4Recorder>(tuple, path, option.mp4_max_second);
+#else
+            throw std::invalid_argument("mp4相关功能未打开，请开启ENABLE_MP4宏后编译再测试");
+#endif
+        }
+
+        case Recorder::type_hls:
+        case Recorder::type_ts: return std::make_shared<SharedMuxerSink<SharedTSMuxer, MpegConsumer> >(createMpegConsumer(type, tuple, option));
+
+        case Recorder::type_hls_fmp4:
+        case Recorder::type_fmp4: return std::make_shared<SharedMuxerSink<SharedFMP4Muxer, FMP4Consumer> >(createFMP4Consumer(type, tuple, option));
+
+        default: throw std::invalid_argument("未知的录制类型");
+    }
+}
+
+std::shared_ptr<MpegConsumer> Recorder::createMpegConsumer(type type, const MediaTuple& tuple, const ProtocolOption &option) {
     switch (type) {
         case Recorder::type_hls: {
 #if defined(ENABLE_HLS)
@@ -86,15 +131,20 @@ std::shared_ptr<MediaSinkInterface> Recorder::createRecorder(type type, const Me
 #endif
         }
 
-        case Recorder::type_mp4: {
-#if defined(ENABLE_MP4)
-            auto path = Recorder::getRecordPath(type, tuple, option.mp4_save_path);
-            return std::make_shared<MP4Recorder>(tuple, path, option.mp4_max_second);
+        case Recorder::type_ts: {
+#if defined(ENABLE_HLS) || defined(ENABLE_RTPPROXY)
+            return std::make_shared<TSMediaSourceMuxer>(tuple, option);
 #else
-            throw std::invalid_argument("mp4相关功能未打开，请开启ENABLE_MP4宏后编译再测试");
+            throw std::invalid_argument("mpegts相关功能未打开，请开启ENABLE_HLS或ENABLE_RTPPROXY宏后编译再测试");
 #endif
         }
 
+        default: throw std::invalid_argument("该录制类型不是ts消费者");
+    }
+}
+
+std::shared_ptr<FMP4Consumer> Recorder::createFMP4Consumer(type type, const MediaTuple& tuple, const ProtocolOption &option) {
+    switch (type) {
         case Recorder::type_hls_fmp4: {
 #if defined(ENABLE_MP4)
             auto path = Recorder::getRecordPath(type, tuple, option.hls_save_path);
@@ -115,15 +165,7 @@ std::shared_ptr<MediaSinkInterface> Recorder::createRecorder(type type, const Me
 #endif
         }
 
-        case Recorder::type_ts: {
-#if defined(ENABLE_HLS) || defined(ENABLE_RTPPROXY)
-            return std::make_shared<TSMediaSourceMuxer>(tuple, option);
-#else
-            throw std::invalid_argument("mpegts相关功能未打开，请开启ENABLE_HLS或ENABLE_RTPPROXY宏后编译再测试");
-#endif
-        }
-
-        default: throw std::invalid_argument("未知的录制类型");
+        default: throw std::invalid_argument("该录制类型不是fmp4消费者");
     }
 }
 
@@ -17,6 +17,8 @@
 
 namespace mediakit {
 class MediaSinkInterface;
+class MpegConsumer;
+class FMP4Consumer;
 class ProtocolOption;
 
 struct MediaTuple {
@@ -108,6 +110,26 @@ public:
      */
     static std::shared_ptr<MediaSinkInterface> createRecorder(type type, const MediaTuple& tuple, const ProtocolOption &option);
 
+    /**
+     * 创建消费共享ts复用器输出的hls/http-ts对象，它们自身不复用；createRecorder创建的同类对象自带一个独立的ts复用器
+     * @param type type_hls或type_ts
+     * @return 对象指针
+     * Create the hls/http-ts object that consumes the output of the shared ts muxer, they do not mux by themselves; the same kind of object created by createRecorder has its own ts muxer
+     * @param type type_hls or type_ts
+     * @return object pointer
+     */
+    static std::shared_ptr<MpegConsumer> createMpegConsumer(type type, const MediaTuple& tuple, const ProtocolOption &option);
+
+    /**
+     * 创建消费共享fmp4复用器输出的hls-fmp4/http-fmp4对象，它们自身不复用；createRecorder创建的同类对象自带一个独立的fmp4复用器
+     * @param type type_hls_fmp4或type_fmp4
+     * @return 对象指针
+     * Create the hls-fmp4/http-fmp4 object that consumes the output of the shared fmp4 muxer, they do not mux by themselves; the same kind of object created by createRecorder has its own fmp4 muxer
+     * @param type type_hls_fmp4 or type_fmp4
+     * @return object pointer
+     */
+    static std::shared_ptr<FMP4Consumer> createFMP4Consumer(type type, const MediaTuple& tuple, const ProtocolOption &option);
+
 private:
     Recorder() = delete;
     ~Recorder() = delete;
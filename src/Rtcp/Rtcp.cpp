@@ -59,11 +59,11 @@ const char *rtpfbTypeToStr(RTPFBType type) {
     }
 }
 
-static size_t alignSize(size_t bytes) {
+size_t alignSize(size_t bytes) {
     return (size_t)((bytes + 3) >> 2) << 2;
 }
 
-static void setupHeader(RtcpHeader *rtcp, RtcpType type, size_t report_count, size_t total_bytes) {
+void setupHeader(RtcpHeader *rtcp, RtcpType type, size_t report_count, size_t total_bytes) {
     rtcp->version = 2;
     rtcp->padding = 0;
     if (report_count > 0x1F) {
@@ -76,7 +76,7 @@ static void setupHeader(RtcpHeader *rtcp, RtcpType type, size_t report_count, si
     rtcp->setSize(total_bytes);
 }
 
-static void setupPadding(RtcpHeader *rtcp, size_t padding_size) {
+void setupPadding(RtcpHeader *rtcp, size_t padding_size) {
     if (padding_size) {
         rtcp->padding = 1;
         ((uint8_t *)rtcp)[rtcp->getSize() - 1] = padding_size & 0xFF;
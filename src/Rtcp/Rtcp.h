@@ -235,6 +235,28 @@ private:
 
 };
 
+/**
+ * rtcp长度按4字节对齐
+ * Align the rtcp length to 4 bytes
+ */
+size_t alignSize(size_t bytes);
+
+/**
+ * 设置rtcp头部字段
+ * @param report_count report count或fmt
+ * @param total_bytes rtcp总长度，必须4字节对齐
+ * Set the rtcp header fields
+ * @param report_count report count or fmt
+ * @param total_bytes Total length of rtcp, must be 4-byte aligned
+ */
+void setupHeader(RtcpHeader *rtcp, RtcpType type, size_t report_count, size_t total_bytes);
+
+/**
+ * 设置rtcp末尾padding，须在setupHeader之后调用
+ * Set the trailing padding of rtcp, must be called after setupHeader
+ */
+void setupPadding(RtcpHeader *rtcp, size_t padding_size);
+
 /////////////////////////////////////////////////////////////////////////////
 
 // ReportBlock
@@ -0,0 +1,95 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "RtcpBuilder.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 一般rtcp包都小于该值，避免扩容
+// Generally rtcp packets are smaller than this value, avoid expansion
+static constexpr size_t kInitCapacity = 256;
+
+RtcpHeader *RtcpBuilder::add(RtcpType type, size_t report_count, size_t real_size) {
+    auto bytes = alignSize(real_size);
+    if (!_buffer) {
+        if (_cache && _cache.use_count() == 1) {
+            // 上次的包已经发送完毕，没有其他引用，直接复用
+            // The last packet has been sent and there are no other references, reuse it directly
+            _buffer = std::move(_cache);
+        } else {
+            _buffer = BufferRaw::create();
+        }
+        _buffer->setSize(0);
+        _buffer->setCapacity(MAX(kInitCapacity, bytes));
+    }
+    auto offset = _buffer->size();
+    if (offset + bytes > _buffer->getCapacity()) {
+        // 换一个更大的缓存，并拷贝已经写入的rtcp包
+        // Change to a larger cache and copy the rtcp packets that have been written
+        auto buffer = BufferRaw::create();
+        buffer->setSize(0);
+        buffer->setCapacity(MAX(2 * _buffer->getCapacity(), offset + bytes));
+        memcpy(buffer->data(), _buffer->data(), offset);
+        _buffer = std::move(buffer);
+    }
+    auto rtcp = (RtcpHeader *)(_buffer->data() + offset);
+    memset(rtcp, 0, bytes);
+    setupHeader(rtcp, type, report_count, bytes);
+    setupPadding(rtcp, bytes - real_size);
+    _buffer->setSize(offset + bytes);
+    return rtcp;
+}
+
+RtcpSR *RtcpBuilder::addSR(size_t item_count) {
+    auto real_size = sizeof(RtcpSR) - sizeof(ReportItem) + item_count * sizeof(ReportItem);
+    return (RtcpSR *)add(RtcpType::RTCP_SR, item_count, real_size);
+}
+
+RtcpRR *RtcpBuilder::addRR(size_t item_count) {
+    auto real_size = sizeof(RtcpRR) - sizeof(ReportItem) + item_count * sizeof(ReportItem);
+    return (RtcpRR *)add(RtcpType::RTCP_RR, item_count, real_size);
+}
+
+RtcpFB *RtcpBuilder::addFB(PSFBType fmt, const void *fci, size_t fci_len) {
+    if (!fci) {
+        fci_len = 0;
+    }
+    auto ret = (RtcpFB *)add(RtcpType::RTCP_PSFB, (size_t)fmt, sizeof(RtcpFB) + fci_len);
+    if (fci_len) {
+        memcpy((char *)ret + sizeof(RtcpFB), fci, fci_len);
+    }
+    return ret;
+}
+
+RtcpFB *RtcpBuilder::addFB(RTPFBType fmt, const void *fci, size_t fci_len) {
+    if (!fci) {
+        fci_len = 0;
+    }
+    auto ret = (RtcpFB *)add(RtcpType::RTCP_RTPFB, (size_t)fmt, sizeof(RtcpFB) + fci_len);
+    if (fci_len) {
+        memcpy((char *)ret + sizeof(RtcpFB), fci, fci_len);
+    }
+    return ret;
+}
+
+RtcpXRDLRR *RtcpBuilder::addXRDLRR(size_t item_count) {
+    auto real_size = sizeof(RtcpXRDLRR) - sizeof(RtcpXRDLRRReportItem) + item_count * sizeof(RtcpXRDLRRReportItem);
+    return (RtcpXRDLRR *)add(RtcpType::RTCP_XR, 0, real_size);
+}
+
+Buffer::Ptr RtcpBuilder::finish() {
+    _cache = _buffer;
+    return std::move(_buffer);
+}
+
+} // namespace mediakit
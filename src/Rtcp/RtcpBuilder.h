@@ -0,0 +1,54 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RTCPBUILDER_H
+#define ZLMEDIAKIT_RTCPBUILDER_H
+
+#include "Rtcp.h"
+#include "Network/Buffer.h"
+
+namespace mediakit {
+
+/**
+ * rtcp包构造器，在每个会话复用的缓存上直接写入rtcp包，多次add可拼成复合包
+ * 生成的包与RtcpSR/RtcpRR/RtcpFB/RtcpXRDLRR::create一致，除头部外所有字段都清零，由调用者以网络字节序赋值
+ * add返回的指针在下一次add或finish前有效
+ * Rtcp packet builder, writes rtcp packets directly on the cache reused by each session, multiple adds can form a compound packet
+ * The generated packet is consistent with RtcpSR/RtcpRR/RtcpFB/RtcpXRDLRR::create, all fields except the header are zeroed, and assigned by the caller in network byte order
+ * The pointer returned by add is valid until the next add or finish
+ */
+class RtcpBuilder {
+public:
+    RtcpSR *addSR(size_t item_count);
+    RtcpRR *addRR(size_t item_count);
+    RtcpFB *addFB(PSFBType fmt, const void *fci = nullptr, size_t fci_len = 0);
+    RtcpFB *addFB(RTPFBType fmt, const void *fci = nullptr, size_t fci_len = 0);
+    RtcpXRDLRR *addXRDLRR(size_t item_count);
+
+    /**
+     * 取走已构造的rtcp(复合)包，调用者释放后下次add会复用该缓存
+     * Take away the constructed rtcp (compound) packet, the next add will reuse the cache after the caller releases it
+     */
+    toolkit::Buffer::Ptr finish();
+
+private:
+    RtcpHeader *add(RtcpType type, size_t report_count, size_t real_size);
+
+private:
+    // 正在构造的包
+    // The packet being constructed
+    toolkit::BufferRaw::Ptr _buffer;
+    // 上次finish的包，不再被引用时复用
+    // The packet of the last finish, reused when it is no longer referenced
+    toolkit::BufferRaw::Ptr _cache;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RTCPBUILDER_H
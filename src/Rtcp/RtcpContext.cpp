@@ -52,15 +52,16 @@ Buffer::Ptr RtcpContext::createRtcpXRDLRR(uint32_t rtcp_ssrc, uint32_t rtp_ssrc)
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-void RtcpContextForSend::onRtcp(RtcpHeader *rtcp) {
-    switch ((RtcpType)rtcp->pt) {
+void RtcpContextForSend::onRtcp(const RtcpView &rtcp) {
+    switch (rtcp.type()) {
     case RtcpType::RTCP_RR: {
-        auto rtcp_rr = (RtcpRR *)rtcp;
-        for (auto item : rtcp_rr->getItemList()) {
-            if (!item->last_sr_stamp) {
+        RtcpRRView rtcp_rr(rtcp);
+        for (size_t i = 0; i < rtcp_rr.itemCount(); ++i) {
+            auto item = rtcp_rr.getItem(i);
+            if (!item.lastSrStamp()) {
                 continue;
             }
-            auto it = _sender_report_ntp.find(item->last_sr_stamp);
+            auto it = _sender_report_ntp.find(item.lastSrStamp());
             if (it == _sender_report_ntp.end()) {
                 continue;
             }
@@ -69,27 +70,27 @@ void RtcpContextForSend::onRtcp(RtcpHeader *rtcp) {
             auto ms_inc = getCurrentMillisecond() - it->second;
             // rtp接收端收到sr包后，回复rr包的延时，已转换为毫秒  [AUTO-TRANSLATED:bfab8622]
             // Delay of the rtp receiver replying to the rr packet after receiving the sr packet, converted to milliseconds
-            auto delay_ms = (uint64_t)item->delay_since_last_sr * 1000 / 65536;
+            auto delay_ms = (uint64_t)item.delaySinceLastSr() * 1000 / 65536;
             auto rtt = (int)(ms_inc - delay_ms);
             if (rtt >= 0) {
                 // rtt不可能小于0  [AUTO-TRANSLATED:34914014]
                 // RTT cannot be less than 0
-                _rtt[item->ssrc] = rtt;
-                // InfoL << "ssrc:" << item->ssrc << ",rtt:" << rtt;
+                _rtt[item.ssrc()] = rtt;
+                // InfoL << "ssrc:" << item.ssrc() << ",rtt:" << rtt;
             }
         }
         break;
     }
     case RtcpType::RTCP_XR: {
-        auto rtcp_xr = (RtcpXRRRTR *)rtcp;
-        if (rtcp_xr->bt == 4) {
-            _xr_xrrtr_recv_last_rr[rtcp_xr->ssrc]
-                = ((rtcp_xr->ntpmsw & 0xFFFF) << 16) | ((rtcp_xr->ntplsw >> 16) & 0xFFFF);
-            _xr_rrtr_recv_sys_stamp[rtcp_xr->ssrc] = getCurrentMillisecond();
-        } else if (rtcp_xr->bt == 5) {
+        RtcpXRView rtcp_xr(rtcp);
+        if (rtcp_xr.bt() == 4) {
+            _xr_xrrtr_recv_last_rr[rtcp_xr.ssrc()]
+                = ((rtcp_xr.ntpmsw() & 0xFFFF) << 16) | ((rtcp_xr.ntplsw() >> 16) & 0xFFFF);
+            _xr_rrtr_recv_sys_stamp[rtcp_xr.ssrc()] = getCurrentMillisecond();
+        } else if (rtcp_xr.bt() == 5) {
             TraceL << "for sender not recive dlrr";
         } else {
-            TraceL << "not support xr bt " << rtcp_xr->bt;
+            TraceL << "not support xr bt " << (int)rtcp_xr.bt();
         }
         break;
     }
@@ -107,7 +108,7 @@ uint32_t RtcpContextForSend::getRtt(uint32_t ssrc) const {
 }
 
 Buffer::Ptr RtcpContextForSend::createRtcpSR(uint32_t rtcp_ssrc) {
-    auto rtcp = RtcpSR::create(0);
+    auto rtcp = _builder.addSR(0);
     rtcp->setNtpStamp(_last_ntp_stamp_ms);
     rtcp->rtpts = htonl(_last_rtp_stamp);
     rtcp->ssrc = htonl(rtcp_ssrc);
@@ -124,11 +125,11 @@ Buffer::Ptr RtcpContextForSend::createRtcpSR(uint32_t rtcp_ssrc) {
         _sender_report_ntp.erase(_sender_report_ntp.begin());
     }
 
-    return RtcpHeader::toBuffer(std::move(rtcp));
+    return _builder.finish();
 }
 
 toolkit::Buffer::Ptr RtcpContextForSend::createRtcpXRDLRR(uint32_t rtcp_ssrc, uint32_t rtp_ssrc) {
-    auto rtcp = RtcpXRDLRR::create(1);
+    auto rtcp = _builder.addXRDLRR(1);
     rtcp->bt = 5;
     rtcp->reserved = 0;
     rtcp->block_length = htons(3);
@@ -153,7 +154,7 @@ toolkit::Buffer::Ptr RtcpContextForSend::createRtcpXRDLRR(uint32_t rtcp_ssrc, ui
         auto dlsr = (uint32_t)(delay / 1000.0f * 65536);
         rtcp->items.dlrr = htonl(dlsr);
     }
-    return RtcpHeader::toBuffer(std::move(rtcp));
+    return _builder.finish();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -210,10 +211,10 @@ void RtcpContextForRecv::onRtp(
     RtcpContext::onRtp(seq, stamp, ntp_stamp_ms, sample_rate, bytes);
 }
 
-void RtcpContextForRecv::onRtcp(RtcpHeader *rtcp) {
-    switch ((RtcpType)rtcp->pt) {
+void RtcpContextForRecv::onRtcp(const RtcpView &rtcp) {
+    switch (rtcp.type()) {
     case RtcpType::RTCP_SR: {
-        auto rtcp_sr = (RtcpSR *)rtcp;
+        RtcpSRView rtcp_sr(rtcp);
         /**
          last SR timestamp (LSR): 32 bits
           The middle 32 bits out of 64 in the NTP timestamp (as explained in
@@ -221,7 +222,7 @@ void RtcpContextForRecv::onRtcp(RtcpHeader *rtcp) {
           (SR) packet from source SSRC_n.  If no SR has been received yet,
           the field is set to zero.
          */
-        _last_sr_lsr = ((rtcp_sr->ntpmsw & 0xFFFF) << 16) | ((rtcp_sr->ntplsw >> 16) & 0xFFFF);
+        _last_sr_lsr = ((rtcp_sr.ntpmsw() & 0xFFFF) << 16) | ((rtcp_sr.ntplsw() >> 16) & 0xFFFF);
         _last_sr_ntp_sys = getCurrentMillisecond();
         break;
     }
@@ -252,8 +253,12 @@ size_t RtcpContextForRecv::getLostInterval() {
     return ret;
 }
 
+double RtcpContextForRecv::getJitter() const {
+    return _jitter;
+}
+
 Buffer::Ptr RtcpContextForRecv::createRtcpRR(uint32_t rtcp_ssrc, uint32_t rtp_ssrc) {
-    auto rtcp = RtcpRR::create(1);
+    auto rtcp = _builder.addRR(1);
     rtcp->ssrc = htonl(rtcp_ssrc);
 
     ReportItem *item = (ReportItem *)&rtcp->items;
@@ -278,7 +283,7 @@ Buffer::Ptr RtcpContextForRecv::createRtcpRR(uint32_t rtcp_ssrc, uint32_t rtp_ss
     // in units of 1/65536 seconds
     auto dlsr = (uint32_t)(delay / 1000.0f * 65536);
     item->delay_since_last_sr = htonl(_last_sr_lsr ? dlsr : 0);
-    return RtcpHeader::toBuffer(rtcp);
+    return _builder.finish();
 }
 
 } // namespace mediakit
\ No newline at end of file
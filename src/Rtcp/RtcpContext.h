@@ -12,6 +12,8 @@
 #define ZLMEDIAKIT_RTCPCONTEXT_H
 
 #include "Rtcp.h"
+#include "RtcpView.h"
+#include "RtcpBuilder.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -48,7 +50,7 @@ public:
      
      * [AUTO-TRANSLATED:46f309ec]
      */
-    virtual void onRtcp(RtcpHeader *rtcp) = 0;
+    virtual void onRtcp(const RtcpView &rtcp) = 0;
 
     /**
      * 计算总丢包数
@@ -131,13 +133,16 @@ protected:
     // Last rtp timestamp, milliseconds
     uint32_t _last_rtp_stamp = 0;
     uint64_t _last_ntp_stamp_ms = 0;
+    // 复用缓存构造sr/rr/xr包
+    // Build sr/rr/xr packets with reused cache
+    RtcpBuilder _builder;
 };
 
 class RtcpContextForSend : public RtcpContext {
 public:
     toolkit::Buffer::Ptr createRtcpSR(uint32_t rtcp_ssrc) override;
 
-    void onRtcp(RtcpHeader *rtcp) override;
+    void onRtcp(const RtcpView &rtcp) override;
 
     toolkit::Buffer::Ptr createRtcpXRDLRR(uint32_t rtcp_ssrc, uint32_t rtp_ssrc) override;
 
@@ -169,7 +174,15 @@ public:
     size_t getExpectedPacketsInterval() override;
     size_t getLost() override;
     size_t getLostInterval() override;
-    void onRtcp(RtcpHeader *rtcp) override;
+    void onRtcp(const RtcpView &rtcp) override;
+
+    /**
+     * 获取rtp到达抖动
+     * @return 抖动值，单位为采样次数
+     * Get the rtp arrival jitter
+     * @return Jitter value, the unit is the number of samples
+     */
+    double getJitter() const;
 
 private:
     // 时间戳抖动值  [AUTO-TRANSLATED:8100680c]
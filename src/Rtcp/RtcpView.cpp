@@ -0,0 +1,142 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "RtcpView.h"
+#include "Util/logger.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+constexpr size_t RtcpReportItemView::kSize;
+constexpr size_t RtcpSRView::kMinSize;
+constexpr size_t RtcpRRView::kMinSize;
+constexpr size_t RtcpFBView::kMinSize;
+constexpr size_t RtcpByeView::kMinSize;
+constexpr size_t RtcpXRView::kMinSize;
+
+size_t RtcpView::getPaddingSize() const {
+    if (!hasPadding()) {
+        return 0;
+    }
+    return _data[_size - 1];
+}
+
+bool RtcpView::valid() const {
+    switch (type()) {
+        case RtcpType::RTCP_SR: return _size >= RtcpSRView::kMinSize;
+        case RtcpType::RTCP_RR: return _size >= RtcpRRView::kMinSize;
+        case RtcpType::RTCP_SDES: return _size >= 4;
+        case RtcpType::RTCP_RTPFB:
+        case RtcpType::RTCP_PSFB: return _size >= RtcpFBView::kMinSize;
+        case RtcpType::RTCP_BYE: return _size >= RtcpByeView::kMinSize;
+        case RtcpType::RTCP_XR: {
+            if (_size < RtcpXRView::kMinSize) {
+                return false;
+            }
+            switch (_data[8]) {
+                case 4: return _size == sizeof(RtcpXRRRTR);
+                case 5:
+                case 42: return true;
+                default: return false;
+            }
+        }
+        default: return false;
+    }
+}
+
+string RtcpView::dumpString() const {
+    // 旧版解析会原地转换字节序，拷贝一份再打印；多预留一个item，防止其越界读取
+    // The legacy parsing converts the byte order in place, copy one and then print; reserve one more item to prevent it from reading out of bounds
+    string copy((const char *)_data, _size);
+    copy.resize(_size + RtcpReportItemView::kSize, '\0');
+    auto rtcps = RtcpHeader::loadFromBytes((char *)copy.data(), _size);
+    if (rtcps.empty()) {
+        return StrPrinter << rtcpTypeToStr(type()) << " size:" << _size << "\r\n" << hexdump(_data, _size);
+    }
+    return rtcps[0]->dumpString();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+uint64_t RtcpSRView::getNtpUnixStampMS() const {
+    auto msw = ntpmsw();
+    if (msw < 0x83AA7E80) {
+        // ntp时间戳不得早于1970年，否则无法转换为utc时间戳
+        // The ntp timestamp must not be earlier than 1970, otherwise it cannot be converted to utc timestamp
+        return 0;
+    }
+    uint64_t sec = msw - 0x83AA7E80;
+    uint64_t usec = (uint64_t)(ntplsw() / ((double)(((uint64_t)1) << 32) * 1.0e-6));
+    return 1000 * sec + usec / 1000;
+}
+
+size_t RtcpSRView::itemCount() const {
+    return MIN((size_t)reportCount(), (_size - kMinSize) / RtcpReportItemView::kSize);
+}
+
+size_t RtcpRRView::itemCount() const {
+    return MIN((size_t)reportCount(), (_size - kMinSize) / RtcpReportItemView::kSize);
+}
+
+size_t RtcpFBView::getFciSize() const {
+    auto padding = getPaddingSize();
+    if (_size < kMinSize + padding) {
+        return 0;
+    }
+    return _size - kMinSize - padding;
+}
+
+size_t RtcpByeView::ssrcCount() const {
+    return MIN((size_t)reportCount(), (_size - kMinSize) / 4);
+}
+
+string RtcpByeView::getReason() const {
+    auto offset = kMinSize + 4 * ssrcCount();
+    if (offset + 1 >= _size) {
+        return "";
+    }
+    return string((const char *)_data + offset + 1, MIN((size_t)_data[offset], _size - offset - 1));
+}
+
+size_t RtcpXRView::dlrrCount() const {
+    return MIN((size_t)blockLength() / 3, (_size - kMinSize) / sizeof(DLRRItem));
+}
+
+RtcpXRView::DLRRItem RtcpXRView::getDlrr(size_t index) const {
+    auto offset = kMinSize + index * sizeof(DLRRItem);
+    return DLRRItem { load32(offset), load32(offset + 4), load32(offset + 8) };
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void RtcpCompoundView::iterator::next() {
+    while (_ptr && _remain > 4) {
+        size_t size = (1 + (((size_t)_ptr[2] << 8) | _ptr[3])) << 2;
+        if (_remain < size) {
+            WarnL << "非法的rtcp包,声明的长度超过实际数据长度";
+            break;
+        }
+        RtcpView view(_ptr, size);
+        _ptr += size;
+        _remain -= size;
+        if (view.valid()) {
+            _view = view;
+            return;
+        }
+        // 不能处理的rtcp包，或者无法解析的rtcp包，忽略掉
+        // Ignore unprocessable rtcp packets or rtcp packets that cannot be parsed
+        WarnL << "忽略rtcp包:" << rtcpTypeToStr(view.type()) << ",长度为:" << size;
+    }
+    _view = RtcpView();
+}
+
+} // namespace mediakit
@@ -0,0 +1,261 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RTCPVIEW_H
+#define ZLMEDIAKIT_RTCPVIEW_H
+
+#include <string>
+#include <string.h>
+#include "Rtcp.h"
+
+namespace mediakit {
+
+/**
+ * rtcp包只读视图，直接在网络字节序的原始数据上按需读取字段，不修改、不拷贝、不分配内存
+ * 视图只引用外部数据，生命周期不能超过原始数据
+ * Read-only view of an rtcp packet, reads fields on demand directly from the raw data in network byte order, without modifying, copying or allocating memory
+ * The view only references external data, its lifetime cannot exceed the raw data
+ */
+class RtcpView {
+public:
+    RtcpView() = default;
+    RtcpView(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+    const uint8_t *data() const { return _data; }
+
+    /**
+     * rtcp包总长度(包含头与padding)
+     * Total length of the rtcp packet (including header and padding)
+     */
+    size_t size() const { return _size; }
+
+    uint8_t version() const { return _data[0] >> 6; }
+    bool hasPadding() const { return (_data[0] >> 5) & 0x01; }
+    RtcpType type() const { return (RtcpType)_data[1]; }
+
+    /**
+     * report count字段，rtpfb/psfb包中为fmt
+     * report count field, it is fmt in rtpfb/psfb packets
+     */
+    uint8_t reportCount() const { return _data[0] & 0x1F; }
+
+    /**
+     * 末尾padding长度，非法时返回0
+     * Length of the trailing padding, returns 0 if illegal
+     */
+    size_t getPaddingSize() const;
+
+    /**
+     * 发送者ssrc，所有支持的rtcp类型都位于第4个字节(sdes为第一个chunk的ssrc)
+     * Sender ssrc, it is at the 4th byte for all supported rtcp types (for sdes it is the ssrc of the first chunk)
+     */
+    uint32_t ssrc() const { return load32(4); }
+
+    /**
+     * 检查是否为可处理的rtcp包，规则与RtcpHeader::loadFromBytes一致，但严格限制不越界读取
+     * Check whether it is a processable rtcp packet, the rules are the same as RtcpHeader::loadFromBytes, but strictly without out-of-bounds reading
+     */
+    bool valid() const;
+
+    /**
+     * 打印字段详情，会拷贝一份数据，仅用于日志
+     * Print field details, a copy of the data will be made, only for logging
+     */
+    std::string dumpString() const;
+
+protected:
+    uint16_t load16(size_t offset) const {
+        uint16_t ret;
+        memcpy(&ret, _data + offset, sizeof(ret));
+        return ntohs(ret);
+    }
+
+    uint32_t load32(size_t offset) const {
+        uint32_t ret;
+        memcpy(&ret, _data + offset, sizeof(ret));
+        return ntohl(ret);
+    }
+
+protected:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+};
+
+/**
+ * sr/rr包中的ReportItem视图
+ * View of ReportItem in sr/rr packets
+ */
+class RtcpReportItemView : private RtcpView {
+public:
+    static constexpr size_t kSize = 24;
+
+    RtcpReportItemView(const uint8_t *data) : RtcpView(data, kSize) {}
+
+    uint32_t ssrc() const { return load32(0); }
+    uint8_t fraction() const { return _data[4]; }
+    uint32_t cumulative() const { return load32(4) & 0xFFFFFF; }
+    uint16_t seqCycles() const { return load16(8); }
+    uint16_t seqMax() const { return load16(10); }
+    uint32_t jitter() const { return load32(12); }
+    uint32_t lastSrStamp() const { return load32(16); }
+    uint32_t delaySinceLastSr() const { return load32(20); }
+};
+
+// sender report
+class RtcpSRView : public RtcpView {
+public:
+    static constexpr size_t kMinSize = 28;
+
+    RtcpSRView(const RtcpView &view) : RtcpView(view) {}
+
+    uint32_t ntpmsw() const { return load32(8); }
+    uint32_t ntplsw() const { return load32(12); }
+    uint32_t rtpts() const { return load32(16); }
+    uint32_t packetCount() const { return load32(20); }
+    uint32_t octetCount() const { return load32(24); }
+    uint64_t getNtpUnixStampMS() const;
+
+    /**
+     * ReportItem个数，已按包长度修正
+     * Number of ReportItem, corrected according to the packet length
+     */
+    size_t itemCount() const;
+    RtcpReportItemView getItem(size_t index) const { return RtcpReportItemView(_data + kMinSize + index * RtcpReportItemView::kSize); }
+};
+
+// receiver report
+class RtcpRRView : public RtcpView {
+public:
+    static constexpr size_t kMinSize = 8;
+
+    RtcpRRView(const RtcpView &view) : RtcpView(view) {}
+
+    /**
+     * ReportItem个数，已按包长度修正
+     * Number of ReportItem, corrected according to the packet length
+     */
+    size_t itemCount() const;
+    RtcpReportItemView getItem(size_t index) const { return RtcpReportItemView(_data + kMinSize + index * RtcpReportItemView::kSize); }
+};
+
+// rtpfb/psfb
+class RtcpFBView : public RtcpView {
+public:
+    static constexpr size_t kMinSize = 12;
+
+    RtcpFBView(const RtcpView &view) : RtcpView(view) {}
+
+    uint32_t ssrcMedia() const { return load32(8); }
+    const void *getFciPtr() const { return _data + kMinSize; }
+
+    /**
+     * fci数据长度，padding非法时返回0
+     * Length of the fci data, returns 0 if the padding is illegal
+     */
+    size_t getFciSize() const;
+
+    /**
+     * fci转换成某对象引用，fci本身即为网络字节序，与RtcpFB::getFci一致
+     * Convert fci to an object reference, fci itself is in network byte order, consistent with RtcpFB::getFci
+     */
+    template <typename Type>
+    const Type &getFci() const {
+        auto fci = (const Type *)getFciPtr();
+        ((Type *)fci)->check(getFciSize());
+        return *fci;
+    }
+};
+
+// bye
+class RtcpByeView : public RtcpView {
+public:
+    static constexpr size_t kMinSize = 4;
+
+    RtcpByeView(const RtcpView &view) : RtcpView(view) {}
+
+    /**
+     * ssrc个数，已按包长度修正
+     * Number of ssrc, corrected according to the packet length
+     */
+    size_t ssrcCount() const;
+    uint32_t getSSRC(size_t index) const { return load32(kMinSize + index * 4); }
+    std::string getReason() const;
+};
+
+// xr，支持rrtr(bt=4)，dlrr(bt=5)与target bitrate(bt=42)
+// xr, supports rrtr(bt=4), dlrr(bt=5) and target bitrate(bt=42)
+class RtcpXRView : public RtcpView {
+public:
+    static constexpr size_t kMinSize = 12;
+
+    struct DLRRItem {
+        uint32_t ssrc;
+        uint32_t lrr;
+        uint32_t dlrr;
+    };
+
+    RtcpXRView(const RtcpView &view) : RtcpView(view) {}
+
+    uint8_t bt() const { return _data[8]; }
+    uint16_t blockLength() const { return load16(10); }
+
+    // rrtr(bt=4)
+    uint32_t ntpmsw() const { return load32(12); }
+    uint32_t ntplsw() const { return load32(16); }
+
+    /**
+     * dlrr(bt=5)子块个数，已按包长度修正
+     * Number of dlrr(bt=5) sub-blocks, corrected according to the packet length
+     */
+    size_t dlrrCount() const;
+    DLRRItem getDlrr(size_t index) const;
+};
+
+/**
+ * rtcp复合包视图，可用range-for遍历其中的rtcp包
+ * 分包规则与RtcpHeader::loadFromBytes一致，无法处理的rtcp包会被跳过
+ * View of an rtcp compound packet, the rtcp packets in it can be traversed with range-for
+ * The splitting rules are the same as RtcpHeader::loadFromBytes, unprocessable rtcp packets will be skipped
+ */
+class RtcpCompoundView {
+public:
+    class iterator {
+    public:
+        iterator(const uint8_t *ptr, size_t remain) : _ptr(ptr), _remain(remain) { next(); }
+
+        const RtcpView &operator*() const { return _view; }
+        const RtcpView *operator->() const { return &_view; }
+        bool operator!=(const iterator &that) const { return _view.data() != that._view.data(); }
+        iterator &operator++() {
+            next();
+            return *this;
+        }
+
+    private:
+        void next();
+
+    private:
+        const uint8_t *_ptr;
+        size_t _remain;
+        RtcpView _view;
+    };
+
+    RtcpCompoundView(const void *data, size_t size) : _data((const uint8_t *)data), _size(size) {}
+
+    iterator begin() const { return iterator(_data, _size); }
+    iterator end() const { return iterator(nullptr, 0); }
+
+private:
+    const uint8_t *_data;
+    size_t _size;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RTCPVIEW_H
@@ -41,6 +41,9 @@ void FlvMuxer::start(const EventPoller::Ptr &poller, const RtmpMediaSource::Ptr
         return;
     }
 
+    // 注册为flv播放器后，后续rtmp包将在源头预先序列化为flv tag
+    // After registering as a flv player, subsequent rtmp packets will be pre-serialized into flv tags at the source
+    _flv_reader = media->addFlvReader();
     onWriteFlvHeader(media);
 
     std::weak_ptr<FlvMuxer> weak_self = getSharedPtr();
@@ -149,10 +152,22 @@ void FlvMuxer::onWriteFlvTag(uint8_t type, const Buffer::Ptr &buffer, uint32_t t
 }
 
 void FlvMuxer::onWriteRtmp(const RtmpPacket::Ptr &pkt, bool flush) {
+    if (pkt->flv_tag_header) {
+        // 源头已经序列化好flv tag头尾，与负载一起引用发送，由socket发送队列合并为一次writev
+        // The flv tag header and tail have been serialized at the source, send them with the payload by reference,
+        // the socket send queue merges them into one writev
+        onWrite(pkt->flv_tag_header, false);
+        onWrite(pkt, false);
+        onWrite(pkt->flv_tag_tail, flush);
+        return;
+    }
+    // gop缓存中注册前的rtmp包，需要自行序列化
+    // Rtmp packets in the gop cache before registration need to be serialized by itself
     onWriteFlvTag(pkt, pkt->time_stamp, flush);
 }
 
 void FlvMuxer::stop() {
+    _flv_reader = nullptr;
     if (_ring_reader) {
         _ring_reader.reset();
         onDetach();
@@ -41,6 +41,7 @@ private:
 
 private:
     toolkit::ResourcePool<toolkit::BufferRaw> _packet_pool;
+    std::shared_ptr<void> _flv_reader;
     RtmpMediaSource::RingType::RingReader::Ptr _ring_reader;
 };
 
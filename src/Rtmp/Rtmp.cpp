@@ -9,6 +9,7 @@
  */
 
 #include "Rtmp.h"
+#include "utils.h"
 #include "Common/config.h"
 #include "Extension/Factory.h"
 
@@ -174,6 +175,27 @@ void RtmpPacket::clear() {
     ts_field = 0;
     body_size = 0;
     buffer.clear();
+    flv_tag_header = nullptr;
+    flv_tag_tail = nullptr;
+    std::atomic_store(&chunk_cache, RtmpChunkCache::Ptr());
+}
+
+void RtmpPacket::makeFlvTag() {
+    RtmpTagHeader header;
+    header.type = type_id;
+    set_be24(header.data_size, (uint32_t)size());
+    header.timestamp_ex = (time_stamp >> 24) & 0xff;
+    set_be24(header.timestamp, time_stamp & 0xFFFFFF);
+    uint32_t previous_tag_size = htonl((uint32_t)(size() + sizeof(header)));
+
+    // 只序列化头尾，负载不拷贝
+    // Only serialize the header and tail, the payload is not copied
+    auto tag_header = toolkit::BufferRaw::create();
+    tag_header->assign((char *)&header, sizeof(header));
+    auto tag_tail = toolkit::BufferRaw::create();
+    tag_tail->assign((char *)&previous_tag_size, 4);
+    flv_tag_header = std::move(tag_header);
+    flv_tag_tail = std::move(tag_tail);
 }
 
 bool RtmpPacket::isVideoKeyFrame() const {
@@ -171,6 +171,27 @@ struct RtmpVideoHeaderClassic {
 
 #pragma pack(pop)
 
+/**
+ * rtmp包按照特定协商参数生成的chunk头，供协商参数相同的多个rtmp播放器共享
+ * 只缓存头部，负载直接引用RtmpPacket::buffer分片发送，不做拷贝
+ * Chunk headers of a rtmp packet generated with specific negotiation parameters, shared by multiple rtmp players with the same negotiation parameters
+ * Only the headers are cached, the payload is sent as slices referencing RtmpPacket::buffer without copying
+ */
+class RtmpChunkCache {
+public:
+    using Ptr = std::shared_ptr<RtmpChunkCache>;
+    size_t chunk_size = 0;
+    uint32_t stream_index = 0;
+    uint32_t stamp = 0;
+    int chunk_id = 0;
+    // 第一个chunk的type 0头(含扩展时间戳)
+    // Type 0 header of the first chunk (including the extended timestamp)
+    toolkit::Buffer::Ptr header;
+    // 后续chunk的type 3头(含扩展时间戳)
+    // Type 3 header of the subsequent chunks (including the extended timestamp)
+    toolkit::Buffer::Ptr separator;
+};
+
 class RtmpPacket : public toolkit::Buffer{
 public:
     friend class RtmpProtocol;
@@ -183,6 +204,13 @@ public:
     uint32_t chunk_id;
     size_t body_size;
     toolkit::BufferLikeString buffer;
+    // 预序列化的flv tag header和PreviousTagSize，负载直接引用本包发送；为空时由各flv播放器自行序列化
+    // Pre-serialized flv tag header and PreviousTagSize, the payload is sent by referencing this packet; each flv player serializes by itself when empty
+    toolkit::Buffer::Ptr flv_tag_header;
+    toolkit::Buffer::Ptr flv_tag_tail;
+    // chunk化缓存，可能被多个poller线程同时访问，必须使用std::atomic_load/std::atomic_store读写
+    // Chunked cache, may be accessed by multiple poller threads at the same time, must be read and written with std::atomic_load/std::atomic_store
+    RtmpChunkCache::Ptr chunk_cache;
 
 public:
     static Ptr create();
@@ -196,6 +224,13 @@ public:
 
     void clear();
 
+    /**
+     * 生成flv tag header和PreviousTagSize并保存至flv_tag_header/flv_tag_tail，所有http-flv/ws-flv播放器共享，避免每个播放器重复序列化
+     * Generate the flv tag header and PreviousTagSize and save them to flv_tag_header/flv_tag_tail,
+     * shared by all http-flv/ws-flv players to avoid repeated serialization per player
+     */
+    void makeFlvTag();
+
     // video config frame和key frame都返回true  [AUTO-TRANSLATED:de025c52]
     // video config frame and key frame both return true
     // 用于gop缓存定位  [AUTO-TRANSLATED:828204e5]
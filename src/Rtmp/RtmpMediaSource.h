@@ -12,6 +12,7 @@
 #define SRC_RTMP_RTMPMEDIASOURCE_H_
 
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <functional>
@@ -97,6 +98,13 @@ public:
         return _ring ? _ring->readerCount() : 0;
     }
 
+    /**
+     * 注册flv播放器，返回对象存在期间，rtmp包在写入环形缓存前会预先生成flv tag头尾供所有flv播放器共享
+     * Register a flv player, while the returned object exists, the flv tag header and tail of rtmp packets will be pre-generated before writing to the ring buffer,
+     * shared by all flv players
+     */
+    std::shared_ptr<void> addFlvReader();
+
     /**
      * 获取metadata
      * Get metadata
@@ -188,6 +196,9 @@ private:
     uint32_t _track_stamps[TrackMax] = {0};
     AMFValue _metadata;
     RingType::Ptr _ring;
+    // flv播放器个数，播放器可能比本对象后销毁，所以使用智能指针
+    // Number of flv players, the player may be destroyed after this object, so use smart pointer
+    std::shared_ptr<std::atomic<int>> _flv_reader_count = std::make_shared<std::atomic<int>>(0);
 
     mutable std::recursive_mutex _mtx;
     std::unordered_map<int, RtmpPacket::Ptr> _config_frame_map;
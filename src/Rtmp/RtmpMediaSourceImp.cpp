@@ -57,6 +57,12 @@ void RtmpMediaSource::onWrite(RtmpPacket::Ptr pkt, bool /*= true*/) {
         default: break;
     }
 
+    if (*_flv_reader_count && !pkt->flv_tag_header) {
+        // 存在flv播放器时，在源头序列化一次flv tag，各播放器只需引用发送
+        // When there are flv players, serialize the flv tag once at the source, each player only needs to send it by reference
+        pkt->makeFlvTag();
+    }
+
     if (pkt->isConfigFrame()) {
         std::lock_guard<std::recursive_mutex> lock(_mtx);
         _config_frame_map[pkt->type_id] = pkt;
@@ -91,6 +97,14 @@ void RtmpMediaSource::onWrite(RtmpPacket::Ptr pkt, bool /*= true*/) {
     PacketCache<RtmpPacket>::inputPacket(stamp, is_video, std::move(pkt), key);
 }
 
+std::shared_ptr<void> RtmpMediaSource::addFlvReader() {
+    auto counter = _flv_reader_count;
+    ++(*counter);
+    // 确保返回的智能指针不为空，0x01无实际意义
+    // Ensure that the returned smart pointer is not empty, 0x01 has no practical meaning
+    return std::shared_ptr<void>((void *)0x01, [counter](void *ptr) { --(*counter); });
+}
+
 RtmpMediaSourceImp::RtmpMediaSourceImp(const MediaTuple &tuple, int ringSize)
     : RtmpMediaSource(tuple, ringSize) {
     _demuxer = std::make_shared<RtmpDemuxer>();
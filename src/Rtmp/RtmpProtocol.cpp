@@ -274,7 +274,89 @@ void RtmpProtocol::sendRtmp(uint8_t type, uint32_t stream_index, const Buffer::P
         totalSize += chunk;
         offset += chunk;
     }
-    _bytes_sent += (uint32_t)totalSize;
+    onBytesSent(totalSize);
+}
+
+void RtmpProtocol::sendRtmp(const RtmpPacket::Ptr &pkt, uint32_t stream_index) {
+    auto cache = std::atomic_load(&pkt->chunk_cache);
+    if (!cache) {
+        // 第一个发送该包的会话负责生成chunk头，后续协商参数相同的会话直接复用
+        // The first session sending this packet is responsible for generating the chunk headers, subsequent sessions with the same negotiation parameters reuse them directly
+        cache = makeChunkHeaders(pkt->type_id, stream_index, pkt->size(), pkt->time_stamp, pkt->chunk_id);
+        std::atomic_store(&pkt->chunk_cache, cache);
+    } else if (cache->chunk_size != _chunk_size_out || cache->stream_index != stream_index || cache->stamp != pkt->time_stamp
+               || cache->chunk_id != pkt->chunk_id) {
+        // chunk size或type 0头不同，回退为本会话单独chunk化
+        // The chunk size or type 0 header is different, fall back to chunking by this session alone
+        sendRtmp(pkt->type_id, stream_index, pkt, pkt->time_stamp, pkt->chunk_id);
+        return;
+    }
+
+    // 共享的chunk头 + 引用包内负载的分片，由socket发送队列合并为一次writev，负载不拷贝
+    // Shared chunk headers + slices referencing the payload in the packet, merged into one writev by the socket send queue, the payload is not copied
+    onSendRawData(cache->header);
+    size_t offset = 0;
+    size_t total_size = cache->header->size();
+    while (offset < pkt->size()) {
+        if (offset) {
+            onSendRawData(cache->separator);
+            total_size += cache->separator->size();
+        }
+        size_t chunk = min(cache->chunk_size, pkt->size() - offset);
+        onSendRawData(std::make_shared<BufferPartial>(pkt, offset, chunk));
+        total_size += chunk;
+        offset += chunk;
+    }
+    onBytesSent(total_size);
+}
+
+RtmpChunkCache::Ptr RtmpProtocol::makeChunkHeaders(uint8_t type, uint32_t stream_index, size_t body_size, uint32_t stamp, int chunk_id) const {
+    if (chunk_id < 2 || chunk_id > 63) {
+        auto strErr = StrPrinter << "不支持发送该类型的块流 ID:" << chunk_id << endl;
+        throw std::runtime_error(strErr);
+    }
+    bool ext_stamp = stamp >= 0xFFFFFF;
+    size_t ext_size = ext_stamp ? 4 : 0;
+
+    auto ret = std::make_shared<RtmpChunkCache>();
+    ret->chunk_size = _chunk_size_out;
+    ret->stream_index = stream_index;
+    ret->stamp = stamp;
+    ret->chunk_id = chunk_id;
+
+    // 这些buffer会跨线程共享，所以不能使用本对象的内存池
+    // These buffers will be shared across threads, so the memory pool of this object cannot be used
+    auto header_buf = BufferRaw::create();
+    header_buf->setCapacity(sizeof(RtmpHeader) + ext_size);
+    header_buf->setSize(sizeof(RtmpHeader) + ext_size);
+    RtmpHeader *header = (RtmpHeader *)header_buf->data();
+    memset(header, 0, sizeof(RtmpHeader));
+    header->fmt = 0;
+    header->chunk_id = chunk_id;
+    header->type_id = type;
+    set_be24(header->time_stamp, ext_stamp ? 0xFFFFFF : stamp);
+    set_be24(header->body_size, (uint32_t)body_size);
+    set_le32(header->stream_index, stream_index);
+    if (ext_stamp) {
+        set_be32(header_buf->data() + sizeof(RtmpHeader), stamp);
+    }
+    ret->header = std::move(header_buf);
+
+    auto separator_buf = BufferRaw::create();
+    separator_buf->setCapacity(1 + ext_size);
+    separator_buf->setSize(1 + ext_size);
+    header = (RtmpHeader *)separator_buf->data();
+    header->fmt = 3;
+    header->chunk_id = chunk_id;
+    if (ext_stamp) {
+        set_be32(separator_buf->data() + 1, stamp);
+    }
+    ret->separator = std::move(separator_buf);
+    return ret;
+}
+
+void RtmpProtocol::onBytesSent(size_t size) {
+    _bytes_sent += (uint32_t)size;
     if (_windows_size > 0 && _bytes_sent - _bytes_sent_last >= _windows_size) {
         _bytes_sent_last = _bytes_sent;
         sendAcknowledgement(_bytes_sent);
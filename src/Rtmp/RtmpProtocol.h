@@ -62,6 +62,12 @@ protected:
     void sendResponse(int type, const std::string &str);
     void sendRtmp(uint8_t type, uint32_t stream_index, const std::string &buffer, uint32_t stamp, int chunk_id);
     void sendRtmp(uint8_t type, uint32_t stream_index, const toolkit::Buffer::Ptr &buffer, uint32_t stamp, int chunk_id);
+    /**
+     * 发送媒体rtmp包，chunk头缓存在包内，协商参数相同的会话共享同一份chunk头，负载按chunk分片引用发送
+     * Send media rtmp packet, the chunk headers are cached in the packet and shared by sessions with the same negotiation parameters,
+     * the payload is sent as referenced chunk slices
+     */
+    void sendRtmp(const RtmpPacket::Ptr &pkt, uint32_t stream_index);
     toolkit::BufferRaw::Ptr obtainBuffer(const void *data = nullptr, size_t len = 0);
 
 private:
@@ -79,6 +85,8 @@ private:
     const char* handle_C2(const char *data, size_t len);
     const char* handle_rtmp(const char *data, size_t len);
     void handle_chunk(RtmpPacket::Ptr chunk_data);
+    RtmpChunkCache::Ptr makeChunkHeaders(uint8_t type, uint32_t stream_index, size_t body_size, uint32_t stamp, int chunk_id) const;
+    void onBytesSent(size_t size);
 
 protected:
     int _send_req_id = 0;
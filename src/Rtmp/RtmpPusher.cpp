@@ -238,7 +238,7 @@ void RtmpPusher::send_metaData(){
                 pkt.append(rtmp->data(), rtmp->size());
                 strong_self->sendRequest(MSG_DATA, pkt);
             } else {
-                strong_self->sendRtmp(rtmp->type_id, strong_self->_stream_index, rtmp, rtmp->time_stamp, rtmp->chunk_id);
+                strong_self->sendRtmp(rtmp, strong_self->_stream_index);
             }
         });
     });
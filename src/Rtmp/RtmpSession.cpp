@@ -587,7 +587,7 @@ void RtmpSession::onCmd_seek(AMFDecoder &dec) {
 }
 
 void RtmpSession::onSendMedia(const RtmpPacket::Ptr &pkt) {
-    sendRtmp(pkt->type_id, pkt->stream_index, pkt, pkt->time_stamp, pkt->chunk_id);
+    sendRtmp(pkt, pkt->stream_index);
 }
 
 bool RtmpSession::close(MediaSource &sender) {
@@ -0,0 +1,207 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_RTPPROXY)
+#include <algorithm>
+#include "FrameJitterBuffer.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 统计窗口时长，传输延时基准与波动峰值取最近两个窗口(10~20秒)内的值
+// Statistical window duration, the transit delay baseline and variation peak take the values within the last two windows (10~20 seconds)
+static constexpr uint64_t kWindowMS = 10 * 1000;
+// 最小缓存时长
+// Minimum buffer duration
+static constexpr uint32_t kMinDelayMS = 20;
+// 目标缓存时长至少为rtcp到达抖动的倍数
+// The target buffer duration is at least a multiple of the rtcp arrival jitter
+static constexpr float kJitterFactor = 4;
+// 缩短缓存时长时每帧最多缩短1毫秒，避免输出突然加速
+// When shortening the buffer duration, shorten at most 1 millisecond per frame to avoid sudden acceleration of the output
+static constexpr uint32_t kShrinkStepMS = 1;
+// 传输延时相对基准突变超过该值(加上最大缓存时长)时，认为时间戳跳变，重新同步
+// When the transit delay changes suddenly relative to the baseline by more than this value (plus the maximum buffer duration), it is considered a timestamp jump, resynchronize
+static constexpr int64_t kResyncMS = 5 * 1000;
+// 最多缓存帧数，防止内存溢出
+// Maximum number of cached frames to prevent memory overflow
+static constexpr size_t kMaxCachedFrames = 1024;
+
+FrameJitterBuffer::FrameJitterBuffer(uint32_t max_delay_ms, EventPoller::Ptr poller, OnFrame cb) {
+    _max_delay_ms = std::max(max_delay_ms, kMinDelayMS);
+    _delay_ms = kMinDelayMS;
+    _poller = std::move(poller);
+    _cb = std::move(cb);
+}
+
+FrameJitterBuffer::~FrameJitterBuffer() {
+    if (_delay_task) {
+        _delay_task->cancel();
+    }
+}
+
+void FrameJitterBuffer::setJitter(float jitter_ms) {
+    _jitter_ms = jitter_ms;
+}
+
+bool FrameJitterBuffer::inputFrame(const Frame::Ptr &frame) {
+    auto now = getCurrentMillisecond();
+    auto dts = frame->dts();
+    // 传输延时，包含发送端与本机的时钟差
+    // Transit delay, including the clock difference between the sender and the local machine
+    int64_t transit = (int64_t)now - (int64_t)dts;
+    auto &last_dts = _last_dts[frame->getTrackType() == TrackAudio ? 1 : 0];
+    if (!_started || last_dts > dts || std::abs(transit - _base_transit) > kResyncMS + _max_delay_ms) {
+        resync(now, transit);
+    }
+    last_dts = dts;
+    updateDelay(now, transit);
+
+    _cache.emplace(dts, Frame::getCacheAbleFrame(frame));
+    if (_cache.size() > kMaxCachedFrames) {
+        WarnL << "Flush frame jitter buffer cache: " << _cache.size();
+        flush();
+    }
+    release(now);
+    schedule(now);
+    return true;
+}
+
+void FrameJitterBuffer::resync(uint64_t now, int64_t transit) {
+    if (_started) {
+        ++_resync_count;
+        WarnL << "Stamp jumped, resync frame jitter buffer, transit: " << _base_transit << " -> " << transit << ", cached frames: " << _cache.size();
+    }
+    flush();
+    _started = true;
+    _base_transit = transit;
+    _window_min[0] = _window_min[1] = transit;
+    _window_peak[0] = _window_peak[1] = 0;
+    _window_start = now;
+    _last_dts[0] = _last_dts[1] = 0;
+}
+
+void FrameJitterBuffer::updateDelay(uint64_t now, int64_t transit) {
+    if (now - _window_start >= kWindowMS) {
+        // 切换统计窗口，使基准能跟上收发两端的时钟漂移，峰值能随网络好转而回落
+        // Switch the statistical window so that the baseline can keep up with the clock drift of the sender and receiver, and the peak can fall back as the network improves
+        _window_min[0] = _window_min[1];
+        _window_peak[0] = _window_peak[1];
+        _window_min[1] = transit;
+        _window_peak[1] = 0;
+        _window_start = now;
+    }
+    _window_min[1] = std::min(_window_min[1], transit);
+    _base_transit = std::min(_window_min[0], _window_min[1]);
+
+    // 本帧相对最早到达帧的延后时长
+    // The delay of this frame relative to the earliest arriving frame
+    auto spread = transit - _base_transit;
+    _window_peak[1] = std::max(_window_peak[1], spread);
+    if (spread > _delay_ms) {
+        // 晚于计划输出时间到达
+        // Arrived later than the scheduled output time
+        ++_late_frames;
+    }
+
+    auto target = getTargetDelay();
+    if (target >= _delay_ms) {
+        // 抖动变大时立即增加缓存
+        // Increase the buffer immediately when the jitter increases
+        _delay_ms = target;
+    } else {
+        // 抖动变小时逐步减少缓存
+        // Gradually reduce the buffer when the jitter decreases
+        _delay_ms -= std::min(_delay_ms - target, kShrinkStepMS);
+    }
+}
+
+uint32_t FrameJitterBuffer::getTargetDelay() const {
+    int64_t target = std::max((int64_t)(_jitter_ms * kJitterFactor), std::max(_window_peak[0], _window_peak[1]));
+    target = std::max(target, (int64_t)kMinDelayMS);
+    return (uint32_t)std::min(target, (int64_t)_max_delay_ms);
+}
+
+void FrameJitterBuffer::release(uint64_t now) {
+    while (!_cache.empty()) {
+        auto it = _cache.begin();
+        if ((int64_t)it->first + _base_transit + _delay_ms > (int64_t)now) {
+            // 还没到输出时间
+            // Not yet time to output
+            break;
+        }
+        auto frame = std::move(it->second);
+        _cache.erase(it);
+        ++_output_frames;
+        _cb(frame);
+    }
+}
+
+void FrameJitterBuffer::schedule(uint64_t now) {
+    if (_cache.empty()) {
+        return;
+    }
+    auto release_ms = (uint64_t)std::max((int64_t)_cache.begin()->first + _base_transit + _delay_ms, (int64_t)now + 1);
+    if (_delay_task && _wake_ms <= release_ms) {
+        // 已经会在此之前唤醒
+        // Will wake up before this
+        return;
+    }
+    if (_delay_task) {
+        _delay_task->cancel();
+    }
+    _wake_ms = release_ms;
+    weak_ptr<FrameJitterBuffer> weak_self = shared_from_this();
+    _delay_task = _poller->doDelayTask(release_ms - now, [weak_self]() -> uint64_t {
+        auto strong_self = weak_self.lock();
+        return strong_self ? strong_self->onWake() : 0;
+    });
+}
+
+uint64_t FrameJitterBuffer::onWake() {
+    auto now = getCurrentMillisecond();
+    release(now);
+    if (_cache.empty()) {
+        _delay_task = nullptr;
+        return 0;
+    }
+    _wake_ms = (uint64_t)std::max((int64_t)_cache.begin()->first + _base_transit + _delay_ms, (int64_t)now + 1);
+    return _wake_ms - now;
+}
+
+void FrameJitterBuffer::flush() {
+    while (!_cache.empty()) {
+        auto it = _cache.begin();
+        auto frame = std::move(it->second);
+        _cache.erase(it);
+        ++_output_frames;
+        _cb(frame);
+    }
+}
+
+FrameJitterBuffer::Statistic FrameJitterBuffer::getStatistic() const {
+    Statistic ret;
+    ret.jitter_ms = (uint32_t)_jitter_ms;
+    ret.delay_ms = _delay_ms;
+    ret.target_ms = getTargetDelay();
+    ret.max_delay_ms = _max_delay_ms;
+    ret.cached_frames = _cache.size();
+    ret.output_frames = _output_frames;
+    ret.late_frames = _late_frames;
+    ret.resync_count = _resync_count;
+    return ret;
+}
+
+} // namespace mediakit
+#endif // defined(ENABLE_RTPPROXY)
@@ -0,0 +1,128 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_FRAMEJITTERBUFFER_H
+#define ZLMEDIAKIT_FRAMEJITTERBUFFER_H
+
+#if defined(ENABLE_RTPPROXY)
+#include <map>
+#include <memory>
+#include <functional>
+#include "Extension/Frame.h"
+#include "Poller/EventPoller.h"
+
+namespace mediakit {
+
+/**
+ * 自适应去抖动缓存
+ * 以最早到达的帧为基准估算每帧的传输延时波动，结合rtcp统计的到达抖动动态调整缓存时长，
+ * 帧按照dts加上缓存时长的时间点匀速输出，用于消除4G等网络下推流突发到达导致的转协议卡顿
+ * 所有接口请在同一个poller线程调用
+ * Adaptive de-jitter buffer
+ * Estimate the transit delay variation of each frame based on the earliest arriving frame, dynamically adjust the buffer duration with the arrival jitter counted by rtcp,
+ * frames are output evenly at the time of dts plus the buffer duration, used to eliminate the stutter of protocol conversion caused by bursty arrival of push streams under 4G networks
+ * Please call all interfaces in the same poller thread
+ */
+class FrameJitterBuffer : public FrameWriterInterface, public std::enable_shared_from_this<FrameJitterBuffer> {
+public:
+    using Ptr = std::shared_ptr<FrameJitterBuffer>;
+    using OnFrame = std::function<void(const Frame::Ptr &frame)>;
+
+    struct Statistic {
+        // rtcp统计的到达抖动，单位毫秒
+        // Arrival jitter counted by rtcp, in milliseconds
+        uint32_t jitter_ms = 0;
+        // 当前缓存时长，单位毫秒
+        // Current buffer duration, in milliseconds
+        uint32_t delay_ms = 0;
+        // 根据抖动估算的目标缓存时长，单位毫秒
+        // Target buffer duration estimated from jitter, in milliseconds
+        uint32_t target_ms = 0;
+        // 最大缓存时长，单位毫秒
+        // Maximum buffer duration, in milliseconds
+        uint32_t max_delay_ms = 0;
+        // 当前缓存的帧数
+        // Number of frames currently cached
+        size_t cached_frames = 0;
+        // 输出的帧数
+        // Number of frames output
+        uint64_t output_frames = 0;
+        // 晚于计划输出时间到达的帧数
+        // Number of frames that arrived later than the scheduled output time
+        uint64_t late_frames = 0;
+        // 时间戳跳变或回退导致的重新同步次数
+        // Number of resynchronizations caused by timestamp jumps or rollbacks
+        uint64_t resync_count = 0;
+    };
+
+    /**
+     * @param max_delay_ms 最大缓存时长，单位毫秒
+     * @param poller 输出定时器所在线程
+     * @param cb 帧输出回调
+     * @param max_delay_ms Maximum buffer duration, in milliseconds
+     * @param poller Thread of the output timer
+     * @param cb Frame output callback
+     */
+    FrameJitterBuffer(uint32_t max_delay_ms, toolkit::EventPoller::Ptr poller, OnFrame cb);
+    ~FrameJitterBuffer() override;
+
+    /**
+     * 更新rtcp统计的到达抖动
+     * @param jitter_ms 到达抖动，单位毫秒
+     * Update the arrival jitter counted by rtcp
+     * @param jitter_ms Arrival jitter, in milliseconds
+     */
+    void setJitter(float jitter_ms);
+
+    bool inputFrame(const Frame::Ptr &frame) override;
+
+    /**
+     * 立即输出所有缓存的帧
+     * Output all cached frames immediately
+     */
+    void flush() override;
+
+    Statistic getStatistic() const;
+
+private:
+    void updateDelay(uint64_t now, int64_t transit);
+    void resync(uint64_t now, int64_t transit);
+    void release(uint64_t now);
+    void schedule(uint64_t now);
+    uint64_t onWake();
+    uint32_t getTargetDelay() const;
+
+private:
+    uint32_t _max_delay_ms;
+    uint32_t _delay_ms = 0;
+    float _jitter_ms = 0;
+    bool _started = false;
+    // 传输延时(到达时间-dts)的基准，取最近两个统计窗口的最小值
+    // The baseline of transit delay (arrival time - dts), take the minimum of the last two statistical windows
+    int64_t _base_transit = 0;
+    int64_t _window_min[2] = { 0, 0 };
+    // 相对基准的传输延时波动峰值，取最近两个统计窗口的最大值
+    // Peak of transit delay variation relative to the baseline, take the maximum of the last two statistical windows
+    int64_t _window_peak[2] = { 0, 0 };
+    uint64_t _window_start = 0;
+    uint64_t _last_dts[2] = { 0, 0 };
+    uint64_t _wake_ms = 0;
+    uint64_t _output_frames = 0;
+    uint64_t _late_frames = 0;
+    uint64_t _resync_count = 0;
+    OnFrame _cb;
+    toolkit::EventPoller::Ptr _poller;
+    toolkit::EventPoller::DelayTask::Ptr _delay_task;
+    std::multimap<uint64_t /*dts*/, Frame::Ptr> _cache;
+};
+
+} // namespace mediakit
+#endif // defined(ENABLE_RTPPROXY)
+#endif // ZLMEDIAKIT_FRAMEJITTERBUFFER_H
@@ -10,6 +10,7 @@
 
 #if defined(ENABLE_RTPPROXY)
 #include "GB28181Process.h"
+#include "PSDemuxer.h"
 #include "Extension/CommonRtp.h"
 #include "Extension/Factory.h"
 #include "Http/HttpTSPlayer.h"
@@ -50,6 +51,93 @@ private:
     int _sample_rate;
 };
 
+// 把PSDemuxer解析出的流与帧转换为track与frame
+// Convert the streams and frames parsed by PSDemuxer into tracks and frames
+class PSDemuxerImp : public PSDemuxer {
+public:
+    PSDemuxerImp(MediaSinkInterface *sink) {
+        GET_CONFIG(bool, merge_frame, RtpProxy::kMergeFrame);
+        _sink = sink;
+        setMergeFrame(merge_frame);
+        setOnStream([this](int stream, int codecid, bool finish) { onStream(stream, codecid, finish); });
+        setOnFrame([this](int stream, int codecid, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) { onFrame(stream, codecid, pts, dts, buffer); });
+    }
+
+    void inputRtp(const RtpPacket::Ptr &rtp) {
+        auto seq = rtp->getSeq();
+        if (_have_seq && seq != (uint16_t)(_last_seq + 1)) {
+            // rtp丢包，丢弃未解析完的数据，从下一个起始码开始解析
+            // Rtp packet loss, discard the unparsed data, start parsing from the next start code
+            resync();
+        }
+        _have_seq = true;
+        _last_seq = seq;
+        auto payload = rtp->getPayload();
+        input(rtp, payload - (uint8_t *)rtp->data(), rtp->getPayloadSize());
+    }
+
+private:
+    void onStream(int stream, int codecid, bool finish) {
+        if (_finished) {
+            return;
+        }
+        addTrack(stream, codecid);
+        // 防止未获取视频track提前complete导致忽略后续视频的问题
+        // Prevent the problem of ignoring subsequent video due to premature completion of the video track before it is obtained
+        if (finish && _have_video) {
+            _finished = true;
+            _sink->addTrackCompleted();
+            InfoL << "Add track finished";
+        }
+    }
+
+    void onFrame(int stream, int codecid, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        auto it = _tracks.find(stream);
+        if (it == _tracks.end()) {
+            it = addTrack(stream, codecid);
+        }
+        if (!it->second) {
+            return;
+        }
+        auto frame = Factory::getFrameFromBuffer(it->second->getCodecId(), buffer, dts / 90, pts / 90);
+        if (frame) {
+            frame->setIndex(stream);
+            _sink->inputFrame(frame);
+        }
+    }
+
+    std::unordered_map<int, Track::Ptr>::iterator addTrack(int stream, int codecid) {
+        auto it = _tracks.find(stream);
+        if (it != _tracks.end()) {
+            return it;
+        }
+        // 不支持的编码格式也记录下来，避免重复创建
+        // Unsupported codecs are also recorded to avoid repeated creation
+        Track::Ptr track;
+        auto codec = getCodecByMpegId(codecid);
+        if (codec != CodecInvalid) {
+            track = Factory::getTrackByCodecId(codec);
+        }
+        if (track) {
+            track->setIndex(stream);
+            _sink->addTrack(track);
+            InfoL << "Got track: " << track->getCodecName();
+            _have_video = track->getTrackType() == TrackVideo ? true : _have_video;
+        } else {
+            WarnL << "Unsupported ps stream: " << stream << ", codec id: " << codecid;
+        }
+        return _tracks.emplace(stream, std::move(track)).first;
+    }
+
+private:
+    bool _finished = false;
+    bool _have_video = false;
+    bool _have_seq = false;
+    uint16_t _last_seq = 0;
+    MediaSinkInterface *_sink;
+    std::unordered_map<int, Track::Ptr> _tracks;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 GB28181Process::GB28181Process(const MediaInfo &media_info, MediaSinkInterface *sink) {
@@ -59,13 +147,46 @@ GB28181Process::GB28181Process(const MediaInfo &media_info, MediaSinkInterface *
 }
 
 void GB28181Process::onRtpSorted(RtpPacket::Ptr rtp) {
+    if (rtp->getHeader()->pt == _mpeg_pt && inputPS(rtp)) {
+        return;
+    }
     _rtp_decoder[rtp->getHeader()->pt]->inputRtp(rtp, false);
 }
 
+bool GB28181Process::inputPS(const RtpPacket::Ptr &rtp) {
+    if (!_ps_demuxer) {
+        GET_CONFIG(bool, native_ps_demuxer, RtpProxy::kNativePSDemuxer);
+        if (_decoder || !native_ps_demuxer || checkTS(rtp->getPayload(), rtp->getPayloadSize())) {
+            // ts负载或者已经在使用libmpeg解复用
+            // Ts payload or libmpeg demuxing is already in use
+            return false;
+        }
+        InfoL << _media_info.stream << " judged to be PS";
+        _ps_demuxer = std::make_shared<PSDemuxerImp>(_interface);
+    }
+    if (_save_file_ps) {
+        fwrite(rtp->getPayload(), rtp->getPayloadSize(), 1, _save_file_ps.get());
+    }
+    if (_on_ps_rtp) {
+        _on_ps_rtp(rtp, PSDemuxer::isKeyPacket(rtp->getPayload(), rtp->getPayloadSize()));
+    }
+    // 直接解析rtp负载，不再合并为帧后再交给libmpeg解复用
+    // Parse the rtp payload directly, no longer merge into frames and then hand over to libmpeg for demuxing
+    _ps_demuxer->inputRtp(rtp);
+    return true;
+}
+
+void GB28181Process::setOnPSRtp(onPSRtp cb) {
+    _on_ps_rtp = std::move(cb);
+}
+
 void GB28181Process::flush() {
     if (_decoder) {
         _decoder->flush();
     }
+    if (_ps_demuxer) {
+        _ps_demuxer->flush();
+    }
 }
 
 bool GB28181Process::inputRtp(bool, const char *data, size_t data_len) {
@@ -140,6 +261,7 @@ bool GB28181Process::inputRtp(bool, const char *data, size_t data_len) {
             // ts或ps负载  [AUTO-TRANSLATED:3ca31480]
             // ts or ps payload
             _rtp_decoder[pt] = std::make_shared<CommonRtpDecoder>(CodecInvalid, 32 * 1024);
+            _mpeg_pt = pt;
             // 设置dump目录  [AUTO-TRANSLATED:23c88ace]
             // Set dump directory
             GET_CONFIG(string, dump_dir, RtpProxy::kDumpDir);
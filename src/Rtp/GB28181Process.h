@@ -22,9 +22,19 @@
 namespace mediakit{
 
 class RtpReceiverImp;
+class PSDemuxerImp;
 class GB28181Process : public ProcessInterface {
 public:
     using Ptr = std::shared_ptr<GB28181Process>;
+    /**
+     * 收到排序后的ps负载rtp包(ts负载不会触发)
+     * @param rtp 原始rtp包，不可修改
+     * @param key_pos 是否为关键帧的开始
+     * Received a sorted rtp packet with ps payload (not triggered by ts payload)
+     * @param rtp Original rtp packet, must not be modified
+     * @param key_pos Whether it is the start of a key frame
+     */
+    using onPSRtp = std::function<void(const RtpPacket::Ptr &rtp, bool key_pos)>;
 
     GB28181Process(const MediaInfo &media_info, MediaSinkInterface *sink);
 
@@ -51,15 +61,27 @@ public:
      */
     void flush() override;
 
+    /**
+     * 设置ps rtp包回调，用于ps透传转发；未设置时不判断关键帧
+     * Set the ps rtp packet callback, used for ps passthrough forwarding; key frames are not judged when it is not set
+     */
+    void setOnPSRtp(onPSRtp cb);
+
 protected:
     void onRtpSorted(RtpPacket::Ptr rtp);
 
 private:
     void onRtpDecode(const Frame::Ptr &frame);
+    bool inputPS(const RtpPacket::Ptr &rtp);
 
 private:
+    // ts或ps负载的pt
+    // Pt of ts or ps payload
+    int _mpeg_pt = -1;
     MediaInfo _media_info;
     DecoderImp::Ptr _decoder;
+    std::shared_ptr<PSDemuxerImp> _ps_demuxer;
+    onPSRtp _on_ps_rtp;
     MediaSinkInterface *_interface;
     std::shared_ptr<FILE> _save_file_ps;
     std::unordered_map<uint8_t, RtpCodec::Ptr> _rtp_decoder;
@@ -0,0 +1,489 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_RTPPROXY)
+
+#include <cstring>
+#include <algorithm>
+#include "PSDemuxer.h"
+#include "Util/logger.h"
+#include "mpeg-proto.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// pes头最大长度: 9字节固定头 + 255字节可选头
+// Maximum length of pes header: 9 bytes fixed header + 255 bytes optional header
+static constexpr size_t kMaxPESHeaderSize = 9 + 255;
+// psm最大长度，超过时忽略
+// Maximum length of psm, ignore when exceeded
+static constexpr size_t kMaxPSMSize = 1024;
+
+static inline int64_t readStamp(const uint8_t *ptr) {
+    return ((int64_t)(ptr[0] & 0x0E) << 29) | (ptr[1] << 22) | ((ptr[2] & 0xFE) << 14) | (ptr[3] << 7) | (ptr[4] >> 1);
+}
+
+static inline bool isVideoStream(int stream_id) {
+    return stream_id >= 0xE0 && stream_id <= 0xEF;
+}
+
+static inline bool isAudioStream(int stream_id) {
+    return stream_id >= 0xC0 && stream_id <= 0xDF;
+}
+
+// 从第index个片段开始拷贝最多size字节
+// Copy up to size bytes starting from the index-th slice
+template <typename Slices>
+static size_t copySlices(const Slices &slices, size_t index, uint8_t *out, size_t size) {
+    size_t copied = 0;
+    for (; index < slices.size() && copied < size; ++index) {
+        auto &slice = slices[index];
+        auto n = std::min(slice.size, size - copied);
+        memcpy(out + copied, slice.buffer->data() + slice.offset, n);
+        copied += n;
+    }
+    return copied;
+}
+
+static inline size_t startCodeSize(const uint8_t *ptr, size_t size) {
+    if (size >= 4 && !ptr[0] && !ptr[1] && !ptr[2] && ptr[3] == 1) {
+        return 4;
+    }
+    return size >= 3 && !ptr[0] && !ptr[1] && ptr[2] == 1 ? 3 : 0;
+}
+
+bool PSDemuxer::isKeyPacket(const uint8_t *data, size_t size) {
+    // 关键帧前的pack header、system header、psm一般都在第一个rtp包内
+    // The pack header, system header and psm before the key frame are generally in the first rtp packet
+    for (size_t pos = 0; pos + 9 <= size; ++pos) {
+        if (data[pos] || data[pos + 1] || data[pos + 2] != 1 || !isVideoStream(data[pos + 3])) {
+            continue;
+        }
+        // 只检查pes头后的开头部分，略过aud、sei等
+        // Only check the beginning after the pes header, skipping aud, sei, etc.
+        auto es = pos + 9 + data[pos + 8];
+        auto end = std::min(size, es + 256);
+        for (auto i = es; i + 3 < end; ++i) {
+            if (data[i] || data[i + 1] || data[i + 2] != 1) {
+                continue;
+            }
+            auto nal = data[i + 3];
+            auto h264_type = nal & 0x1F;
+            auto h265_type = (nal >> 1) & 0x3F;
+            if (h264_type == 5 || h264_type == 7 || (!(nal & 0x81) && (h265_type == 19 || h265_type == 20 || h265_type == 32))) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+void PSDemuxer::setOnStream(onStream cb) {
+    _on_stream = std::move(cb);
+}
+
+void PSDemuxer::setOnFrame(onFrame cb) {
+    _on_frame = std::move(cb);
+}
+
+void PSDemuxer::setMergeFrame(bool merge) {
+    _merge_frame = merge;
+}
+
+void PSDemuxer::input(const Buffer::Ptr &buffer, size_t offset, size_t size) {
+    if (!size) {
+        return;
+    }
+    _input.emplace_back(Slice { buffer, offset, size });
+    _input_size += size;
+    parse();
+}
+
+void PSDemuxer::resync() {
+    _input.clear();
+    _input_size = 0;
+    _skip = 0;
+    _last_is_key = false;
+    for (auto &pr : _streams) {
+        // 缓存的帧可能缺少丢失的pes，不再输出
+        // The cached frame may lack the lost pes, no longer output it
+        auto &stream = pr.second;
+        stream.slices.clear();
+        stream.bytes = 0;
+        stream.drop = isVideoStream(pr.first);
+    }
+}
+
+void PSDemuxer::flush() {
+    for (auto &pr : _streams) {
+        flushStream(pr.first, pr.second);
+    }
+}
+
+size_t PSDemuxer::peek(size_t offset, uint8_t *out, size_t size) const {
+    size_t copied = 0;
+    for (auto &slice : _input) {
+        if (copied == size) {
+            break;
+        }
+        if (offset >= slice.size) {
+            offset -= slice.size;
+            continue;
+        }
+        auto n = std::min(slice.size - offset, size - copied);
+        memcpy(out + copied, slice.buffer->data() + slice.offset + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+void PSDemuxer::consume(size_t size) {
+    _input_size -= size;
+    while (size) {
+        auto &front = _input.front();
+        if (front.size > size) {
+            front.offset += size;
+            front.size -= size;
+            return;
+        }
+        size -= front.size;
+        _input.pop_front();
+    }
+}
+
+void PSDemuxer::take(size_t size, std::vector<Slice> &out) {
+    _input_size -= size;
+    while (size) {
+        auto &front = _input.front();
+        if (front.size > size) {
+            out.emplace_back(Slice { front.buffer, front.offset, size });
+            front.offset += size;
+            front.size -= size;
+            return;
+        }
+        size -= front.size;
+        out.emplace_back(std::move(front));
+        _input.pop_front();
+    }
+}
+
+bool PSDemuxer::findStartCode() {
+    while (_input_size >= 4) {
+        uint8_t code[3];
+        peek(0, code, 3);
+        if (code[0] == 0 && code[1] == 0 && code[2] == 1) {
+            return true;
+        }
+        // 在第一个片段内查找起始码，末尾不足3字节的部分与下一个片段拼接后再判断
+        // Search for the start code in the first slice, the part less than 3 bytes at the end is judged after splicing with the next slice
+        auto &front = _input.front();
+        auto ptr = (const uint8_t *)front.buffer->data() + front.offset;
+        size_t pos = 1;
+        while (pos + 2 < front.size && !(ptr[pos] == 0 && ptr[pos + 1] == 0 && ptr[pos + 2] == 1)) {
+            ++pos;
+        }
+        consume(pos);
+    }
+    return false;
+}
+
+void PSDemuxer::parse() {
+    uint8_t header[kMaxPESHeaderSize];
+    for (;;) {
+        if (_skip) {
+            auto size = std::min(_skip, _input_size);
+            consume(size);
+            _skip -= size;
+            if (_skip) {
+                return;
+            }
+        }
+        if (!findStartCode()) {
+            return;
+        }
+        if (peek(0, header, 6) < 6) {
+            return;
+        }
+        auto stream_id = header[3];
+        if (stream_id == 0xBA) {
+            // pack header, mpeg2为14字节+填充，mpeg1为12字节
+            // Pack header, 14 bytes + stuffing for mpeg2, 12 bytes for mpeg1
+            if (peek(0, header, 14) < 14) {
+                return;
+            }
+            size_t size = (header[4] & 0xC0) == 0x40 ? 14 + (header[13] & 0x07) : 12;
+            if (_input_size < size) {
+                return;
+            }
+            consume(size);
+            continue;
+        }
+        if (stream_id == 0xB9) {
+            // program end code
+            consume(4);
+            continue;
+        }
+        if (stream_id < 0xBB) {
+            // 不是ps的起始码(例如ps头之外的es起始码)，继续查找
+            // Not a ps start code (such as an es start code outside the ps header), continue searching
+            consume(3);
+            continue;
+        }
+
+        size_t total = 6 + ((header[4] << 8) | header[5]);
+        if (stream_id == 0xBC) {
+            // program stream map
+            if (_input_size < total) {
+                return;
+            }
+            if (total <= kMaxPSMSize) {
+                uint8_t psm[kMaxPSMSize];
+                peek(0, psm, total);
+                parsePSM(psm, total);
+            }
+            consume(total);
+            continue;
+        }
+        if (!isVideoStream(stream_id) && !isAudioStream(stream_id)) {
+            // system header、padding、私有流(例如海康的0xBD)等直接丢弃
+            // System header, padding, private stream (such as Hikvision's 0xBD), etc. are discarded directly
+            _skip = total;
+            continue;
+        }
+        if (peek(0, header, 9) < 9) {
+            return;
+        }
+        size_t header_size = 9 + header[8];
+        if ((header[6] & 0xC0) != 0x80 || header_size > total) {
+            // 不支持mpeg1 pes或者pes头损坏
+            // Mpeg1 pes is not supported or the pes header is damaged
+            WarnL << "Invalid pes header, stream id: " << (int)stream_id << ", pes size: " << total;
+            _skip = total;
+            continue;
+        }
+        // pes最大64KB，等待完整后再解析，等待期间只引用输入数据
+        // Pes is up to 64KB, wait until complete before parsing, only reference the input data while waiting
+        if (_input_size < total) {
+            return;
+        }
+        peek(0, header, header_size);
+        consume(header_size);
+        onPES(stream_id, header, header_size, total - header_size);
+    }
+}
+
+void PSDemuxer::parsePSM(const uint8_t *data, size_t size) {
+    if (size < 16) {
+        return;
+    }
+    size_t pos = 10 + ((data[8] << 8) | data[9]);
+    if (pos + 2 > size) {
+        return;
+    }
+    size_t end = std::min<size_t>(pos + 2 + ((data[pos] << 8) | data[pos + 1]), size - 4);
+    pos += 2;
+
+    // <stream id, stream type>
+    std::vector<std::pair<int, int> > entries;
+    while (pos + 4 <= end) {
+        if (isVideoStream(data[pos + 1]) || isAudioStream(data[pos + 1])) {
+            entries.emplace_back(data[pos + 1], data[pos]);
+        }
+        pos += 4 + ((data[pos + 2] << 8) | data[pos + 3]);
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto stream_id = entries[i].first;
+        auto codecid = entries[i].second;
+        auto &stream = _streams[stream_id];
+        bool finish = !_psm_done && i + 1 == entries.size();
+        if (stream.codecid == codecid && !finish) {
+            continue;
+        }
+        if (stream.codecid != codecid) {
+            // 编码格式变了，先输出之前的数据
+            // The codec has changed, output the previous data first
+            flushStream(stream_id, stream);
+            stream.codecid = codecid;
+        }
+        if (_on_stream) {
+            _on_stream(stream_id, codecid, finish);
+        }
+    }
+    if (!entries.empty()) {
+        _psm_done = true;
+    }
+}
+
+int PSDemuxer::guessCodec(int stream_id, const Slice &slice) const {
+    auto ptr = (const uint8_t *)slice.buffer->data() + slice.offset;
+    auto size = slice.size;
+    if (isAudioStream(stream_id)) {
+        // 只能识别adts格式的aac，其他音频必须依赖psm
+        // Only aac in adts format can be recognized, other audio must rely on psm
+        return size >= 2 && ptr[0] == 0xFF && (ptr[1] & 0xF6) == 0xF0 ? PSI_STREAM_AAC : 0;
+    }
+    auto prefix = startCodeSize(ptr, size);
+    if (!prefix || prefix >= size) {
+        return 0;
+    }
+    auto nal = ptr[prefix];
+    auto h265_type = (nal >> 1) & 0x3F;
+    if (!(nal & 0x81) && (h265_type == 32 || h265_type == 33 || h265_type == 34 || h265_type == 19 || h265_type == 20 || h265_type == 1)) {
+        return PSI_STREAM_H265;
+    }
+    switch (nal & 0x1F) {
+        case 1:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+        case 9: return PSI_STREAM_H264;
+        default: return 0;
+    }
+}
+
+void PSDemuxer::onPES(int stream_id, const uint8_t *header, size_t header_size, size_t payload_size) {
+    auto &stream = _streams[stream_id];
+    bool have_pts = false;
+    int64_t pts = 0, dts = 0;
+    auto flags = header[7] >> 6;
+    if ((flags & 0x02) && header_size >= 14) {
+        have_pts = true;
+        pts = dts = readStamp(header + 9);
+        if (flags == 0x03 && header_size >= 19) {
+            dts = readStamp(header + 14);
+        }
+    }
+
+    if (!payload_size) {
+        return;
+    }
+
+    bool video = isVideoStream(stream_id);
+    if (stream.drop) {
+        // 丢包后只从以起始码开头且pts变化的pes(新的一帧)恢复输出
+        // After packet loss, only resume output from the pes that starts with a start code and whose pts changes (a new frame)
+        uint8_t head[4];
+        auto size = peek(0, head, std::min<size_t>(payload_size, sizeof(head)));
+        auto new_frame = have_pts ? !stream.have_pts || pts != stream.pts : !stream.have_pts;
+        if (!new_frame || !startCodeSize(head, size)) {
+            consume(payload_size);
+            if (have_pts) {
+                stream.have_pts = true;
+                stream.pts = pts;
+                stream.dts = dts;
+            }
+            return;
+        }
+        stream.drop = false;
+    }
+    if (video && have_pts && stream.have_pts && pts != stream.pts) {
+        // 新的一帧开始了，输出上一帧
+        // A new frame starts, output the previous frame
+        flushStream(stream_id, stream);
+    }
+    auto slices = stream.slices.size();
+    take(payload_size, stream.slices);
+    stream.bytes += payload_size;
+    if (have_pts) {
+        stream.have_pts = true;
+        stream.pts = pts;
+        stream.dts = dts;
+    }
+
+    if (!stream.codecid) {
+        // 没有psm时根据负载猜测编码格式
+        // Guess the codec based on the payload when there is no psm
+        stream.codecid = guessCodec(stream_id, stream.slices[slices]);
+        if (!stream.codecid) {
+            stream.slices.clear();
+            stream.bytes = 0;
+            return;
+        }
+        if (_on_stream) {
+            _on_stream(stream_id, stream.codecid, false);
+        }
+    }
+
+    if (!video || !_merge_frame) {
+        flushStream(stream_id, stream);
+    }
+    if (video) {
+        _last_is_key = isKeyPES(stream, slices);
+    } else if (_last_is_key && _merge_frame) {
+        // 上次是关键帧，收到音频后，说明帧收齐了，提前输出以降低首帧延时
+        // Last time it was a key frame, after receiving audio, it means that the frame is complete, output in advance to reduce the first frame delay
+        for (auto &pr : _streams) {
+            if (isVideoStream(pr.first)) {
+                flushStream(pr.first, pr.second);
+            }
+        }
+    }
+}
+
+bool PSDemuxer::isKeyPES(const Stream &stream, size_t index) const {
+    // 与Frame::keyFrame()/configFrame()一致，只判断pes负载开头的nal
+    // Consistent with Frame::keyFrame()/configFrame(), only judge the nal at the beginning of the pes payload
+    uint8_t head[5];
+    auto size = copySlices(stream.slices, index, head, sizeof(head));
+    auto prefix = startCodeSize(head, size);
+    if (!prefix || prefix >= size) {
+        return false;
+    }
+    auto nal = head[prefix];
+    switch (stream.codecid) {
+        case PSI_STREAM_H264: {
+            auto type = nal & 0x1F;
+            return type == 5 || type == 7 || type == 8;
+        }
+        case PSI_STREAM_H265: {
+            auto type = (nal >> 1) & 0x3F;
+            return (type >= 16 && type <= 21) || (type >= 32 && type <= 34);
+        }
+        default: return false;
+    }
+}
+
+void PSDemuxer::flushStream(int stream_id, Stream &stream) {
+    if (!stream.bytes) {
+        stream.slices.clear();
+        return;
+    }
+    Buffer::Ptr buffer;
+    if (stream.slices.size() == 1) {
+        // 整帧在一个输入片段内，零拷贝
+        // The whole frame is in one input slice, zero copy
+        auto &slice = stream.slices[0];
+        buffer = std::make_shared<BufferOffset<Buffer::Ptr> >(std::move(slice.buffer), slice.offset, slice.size);
+    } else {
+        auto raw = _buffer_pool.obtain2();
+        raw->setCapacity(stream.bytes + 1);
+        raw->setSize(stream.bytes);
+        auto ptr = raw->data();
+        for (auto &slice : stream.slices) {
+            memcpy(ptr, slice.buffer->data() + slice.offset, slice.size);
+            ptr += slice.size;
+        }
+        buffer = std::move(raw);
+    }
+    stream.slices.clear();
+    stream.bytes = 0;
+    if (_on_frame && stream.codecid) {
+        _on_frame(stream_id, stream.codecid, stream.pts, stream.dts, buffer);
+    }
+}
+
+}//namespace mediakit
+#endif//defined(ENABLE_RTPPROXY)
@@ -0,0 +1,140 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_PSDEMUXER_H
+#define ZLMEDIAKIT_PSDEMUXER_H
+
+#if defined(ENABLE_RTPPROXY)
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include "Network/Buffer.h"
+#include "Util/ResourcePool.h"
+
+namespace mediakit {
+
+/**
+ * 流式mpeg-ps解复用器，直接在输入的数据片段(例如排序后的rtp负载)上解析，不拷贝合并输入数据
+ * 一帧的负载只在一个数据片段内时零拷贝输出，跨越多个片段时只拷贝一次到帧缓存
+ * Streaming mpeg-ps demuxer, parses directly on the input data slices (such as sorted rtp payloads) without copying and merging the input data
+ * Zero-copy output when the payload of a frame is in only one data slice, copy only once to the frame buffer when it spans multiple slices
+ */
+class PSDemuxer {
+public:
+    using Ptr = std::shared_ptr<PSDemuxer>;
+    /**
+     * 发现新的流
+     * @param stream pes stream id
+     * @param codecid psm中的stream type(PSI_STREAM_XXX)，没有psm时根据负载猜测
+     * @param finish psm中的最后一个流
+     * New stream found
+     * @param stream Pes stream id
+     * @param codecid Stream type in psm (PSI_STREAM_XXX), guessed from the payload when there is no psm
+     * @param finish The last stream in psm
+     */
+    using onStream = std::function<void(int stream, int codecid, bool finish)>;
+    /**
+     * 解析出一帧，pts/dts单位为90KHz
+     * Parse out a frame, the unit of pts/dts is 90KHz
+     */
+    using onFrame = std::function<void(int stream, int codecid, int64_t pts, int64_t dts, const toolkit::Buffer::Ptr &buffer)>;
+
+    void setOnStream(onStream cb);
+    void setOnFrame(onFrame cb);
+
+    /**
+     * 设置是否合并pts相同的多个视频pes为一帧(收到下一帧时才输出)
+     * Set whether to merge multiple video pes with the same pts into one frame (output when the next frame is received)
+     */
+    void setMergeFrame(bool merge);
+
+    /**
+     * 输入ps数据片段，片段可以在任意位置切分，解析时只引用不拷贝
+     * Input a ps data slice, the slice can be split at any position, only referenced and not copied when parsing
+     * @param buffer 数据所在的buffer
+     * @param buffer Buffer where the data is located
+     * @param offset 数据在buffer中的偏移量
+     * @param offset Offset of the data in the buffer
+     * @param size 数据长度
+     * @param size Data length
+     */
+    void input(const toolkit::Buffer::Ptr &buffer, size_t offset, size_t size);
+
+    /**
+     * 丢弃未解析完的输入数据与未输出的帧(例如rtp丢包后)，从下一个起始码重新同步，丢包所在视频帧的后续pes也会被丢弃
+     * Discard the input data that has not been parsed and the frames not output (for example after rtp packet loss), resynchronize from the next start code,
+     * the subsequent pes of the video frame where the packet loss occurred are also discarded
+     */
+    void resync();
+
+    /**
+     * 输出缓存的视频帧
+     * Output cached video frames
+     */
+    void flush();
+
+    /**
+     * 判断ps数据片段(一般为一个rtp负载)是否包含视频关键帧的开始(idr/sps/vps)，只检查其中第一个视频pes的开头
+     * Determine whether a ps data slice (usually an rtp payload) contains the start of a video key frame (idr/sps/vps), only the beginning of the first video pes in it is checked
+     */
+    static bool isKeyPacket(const uint8_t *data, size_t size);
+
+private:
+    struct Slice {
+        toolkit::Buffer::Ptr buffer;
+        size_t offset;
+        size_t size;
+    };
+
+    struct Stream {
+        int codecid = 0;
+        bool have_pts = false;
+        int64_t pts = 0;
+        int64_t dts = 0;
+        size_t bytes = 0;
+        // 丢包后丢弃当前帧剩余的pes，直到下一帧开始
+        // After packet loss, discard the remaining pes of the current frame until the next frame starts
+        bool drop = false;
+        std::vector<Slice> slices;
+    };
+
+    void parse();
+    bool findStartCode();
+    size_t peek(size_t offset, uint8_t *out, size_t size) const;
+    void consume(size_t size);
+    void take(size_t size, std::vector<Slice> &out);
+    void parsePSM(const uint8_t *data, size_t size);
+    void onPES(int stream_id, const uint8_t *header, size_t header_size, size_t payload_size);
+    void flushStream(int stream_id, Stream &stream);
+    int guessCodec(int stream_id, const Slice &slice) const;
+    bool isKeyPES(const Stream &stream, size_t index) const;
+
+private:
+    bool _merge_frame = true;
+    bool _psm_done = false;
+    // 最后一个视频pes是否为关键帧或配置帧
+    // Whether the last video pes is a key frame or config frame
+    bool _last_is_key = false;
+    // 待丢弃的字节数(不关心的pes)
+    // Number of bytes to be discarded (pes we don't care about)
+    size_t _skip = 0;
+    size_t _input_size = 0;
+    std::deque<Slice> _input;
+    std::unordered_map<int, Stream> _streams;
+    onStream _on_stream;
+    onFrame _on_frame;
+    toolkit::ResourcePool<toolkit::BufferRaw> _buffer_pool;
+};
+
+}//namespace mediakit
+#endif//defined(ENABLE_RTPPROXY)
+#endif //ZLMEDIAKIT_PSDEMUXER_H
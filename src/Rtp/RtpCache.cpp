@@ -20,8 +20,8 @@ RtpCache::RtpCache(onFlushed cb) {
     _cb = std::move(cb);
 }
 
-void RtpCache::onFlush(std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool) {
-    _cb(std::move(rtp_list));
+void RtpCache::onFlush(std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool key_pos) {
+    _cb(std::move(rtp_list), key_pos);
 }
 
 void RtpCache::input(uint64_t stamp, Buffer::Ptr buffer, bool is_key) {
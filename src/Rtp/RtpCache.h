@@ -21,7 +21,9 @@ namespace mediakit{
 
 class RtpCache : protected PacketCache<toolkit::Buffer> {
 public:
-    using onFlushed = std::function<void(std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> >)>;
+    // key_pos: 本次输出是否包含关键帧(关键帧总是在开头)
+    // key_pos: Whether this output contains a key frame (the key frame is always at the beginning)
+    using onFlushed = std::function<void(std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> >, bool key_pos)>;
     RtpCache(onFlushed cb);
 
 protected:
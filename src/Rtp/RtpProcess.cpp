@@ -59,6 +59,9 @@ void RtpProcess::flush() {
     if (_process) {
         _process->flush();
     }
+    if (_jitter_buffer) {
+        _jitter_buffer->flush();
+    }
 }
 
 RtpProcess::~RtpProcess() {
@@ -88,8 +91,10 @@ void RtpProcess::onManager() {
 void RtpProcess::createTimer() {
     // 创建超时管理定时器  [AUTO-TRANSLATED:865cf865]
     // Create a timeout management timer
+    // 使用poller共享的时间轮，上万路推流时避免每路一个poller定时器
+    // Use the timer wheel shared by the poller to avoid one poller timer per stream when there are tens of thousands of streams
     weak_ptr<RtpProcess> weakSelf = shared_from_this();
-    _timer = std::make_shared<Timer>(3.0f, [weakSelf] {
+    _timer = std::make_shared<WheelTimer>(3.0f, [weakSelf] {
         auto strongSelf = weakSelf.lock();
         if (!strongSelf) {
             return false;
@@ -99,6 +104,15 @@ void RtpProcess::createTimer() {
     }, EventPollerPool::Instance().getPoller());
 }
 
+void RtpProcess::createJitterBuffer(uint32_t max_delay_ms) {
+    weak_ptr<RtpProcess> weak_self = shared_from_this();
+    _jitter_buffer = std::make_shared<FrameJitterBuffer>(max_delay_ms, getOwnerPoller(MediaSource::NullMediaSource()), [weak_self](const Frame::Ptr &frame) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->_muxer->inputFrame(frame);
+        }
+    });
+}
+
 bool RtpProcess::inputRtp(bool is_udp, const Socket::Ptr &sock, const char *data, size_t len, const struct sockaddr *addr, uint64_t *dts_out) {
     if (!isRtp(data, len)) {
         WarnP(this) << "Not rtp packet";
@@ -130,6 +144,9 @@ bool RtpProcess::inputRtp(bool is_udp, const Socket::Ptr &sock, const char *data
     if (!_process) {
         _media_info.protocol = is_udp ? "udp" : "tcp";
         _process = std::make_shared<GB28181Process>(_media_info, this);
+        if (_ps_rtp_ring) {
+            setupPSRtp();
+        }
     }
 
     onRtp(ntohs(header->seq), ntohl(header->stamp), 0/*不发送sr,所以可以设置为0*/ , 90000/*ps/ts流时间戳按照90K采样率*/, len);
@@ -156,6 +173,10 @@ bool RtpProcess::inputFrame(const Frame::Ptr &frame) {
     }
     if (_muxer) {
         _last_frame_time.resetTime();
+        if (_jitter_buffer) {
+            _jitter_buffer->setJitter(getJitterMS());
+            return _jitter_buffer->inputFrame(frame);
+        }
         return _muxer->inputFrame(frame);
     }
     if (_cache_ticker.elapsedTime() > kMaxCachedFrameMS) {
@@ -289,6 +310,9 @@ void RtpProcess::emitOnPublish(uint32_t ssrc) {
                     default: break;
                 }
                 strong_self->_muxer->setMediaListener(strong_self);
+                if (option.jitter_buffer_ms) {
+                    strong_self->createJitterBuffer(option.jitter_buffer_ms);
+                }
                 strong_self->doCachedFunc();
                 InfoP(strong_self) << "允许RTP推流，ssrc: " << printSSRC(ssrc);
             } else {
@@ -320,6 +344,36 @@ std::shared_ptr<SockInfo> RtpProcess::getOriginSock(MediaSource &sender) const {
     return const_cast<RtpProcess *>(this)->shared_from_this();
 }
 
+const RtpProcess::PSRtpRing::Ptr &RtpProcess::getPSRtpRing() {
+    if (!_ps_rtp_ring) {
+        // 没有透传转发时不缓存rtp包
+        // Do not cache rtp packets when there is no passthrough forwarding
+        _ps_rtp_ring = std::make_shared<PSRtpRing>();
+        setupPSRtp();
+    }
+    return _ps_rtp_ring;
+}
+
+void RtpProcess::setupPSRtp() {
+    // 有透传转发后才设置回调，否则每个rtp包都要扫描关键帧
+    // Set the callback only after there is passthrough forwarding, otherwise every rtp packet has to be scanned for key frames
+    auto process = std::dynamic_pointer_cast<GB28181Process>(_process);
+    if (!process) {
+        return;
+    }
+    process->setOnPSRtp([this](const RtpPacket::Ptr &rtp, bool key_pos) { _ps_rtp_ring->write(rtp, key_pos); });
+}
+
+float RtpProcess::getJitterMS() const {
+    // ps/ts流时间戳按照90K采样率
+    // The timestamp of ps/ts stream is based on 90K sampling rate
+    return getJitter() / 90;
+}
+
+const FrameJitterBuffer::Ptr &RtpProcess::getJitterBuffer() const {
+    return _jitter_buffer;
+}
+
 RtpProcess::Ptr RtpProcess::getRtpProcess(mediakit::MediaSource &sender) const {
     return const_cast<RtpProcess *>(this)->shared_from_this();
 }
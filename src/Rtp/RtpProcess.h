@@ -15,6 +15,8 @@
 #include "ProcessInterface.h"
 #include "Rtcp/RtcpContext.h"
 #include "Common/MultiMediaSourceMuxer.h"
+#include "Common/TimerWheel.h"
+#include "FrameJitterBuffer.h"
 
 namespace mediakit {
 
@@ -24,6 +26,7 @@ class RtpProcess final : public RtcpContextForRecv, public toolkit::SockInfo, pu
 public:
     using Ptr = std::shared_ptr<RtpProcess>;
     using onDetachCB = std::function<void(const toolkit::SockException &ex)>;
+    using PSRtpRing = toolkit::RingBuffer<RtpPacket::Ptr>;
 
     static Ptr createProcess(const MediaTuple &tuple);
     ~RtpProcess();
@@ -103,6 +106,26 @@ public:
 
     const toolkit::Socket::Ptr& getSock() const;
 
+    /**
+     * 获取收到的原始ps rtp包的环形缓存(带gop缓存)，用于startSendRtp透传转发，首次调用时创建
+     * 源流为ts或者未使用内置ps解复用器时没有数据，请在归属线程调用
+     * Get the ring buffer (with gop cache) of the received original ps rtp packets, used for startSendRtp passthrough forwarding, created on the first call
+     * There is no data when the source stream is ts or the built-in ps demuxer is not used, please call it in the owner thread
+     */
+    const PSRtpRing::Ptr &getPSRtpRing();
+
+    /**
+     * 获取rtp到达抖动，单位毫秒，请在归属线程调用
+     * Get the rtp arrival jitter, in milliseconds, please call it in the owner thread
+     */
+    float getJitterMS() const;
+
+    /**
+     * 获取自适应去抖动缓存，未开启时为空，请在归属线程调用
+     * Get the adaptive de-jitter buffer, it is empty when not enabled, please call it in the owner thread
+     */
+    const FrameJitterBuffer::Ptr &getJitterBuffer() const;
+
 protected:
     bool inputFrame(const Frame::Ptr &frame) override;
     bool addTrack(const Track::Ptr & track) override;
@@ -126,6 +149,8 @@ private:
     bool alive();
     void onManager();
     void createTimer();
+    void createJitterBuffer(uint32_t max_delay_ms);
+    void setupPSRtp();
 
 private:
     bool _pause_timeout = false;
@@ -143,7 +168,9 @@ private:
     std::shared_ptr<FILE> _save_file_video;
     ProcessInterface::Ptr _process;
     MultiMediaSourceMuxer::Ptr _muxer;
-    toolkit::Timer::Ptr _timer;
+    PSRtpRing::Ptr _ps_rtp_ring;
+    FrameJitterBuffer::Ptr _jitter_buffer;
+    WheelTimer::Ptr _timer;
     toolkit::Ticker _last_check_alive;
     std::recursive_mutex _func_mtx;
     toolkit::Ticker _cache_ticker;
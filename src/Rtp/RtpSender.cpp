@@ -9,29 +9,44 @@
  */
 
 #if defined(ENABLE_RTPPROXY)
+#include <chrono>
 #include "RtpSender.h"
 #include "RtpSession.h"
 #include "Rtsp/RtspSession.h"
 #include "Thread/WorkThreadPool.h"
 #include "Util/uv_errno.h"
-#include "RtpCache.h"
+#include "RtpProcess.h"
+#include "PSDemuxer.h"
+#include "RtpSenderGroup.h"
+#include "Common/config.h"
 #include "Rtcp/RtcpContext.h"
+#include "Common/TimerWheel.h"
 
 using namespace std;
 using namespace toolkit;
 
 namespace mediakit{
 
+// 等待源流ps关键帧rtp包的超时时间，超时后回退为重新复用
+// Timeout for waiting for the ps key frame rtp packets of the source stream, fall back to remuxing after timeout
+static constexpr uint64_t kPassthroughWaitMS = 3000;
+// 回退为复用时，复用输出的第一个包与最后一个透传包的时间戳间隔(90KHz时钟下的一帧，40ms)
+// When falling back to remuxing, the timestamp interval between the first remuxed packet and the last passthrough packet (one frame at 90KHz clock, 40ms)
+static constexpr uint32_t kFallbackStampGap = 3600;
+
+static uint64_t nowNS() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 RtpSender::RtpSender(EventPoller::Ptr poller) {
     _poller = poller ? std::move(poller) : EventPollerPool::Instance().getPoller();
     _socket_rtp = Socket::createSocket(_poller, false);
 }
 
 RtpSender::~RtpSender() {
-    try {
-        flush();
-    } catch (std::exception &ex) {
-        WarnL << "Exception occurred: " << ex.what();
+    if (_passthrough_bytes) {
+        InfoL << "ps passthrough forwarded " << _passthrough_bytes << " bytes, remuxing of " << _passthrough_frames << " frames saved, about "
+              << getPassthroughCpuSavedMS() << "ms cpu saved, ssrc: " << _args.ssrc;
     }
 }
 
@@ -42,21 +57,12 @@ void RtpSender::startSend(const MediaSourceEvent &sender, const MediaSourceEvent
         auto process = dynamic_pointer_cast<RtpProcess>(origin_socket);
         if (process) {
             _origin_socket = process->getSock();
+            _origin_process = process;
         }
     }
 
     _args = args;
-    if (!_interface) {
-        // 重连时不重新创建对象  [AUTO-TRANSLATED:b788cd5d]
-        // Do not recreate the object when reconnecting
-        auto lam = [this](std::shared_ptr<List<Buffer::Ptr>> list) { onFlushRtpList(std::move(list)); };
-        switch (args.data_type) {
-            case MediaSourceEvent::SendRtpArgs::kRtpPS: _interface = std::make_shared<RtpCachePS>(lam, atoi(args.ssrc.data()), args.pt, true); break;
-            case MediaSourceEvent::SendRtpArgs::kRtpTS: _interface = std::make_shared<RtpCachePS>(lam, atoi(args.ssrc.data()), args.pt, false); break;
-            case MediaSourceEvent::SendRtpArgs::kRtpES: _interface = std::make_shared<RtpCacheRaw>(lam, atoi(args.ssrc.data()), args.pt, args.only_audio); break;
-            default: CHECK(0, "invalid rtp type: " + to_string(args.data_type)); break;
-        }
-    }
+    _ssrc = atoi(args.ssrc.data());
 
     auto delay_ms = _args.close_delay_ms ? _args.close_delay_ms : 5000;
     weak_ptr<RtpSender> weak_self = shared_from_this();
@@ -76,15 +82,15 @@ void RtpSender::startSend(const MediaSourceEvent &sender, const MediaSourceEvent
         }
         // 定时器持有tcp_listener，保证超时时间内保持监听  [AUTO-TRANSLATED:39df3f48]
         // The timer holds the tcp_listener to ensure listening within the timeout period
-        auto delay_task = _poller->doDelayTask(delay_ms, [weak_self, tcp_listener]() mutable {
+        auto delay_task = std::make_shared<WheelTimer>(delay_ms / 1000.0f, [weak_self, tcp_listener]() mutable {
             // 防止循环引用  [AUTO-TRANSLATED:e2e9f9e7]
             // Prevent circular references
             tcp_listener = nullptr;
             if (auto strong_self = weak_self.lock()) {
                 strong_self->onClose(SockException(Err_timeout, "wait tcp connection timeout"));
             }
-            return 0;
-        });
+            return false;
+        }, _poller);
         tcp_listener->setOnAccept([weak_self, delay_task](Socket::Ptr &sock, std::shared_ptr<void> &complete) {
             auto strong_self = weak_self.lock();
             if (!strong_self) {
@@ -111,15 +117,15 @@ void RtpSender::startSend(const MediaSourceEvent &sender, const MediaSourceEvent
             // Get a random port from the port pool
             makeSockPair(pr, "::", true, true);
         }
-        auto delay_task = _poller->doDelayTask(delay_ms, [weak_self]() mutable {
+        auto delay_task = std::make_shared<WheelTimer>(delay_ms / 1000.0f, [weak_self]() mutable {
             if (auto strong_self = weak_self.lock()) {
                 // 关闭端口  [AUTO-TRANSLATED:3b3dff64]
                 // Close the port
                 strong_self->_socket_rtp->closeSock();
                 strong_self->onClose(SockException(Err_timeout, "wait udp connection timeout"));
             }
-            return 0;
-        });
+            return false;
+        }, _poller);
         _socket_rtp->setOnRead([weak_self, delay_task](const Buffer::Ptr &buf, struct sockaddr *addr, int addr_len) {
             auto strong_self = weak_self.lock();
             if (!strong_self) {
@@ -257,15 +263,14 @@ void RtpSender::createRtcpSocket() {
             bind_addr = true;
             strong_self->_socket_rtcp->bindPeerAddr(addr, addr_len, true);
         }
-        auto rtcp_arr = RtcpHeader::loadFromBytes(buf->data(), buf->size());
-        for (auto &rtcp : rtcp_arr) {
+        for (auto &rtcp : RtcpCompoundView(buf->data(), buf->size())) {
             strong_self->onRecvRtcp(rtcp);
         }
     });
     InfoL << "open rtcp port success, start check rr rtcp timeout";
 }
 
-void RtpSender::onRecvRtcp(RtcpHeader *rtcp) {
+void RtpSender::onRecvRtcp(const RtcpView &rtcp) {
     _rtcp_context->onRtcp(rtcp);
     _rtcp_recv_ticker.resetTime();
 }
@@ -332,40 +337,200 @@ void RtpSender::onConnect() {
         });
     }
     InfoL << "startSend rtp success: " << _socket_rtp->get_peer_ip() << ":" << _socket_rtp->get_peer_port() << ", data_type: " << _args.data_type << ", con_type: " << _args.con_type;
+    startPassthrough();
 }
 
-bool RtpSender::addTrack(const Track::Ptr &track) {
-    if (_args.only_audio && track->getTrackType() == TrackVideo) {
-        // 如果只发送音频则忽略视频  [AUTO-TRANSLATED:6843e322]
-        // Ignore video if only audio is sent
-        return false;
+void RtpSender::startPassthrough() {
+    GET_CONFIG(bool, ps_passthrough, RtpProxy::kPSPassthrough);
+    GET_CONFIG(bool, native_ps_demuxer, RtpProxy::kNativePSDemuxer);
+    if (!ps_passthrough || !native_ps_demuxer || _passthrough_reader || _args.data_type != MediaSourceEvent::SendRtpArgs::kRtpPS || _args.only_audio
+        || _args.con_type == MediaSourceEvent::SendRtpArgs::kVoiceTalk) {
+        return;
+    }
+    auto process = _origin_process.lock();
+    if (!process) {
+        // 源流不是rtp推流
+        // The source stream is not an rtp push stream
+        return;
     }
-    return _interface->addTrack(track);
+    weak_ptr<RtpSender> weak_self = shared_from_this();
+    _passthrough_reader = process->getPSRtpRing()->attach(_poller);
+    _passthrough_reader->setReadCB([weak_self](const RtpPacket::Ptr &rtp) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onPassthroughRtp(rtp);
+        }
+    });
+    _passthrough_reader->setDetachCB([weak_self]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->stopPassthrough("source detached");
+        }
+    });
+    _passthrough = true;
+    _passthrough_ticker.resetTime();
+    InfoL << "try ps passthrough forwarding, ssrc: " << _args.ssrc;
 }
 
-void RtpSender::addTrackCompleted() {
-    _interface->addTrackCompleted();
+void RtpSender::stopPassthrough(const string &reason) {
+    if (!_passthrough) {
+        return;
+    }
+    _passthrough = false;
+    // 等待共享组输出下一个关键帧
+    // Wait for the sharing group to output the next key frame
+    _rtp_started = false;
+    flushPassthrough();
+    // 透传转发的时间戳从0开始，而复用输出使用源流的绝对时间戳，需要衔接
+    // The timestamp of passthrough forwarding starts from 0, while the remuxing output uses the absolute timestamp of the source stream, they need to be joined
+    _stamp_rebase = _passthrough_started;
+    // 可能在reader的回调中，延后释放
+    // May be in the callback of the reader, release later
+    auto reader = std::move(_passthrough_reader);
+    _poller->async([reader]() {}, false);
+    WarnL << "ps passthrough stopped, fall back to remuxing, ssrc: " << _args.ssrc << ", reason: " << reason;
 }
 
-void RtpSender::resetTracks() {
-    _interface->resetTracks();
-}
+void RtpSender::onPassthroughRtp(const RtpPacket::Ptr &rtp) {
+    if (!_passthrough || !_is_connect) {
+        return;
+    }
+    if (!_passthrough_recv) {
+        _passthrough_recv = true;
+        if (rtp->getHeader()->pt != _args.pt) {
+            stopPassthrough(StrPrinter << "payload type mismatch: " << (int)rtp->getHeader()->pt << " != " << (int)_args.pt);
+            return;
+        }
+    }
+    if (!_passthrough_started) {
+        // 从关键帧开始转发，gop缓存中的第一个包一般就是关键帧
+        // Start forwarding from a key frame, the first packet in the gop cache is generally a key frame
+        if (!PSDemuxer::isKeyPacket(rtp->getPayload(), rtp->getPayloadSize())) {
+            if (_passthrough_ticker.elapsedTime() >= kPassthroughWaitMS) {
+                // 关键帧前有很大的sei、pes头不在扫描范围内或者编码格式不支持等
+                // There is a large sei before the key frame, the pes header is not within the scan range, or the codec is not supported, etc.
+                stopPassthrough("no ps key frame found from source");
+            }
+            return;
+        }
+        _passthrough_started = true;
+        _passthrough_stamp_base = rtp->getStamp();
+        InfoL << "ps passthrough started, ssrc: " << _args.ssrc;
+    }
 
-void RtpSender::flush() {
-    if (_interface) {
-        _interface->flush();
+    auto start = nowNS();
+    // 源rtp包可能还被解复用器引用，拷贝后再改写ssrc、seq和时间戳，负载保持不变
+    // The source rtp packet may still be referenced by the demuxer, copy it and then rewrite ssrc, seq and stamp, the payload remains unchanged
+    auto size = rtp->size();
+    auto packet = RtpPacket::create();
+    packet->setCapacity(size);
+    packet->setSize(size);
+    memcpy(packet->data(), rtp->data(), size);
+    packet->sample_rate = rtp->sample_rate;
+    packet->type = TrackVideo;
+    packet->ntp_stamp = rtp->ntp_stamp;
+    auto stamp = rtp->getStamp() - _passthrough_stamp_base;
+    auto header = packet->getHeader();
+    header->ssrc = htonl(_ssrc);
+    header->seq = htons(_seq++);
+    header->stamp = htonl(stamp);
+
+    // 同一时间戳(同一帧)的rtp包合并写
+    // Merge write rtp packets with the same stamp (the same frame)
+    if (_passthrough_list && !_passthrough_list->empty() && stamp != _passthrough_stamp) {
+        flushPassthrough();
+    }
+    if (!_passthrough_list) {
+        _passthrough_list = std::make_shared<List<Buffer::Ptr> >();
+    }
+    _passthrough_stamp = stamp;
+    _passthrough_bytes += size - RtpPacket::kRtpTcpHeaderSize;
+    bool mark = header->mark;
+    _passthrough_list->emplace_back(std::move(packet));
+    _passthrough_ns += nowNS() - start;
+    if (mark) {
+        flushPassthrough();
     }
 }
 
-bool RtpSender::inputFrame(const Frame::Ptr &frame) {
-    if (_args.only_audio && frame->getTrackType() == TrackVideo) {
-        // 如果只发送音频则忽略视频  [AUTO-TRANSLATED:6843e322]
-        // Ignore video if only audio is sent
-        return false;
+void RtpSender::flushPassthrough() {
+    if (_passthrough_list && !_passthrough_list->empty()) {
+        onFlushRtpList(std::move(_passthrough_list));
     }
+}
+
+bool RtpSender::needEncode(const Frame::Ptr &frame) {
     // 连接成功后才做实质操作(节省cpu资源)  [AUTO-TRANSLATED:666253b3]
     // Perform the actual operation after the connection is successful (save CPU resources)
-    return _is_connect ? _interface->inputFrame(frame) : false;
+    if (!_is_connect) {
+        return false;
+    }
+    if (_passthrough) {
+        if (_passthrough_started || _passthrough_ticker.elapsedTime() < kPassthroughWaitMS) {
+            // 透传转发中，不再复用ps
+            // Forwarding through, no longer mux ps
+            _passthrough_frames += _passthrough_started;
+            return false;
+        }
+        // 源流是ts负载等情况收不到ps rtp包，或者一直找不到关键帧
+        // The source stream is ts payload, etc. so no ps rtp packets can be received, or the key frame can never be found
+        stopPassthrough(_passthrough_recv ? "no ps key frame found from source" : "no ps rtp packets from source");
+    }
+    return true;
+}
+
+bool RtpSender::acceptRtp(bool key_pos) {
+    if (!_is_connect || _passthrough) {
+        return false;
+    }
+    if (!_rtp_started) {
+        // 中途加入共享组或透传转发回退时，从关键帧开始发送
+        // When joining the sharing group midway or falling back from passthrough forwarding, start sending from a key frame
+        if (!key_pos) {
+            return false;
+        }
+        _rtp_started = true;
+    }
+    return true;
+}
+
+void RtpSender::inputRtpList(const std::shared_ptr<List<Buffer::Ptr> > &rtp_list, bool reuse) {
+    auto out = reuse ? rtp_list : std::make_shared<List<Buffer::Ptr> >();
+    rtp_list->for_each([&](Buffer::Ptr &buffer) {
+        auto rtp = std::static_pointer_cast<RtpPacket>(buffer);
+        if (!reuse) {
+            // 其他目标还要使用该rtp包，拷贝一份再改写
+            // Other targets still use this rtp packet, copy one and then rewrite
+            auto size = rtp->size();
+            auto packet = RtpPacket::create();
+            packet->setCapacity(size);
+            packet->setSize(size);
+            memcpy(packet->data(), rtp->data(), size);
+            packet->sample_rate = rtp->sample_rate;
+            packet->type = rtp->type;
+            packet->ntp_stamp = rtp->ntp_stamp;
+            packet->track_index = rtp->track_index;
+            out->emplace_back(packet);
+            rtp = std::move(packet);
+        }
+        auto header = rtp->getHeader();
+        header->ssrc = htonl(_ssrc);
+        header->seq = htons(_seq++);
+        if (_stamp_rebase) {
+            _stamp_rebase = false;
+            _stamp_offset = _passthrough_stamp + kFallbackStampGap - ntohl(header->stamp);
+        }
+        if (_stamp_offset) {
+            header->stamp = htonl(ntohl(header->stamp) + _stamp_offset);
+        }
+    });
+    onFlushRtpList(std::move(out));
+}
+
+void RtpSender::setGroupKey(std::string key) {
+    _group_key = std::move(key);
+}
+
+const std::string &RtpSender::getGroupKey() const {
+    return _group_key;
 }
 
 void RtpSender::onSendRtpUdp(const toolkit::Buffer::Ptr &buf, bool check) {
@@ -500,6 +665,23 @@ size_t RtpSender::getRecvSpeed() const {
     return ret;
 }
 
+bool RtpSender::isPassthrough() const {
+    return _passthrough && _passthrough_started;
+}
+
+size_t RtpSender::getPassthroughBytes() const {
+    return _passthrough_bytes;
+}
+
+size_t RtpSender::getPassthroughFrames() const {
+    return _passthrough_frames;
+}
+
+uint64_t RtpSender::getPassthroughCpuSavedMS() const {
+    auto remux_ns = RtpSenderGroup::getPSRemuxCostNS() * _passthrough_frames;
+    return remux_ns > _passthrough_ns ? (remux_ns - _passthrough_ns) / 1000000 : 0;
+}
+
 size_t RtpSender::getRecvTotalBytes() const {
     size_t ret = 0;
     if (_socket_rtp) {
@@ -20,15 +20,18 @@
 namespace mediakit{
 
 class RtpSession;
+class RtpProcess;
 
 // rtp发送客户端，支持发送GB28181协议  [AUTO-TRANSLATED:668038b6]
 // RTP sending client, supporting sending GB28181 protocol
-class RtpSender final : public MediaSinkInterface, public std::enable_shared_from_this<RtpSender>{
+// ps/ts/es打包由RtpSenderGroup完成，本对象只负责改写ssrc与seq后发送
+// Ps/ts/es packing is done by RtpSenderGroup, this object is only responsible for rewriting ssrc and seq before sending
+class RtpSender final : public std::enable_shared_from_this<RtpSender>{
 public:
     using Ptr = std::shared_ptr<RtpSender>;
 
     RtpSender(toolkit::EventPoller::Ptr poller = nullptr);
-    ~RtpSender() override;
+    ~RtpSender();
 
     /**
      * 开始发送ps-rtp包
@@ -43,48 +46,35 @@ public:
     void startSend(const MediaSourceEvent &sender, const MediaSourceEvent::SendRtpArgs &args, const std::function<void(uint16_t local_port, const toolkit::SockException &ex)> &cb);
 
     /**
-     * 输入帧数据
-     * Input frame data
-     
-     * [AUTO-TRANSLATED:d13bc7f2]
+     * 是否需要打包该帧，未连接或透传转发时不需要
+     * Whether the frame needs to be packed, not needed when not connected or forwarding through
      */
-    bool inputFrame(const Frame::Ptr &frame) override;
+    bool needEncode(const Frame::Ptr &frame);
 
     /**
-     * 刷新输出frame缓存
-     * Refresh the output frame cache
-     
-     * [AUTO-TRANSLATED:547f851c]
+     * 是否接收本次打包输出，连接后从关键帧开始接收
+     * @param key_pos 本次输出是否从关键帧开始
+     * Whether to accept this packing output, start accepting from a key frame after connecting
+     * @param key_pos Whether this output starts with a key frame
      */
-    void flush() override;
+    bool acceptRtp(bool key_pos);
 
     /**
-     * 添加track，内部会调用Track的clone方法
-     * 只会克隆sps pps这些信息 ，而不会克隆Delegate相关关系
-     * @param track
-     * Add track, internally calls the clone method of Track
-     * Only clones sps pps information, not Delegate relationships
-     * @param track
-     
-     * [AUTO-TRANSLATED:ba6faf58]
+     * 输入打包好的rtp，改写ssrc与seq后发送
+     * @param rtp_list rtp列表
+     * @param reuse 是否可以直接改写rtp包(最后一个接收者)，否则拷贝后再改写
+     * Input packed rtp, rewrite ssrc and seq and then send
+     * @param rtp_list Rtp list
+     * @param reuse Whether the rtp packets can be rewritten directly (the last receiver), otherwise copy and then rewrite
      */
-    virtual bool addTrack(const Track::Ptr & track) override;
+    void inputRtpList(const std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> > &rtp_list, bool reuse);
 
     /**
-     * 添加所有Track完毕
-     * All Tracks added
-     
-     * [AUTO-TRANSLATED:751c45ca]
+     * 设置所属共享组的key
+     * Set the key of the sharing group it belongs to
      */
-    virtual void addTrackCompleted() override;
-
-    /**
-     * 重置track
-     * Reset track
-     
-     * [AUTO-TRANSLATED:95dc0b4f]
-     */
-    virtual void resetTracks() override;
+    void setGroupKey(std::string key);
+    const std::string &getGroupKey() const;
 
     /**
      * 设置发送rtp停止回调
@@ -99,6 +89,28 @@ public:
     size_t getRecvTotalBytes() const;
     size_t getSendTotalBytes() const;
 
+    /**
+     * 是否正在透传转发源流的ps rtp包(未经过解复用再复用)
+     * Whether the ps rtp packets of the source stream are being forwarded through (without demuxing and remuxing)
+     */
+    bool isPassthrough() const;
+
+    /**
+     * 透传转发的字节数与因此省去复用的帧数
+     * Number of bytes forwarded through and number of frames whose remuxing was saved
+     */
+    size_t getPassthroughBytes() const;
+    size_t getPassthroughFrames() const;
+
+    /**
+     * 透传转发省去的cpu时间估算值：省去复用的帧数乘以本进程ps复用每帧的平均耗时，再减去透传转发本身的耗时
+     * Estimated cpu time saved by passthrough forwarding: the number of frames whose remuxing was saved multiplied by the average time per frame of ps remuxing in this process,
+     * minus the time of passthrough forwarding itself
+     * @return 单位毫秒，尚未复用过ps无法估算时返回0
+     * @return In milliseconds, returns 0 when it cannot be estimated because no ps has been remuxed yet
+     */
+    uint64_t getPassthroughCpuSavedMS() const;
+
 private:
     // 合并写输出  [AUTO-TRANSLATED:23544836]
     // Merge write output
@@ -110,23 +122,59 @@ private:
     // Abnormal socket disconnect event
     void onErr(const toolkit::SockException &ex);
     void createRtcpSocket();
-    void onRecvRtcp(RtcpHeader *rtcp);
+    void onRecvRtcp(const RtcpView &rtcp);
     void onSendRtpUdp(const toolkit::Buffer::Ptr &buf, bool check);
     void onClose(const toolkit::SockException &ex);
+    // ps透传转发
+    // Ps passthrough forwarding
+    void startPassthrough();
+    void stopPassthrough(const std::string &reason);
+    void onPassthroughRtp(const RtpPacket::Ptr &rtp);
+    void flushPassthrough();
 
 private:
     bool _is_connect = false;
+    // 是否已经从关键帧开始接收打包输出
+    // Whether it has started to accept packing output from a key frame
+    bool _rtp_started = false;
+    uint16_t _seq = 0;
+    uint32_t _ssrc = 0;
+    std::string _group_key;
     toolkit::Socket::Ptr _origin_socket;
     MediaSourceEvent::SendRtpArgs _args;
     toolkit::Socket::Ptr _socket_rtp;
     toolkit::Socket::Ptr _socket_rtcp;
     toolkit::EventPoller::Ptr _poller;
-    MediaSinkInterface::Ptr _interface;
     std::shared_ptr<RtcpContext> _rtcp_context;
     toolkit::Ticker _rtcp_send_ticker;
     toolkit::Ticker _rtcp_recv_ticker;
     std::shared_ptr<RtpSession> _rtp_session;
     std::function<void(const toolkit::SockException &ex)> _on_close;
+
+    // ps透传转发相关
+    // Ps passthrough forwarding related
+    bool _passthrough = false;
+    // 是否已经从源流收到过ps rtp包
+    // Whether ps rtp packets have been received from the source stream
+    bool _passthrough_recv = false;
+    // 是否已经从关键帧开始转发
+    // Whether forwarding has started from a key frame
+    bool _passthrough_started = false;
+    uint32_t _passthrough_stamp = 0;
+    uint32_t _passthrough_stamp_base = 0;
+    size_t _passthrough_bytes = 0;
+    size_t _passthrough_frames = 0;
+    // 透传转发本身的耗时，单位纳秒
+    // The time of passthrough forwarding itself, in nanoseconds
+    uint64_t _passthrough_ns = 0;
+    // 透传转发回退为复用后，复用输出的时间戳接着透传转发的时间戳递增
+    // After passthrough forwarding falls back to remuxing, the timestamp of the remuxing output continues to increase from the timestamp of passthrough forwarding
+    bool _stamp_rebase = false;
+    uint32_t _stamp_offset = 0;
+    toolkit::Ticker _passthrough_ticker;
+    std::weak_ptr<RtpProcess> _origin_process;
+    toolkit::RingBuffer<RtpPacket::Ptr>::RingReader::Ptr _passthrough_reader;
+    std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> > _passthrough_list;
 };
 
 }//namespace mediakit
@@ -0,0 +1,183 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_RTPPROXY)
+#include <atomic>
+#include <chrono>
+#include "RtpSenderGroup.h"
+#include "RtpCache.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// ps复用每帧耗时的滑动平均，单位纳秒
+// Moving average of the time per frame of ps remuxing, in nanoseconds
+static std::atomic<uint64_t> s_ps_remux_ns { 0 };
+
+static uint64_t nowNS() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t RtpSenderGroup::getPSRemuxCostNS() {
+    return s_ps_remux_ns.load(std::memory_order_relaxed);
+}
+
+string RtpSenderGroup::makeKey(const MediaSourceEvent::SendRtpArgs &args) {
+    GET_CONFIG(uint32_t, video_mtu, Rtp::kVideoMtuSize);
+    GET_CONFIG(uint32_t, audio_mtu, Rtp::kAudioMtuSize);
+    _StrPrinter printer;
+    switch (args.data_type) {
+        case MediaSourceEvent::SendRtpArgs::kRtpPS: printer << "ps/" << (int)args.pt << "/mtu" << video_mtu; break;
+        // ts负载的pt固定为33
+        // The pt of ts payload is fixed to 33
+        case MediaSourceEvent::SendRtpArgs::kRtpTS: printer << "ts/" << (int)Rtsp::PT_MP2T << "/mtu" << video_mtu; break;
+        case MediaSourceEvent::SendRtpArgs::kRtpES: printer << "es/" << (int)args.pt << "/mtu" << (args.only_audio ? audio_mtu : video_mtu); break;
+        default: CHECK(0, "invalid rtp type: " + to_string(args.data_type)); break;
+    }
+    if (args.only_audio) {
+        printer << "/audio";
+    }
+    return printer;
+}
+
+RtpSenderGroup::RtpSenderGroup(const MediaSourceEvent::SendRtpArgs &args, EventPoller::Ptr poller) {
+    _only_audio = args.only_audio;
+    _ps = args.data_type == MediaSourceEvent::SendRtpArgs::kRtpPS;
+    _key = makeKey(args);
+    _poller = std::move(poller);
+    auto lam = [this](std::shared_ptr<List<Buffer::Ptr>> list, bool key_pos) { onFlushRtpList(std::move(list), key_pos); };
+    switch (args.data_type) {
+        case MediaSourceEvent::SendRtpArgs::kRtpPS: _interface = std::make_shared<RtpCachePS>(lam, atoi(args.ssrc.data()), args.pt, true); break;
+        case MediaSourceEvent::SendRtpArgs::kRtpTS: _interface = std::make_shared<RtpCachePS>(lam, atoi(args.ssrc.data()), args.pt, false); break;
+        case MediaSourceEvent::SendRtpArgs::kRtpES: _interface = std::make_shared<RtpCacheRaw>(lam, atoi(args.ssrc.data()), args.pt, args.only_audio); break;
+        default: CHECK(0, "invalid rtp type: " + to_string(args.data_type)); break;
+    }
+}
+
+void RtpSenderGroup::start(const vector<Track::Ptr> &tracks, const RingType::Ptr &ring) {
+    for (auto &track : tracks) {
+        addTrack(track);
+    }
+    addTrackCompleted();
+
+    weak_ptr<RtpSenderGroup> weak_self = shared_from_this();
+    _reader = ring->attach(_poller);
+    _reader->setReadCB([weak_self](const Frame::Ptr &frame) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->inputFrame(frame);
+        }
+    });
+}
+
+std::shared_ptr<onceToken> RtpSenderGroup::addSender(const RtpSender::Ptr &sender) {
+    sender->setGroupKey(_key);
+    _senders.emplace(sender.get(), sender);
+    InfoL << "rtp sender join group: " << _key << ", size: " << _senders.size();
+
+    // 凭证持有本组，最后一个成员退出后本组才释放
+    // The token holds this group, this group is released only after the last member leaves
+    auto strong_self = shared_from_this();
+    auto ptr = sender.get();
+    return std::make_shared<onceToken>(nullptr, [strong_self, ptr]() {
+        // 源流归属线程可能发生变更，切回本组线程
+        // The owning thread of the source stream may change, switch back to the thread of this group
+        strong_self->_poller->async([strong_self, ptr]() { strong_self->_senders.erase(ptr); });
+    });
+}
+
+const string &RtpSenderGroup::getKey() const {
+    return _key;
+}
+
+const EventPoller::Ptr &RtpSenderGroup::getPoller() const {
+    return _poller;
+}
+
+size_t RtpSenderGroup::size() const {
+    return _senders.size();
+}
+
+bool RtpSenderGroup::addTrack(const Track::Ptr &track) {
+    if (_only_audio && track->getTrackType() == TrackVideo) {
+        // 如果只发送音频则忽略视频  [AUTO-TRANSLATED:6843e322]
+        // Ignore video if only audio is sent
+        return false;
+    }
+    return _interface->addTrack(track);
+}
+
+void RtpSenderGroup::addTrackCompleted() {
+    _interface->addTrackCompleted();
+}
+
+void RtpSenderGroup::resetTracks() {
+    _interface->resetTracks();
+}
+
+void RtpSenderGroup::flush() {
+    _interface->flush();
+}
+
+bool RtpSenderGroup::inputFrame(const Frame::Ptr &frame) {
+    if (_only_audio && frame->getTrackType() == TrackVideo) {
+        // 如果只发送音频则忽略视频  [AUTO-TRANSLATED:6843e322]
+        // Ignore video if only audio is sent
+        return false;
+    }
+    // 所有成员都未连接或都在透传转发时不打包(节省cpu资源)
+    // Do not pack when all members are not connected or are forwarding through (save cpu resources)
+    bool need_encode = false;
+    for (auto &pr : _senders) {
+        // 需要遍历所有成员，透传转发的超时回退在其中判断
+        // All members need to be traversed, the timeout fallback of passthrough forwarding is judged in it
+        need_encode = pr.second->needEncode(frame) || need_encode;
+    }
+    if (!need_encode) {
+        return false;
+    }
+    if (!_ps) {
+        return _interface->inputFrame(frame);
+    }
+    _flush_ns = 0;
+    auto start = nowNS();
+    auto ret = _interface->inputFrame(frame);
+    auto ns = nowNS() - start;
+    ns = ns > _flush_ns ? ns - _flush_ns : 0;
+    // 权重1/16的滑动平均，多个组并发更新时丢失个别样本不影响估算
+    // Moving average with weight 1/16, losing individual samples when multiple groups update concurrently does not affect the estimation
+    auto avg = s_ps_remux_ns.load(std::memory_order_relaxed);
+    s_ps_remux_ns.store(avg ? avg - avg / 16 + ns / 16 : ns, std::memory_order_relaxed);
+    return ret;
+}
+
+void RtpSenderGroup::onFlushRtpList(std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool key_pos) {
+    auto start = _ps ? nowNS() : 0;
+    std::vector<RtpSender *> targets;
+    targets.reserve(_senders.size());
+    for (auto &pr : _senders) {
+        if (pr.second->acceptRtp(key_pos)) {
+            targets.emplace_back(pr.first);
+        }
+    }
+    // 一份打包输出分发给所有目标，最后一个目标直接改写，其他目标拷贝后改写
+    // One packing output is distributed to all targets, the last target rewrites directly, other targets copy and then rewrite
+    for (size_t i = 0; i < targets.size(); ++i) {
+        targets[i]->inputRtpList(rtp_list, i + 1 == targets.size());
+    }
+    if (_ps) {
+        _flush_ns += nowNS() - start;
+    }
+}
+
+} // namespace mediakit
+#endif // defined(ENABLE_RTPPROXY)
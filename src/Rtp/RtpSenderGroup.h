@@ -0,0 +1,104 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RTPSENDERGROUP_H
+#define ZLMEDIAKIT_RTPSENDERGROUP_H
+
+#if defined(ENABLE_RTPPROXY)
+#include <unordered_map>
+#include "RtpSender.h"
+#include "Util/onceToken.h"
+#include "Util/RingBuffer.h"
+
+namespace mediakit {
+
+/**
+ * 共享打包输出的rtp发送组
+ * 同一路流负载类型、打包模式(ps/ts/es)、only_audio与mtu相同的多个rtp发送目标共用一个ps/ts/es打包器，
+ * 打包后的rtp包分发给各个RtpSender，各目标只改写ssrc与seq
+ * Rtp sending group that shares the packetization output
+ * Multiple rtp sending targets of the same stream with the same payload type, packing mode (ps/ts/es), only_audio and mtu share one ps/ts/es packer,
+ * the packed rtp packets are distributed to each RtpSender, each target only rewrites ssrc and seq
+ */
+class RtpSenderGroup : public MediaSinkInterface, public std::enable_shared_from_this<RtpSenderGroup> {
+public:
+    using Ptr = std::shared_ptr<RtpSenderGroup>;
+    using RingType = toolkit::RingBuffer<Frame::Ptr>;
+
+    /**
+     * 获取共享组的key，key相同的发送目标可以共用打包输出
+     * Get the key of the sharing group, sending targets with the same key can share the packetization output
+     */
+    static std::string makeKey(const MediaSourceEvent::SendRtpArgs &args);
+
+    RtpSenderGroup(const MediaSourceEvent::SendRtpArgs &args, toolkit::EventPoller::Ptr poller);
+
+    /**
+     * 添加track并开始从帧环形缓存读取数据(会回放gop缓存)
+     * @param tracks 源流的track
+     * @param ring 源流的帧环形缓存
+     * Add tracks and start reading data from the frame ring buffer (the gop cache will be replayed)
+     * @param tracks Tracks of the source stream
+     * @param ring Frame ring buffer of the source stream
+     */
+    void start(const std::vector<Track::Ptr> &tracks, const RingType::Ptr &ring);
+
+    /**
+     * 加入发送目标
+     * @param sender 发送目标，必须与本组在同一个poller线程
+     * @return 成员凭证，释放后发送目标退出本组，最后一个成员退出后本组停止读取数据
+     * Add a sending target
+     * @param sender Sending target, must be in the same poller thread as this group
+     * @return Member token, the sending target leaves this group after it is released, this group stops reading data after the last member leaves
+     */
+    std::shared_ptr<toolkit::onceToken> addSender(const RtpSender::Ptr &sender);
+
+    const std::string &getKey() const;
+    const toolkit::EventPoller::Ptr &getPoller() const;
+
+    /**
+     * 发送目标个数
+     * Number of sending targets
+     */
+    size_t size() const;
+
+    bool inputFrame(const Frame::Ptr &frame) override;
+    bool addTrack(const Track::Ptr &track) override;
+    void addTrackCompleted() override;
+    void resetTracks() override;
+    void flush() override;
+
+    /**
+     * 本进程ps复用每帧的平均cpu耗时(不含发送)，尚未复用过ps时返回0；用于估算ps透传转发省去的cpu
+     * The average cpu time per frame of ps remuxing in this process (excluding sending), returns 0 if no ps has been remuxed yet; used to estimate the cpu saved by ps passthrough forwarding
+     * @return 单位纳秒
+     * @return In nanoseconds
+     */
+    static uint64_t getPSRemuxCostNS();
+
+private:
+    void onFlushRtpList(std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> > rtp_list, bool key_pos);
+
+private:
+    bool _only_audio;
+    bool _ps = false;
+    // 当前帧复用过程中分发rtp包(发送)的耗时，统计复用耗时时扣除
+    // The time spent distributing (sending) rtp packets while remuxing the current frame, deducted when counting the remuxing time
+    uint64_t _flush_ns = 0;
+    std::string _key;
+    toolkit::EventPoller::Ptr _poller;
+    MediaSinkInterface::Ptr _interface;
+    RingType::RingReader::Ptr _reader;
+    std::unordered_map<RtpSender *, RtpSender::Ptr> _senders;
+};
+
+} // namespace mediakit
+#endif // defined(ENABLE_RTPPROXY)
+#endif // ZLMEDIAKIT_RTPSENDERGROUP_H
@@ -89,8 +89,7 @@ public:
                 strong_self->_rtcp_addr = std::make_shared<struct sockaddr_storage>();
                 memcpy(strong_self->_rtcp_addr.get(), addr, addr_len);
             }
-            auto rtcps = RtcpHeader::loadFromBytes(buf->data(), buf->size());
-            for (auto &rtcp : rtcps) {
+            for (auto &rtcp : RtcpCompoundView(buf->data(), buf->size())) {
                 strong_self->_process->onRtcp(rtcp);
             }
             // 收到sr rtcp后驱动返回rr rtcp  [AUTO-TRANSLATED:d7373077]
@@ -10,10 +10,85 @@
 
 #if defined(ENABLE_RTPPROXY)
 #include <string.h>
+#include <algorithm>
+#include <stdexcept>
 #include "RtpSplitter.h"
 namespace mediakit{
 
 static const int  kEHOME_OFFSET = 256;
+// 最大缓存4兆数据(搜索rtp上下文时可能缓存多个rtp包)
+// Maximum cache 4MB data (multiple rtp packets may be cached when searching the rtp context)
+static constexpr size_t kMaxTailSize = 4 * 1024 * 1024;
+
+void RtpSplitter::input(const char *data, size_t len) {
+    while (!_tail.empty() && len) {
+        // 只追加补全缓存rtp包所需的数据，长度未知时(ehome或搜索rtp上下文)追加全部数据
+        // Only append the data needed to complete the cached rtp packet, append all data when the length is unknown (ehome or searching the rtp context)
+        auto want = nextPacketSize(_tail.data(), _tail.size());
+        auto size = want > _tail.size() ? std::min(want - _tail.size(), len) : len;
+        _tail.append(data, size);
+        data += size;
+        len -= size;
+
+        auto consumed = splitPacket(_tail.data(), _tail.size());
+        if (consumed == _tail.size()) {
+            _tail.clear();
+        } else if (consumed) {
+            _tail.erase(0, consumed);
+        }
+        if (_tail.size() > kMaxTailSize) {
+            // 缓存太多数据无法处理则上抛异常  [AUTO-TRANSLATED:30e48e9e]
+            // If too much data is cached and cannot be processed, throw an exception
+            auto tail_size = _tail.size();
+            _tail.clear();
+            throw std::out_of_range("remain data size is too huge, now cleared:" + std::to_string(tail_size));
+        }
+    }
+    if (!len) {
+        return;
+    }
+    // 缓存已清空，剩余数据直接在输入数据上解析
+    // The cache has been cleared, the remaining data is parsed directly on the input data
+    auto consumed = splitPacket(data, len);
+    if (consumed < len) {
+        _tail.assign(data + consumed, len - consumed);
+    }
+}
+
+size_t RtpSplitter::splitPacket(const char *data, size_t len) {
+    const char *ptr = data;
+    const char *end = data + len;
+    while (ptr < end) {
+        auto index = onSearchPacketTail(ptr, end - ptr);
+        if (!index || index == ptr) {
+            // 数据不够  [AUTO-TRANSLATED:72802244]
+            // Not enough data
+            break;
+        }
+        if (index < ptr || index > end) {
+            throw std::out_of_range("上层分包逻辑异常");
+        }
+        auto packet = ptr;
+        ptr = index;
+        onRecvHeader(packet, index - packet);
+    }
+    return ptr - data;
+}
+
+size_t RtpSplitter::nextPacketSize(const char *data, size_t len) const {
+    if (_is_ehome || _check_ehome_count) {
+        // ehome私有头需要特殊处理
+        // The ehome private header needs special handling
+        return 0;
+    }
+    auto ptr = (const uint8_t *)data;
+    if (_is_rtsp_interleaved && ptr[0] == '$') {
+        // $ + channel + 2个字节长度
+        // $ + channel + 2 bytes length
+        return len < 4 ? 4 : 4 + ((ptr[2] << 8) | ptr[3]);
+    }
+    return len < 2 ? 2 : 2 + ((ptr[0] << 8) | ptr[1]);
+}
 
 ssize_t RtpSplitter::onRecvHeader(const char *data,size_t len){
     // 忽略偏移量  [AUTO-TRANSLATED:7fbc3d5d]
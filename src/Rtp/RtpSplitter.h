@@ -17,6 +17,17 @@
 namespace mediakit{
 
 class RtpSplitter : public HttpRequestSplitter{
+public:
+    /**
+     * 输入tcp数据
+     * 完整的rtp包直接在输入数据上解析回调，只缓存末尾不完整的rtp包，
+     * 下次输入时只拷贝补全该rtp包所缺的数据，不再把整个输入追加到缓存
+     * Input tcp data
+     * Complete rtp packets are parsed and called back directly on the input data, only the incomplete rtp packet at the end is cached,
+     * only the data missing from this rtp packet is copied to complete it the next time, instead of appending the whole input to the cache
+     */
+    void input(const char *data, size_t len) override;
+
 protected:
     /**
      * 收到rtp包回调
@@ -36,11 +47,18 @@ protected:
     const char *onSearchPacketTail(const char *data, size_t len) override;
     const char *onSearchPacketTail_l(const char *data, size_t len);
 
+private:
+    size_t splitPacket(const char *data, size_t len);
+    size_t nextPacketSize(const char *data, size_t len) const;
+
 private:
     bool _is_ehome = false;
     int _check_ehome_count = 3;
     bool _is_rtsp_interleaved = true;
     size_t _offset = 0;
+    // 末尾不完整的rtp包
+    // Incomplete rtp packet at the end
+    std::string _tail;
 };
 
 }//namespace mediakit
@@ -568,14 +568,13 @@ void RtspPlayer::onRtpPacket(const char *data, size_t len) {
 // 此处预留rtcp处理函数  [AUTO-TRANSLATED:30c3afa8]
 // Reserved for RTCP processing function
 void RtspPlayer::onRtcpPacket(int track_idx, SdpTrack::Ptr &track, uint8_t *data, size_t len) {
-    auto rtcp_arr = RtcpHeader::loadFromBytes((char *)data, len);
-    for (auto &rtcp : rtcp_arr) {
+    for (auto &rtcp : RtcpCompoundView(data, len)) {
         _rtcp_context[track_idx]->onRtcp(rtcp);
-        if ((RtcpType)rtcp->pt == RtcpType::RTCP_SR) {
-            auto sr = (RtcpSR *)(rtcp);
+        if (rtcp.type() == RtcpType::RTCP_SR) {
+            RtcpSRView sr(rtcp);
             // 设置rtp时间戳与ntp时间戳的对应关系  [AUTO-TRANSLATED:e92f4749]
             // Set the correspondence between RTP timestamp and NTP timestamp
-            setNtpStamp(track_idx, sr->rtpts, sr->getNtpUnixStampMS());
+            setNtpStamp(track_idx, sr.rtpts(), sr.getNtpUnixStampMS());
         }
     }
 }
@@ -165,8 +165,7 @@ void RtspPusher::onRtpPacket(const char *data, size_t len) {
 }
 
 void RtspPusher::onRtcpPacket(int track_idx, SdpTrack::Ptr &track, uint8_t *data, size_t len){
-    auto rtcp_arr = RtcpHeader::loadFromBytes((char *) data, len);
-    for (auto &rtcp : rtcp_arr) {
+    for (auto &rtcp : RtcpCompoundView(data, len)) {
         _rtcp_context[track_idx]->onRtcp(rtcp);
     }
 }
@@ -64,6 +64,16 @@ void RtspSession::onError(const SockException &err) {
                 << ")断开:" << err.what()
                 << ",耗时(s):" << duration;
 
+    if (is_player && _rtp_type == Rtsp::RTP_TCP && _tcp_send_calls) {
+        //rtp over tcp发送统计
+        // Rtp over tcp send statistics
+        InfoP(this) << "rtp over tcp发送调用次数:" << _tcp_send_calls
+                    << ",rtp个数:" << _tcp_send_packets
+                    << ",每次调用rtp个数:" << _tcp_send_packets / _tcp_send_calls
+                    << ",每秒发送次数:" << _tcp_send_calls / (duration ? duration : 1)
+                    << ",发送缓存满次数:" << _tcp_send_blocked;
+    }
+
     if (_rtp_type == Rtsp::RTP_MULTICAST) {
         //取消UDP端口监听
         UDPServer::Instance().stopListenPeer(get_peer_ip().data(), this);
@@ -178,13 +188,12 @@ void RtspSession::onRtpPacket(const char *data, size_t len) {
 }
 
 void RtspSession::onRtcpPacket(int track_idx, SdpTrack::Ptr &track, const char *data, size_t len){
-    auto rtcp_arr = RtcpHeader::loadFromBytes((char *) data, len);
-    for (auto &rtcp : rtcp_arr) {
+    for (auto &rtcp : RtcpCompoundView(data, len)) {
         _rtcp_context[track_idx]->onRtcp(rtcp);
-        if ((RtcpType) rtcp->pt == RtcpType::RTCP_SR) {
-            auto sr = (RtcpSR *) (rtcp);
+        if (rtcp.type() == RtcpType::RTCP_SR) {
+            RtcpSRView sr(rtcp);
             //设置rtp时间戳与ntp时间戳的对应关系
-            setNtpStamp(track_idx, sr->rtpts, sr->getNtpUnixStampMS());
+            setNtpStamp(track_idx, sr.rtpts(), sr.getNtpUnixStampMS());
         }
     }
 }
@@ -1242,15 +1251,28 @@ void RtspSession::updateRtcpContext(const RtpPacket::Ptr &rtp){
 void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
     switch (_rtp_type) {
         case Rtsp::RTP_TCP: {
+            GET_CONFIG(size_t, max_packets, Rtsp::kTcpBatchMaxPackets);
+            GET_CONFIG(size_t, max_bytes, Rtsp::kTcpBatchMaxBytes);
+            // 环形缓存每次分发一个合并写列表，列表内的rtp只写入发送缓存，分发结束时由flushTcpBatch一次发送
+            // The ring buffer dispatches one merged write list each time, the rtp in the list are only written to the send buffer, and sent at once by flushTcpBatch at the end of the dispatch
             setSendFlushFlag(false);
             pkt->for_each([&](const RtpPacket::Ptr &rtp) {
                 if (_target_play_track == TrackInvalid || _target_play_track == rtp->type) {
                     updateRtcpContext(rtp);
                     send(rtp);
+                    ++_tcp_batch_packets;
+                    _tcp_batch_bytes += rtp->size();
+                    if ((max_packets && _tcp_batch_packets >= max_packets) || (max_bytes && _tcp_batch_bytes >= max_bytes)) {
+                        //达到批量上限，立即发送
+                        // The batch limit is reached, send immediately
+                        flushTcpBatch();
+                    }
                 }
             });
-            flushAll();
+            // 恢复flush标记，之后其他发送(rtsp回复、rtcp等)仍然立即flush
+            // Restore the flush flag, other sends afterwards (rtsp responses, rtcp, etc.) still flush immediately
             setSendFlushFlag(true);
+            flushTcpBatch();
         }
             break;
         case Rtsp::RTP_UDP: {
@@ -1282,6 +1304,34 @@ void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
     }
 }
 
+void RtspSession::flushTcpBatch() {
+    if (!_tcp_batch_packets) {
+        return;
+    }
+    _tcp_send_calls.fetch_add(1, std::memory_order_relaxed);
+    _tcp_send_packets.fetch_add(_tcp_batch_packets, std::memory_order_relaxed);
+    _tcp_batch_packets = 0;
+    _tcp_batch_bytes = 0;
+    flushAll();
+    if (isSocketBusy()) {
+        // 内核发送缓存已满，剩余数据由socket在可写时继续发送
+        // The kernel send buffer is full, the remaining data continues to be sent by the socket when writable
+        _tcp_send_blocked.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t RtspSession::getTcpSendCalls() const {
+    return _tcp_send_calls.load(std::memory_order_relaxed);
+}
+
+uint64_t RtspSession::getTcpSendPackets() const {
+    return _tcp_send_packets.load(std::memory_order_relaxed);
+}
+
+uint64_t RtspSession::getTcpSendBlocked() const {
+    return _tcp_send_blocked.load(std::memory_order_relaxed);
+}
+
 void RtspSession::setSocketFlags(){
     GET_CONFIG(int, mergeWriteMS, General::kMergeWriteMS);
     if(mergeWriteMS > 0) {
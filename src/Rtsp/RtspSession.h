@@ -12,6 +12,7 @@
 #define SESSION_RTSPSESSION_H_
 
 #include <set>
+#include <atomic>
 #include <vector>
 #include <unordered_set>
 #include "Network/Session.h"
@@ -41,6 +42,16 @@ public:
     void onError(const toolkit::SockException &err) override;
     void onManager() override;
 
+    /**
+     * rtp over tcp播放的发送统计：提交给socket的writev/sendmsg次数、发送的rtp个数，
+     * 以及提交时内核发送缓存已满的次数(剩余数据由socket在可写时再次发送，不计入提交次数)
+     * Sending statistics of rtp over tcp playback: the number of writev/sendmsg submitted to the socket, the number of rtp sent,
+     * and the number of times the kernel send buffer was full when submitting (the remaining data is sent again by the socket when writable, not counted in the submission count)
+     */
+    uint64_t getTcpSendCalls() const;
+    uint64_t getTcpSendPackets() const;
+    uint64_t getTcpSendBlocked() const;
+
 protected:
     /////RtspSplitter override/////
     // 收到完整的rtsp包回调，包括sdp等content数据  [AUTO-TRANSLATED:efbe20df]
@@ -196,6 +207,9 @@ private:
     // 设置socket标志  [AUTO-TRANSLATED:4086e686]
     // Set socket flag
     void setSocketFlags();
+    // 发送rtp over tcp批量缓存
+    // Send the batched rtp over tcp cache
+    void flushTcpBatch();
 
 private:
     // 是否已经触发on_play事件  [AUTO-TRANSLATED:49c937ce]
@@ -214,6 +228,13 @@ private:
     // 消耗的总流量  [AUTO-TRANSLATED:45ad2785]
     // Total traffic consumed
     uint64_t _bytes_usage = 0;
+    // rtp over tcp批量发送状态与统计，统计值可能在其他线程读取
+    // Rtp over tcp batch send state and statistics, the statistics may be read in other threads
+    size_t _tcp_batch_packets = 0;
+    size_t _tcp_batch_bytes = 0;
+    std::atomic<uint64_t> _tcp_send_calls { 0 };
+    std::atomic<uint64_t> _tcp_send_packets { 0 };
+    std::atomic<uint64_t> _tcp_send_blocked { 0 };
     //ContentBase
     std::string _content_base;
     // 记录是否需要rtsp专属鉴权，防止重复触发事件  [AUTO-TRANSLATED:9cff90b9]
@@ -16,24 +16,20 @@
 
 namespace mediakit {
 
-class TSMediaSourceMuxer final : public MpegMuxer, public MediaSourceEventInterceptor,
+/**
+ * http-ts直播源，只消费共享ts复用器的输出，自身不复用
+ * http-ts live source, only consumes the output of the shared ts muxer and does not mux by itself
+ */
+class TSMediaSourceMuxer final : public MpegConsumer, public MediaSourceEventInterceptor,
                                  public std::enable_shared_from_this<TSMediaSourceMuxer> {
 public:
     using Ptr = std::shared_ptr<TSMediaSourceMuxer>;
 
-    TSMediaSourceMuxer(const MediaTuple& tuple, const ProtocolOption &option) : MpegMuxer(false) {
+    TSMediaSourceMuxer(const MediaTuple& tuple, const ProtocolOption &option) {
         _option = option;
         _media_src = std::make_shared<TSMediaSource>(tuple);
     }
 
-    ~TSMediaSourceMuxer() override {
-        try {
-            MpegMuxer::flush();
-        } catch (std::exception &ex) {
-            WarnL << ex.what();
-        }
-    };
-
     void setListener(const std::weak_ptr<MediaSourceEvent> &listener){
         setDelegate(listener);
         _media_src->setListener(shared_from_this());
@@ -51,15 +47,14 @@ public:
         MediaSourceEventInterceptor::onReaderChanged(sender, size);
     }
 
-    bool inputFrame(const Frame::Ptr &frame) override {
-        if (_clear_cache && _option.ts_demand) {
-            _clear_cache = false;
-            _media_src->clearCache();
+    bool inputMpeg(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) override {
+        if (!buffer || !checkEnabled()) {
+            return false;
         }
-        if (_enabled || !_option.ts_demand) {
-            return MpegMuxer::inputFrame(frame);
-        }
-        return false;
+        auto packet = std::make_shared<TSPacket>(buffer);
+        packet->time_stamp = timestamp;
+        _media_src->onWrite(std::move(packet), key_pos);
+        return true;
     }
 
     bool isEnabled() {
@@ -68,14 +63,13 @@ public:
         return _option.ts_demand ? (_clear_cache ? true : _enabled) : true;
     }
 
-protected:
-    void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t timestamp, bool key_pos) override {
-        if (!buffer) {
-            return;
+private:
+    bool checkEnabled() {
+        if (_clear_cache && _option.ts_demand) {
+            _clear_cache = false;
+            _media_src->clearCache();
         }
-        auto packet = std::make_shared<TSPacket>(std::move(buffer));
-        packet->time_stamp = timestamp;
-        _media_src->onWrite(std::move(packet), key_pos);
+        return _enabled || !_option.ts_demand;
     }
 
 private:
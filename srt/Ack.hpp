@@ -1,5 +1,6 @@
 ﻿#ifndef ZLMEDIAKIT_SRT_ACK_H
 #define ZLMEDIAKIT_SRT_ACK_H
+#include <array>
 #include "Packet.hpp"
 
 namespace SRT {
@@ -86,5 +87,43 @@ public:
     uint32_t ack_number;
 };
 
+/**
+ * 记录full ack的发送时间，收到ackack时用于计算rtt
+ * Record the sending time of full ack, used to calculate rtt when receiving ackack
+ * 以ack number取模为下标的定长环形表，收发ack时没有内存分配，过期记录被自然覆盖
+ * Fixed-size ring table indexed by ack number modulo, no memory allocation when sending/receiving ack, expired records are naturally overwritten
+ */
+class ACKHistory {
+public:
+    void add(uint32_t ack_number, TimePoint now) {
+        auto &item = _items[ack_number % kSize];
+        item.ack_number = ack_number;
+        item.send_time = now;
+        item.valid = true;
+    }
+
+    bool pop(uint32_t ack_number, TimePoint &send_time) {
+        auto &item = _items[ack_number % kSize];
+        if (!item.valid || item.ack_number != ack_number) {
+            return false;
+        }
+        item.valid = false;
+        send_time = item.send_time;
+        return true;
+    }
+
+private:
+    // 每10ms发送一次full ack，可保存约10秒的记录
+    // Full ack is sent every 10ms, about 10 seconds of records can be kept
+    static constexpr size_t kSize = 1024;
+
+    struct Item {
+        bool valid = false;
+        uint32_t ack_number = 0;
+        TimePoint send_time;
+    };
+    std::array<Item, kSize> _items;
+};
+
 } // namespace SRT
 #endif // ZLMEDIAKIT_SRT_ACK_H
\ No newline at end of file
@@ -610,9 +610,9 @@ bool NAKPacket::storeToData() {
     return true;
 }
 
-size_t NAKPacket::getCIFSize(std::list<LostPair> &lost) {
+size_t NAKPacket::getCIFSize(const std::vector<LostPair> &lost) {
     size_t size = 0;
-    for (auto it : lost) {
+    for (auto &it : lost) {
         if (it.first + 1 == it.second) {
             size += 4;
         } else {
@@ -24,6 +24,14 @@ static inline bool isSeqCycle(uint32_t first, uint32_t second) {
     }
 }
 
+static inline uint32_t tsDistance(uint32_t first, uint32_t last) {
+    uint32_t dur = last > first ? last - first : first - last;
+    if (dur > 0x80000000) {
+        dur = MAX_TS - dur;
+    }
+    return dur;
+}
+
 static inline bool isTSCycle(uint32_t first, uint32_t second) {
     uint32_t diff;
     if (first > second) {
@@ -67,7 +75,7 @@ void PacketQueue::tryInsertPkt(DataPacket::Ptr pkt) {
     }
 }
 
-bool PacketQueue::inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out) {
+bool PacketQueue::inputPacket(DataPacket::Ptr pkt, PacketList &out) {
     tryInsertPkt(pkt);
     auto it = _pkt_map.find(_pkt_expected_seq);
     while (it != _pkt_map.end()) {
@@ -100,7 +108,7 @@ bool PacketQueue::inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &o
     return true;
 }
 
-bool PacketQueue::drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out) {
+bool PacketQueue::drop(uint32_t first, uint32_t last, PacketList &out) {
     uint32_t end = genExpectedSeq(last + 1);
     decltype(_pkt_map.end()) it;
     for (uint32_t i = _pkt_expected_seq; i < end;) {
@@ -137,14 +145,14 @@ uint32_t PacketQueue::timeLatency() {
     return dur;
 }
 
-std::list<PacketQueue::LostPair> PacketQueue::getLostSeq() {
-    std::list<PacketQueue::LostPair> re;
+void PacketQueue::getLostSeq(LostList &re) {
+    re.clear();
     if (_pkt_map.empty()) {
-        return re;
+        return;
     }
 
     if (getExpectedSize() == getSize()) {
-        return re;
+        return;
     }
 
     uint32_t end = 0;
@@ -181,8 +189,6 @@ std::list<PacketQueue::LostPair> PacketQueue::getLostSeq() {
         }
         i = genExpectedSeq(i + 1);
     }
-
-    return re;
 }
 
 size_t PacketQueue::getSize() {
@@ -248,72 +254,76 @@ PacketRecvQueue::PacketRecvQueue(uint32_t max_size, uint32_t init_seq, uint32_t
 bool  PacketRecvQueue::TLPKTDrop(){
     return (_srt_flag&HSExtMessage::HS_EXT_MSG_TLPKTDROP) && (_srt_flag &HSExtMessage::HS_EXT_MSG_TSBPDRCV);
 }
-bool PacketRecvQueue::inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out) {
+bool PacketRecvQueue::inputPacket(DataPacket::Ptr pkt, PacketList &out) {
     // TraceL << dump() << " seq:" << pkt->packet_seq_number;
     while (_size > 0 && _start == _end) {
         if (_pkt_buf[_start]) {
-            out.push_back(_pkt_buf[_start]);
+            out.emplace_back(std::move(_pkt_buf[_start]));
             _size--;
-            _pkt_buf[_start] = nullptr;
         }
         _start = (_start + 1) % _pkt_cap;
         _pkt_expected_seq = genExpectedSeq(_pkt_expected_seq + 1);
     }
 
-    tryInsertPkt(pkt);
+    tryInsertPkt(std::move(pkt));
+    popContinuous(out);
+    if (TLPKTDrop()) {
+        releaseExpired(out);
+    }
+    return true;
+}
 
-    DataPacket::Ptr it = _pkt_buf[_start];
-    while (it) {
-        out.push_back(it);
+void PacketRecvQueue::popContinuous(PacketList &out) {
+    // 交付窗口头部连续的包，shared_ptr被move后槽位自动清空
+    // Deliver the continuous packets at the head of the window, the slot is cleared after the shared_ptr is moved
+    while (_pkt_buf[_start]) {
+        out.emplace_back(std::move(_pkt_buf[_start]));
         _size--;
-        _pkt_buf[_start] = nullptr;
         _pkt_expected_seq = genExpectedSeq(_pkt_expected_seq + 1);
         _start = (_start + 1) % _pkt_cap;
-        it = _pkt_buf[_start];
     }
-    while (timeLatency() > _pkt_latency && TLPKTDrop()) {
-        it = _pkt_buf[_start];
-        if (it) {
-            _pkt_buf[_start] = nullptr;
-            out.push_back(it);
-            _size--;
+}
+
+void PacketRecvQueue::releaseExpired(PacketList &out) {
+    if (_size <= 0) {
+        return;
+    }
+    // 窗口按seq排列，时间戳基本有序，只需从头部开始一次扫描；
+    // 首个已收到的包超过延时则跳过它前面丢失的包，否则后面的包也不会超时
+    // The window is ordered by seq and the timestamps are roughly ordered, so a single scan from the head is enough;
+    // if the first received packet exceeds the latency, skip the lost packets before it, otherwise the later packets will not time out either
+    auto last_ts = getLast()->timestamp;
+    while (_size > 0) {
+        uint32_t pos = _start;
+        uint32_t gap = 0;
+        while (!_pkt_buf[pos]) {
+            pos = (pos + 1) % _pkt_cap;
+            ++gap;
         }
-        _pkt_expected_seq = genExpectedSeq(_pkt_expected_seq + 1);
-        _start = (_start + 1) % _pkt_cap;
+        if (tsDistance(_pkt_buf[pos]->timestamp, last_ts) <= _pkt_latency) {
+            break;
+        }
+        _start = pos;
+        _pkt_expected_seq = genExpectedSeq(_pkt_expected_seq + gap);
+        popContinuous(out);
     }
-    return true;
 }
 
 uint32_t PacketRecvQueue::timeLatency() {
     if (_size <= 0) {
         return 0;
     }
-
-    auto first = getFirst()->timestamp;
-    auto last = getLast()->timestamp;
-
-    uint32_t dur;
-    if (last > first) {
-        dur = last - first;
-    } else {
-        dur = first - last;
-    }
-
-    if (dur > 0x80000000) {
-        dur = MAX_TS - dur;
-        WarnL << "cycle dur " << dur;
-    }
-
-    return dur;
+    return tsDistance(getFirst()->timestamp, getLast()->timestamp);
 }
-std::list<PacketQueueInterface::LostPair> PacketRecvQueue::getLostSeq() {
-    std::list<PacketQueueInterface::LostPair> re;
+
+void PacketRecvQueue::getLostSeq(LostList &re) {
+    re.clear();
     if (_size <= 0) {
-        return re;
+        return;
     }
 
     if (getExpectedSize() == getSize()) {
-        return re;
+        return;
     }
 
     LostPair lost;
@@ -324,7 +334,7 @@ std::list<PacketQueueInterface::LostPair> PacketRecvQueue::getLostSeq() {
         if (!_pkt_buf[i]) {
             if (finish) {
                 finish = false;
-                lost.first = _pkt_expected_seq + steup;
+                lost.first = genExpectedSeq(_pkt_expected_seq + steup);
                 lost.second = genExpectedSeq(lost.first + 1);
             } else {
                 lost.second = genExpectedSeq(_pkt_expected_seq + steup + 1);
@@ -338,7 +348,6 @@ std::list<PacketQueueInterface::LostPair> PacketRecvQueue::getLostSeq() {
         i = (i + 1) % _pkt_cap;
         steup++;
     }
-    return re;
 }
 
 size_t PacketRecvQueue::getSize() {
@@ -362,7 +371,9 @@ size_t PacketRecvQueue::getExpectedSize() {
     if ((max - min) >= (MAX_SEQ >> 1)) {
         TraceL << "cycle "
                << "expected seq " << _pkt_expected_seq << " min " << min << " max " << max << " size " << _size;
-        return MAX_SEQ - _pkt_expected_seq + min + 1;
+        // seq取值范围为[0, MAX_SEQ]，回环时需要加上0这个seq
+        // The seq range is [0, MAX_SEQ], seq 0 must be counted when wrapping around
+        return MAX_SEQ - _pkt_expected_seq + min + 2;
     } else {
         return max - _pkt_expected_seq + 1;
     }
@@ -397,11 +408,11 @@ std::string PacketRecvQueue::dump() {
     }
     return printer;
 }
-bool PacketRecvQueue::drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out) {
+bool PacketRecvQueue::drop(uint32_t first, uint32_t last, PacketList &out) {
     uint32_t diff = 0;
     if (isSeqCycle(_pkt_expected_seq, last)) {
         if (last < _pkt_expected_seq) {
-            diff = MAX_SEQ - _pkt_expected_seq + last + 1;
+            diff = MAX_SEQ - _pkt_expected_seq + last + 2;
         } else {
             WarnL << "drop first " << first << " last " << last << " expected " << _pkt_expected_seq;
             return false;
@@ -422,8 +433,7 @@ bool PacketRecvQueue::drop(uint32_t first, uint32_t last, std::list<DataPacket::
     for (uint32_t i = 0; i < diff; i++) {
         auto pos = (i + _start) % _pkt_cap;
         if (_pkt_buf[pos]) {
-            out.push_back(_pkt_buf[pos]);
-            _pkt_buf[pos] = nullptr;
+            out.emplace_back(std::move(_pkt_buf[pos]));
             _size--;
         }
     }
@@ -446,7 +456,7 @@ void PacketRecvQueue::insertToCycleBuf(DataPacket::Ptr pkt, uint32_t diff) {
         // WarnL << "repate packet " << pkt->packet_seq_number;
         return;
     }
-    _pkt_buf[pos] = pkt;
+    _pkt_buf[pos] = std::move(pkt);
 
     if (_start <= _end && pos >= _end) {
         _end = (pos + 1) % _pkt_cap;
@@ -478,12 +488,12 @@ void PacketRecvQueue::tryInsertPkt(DataPacket::Ptr pkt) {
                 return;
             }
 
-            insertToCycleBuf(pkt, diff);
+            insertToCycleBuf(std::move(pkt), diff);
         }
     } else {
         auto diff = _pkt_expected_seq - pkt->packet_seq_number;
         if (diff >= (MAX_SEQ >> 1)) {
-            diff = MAX_SEQ - diff;
+            diff = MAX_SEQ - diff + 1;
             if (diff >= _pkt_cap) {
                 WarnL << "too new "
                       << "expected seq=" << _pkt_expected_seq << " pkt seq=" << pkt->packet_seq_number << " cap "
@@ -15,13 +15,21 @@ class PacketQueueInterface {
 public:
     using Ptr = std::shared_ptr<PacketQueueInterface>;
     using LostPair = std::pair<uint32_t, uint32_t>;
+    // 输出容器由调用者复用，避免每个包都分配内存
+    // The output containers are reused by the caller to avoid allocating memory for every packet
+    using LostList = std::vector<LostPair>;
+    using PacketList = std::vector<DataPacket::Ptr>;
 
     PacketQueueInterface() = default;
     virtual ~PacketQueueInterface() = default;
-    virtual bool inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out) = 0;
+    virtual bool inputPacket(DataPacket::Ptr pkt, PacketList &out) = 0;
 
     virtual uint32_t timeLatency() = 0;
-    virtual std::list<LostPair> getLostSeq() = 0;
+    /**
+     * 获取丢包列表，out会被先清空
+     * Get the lost list, out will be cleared first
+     */
+    virtual void getLostSeq(LostList &out) = 0;
 
     virtual size_t getSize() = 0;
     virtual size_t getExpectedSize() = 0;
@@ -29,7 +37,7 @@ public:
     virtual uint32_t getExpectedSeq() = 0;
 
     virtual std::string dump() = 0;
-    virtual bool drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out) = 0;
+    virtual bool drop(uint32_t first, uint32_t last, PacketList &out) = 0;
 };
 // for recv
 class PacketQueue : public PacketQueueInterface {
@@ -38,10 +46,10 @@ public:
 
     PacketQueue(uint32_t max_size, uint32_t init_seq, uint32_t latency);
     ~PacketQueue() = default;
-    bool inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out);
+    bool inputPacket(DataPacket::Ptr pkt, PacketList &out);
 
     uint32_t timeLatency();
-    std::list<LostPair> getLostSeq();
+    void getLostSeq(LostList &out);
 
     size_t getSize();
     size_t getExpectedSize();
@@ -49,7 +57,7 @@ public:
     uint32_t getExpectedSeq();
 
     std::string dump();
-    bool drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out);
+    bool drop(uint32_t first, uint32_t last, PacketList &out);
 
 private:
     void tryInsertPkt(DataPacket::Ptr pkt);
@@ -67,10 +75,10 @@ public:
 
     PacketRecvQueue(uint32_t max_size, uint32_t init_seq, uint32_t latency,uint32_t flag = 0xbf);
     ~PacketRecvQueue() = default;
-    bool inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out);
+    bool inputPacket(DataPacket::Ptr pkt, PacketList &out);
 
     uint32_t timeLatency();
-    std::list<LostPair> getLostSeq();
+    void getLostSeq(LostList &out);
 
     size_t getSize();
     size_t getExpectedSize();
@@ -78,11 +86,13 @@ public:
     uint32_t getExpectedSeq();
 
     std::string dump();
-    bool drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out);
+    bool drop(uint32_t first, uint32_t last, PacketList &out);
 
 private:
     void tryInsertPkt(DataPacket::Ptr pkt);
     void insertToCycleBuf(DataPacket::Ptr pkt, uint32_t diff);
+    void popContinuous(PacketList &out);
+    void releaseExpired(PacketList &out);
     DataPacket::Ptr getFirst();
     DataPacket::Ptr getLast();
     bool TLPKTDrop();
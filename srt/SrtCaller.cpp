@@ -392,7 +392,7 @@ void SrtCaller::sendACKPacket() {
         pkt->available_buf_size = 2;
     }
     pkt->storeToData();
-    _ack_send_timestamp[pkt->ack_number] = _now;
+    _ack_send_timestamp.add(pkt->ack_number, _now);
     _last_ack_pkt_seq = pkt->last_ack_pkt_seq_number;
     sendControlPacket(pkt, true);
     // TraceL<<"send  ack "<<pkt->dump();
@@ -419,9 +419,8 @@ void SrtCaller::sendLightACKPacket() {
     return;
 }
 
-void SrtCaller::sendNAKPacket(std::list<SRT::PacketQueue::LostPair> &lost_list) {
+void SrtCaller::sendNAKPacket(const SRT::PacketQueueInterface::LostList &lost_list) {
     SRT::NAKPacket::Ptr pkt = std::make_shared<SRT::NAKPacket>();
-    std::list<SRT::PacketQueue::LostPair> tmp;
     auto size = SRT::NAKPacket::getCIFSize(lost_list);
     size_t paylaod_size = getPayloadSize();
     if (size > paylaod_size) {
@@ -440,10 +439,9 @@ void SrtCaller::sendNAKPacket(std::list<SRT::PacketQueue::LostPair> &lost_list)
                 next = lost_list.begin();
                 std::advance(next, (i + 1) * num);
             }
-            tmp.assign(cur, next);
             pkt->dst_socket_id = _peer_socket_id;
             pkt->timestamp = DurationCountMicroseconds(_now - _start_timestamp);
-            pkt->lost_list = tmp;
+            pkt->lost_list.assign(cur, next);
             pkt->storeToData();
             sendControlPacket(pkt, true);
         }
@@ -735,12 +733,12 @@ void SrtCaller::handleACKACK(uint8_t *buf, int len, struct sockaddr *addr) {
     ACKACKPacket::Ptr pkt = std::make_shared<ACKACKPacket>();
     pkt->loadFromData(buf, len);
 
-    if(_ack_send_timestamp.find(pkt->ack_number) != _ack_send_timestamp.end()){
-        uint32_t rtt = DurationCountMicroseconds(_now - _ack_send_timestamp[pkt->ack_number]);
+    TimePoint send_time;
+    if(_ack_send_timestamp.pop(pkt->ack_number, send_time)){
+        uint32_t rtt = DurationCountMicroseconds(_now - send_time);
         _rtt_variance = (3 * _rtt_variance + abs((long)_rtt - (long)rtt)) / 4;
         _rtt = (7 * rtt + _rtt) / 8;
         // TraceL<<" rtt:"<<_rtt<<" rtt variance:"<<_rtt_variance;
-        _ack_send_timestamp.erase(pkt->ack_number);
 
         if(_last_recv_ackack_seq_num < pkt->ack_number){
             _last_recv_ackack_seq_num = pkt->ack_number;
@@ -749,19 +747,6 @@ void SrtCaller::handleACKACK(uint8_t *buf, int len, struct sockaddr *addr) {
                 _last_recv_ackack_seq_num = pkt->ack_number;
             }
         }
-
-        if(_ack_send_timestamp.size()>1000){
-            // clear data
-            for(auto it = _ack_send_timestamp.begin(); it != _ack_send_timestamp.end();){
-                if(DurationCountMicroseconds(_now-it->second)>5e6){
-                    // 超过五秒没有ackack 丢弃
-                    it = _ack_send_timestamp.erase(it);
-                }else{
-                    it++;
-                }
-            }
-        }
-
     }
     return;
 }
@@ -813,22 +798,10 @@ void SrtCaller::handleDropReq(uint8_t *buf, int len, struct sockaddr *addr) {
 
     MsgDropReqPacket pkt;
     pkt.loadFromData(buf, len);
-    std::list<DataPacket::Ptr> list;
     // TraceL<<"drop "<<pkt.first_pkt_seq_num<<" last "<<pkt.last_pkt_seq_num;
-    _recv_buf->drop(pkt.first_pkt_seq_num, pkt.last_pkt_seq_num, list);
+    _recv_buf->drop(pkt.first_pkt_seq_num, pkt.last_pkt_seq_num, _recv_pkt_list);
     //checkAndSendAckNak();
-    if (list.empty()) {
-        return;
-    }
-    // uint32_t max_seq = 0;
-    for (auto& data : list) {
-        // max_seq = data->packet_seq_number;
-        if (_last_pkt_seq + 1 != data->packet_seq_number) {
-            TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
-        }
-        _last_pkt_seq = data->packet_seq_number;
-        onSRTData(std::move(data));
-    }
+    deliverRecvPackets();
     return;
 }
 
@@ -919,16 +892,20 @@ void SrtCaller::handleDataPacket(uint8_t *buf, int len, struct sockaddr *addr) {
 
     _estimated_link_capacity_context->inputPacket(_now, pkt);
 
-    std::list<DataPacket::Ptr> list;
-    _recv_buf->inputPacket(pkt, list);
-    for (auto& data : list) {
+    _recv_buf->inputPacket(std::move(pkt), _recv_pkt_list);
+    deliverRecvPackets();
+    return;
+}
+
+void SrtCaller::deliverRecvPackets() {
+    for (auto &data : _recv_pkt_list) {
         if (_last_pkt_seq + 1 != data->packet_seq_number) {
             TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
         }
         _last_pkt_seq = data->packet_seq_number;
         onSRTData(std::move(data));
     }
-    return;
+    _recv_pkt_list.clear();
 }
 
 void SrtCaller::checkAndSendAckNak() {
@@ -939,9 +916,9 @@ void SrtCaller::checkAndSendAckNak() {
         nak_interval = 20 * 1000;
     }
     if (_nak_ticker.elapsedTime(_now) > nak_interval) {
-        auto lost = _recv_buf->getLostSeq();
-        if (!lost.empty()) {
-            sendNAKPacket(lost);
+        _recv_buf->getLostSeq(_lost_list);
+        if (!_lost_list.empty()) {
+            sendNAKPacket(_lost_list);
         }
         _nak_ticker.resetTime(_now);
     }
@@ -13,6 +13,7 @@
 
 //srt
 #include "srt/Packet.hpp"
+#include "srt/Ack.hpp"
 #include "srt/Crypto.hpp"
 #include "srt/PacketQueue.hpp"
 #include "srt/PacketSendQueue.hpp"
@@ -90,7 +91,7 @@ private:
     void sendHandshakeConclusion();
     void sendACKPacket();
     void sendLightACKPacket();
-    void sendNAKPacket(std::list<SRT::PacketQueue::LostPair> &lost_list);
+    void sendNAKPacket(const SRT::PacketQueueInterface::LostList &lost_list);
     void sendMsgDropReq(uint32_t first, uint32_t last);
     void sendKeepLivePacket();
     void sendShutDown();
@@ -116,6 +117,7 @@ private:
     void handleKeyMaterialRspPacket(uint8_t *buf, int len, struct sockaddr *addr);
 
     void checkAndSendAckNak();
+    void deliverRecvPackets();
     void createTimerForCheckAlive();
 
     std::string generateStreamId();
@@ -169,6 +171,8 @@ private:
 
     // for recv
     SRT::PacketQueueInterface::Ptr _recv_buf;
+    SRT::PacketQueueInterface::PacketList _recv_pkt_list;
+    SRT::PacketQueueInterface::LostList _lost_list;
     uint32_t _last_pkt_seq = 0;
 
     // Ack
@@ -176,7 +180,7 @@ private:
     uint32_t _last_ack_pkt_seq    = 0;
     uint32_t _light_ack_pkt_count = 0;
     uint32_t _ack_number_count    = 0;
-    std::map<uint32_t, TimePoint> _ack_send_timestamp;
+    SRT::ACKHistory _ack_send_timestamp;
     // Full Ack
     // Link Capacity and Receiving Rate Estimation
     std::shared_ptr<SRT::PacketRecvRateContext> _pkt_recv_rate_context;
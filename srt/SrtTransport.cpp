@@ -472,22 +472,10 @@ void SrtTransport::handleShutDown(uint8_t *buf, int len, struct sockaddr_storage
 void SrtTransport::handleDropReq(uint8_t *buf, int len, struct sockaddr_storage *addr) {
     MsgDropReqPacket pkt;
     pkt.loadFromData(buf, len);
-    std::list<DataPacket::Ptr> list;
     // TraceL<<"drop "<<pkt.first_pkt_seq_num<<" last "<<pkt.last_pkt_seq_num;
-    _recv_buf->drop(pkt.first_pkt_seq_num, pkt.last_pkt_seq_num, list);
+    _recv_buf->drop(pkt.first_pkt_seq_num, pkt.last_pkt_seq_num, _recv_pkt_list);
     //checkAndSendAckNak();
-    if (list.empty()) {
-        return;
-    }
-    // uint32_t max_seq = 0;
-    for (auto& data : list) {
-        // max_seq = data->packet_seq_number;
-        if (_last_pkt_seq + 1 != data->packet_seq_number) {
-            TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
-        }
-        _last_pkt_seq = data->packet_seq_number;
-        onSRTData(std::move(data));
-    }
+    deliverRecvPackets();
     /*
     _recv_nack.drop(max_seq);
 
@@ -509,9 +497,9 @@ void SrtTransport::checkAndSendAckNak(){
         nak_interval = 20 * 1000;
     }
     if (_nak_ticker.elapsedTime(_now) > nak_interval) {
-        auto lost = _recv_buf->getLostSeq();
-        if (!lost.empty()) {
-            sendNAKPacket(lost);
+        _recv_buf->getLostSeq(_lost_list);
+        if (!_lost_list.empty()) {
+            sendNAKPacket(_lost_list);
         }
         _nak_ticker.resetTime(_now);
     }
@@ -592,12 +580,12 @@ void SrtTransport::handleACKACK(uint8_t *buf, int len, struct sockaddr_storage *
     ACKACKPacket::Ptr pkt = std::make_shared<ACKACKPacket>();
     pkt->loadFromData(buf, len);
 
-    if(_ack_send_timestamp.find(pkt->ack_number)!=_ack_send_timestamp.end()){
-        uint32_t rtt = DurationCountMicroseconds(_now - _ack_send_timestamp[pkt->ack_number]);
+    TimePoint send_time;
+    if(_ack_send_timestamp.pop(pkt->ack_number, send_time)){
+        uint32_t rtt = DurationCountMicroseconds(_now - send_time);
         _rtt_variance = (3 * _rtt_variance + abs((long)_rtt - (long)rtt)) / 4;
         _rtt = (7 * rtt + _rtt) / 8;
         // TraceL<<" rtt:"<<_rtt<<" rtt variance:"<<_rtt_variance;
-        _ack_send_timestamp.erase(pkt->ack_number);
 
         if(_last_recv_ackack_seq_num < pkt->ack_number){
             _last_recv_ackack_seq_num = pkt->ack_number;
@@ -606,20 +594,6 @@ void SrtTransport::handleACKACK(uint8_t *buf, int len, struct sockaddr_storage *
                 _last_recv_ackack_seq_num = pkt->ack_number;
             }
         }
-
-        if(_ack_send_timestamp.size()>1000){
-            // clear data
-            for(auto it = _ack_send_timestamp.begin(); it != _ack_send_timestamp.end();){
-                if(DurationCountMicroseconds(_now-it->second)>5e6){
-                    // 超过五秒没有ackack 丢弃  [AUTO-TRANSLATED:9626442f]
-                    // Discard if no ACK for more than five seconds
-                    it = _ack_send_timestamp.erase(it);
-                }else{
-                    it++;
-                }
-            }
-        }
-
     }
 }
 
@@ -653,7 +627,7 @@ void SrtTransport::sendACKPacket() {
         pkt->available_buf_size = 2;
     }
     pkt->storeToData();
-    _ack_send_timestamp[pkt->ack_number] = _now;
+    _ack_send_timestamp.add(pkt->ack_number, _now);
     _last_ack_pkt_seq = pkt->last_ack_pkt_seq_number;
     sendControlPacket(pkt, true);
     // TraceL<<"send  ack "<<pkt->dump();
@@ -679,9 +653,8 @@ void SrtTransport::sendLightACKPacket() {
     TraceL << "send  ack " << pkt->dump();
 }
 
-void SrtTransport::sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list) {
+void SrtTransport::sendNAKPacket(const PacketQueueInterface::LostList &lost_list) {
     NAKPacket::Ptr pkt = std::make_shared<NAKPacket>();
-    std::list<PacketQueue::LostPair> tmp;
     auto size = NAKPacket::getCIFSize(lost_list);
     size_t paylaod_size = getPayloadSize();
     if (size > paylaod_size) {
@@ -700,10 +673,9 @@ void SrtTransport::sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list) {
                 next = lost_list.begin();
                 std::advance(next, (i + 1) * num);
             }
-            tmp.assign(cur, next);
             pkt->dst_socket_id = _peer_socket_id;
             pkt->timestamp = DurationCountMicroseconds(_now - _start_timestamp);
-            pkt->lost_list = tmp;
+            pkt->lost_list.assign(cur, next);
             pkt->storeToData();
             sendControlPacket(pkt, true);
         }
@@ -762,25 +734,10 @@ void SrtTransport::handleDataPacket(uint8_t *buf, int len, struct sockaddr_stora
 
     _estimated_link_capacity_context->inputPacket(_now,pkt);
 
-    std::list<DataPacket::Ptr> list;
     //TraceL<<" seq="<< pkt->packet_seq_number<<" ts="<<pkt->timestamp<<" size="<<pkt->payloadSize()<<\
     //" PP="<<(int)pkt->PP<<" O="<<(int)pkt->O<<" kK="<<(int)pkt->KK<<" R="<<(int)pkt->R;
-    _recv_buf->inputPacket(pkt, list);
-    if (list.empty()) {
-        // when no data ok send nack to sender immediately
-    } else {
-        // uint32_t last_seq;
-        for (auto& data : list) {
-            // last_seq = data->packet_seq_number;
-            if (_last_pkt_seq + 1 != data->packet_seq_number) {
-                TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
-            }
-            _last_pkt_seq = data->packet_seq_number;
-            onSRTData(std::move(data));
-        }
-
-        //_recv_nack.drop(last_seq);
-    }
+    _recv_buf->inputPacket(std::move(pkt), _recv_pkt_list);
+    deliverRecvPackets();
     /*
     auto lost = _recv_buf->getLostSeq();
     _recv_nack.update(_now, lost);
@@ -828,6 +785,28 @@ void SrtTransport::handleDataPacket(uint8_t *buf, int len, struct sockaddr_stora
     // bufCheckInterval();
 }
 
+void SrtTransport::deliverRecvPackets() {
+    if (_recv_pkt_list.empty()) {
+        return;
+    }
+    for (auto &data : _recv_pkt_list) {
+        if (_last_pkt_seq + 1 != data->packet_seq_number) {
+            TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
+        }
+        _last_pkt_seq = data->packet_seq_number;
+    }
+    onSRTDataList(_recv_pkt_list);
+    // 保留容量供下次复用
+    // Keep the capacity for next reuse
+    _recv_pkt_list.clear();
+}
+
+void SrtTransport::onSRTDataList(PacketQueueInterface::PacketList &pkts) {
+    for (auto &data : pkts) {
+        onSRTData(std::move(data));
+    }
+}
+
 void SrtTransport::sendDataPacket(DataPacket::Ptr pkt, char *buf, int len, bool flush) {
     auto data = buf;
     auto size = len;
@@ -11,6 +11,7 @@
 #include "Poller/Timer.h"
 #include "Common/Stamp.h"
 #include "Common.hpp"
+#include "Ack.hpp"
 #include "NackContext.hpp"
 #include "Packet.hpp"
 #include "Crypto.hpp"
@@ -54,6 +55,11 @@ public:
 protected:
     virtual bool isPusher() { return true; };
     virtual void onSRTData(DataPacket::Ptr pkt) {};
+    /**
+     * 批量交付本次收到的按序数据包，默认逐个调用onSRTData
+     * Deliver the in-order data packets received this time in batch, onSRTData is called one by one by default
+     */
+    virtual void onSRTDataList(PacketQueueInterface::PacketList &pkts);
     virtual void onShutdown(const SockException &ex);
     virtual void onHandShakeFinished(std::string &streamid, struct sockaddr_storage *addr) {
         _is_handleshake_finished = true;
@@ -87,7 +93,7 @@ private:
     void handlePeerError(uint8_t *buf, int len, struct sockaddr_storage *addr);
     void handleDataPacket(uint8_t *buf, int len, struct sockaddr_storage *addr);
 
-    void sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list);
+    void sendNAKPacket(const PacketQueueInterface::LostList &lost_list);
     void sendACKPacket();
     void sendRejectPacket(SRT_REJECT_REASON reason, struct sockaddr_storage *addr);
     void sendLightACKPacket();
@@ -101,6 +107,7 @@ private:
     void createTimerForCheckAlive();
 
     void checkAndSendAckNak();
+    void deliverRecvPackets();
 
 protected:
     void sendDataPacket(DataPacket::Ptr pkt, char *buf, int len, bool flush = false);
@@ -135,6 +142,10 @@ private:
     PacketSendQueue::Ptr _send_buf;
     uint32_t _buf_delay = 120;
     PacketQueueInterface::Ptr _recv_buf;
+    // 接收队列输出的数据包与丢包列表，复用以避免频繁分配内存
+    // The data packets and lost list output by the receive queue, reused to avoid frequent memory allocation
+    PacketQueueInterface::PacketList _recv_pkt_list;
+    PacketQueueInterface::LostList _lost_list;
     // NackContext _recv_nack;
     uint32_t _rtt = 100 * 1000;
     uint32_t _rtt_variance = 50 * 1000;
@@ -145,7 +156,7 @@ private:
 
     uint32_t _last_pkt_seq = 0;
     UTicker _ack_ticker;
-    std::map<uint32_t, TimePoint> _ack_send_timestamp;
+    ACKHistory _ack_send_timestamp;
 
     std::shared_ptr<PacketRecvRateContext> _pkt_recv_rate_context;
     std::shared_ptr<EstimatedLinkCapacityContext> _estimated_link_capacity_context;
@@ -124,16 +124,39 @@ bool SrtTransportImp::parseStreamid(std::string &streamid) {
     return true;
 }
 
-void SrtTransportImp::onSRTData(DataPacket::Ptr pkt) {
+bool SrtTransportImp::canInputData() {
     if (!_is_pusher) {
         WarnP(this) << "this is a player data ignore";
-        return;
+        return false;
     }
-    if (_decoder) {
-        _decoder->input(reinterpret_cast<const uint8_t *>(pkt->payloadData()), pkt->payloadSize());
-        //TraceL<<" size "<<pkt->payloadSize();
-    } else {
+    if (!_decoder) {
         WarnP(this) << " not reach this";
+        return false;
+    }
+    return true;
+}
+
+void SrtTransportImp::inputData(const DataPacket::Ptr &pkt) {
+    _decoder->input(reinterpret_cast<const uint8_t *>(pkt->payloadData()), pkt->payloadSize());
+    //TraceL<<" size "<<pkt->payloadSize();
+}
+
+void SrtTransportImp::onSRTData(DataPacket::Ptr pkt) {
+    if (canInputData()) {
+        inputData(pkt);
+    }
+}
+
+void SrtTransportImp::onSRTDataList(PacketQueueInterface::PacketList &pkts) {
+    // 整批只检查一次，但仍逐包送入解复用器：ts解复用器本身按188字节逐个解析，
+    // 拼接成连续内存再输入只会多一次拷贝
+    // Check only once for the whole batch, but still feed the demuxer packet by packet: the ts demuxer parses 188 bytes at a time itself,
+    // concatenating into contiguous memory before input would only add one more copy
+    if (!canInputData()) {
+        return;
+    }
+    for (auto &pkt : pkts) {
+        inputData(pkt);
     }
 }
 
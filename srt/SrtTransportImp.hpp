@@ -40,6 +40,7 @@ protected:
     float getTimeOutSec() override;
     std::string getPassphrase() override;
     void onSRTData(DataPacket::Ptr pkt) override;
+    void onSRTDataList(PacketQueueInterface::PacketList &pkts) override;
     void onShutdown(const SockException &ex) override;
     void onHandShakeFinished(std::string &streamid, struct sockaddr_storage *addr) override;
 
@@ -74,6 +75,11 @@ private:
     void doPlay();
     void doCachedFunc();
 
+    // 检查是否可以输入推流数据
+    // Check whether the pushed data can be input
+    bool canInputData();
+    void inputData(const DataPacket::Ptr &pkt);
+
 private:
     bool _is_pusher = true;
     MediaInfo _media_info;
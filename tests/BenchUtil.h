@@ -0,0 +1,111 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_BENCHUTIL_H
+#define ZLMEDIAKIT_BENCHUTIL_H
+
+// test_bench_*性能测试程序共用的计时、内存分配统计与命令行解析
+// Timing, memory allocation counting and command line parsing shared by the test_bench_* performance test programs
+
+#include <new>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <time.h>
+#include <sys/resource.h>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+
+static inline uint64_t nowNS() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 进程消耗的cpu时间(用户态+内核态)
+// CPU time consumed by the process (user mode + kernel mode)
+static inline uint64_t cpuNS() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000 + (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+// 本线程消耗的cpu时间
+// CPU time consumed by this thread
+static inline uint64_t threadCpuNS() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#if defined(BENCH_COUNT_ALLOC)
+// 统计本线程的内存分配次数(只统计operator new，c库内部的malloc不计入)
+// 替换了全局operator new，每个测试程序只能在一个源文件中定义BENCH_COUNT_ALLOC
+// Count the number of memory allocations of this thread (only operator new is counted, malloc inside the c library is not included)
+// The global operator new is replaced, each test program can only define BENCH_COUNT_ALLOC in one source file
+static thread_local uint64_t s_alloc_count = 0;
+
+void *operator new(size_t size) {
+    ++s_alloc_count;
+    if (auto ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+#endif // defined(BENCH_COUNT_ALLOC)
+
+/**
+ * 性能测试的命令行解析器，已经添加了日志等级选项，子类继续添加其他选项
+ * Command line parser of the performance test, the log level option has been added, subclasses continue to add other options
+ */
+class BenchCMD : public toolkit::CMD {
+public:
+    BenchCMD() {
+        _parser.reset(new toolkit::OptionParser(nullptr));
+        (*_parser) << toolkit::Option('l', "level", toolkit::Option::ArgRequired, std::to_string(toolkit::LWarn).data(), false,
+                                     "日志等级,LTrace~LError(0~4)", nullptr);
+    }
+};
+
+/**
+ * 解析命令行参数并按日志等级初始化日志
+ * Parse the command line arguments and initialize the log according to the log level
+ * @param ret 返回false时main函数的返回值
+ * @param ret Return value of the main function when false is returned
+ * @param async_log 是否使用异步日志，避免日志影响计时
+ * @param async_log Whether to use asynchronous logging, to avoid logging affecting the timing
+ * @return 是否继续运行，打印帮助或者参数错误时返回false
+ * @return Whether to continue running, false when printing help or the arguments are wrong
+ */
+static inline bool initBench(BenchCMD &cmd, int argc, char *argv[], int &ret, bool async_log = false) {
+    try {
+        cmd.operator()(argc, argv);
+    } catch (toolkit::ExitException &) {
+        ret = 0;
+        return false;
+    } catch (std::exception &ex) {
+        std::cout << ex.what() << std::endl;
+        ret = -1;
+        return false;
+    }
+    auto level = (toolkit::LogLevel)cmd["level"].as<int>();
+    level = MIN(MAX(level, toolkit::LTrace), toolkit::LError);
+    toolkit::Logger::Instance().add(std::make_shared<toolkit::ConsoleChannel>("ConsoleChannel", level));
+    if (async_log) {
+        toolkit::Logger::Instance().setWriter(std::make_shared<toolkit::AsyncLogWriter>());
+    }
+    return true;
+}
+
+#endif // ZLMEDIAKIT_BENCHUTIL_H
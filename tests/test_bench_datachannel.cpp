@@ -0,0 +1,191 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/EventPoller.h"
+#include "Rtsp/RtpCodec.h"
+#include "../webrtc/WebRtcPlayer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#ifdef ENABLE_SCTP
+
+// 内存中直连的一对sctp端点，模拟一个webrtc观看者的datachannel
+// A pair of sctp endpoints directly connected in memory, simulating the datachannel of a webrtc viewer
+class SctpPeer : public RTC::SctpAssociation::Listener {
+public:
+    SctpPeer(const EventPoller::Ptr &poller) : _poller(poller) {
+        _sctp = std::make_shared<RTC::SctpAssociationImp>(poller, this, 128, 128, 262144, true);
+        // 与WebRtcTransport相同的发送队列：预留发送缓存、批量交给sctp、发送缓存满时阻塞等待清空
+        // The same send queue as WebRtcTransport: reserve the send buffer, hand to sctp in batches, block until drained when the send buffer is full
+        _sender = std::make_shared<DatachannelSender>(poller, [this](const WebRtcDatachannelMessage &msg) {
+            if (!_connected) {
+                return false;
+            }
+            RTC::SctpStreamParameters params;
+            params.streamId = msg.stream_id;
+            return _sctp->SendSctpMessage(params, msg.ppid, (const uint8_t *)msg.data->data(), msg.data->size());
+        });
+    }
+
+    void setRemote(SctpPeer *remote) { _remote = remote; }
+    void start() { _sctp->TransportConnected(); }
+
+    void OnSctpAssociationConnecting(RTC::SctpAssociation *) override {}
+    void OnSctpAssociationConnected(RTC::SctpAssociation *) override {
+        _connected = true;
+        _sender->resume();
+    }
+    void OnSctpAssociationFailed(RTC::SctpAssociation *) override { WarnL << "sctp failed"; }
+    void OnSctpAssociationClosed(RTC::SctpAssociation *) override {}
+
+    void OnSctpAssociationSendData(RTC::SctpAssociation *, const uint8_t *data, size_t len) override {
+        // 异步投递，避免在usrsctp回调中重入
+        // Deliver asynchronously to avoid reentering in the usrsctp callback
+        auto remote = _remote;
+        std::string copy((const char *)data, len);
+        _poller->async([remote, copy]() { remote->_sctp->ProcessSctpData((const uint8_t *)copy.data(), copy.size()); }, false);
+    }
+
+    void OnSctpAssociationMessageReceived(RTC::SctpAssociation *, uint16_t, uint32_t, const uint8_t *, size_t len) override {
+        ++_recv_count;
+        _recv_bytes += len;
+    }
+
+    void OnSctpAssociationBufferedAmountLow(RTC::SctpAssociation *) override {
+        ++_drained;
+        _sender->resume();
+    }
+
+    // 与WebRtcPlayer相同的环形缓存消息处理
+    // The same ring buffer message handling as WebRtcPlayer
+    void attach(const RtspMediaSource::Ptr &src) {
+        _reader = src->getRing()->attach(_poller, false);
+        _reader->setMessageCB([this](const Any &data) {
+            if (!data.is<WebRtcDatachannelMessage>()) {
+                return;
+            }
+            auto &msg = data.get<WebRtcDatachannelMessage>();
+            if (_sender->send(msg.stream_id, msg.ppid, msg.data)) {
+                ++_accepted;
+            } else {
+                ++_blocked;
+            }
+        });
+    }
+
+public:
+    bool _connected = false;
+    uint64_t _accepted = 0;
+    uint64_t _recv_count = 0;
+    uint64_t _recv_bytes = 0;
+    uint64_t _blocked = 0;
+    uint64_t _drained = 0;
+    EventPoller::Ptr _poller;
+    SctpPeer *_remote = nullptr;
+    RTC::SctpAssociationImp::Ptr _sctp;
+    DatachannelSender::Ptr _sender;
+    RtspMediaSource::RingType::RingReader::Ptr _reader;
+};
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", LInfo));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t viewers = argc > 1 ? atoi(argv[1]) : 16;
+    size_t msg_size = argc > 2 ? atoi(argv[2]) : 512;
+    size_t seconds = argc > 3 ? atoi(argv[3]) : 5;
+
+    auto poller = EventPollerPool::Instance().getPoller();
+    // 输入一个rtp包以便创建环形缓存，广播消息经由该流的环形缓存扇出
+    // Input an rtp packet to create the ring buffer, broadcast messages are fanned out through the ring buffer of the stream
+    auto src = std::make_shared<RtspMediaSource>(MediaTuple { DEFAULT_VHOST, "bench", "datachannel", "" });
+    RtpInfo rtp_info(0, 1400, 8000, 0, 0, 0);
+    src->onWrite(rtp_info.makeRtp(TrackAudio, "a", 1, false, 0), true);
+
+    vector<std::shared_ptr<SctpPeer> > senders, receivers;
+    poller->sync([&]() {
+        for (size_t i = 0; i < viewers; ++i) {
+            auto sender = std::make_shared<SctpPeer>(poller);
+            auto receiver = std::make_shared<SctpPeer>(poller);
+            sender->setRemote(receiver.get());
+            receiver->setRemote(sender.get());
+            senders.emplace_back(sender);
+            receivers.emplace_back(receiver);
+            sender->attach(src);
+            sender->start();
+            receiver->start();
+        }
+    });
+
+    // 等待所有关联建立
+    // Wait for all associations to be established
+    for (int i = 0; i < 100; ++i) {
+        bool all_connected = true;
+        poller->sync([&]() {
+            for (auto &sender : senders) {
+                all_connected = all_connected && sender->_connected;
+            }
+        });
+        if (all_connected) {
+            break;
+        }
+        usleep(50 * 1000);
+    }
+
+    // 同一条消息通过WebRtcPlayer::broadcastDatachannel扇出给所有观看者，每批之后等待poller处理完，
+    // 发送缓存超过rtc.datachannel_max_buffer的观看者丢弃该消息(背压)
+    // Fan out the same message to all viewers through WebRtcPlayer::broadcastDatachannel, wait for the poller after each batch,
+    // viewers whose send buffer exceeds rtc.datachannel_max_buffer drop the message (backpressure)
+    Buffer::Ptr msg = std::make_shared<BufferLikeString>(string(msg_size, 'm'));
+    uint64_t broadcasts = 0;
+    Ticker ticker;
+    while (ticker.elapsedTime() < seconds * 1000) {
+        for (int i = 0; i < 64; ++i) {
+            WebRtcPlayer::broadcastDatachannel(src, 0, 51, msg);
+        }
+        broadcasts += 64;
+        poller->sync([]() {});
+    }
+    auto elapsed_ms = ticker.elapsedTime();
+    usleep(500 * 1000);
+
+    poller->sync([&]() {
+        uint64_t accepted = 0, recv_count = 0, recv_bytes = 0, blocked = 0, drained = 0;
+        for (size_t i = 0; i < viewers; ++i) {
+            accepted += senders[i]->_accepted;
+            recv_count += receivers[i]->_recv_count;
+            recv_bytes += receivers[i]->_recv_bytes;
+            blocked += senders[i]->_blocked;
+            drained += senders[i]->_drained;
+        }
+        InfoL << "viewers: " << viewers << ", message size: " << msg_size << ", elapsed: " << elapsed_ms << "ms";
+        InfoL << "broadcast: " << broadcasts << ", accepted: " << accepted << ", received: " << recv_count << ", backpressure drop: " << blocked
+              << ", drained count: " << drained;
+        InfoL << "throughput: " << recv_count * 1000.0 / elapsed_ms << " msg/s, "
+              << recv_bytes * 8.0 / 1024 / 1024 * 1000 / elapsed_ms << " Mbps"
+              << ", per viewer: " << recv_count * 1000.0 / elapsed_ms / viewers << " msg/s";
+        senders.clear();
+        receivers.clear();
+    });
+    sleep(1);
+    return 0;
+}
+
+#else
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_SCTP not defined" << endl;
+    return 0;
+}
+#endif // ENABLE_SCTP
@@ -0,0 +1,148 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+#include <iostream>
+#include <sys/uio.h>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/EventPoller.h"
+#include "Rtmp/FlvMuxer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+// 模拟一个http-flv观看者，flush时把缓存的buffer合并为一次writev(只统计，不真正写socket)
+// Simulate a http-flv viewer, merge the cached buffers into one writev when flushing (only count, do not really write to the socket)
+class FlvViewer : public FlvMuxer, public std::enable_shared_from_this<FlvViewer> {
+public:
+    using Ptr = std::shared_ptr<FlvViewer>;
+
+    void play(const EventPoller::Ptr &poller, const RtmpMediaSource::Ptr &src) { start(poller, src); }
+
+    void onWrite(const Buffer::Ptr &data, bool flush) override {
+        _pending.emplace_back(data);
+        if (!flush) {
+            return;
+        }
+        _iov.resize(_pending.size());
+        for (size_t i = 0; i < _pending.size(); ++i) {
+            _iov[i].iov_base = _pending[i]->data();
+            _iov[i].iov_len = _pending[i]->size();
+            _bytes += _iov[i].iov_len;
+        }
+        _iov_count += _iov.size();
+        ++_writev_count;
+        _pending.clear();
+    }
+
+    void onDetach() override {}
+    std::shared_ptr<FlvMuxer> getSharedPtr() override { return shared_from_this(); }
+
+public:
+    uint64_t _bytes = 0;
+    uint64_t _iov_count = 0;
+    uint64_t _writev_count = 0;
+
+private:
+    std::vector<Buffer::Ptr> _pending;
+    std::vector<struct iovec> _iov;
+};
+
+static RtmpPacket::Ptr makePacket(uint8_t type, uint32_t stamp, size_t size, bool key) {
+    auto pkt = RtmpPacket::create();
+    pkt->type_id = type;
+    pkt->time_stamp = stamp;
+    pkt->chunk_id = type == MSG_VIDEO ? CHUNK_VIDEO : CHUNK_AUDIO;
+    pkt->stream_index = STREAM_MEDIA;
+    pkt->buffer.assign(size, 'f');
+    if (type == MSG_VIDEO) {
+        // h264 nalu(非config帧)
+        // h264 nalu (not config frame)
+        pkt->buffer[0] = key ? 0x17 : 0x27;
+        pkt->buffer[1] = 0x01;
+    } else {
+        // aac raw(非config帧)
+        // aac raw (not config frame)
+        pkt->buffer[0] = (char)0xAF;
+        pkt->buffer[1] = 0x01;
+    }
+    pkt->body_size = pkt->buffer.size();
+    return pkt;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", LInfo));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t viewers = argc > 1 ? atoi(argv[1]) : 1000;
+    size_t seconds = argc > 2 ? atoi(argv[2]) : 30;
+    size_t kbps = argc > 3 ? atoi(argv[3]) : 4000;
+
+    // 25fps视频 + 约43fps aac音频(128kbps)，总码率约为kbps
+    // 25fps video + about 43fps aac audio (128kbps), the total bitrate is about kbps
+    static constexpr size_t kFps = 25;
+    static constexpr size_t kAudioKbps = 128;
+    static constexpr size_t kAudioFps = 43;
+    size_t video_size = (kbps > kAudioKbps ? kbps - kAudioKbps : kbps) * 1000 / 8 / kFps;
+    size_t audio_size = kAudioKbps * 1000 / 8 / kAudioFps;
+
+    // 所有观看者与数据源在同一个poller线程，耗时即为单核开销
+    // All viewers and the source are on the same poller thread, the time consumed is the single core overhead
+    auto poller = EventPollerPool::Instance().getPoller();
+    auto src = std::make_shared<RtmpMediaSource>(MediaTuple { DEFAULT_VHOST, "live", "bench_flv" });
+    vector<FlvViewer::Ptr> players;
+    poller->sync([&]() {
+        src->setMetaData(TitleMeta().getMetadata());
+        // 先写入一帧以创建环形缓存
+        // Write one frame first to create the ring buffer
+        src->onWrite(makePacket(MSG_VIDEO, 0, video_size, true));
+        for (size_t i = 0; i < viewers; ++i) {
+            auto player = std::make_shared<FlvViewer>();
+            player->play(poller, src);
+            players.emplace_back(std::move(player));
+        }
+    });
+
+    Ticker ticker;
+    size_t audio_index = 0;
+    for (size_t frame = 1; frame < seconds * kFps; ++frame) {
+        poller->sync([&]() {
+            uint32_t stamp = (uint32_t)(frame * 1000 / kFps);
+            src->onWrite(makePacket(MSG_VIDEO, stamp, video_size, frame % (2 * kFps) == 0));
+            for (; audio_index * 1000 / kAudioFps <= stamp; ++audio_index) {
+                src->onWrite(makePacket(MSG_AUDIO, (uint32_t)(audio_index * 1000 / kAudioFps), audio_size, false));
+            }
+        });
+    }
+    // 等待环形缓存分发完毕
+    // Wait for the ring buffer to finish dispatching
+    poller->sync([]() {});
+    poller->sync([]() {});
+    auto elapsed_ms = ticker.elapsedTime();
+
+    poller->sync([&]() {
+        uint64_t bytes = 0, iov_count = 0, writev_count = 0;
+        for (auto &player : players) {
+            bytes += player->_bytes;
+            iov_count += player->_iov_count;
+            writev_count += player->_writev_count;
+        }
+        InfoL << "viewers: " << viewers << ", stream: " << seconds << "s@" << kbps << "kbps, elapsed: " << elapsed_ms << "ms";
+        InfoL << "sent: " << bytes / 1024 / 1024 << "MB, writev count: " << writev_count
+              << ", iovec per writev: " << (writev_count ? iov_count * 1.0 / writev_count : 0);
+        InfoL << "cpu per viewer: " << elapsed_ms * 1000.0 / viewers / seconds << "us/s"
+              << ", viewers per core: " << (elapsed_ms ? viewers * seconds * 1000.0 / elapsed_ms : 0);
+        players.clear();
+    });
+    sleep(1);
+    return 0;
+}
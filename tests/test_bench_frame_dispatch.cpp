@@ -0,0 +1,180 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include <vector>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Poller/EventPoller.h"
+#include "Common/config.h"
+#include "Common/MultiMediaSourceMuxer.h"
+#include "Extension/Factory.h"
+
+// 统计内存分配次数
+// Count memory allocations
+#define BENCH_COUNT_ALLOC
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public BenchCMD {
+public:
+    CMD_main() {
+        (*_parser) << Option('s', "seconds", Option::ArgRequired, "60", false, "生成的h264流时长(秒)", nullptr);
+        (*_parser) << Option('m', "mp4", Option::ArgNone, nullptr, false, "是否开启mp4录制(写磁盘)", nullptr);
+    }
+
+    const char *description() const override {
+        return "开启全部协议复用时，统计每帧从MultiMediaSourceMuxer分发到各复用器的耗时与内存分配次数";
+    }
+};
+
+struct H264Nalu {
+    string data;
+    uint64_t stamp;
+};
+
+// 25fps，gop 50，约2Mbps，每个关键帧前带sps与pps
+// 25fps, gop 50, about 2Mbps, sps and pps before each key frame
+static vector<H264Nalu> makeStream(size_t seconds) {
+    static const uint8_t s_sps[] = { 0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x50, 0x05, 0xBB, 0x01, 0x10, 0x00,
+                                     0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0x20, 0xF1, 0x83, 0x19, 0x60 };
+    static const uint8_t s_pps[] = { 0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0 };
+
+    std::mt19937 rng(0);
+    vector<H264Nalu> ret;
+    for (size_t i = 0; i < seconds * 25; ++i) {
+        uint64_t stamp = i * 40;
+        bool key = i % 50 == 0;
+        if (key) {
+            ret.emplace_back(H264Nalu { string((const char *)s_sps, sizeof(s_sps)), stamp });
+            ret.emplace_back(H264Nalu { string((const char *)s_pps, sizeof(s_pps)), stamp });
+        }
+        string frame { 0, 0, 0, 1, (char)(key ? 0x65 : 0x41) };
+        auto header_size = frame.size();
+        frame.resize(key ? 60000 : 9000 + rng() % 2000);
+        for (auto pos = header_size; pos < frame.size(); ++pos) {
+            // 负载中不出现起始码
+            // No start code in the payload
+            frame[pos] = (char)(0x11 + rng() % 0xE0);
+        }
+        ret.emplace_back(H264Nalu { std::move(frame), stamp });
+    }
+    return ret;
+}
+
+struct DispatchStats {
+    uint64_t frames = 0;
+    uint64_t ns = 0;
+    uint64_t allocs = 0;
+};
+
+// cache_able为false时模拟ps/ts解复用输出的借用帧，为true时模拟rtsp/rtmp解包输出的自带缓存的帧
+// When cache_able is false, simulate the borrowed frames output by ps/ts demuxing, when it is true, simulate the frames with their own cache output by rtsp/rtmp depacketizing
+static DispatchStats runCase(const vector<H264Nalu> &stream, const ProtocolOption &option, bool cache_able, size_t index) {
+    DispatchStats stats;
+    MediaTuple tuple { DEFAULT_VHOST, "bench", StrPrinter << "frame_dispatch_" << index, "" };
+    auto muxer = std::make_shared<MultiMediaSourceMuxer>(tuple, 0.0f, option);
+    muxer->addTrack(Factory::getTrackByCodecId(CodecH264));
+    muxer->addTrackCompleted();
+
+    vector<Buffer::Ptr> buffers;
+    if (cache_able) {
+        for (auto &nalu : stream) {
+            buffers.emplace_back(std::make_shared<BufferLikeString>(nalu.data));
+        }
+    }
+    for (size_t i = 0; i < stream.size(); ++i) {
+        auto &nalu = stream[i];
+        auto allocs = s_alloc_count;
+        auto start = nowNS();
+        auto frame = cache_able ? Factory::getFrameFromBuffer(CodecH264, buffers[i], nalu.stamp, nalu.stamp)
+                                : Factory::getFrameFromPtr(CodecH264, nalu.data.data(), nalu.data.size(), nalu.stamp, nalu.stamp);
+        muxer->inputFrame(frame);
+        frame = nullptr;
+        stats.ns += nowNS() - start;
+        stats.allocs += s_alloc_count - allocs;
+        ++stats.frames;
+    }
+    muxer->flush();
+    return stats;
+}
+
+// 帧在推流poller创建，在其他poller释放，与跨poller扇出一致；统计创建线程的内存分配次数，验证帧内存块能回到创建线程复用
+// Frames are created in the push stream poller and released in another poller, consistent with cross-poller fan-out; count the memory allocations of the creating thread to verify that frame blocks can be reused by the creating thread
+static DispatchStats runCrossPoller(const vector<H264Nalu> &stream, const EventPoller::Ptr &producer, const EventPoller::Ptr &consumer) {
+    DispatchStats stats;
+    producer->sync([&]() {
+        for (auto &nalu : stream) {
+            auto allocs = s_alloc_count;
+            auto start = nowNS();
+            auto frame = Factory::getFrameFromPtr(CodecH264, nalu.data.data(), nalu.data.size(), nalu.stamp, nalu.stamp);
+            auto cache = Frame::getCacheAbleFrame(frame);
+            stats.ns += nowNS() - start;
+            stats.allocs += s_alloc_count - allocs;
+            ++stats.frames;
+            // 投递任务本身的分配不计入
+            // The allocation of the posted task itself is not counted
+            consumer->async([cache]() mutable { cache = nullptr; });
+        }
+    });
+    consumer->sync([]() {});
+    return stats;
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    int ret = 0;
+    if (!initBench(cmd_main, argc, argv, ret, true)) {
+        return ret;
+    }
+
+    auto stream = makeStream(MAX(cmd_main["seconds"].as<int>(), 1));
+
+    // 开启全部协议复用且不按需复用
+    // Enable all protocol muxing without on-demand muxing
+    ProtocolOption option;
+    option.enable_rtsp = option.enable_rtmp = option.enable_ts = option.enable_fmp4 = true;
+    option.enable_hls = option.enable_hls_fmp4 = true;
+    option.rtsp_demand = option.rtmp_demand = option.ts_demand = option.fmp4_demand = option.hls_demand = false;
+    option.enable_mp4 = cmd_main.hasKey("mp4");
+
+    // 在poller线程中分发，与推流会话一致
+    // Dispatch in the poller thread, consistent with the push stream session
+    auto poller = EventPollerPool::Instance().getPoller();
+    size_t index = 0;
+    for (auto cache_able : { false, true }) {
+        DispatchStats stats;
+        poller->sync([&]() { stats = runCase(stream, option, cache_able, index++); });
+        auto frames = MAX(stats.frames, (uint64_t)1);
+        cout << (cache_able ? "cacheable frames" : "borrowed frames") << ": " << stats.frames << endl
+             << "  dispatch: " << stats.ns / frames << "ns/frame, " << (double)stats.allocs / frames << " allocs/frame" << endl;
+    }
+
+    EventPoller::Ptr consumer;
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        if (!consumer && executor != poller) {
+            consumer = static_pointer_cast<EventPoller>(executor);
+        }
+    });
+    if (consumer) {
+        // 第一轮预热，让块缓存进入稳定状态
+        // The first round is warm-up to make the block cache stable
+        runCrossPoller(stream, poller, consumer);
+        auto stats = runCrossPoller(stream, poller, consumer);
+        auto frames = MAX(stats.frames, (uint64_t)1);
+        cout << "cross-poller frames: " << stats.frames << endl
+             << "  create: " << stats.ns / frames << "ns/frame, " << (double)stats.allocs / frames << " allocs/frame" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <thread>
+#include <iostream>
+#include "Util/File.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Network/sockutil.h"
+#include "Common/KTls.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__)
+#include <sys/resource.h>
+#include <openssl/ssl.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+// 生成自签名证书(包含私钥)，返回pem文件路径
+// Generate a self-signed certificate (including the private key), return the pem file path
+static string makeCertificate() {
+    EVP_PKEY *pkey = nullptr;
+    auto kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    EVP_PKEY_keygen_init(kctx);
+    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1);
+    EVP_PKEY_keygen(kctx, &pkey);
+    EVP_PKEY_CTX_free(kctx);
+
+    auto x509 = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    auto name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    X509_sign(x509, pkey, EVP_sha256());
+
+    string path = "./test_bench_ktls.pem";
+    auto fp = fopen(path.data(), "w");
+    PEM_write_X509(fp, x509);
+    PEM_write_PrivateKey(fp, pkey, nullptr, nullptr, 0, nullptr, nullptr);
+    fclose(fp);
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    return path;
+}
+
+static uint64_t getCpuUs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// 服务器发送total_bytes明文，客户端线程在用户态解密，统计吞吐量与cpu占用
+// The server sends total_bytes of plaintext, the client thread decrypts in user mode, count throughput and cpu usage
+static void testThroughput(bool ktls, size_t total_bytes, size_t block_size) {
+    auto listen_fd = SockUtil::listen(0, "127.0.0.1");
+    auto port = SockUtil::get_local_port(listen_fd);
+    SockUtil::setNoBlocked(listen_fd, false);
+
+    size_t recv_bytes = 0;
+    thread client([&]() {
+        auto fd = SockUtil::connect("127.0.0.1", port, false);
+        auto ctx = SSL_CTX_new(TLS_client_method());
+        // 只有tls1.2会话会卸载到内核
+        // Only tls1.2 sessions are offloaded to the kernel
+        SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+        auto ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+        SSL_set_tlsext_host_name(ssl, "localhost");
+        if (SSL_connect(ssl) == 1) {
+            char buf[64 * 1024];
+            while (recv_bytes < total_bytes) {
+                auto size = SSL_read(ssl, buf, sizeof(buf));
+                if (size <= 0) {
+                    break;
+                }
+                recv_bytes += size;
+            }
+        }
+        SSL_free(ssl);
+        SSL_CTX_free(ctx);
+        close(fd);
+    });
+
+    auto fd = (int)accept(listen_fd, nullptr, nullptr);
+    SockUtil::setNoBlocked(fd, false);
+    auto ssl = KTls::makeSSL();
+    SSL_set_fd(ssl.get(), fd);
+    if (SSL_accept(ssl.get()) != 1) {
+        ErrorL << "ssl handshake failed";
+        close(fd);
+        close(listen_fd);
+        client.join();
+        return;
+    }
+    bool offload = ktls && KTls::enableTx(fd, ssl.get());
+
+    string block(block_size, 'x');
+    Ticker ticker;
+    auto cpu_start = getCpuUs();
+    size_t sent_bytes = 0;
+    while (sent_bytes < total_bytes) {
+        auto size = offload ? ::send(fd, block.data(), block.size(), MSG_NOSIGNAL) : SSL_write(ssl.get(), block.data(), (int)block.size());
+        if (size <= 0) {
+            break;
+        }
+        sent_bytes += size;
+    }
+    client.join();
+    auto elapsed_ms = ticker.elapsedTime() + 1;
+    auto cpu_us = getCpuUs() - cpu_start;
+
+    // 客户端也在本进程用户态解密，cpu占用包含了两端
+    // The client also decrypts in user mode in this process, the cpu usage includes both ends
+    InfoL << (offload ? "ktls" : "user mode tls")
+          << ", version: " << SSL_get_version(ssl.get()) << ", cipher: " << SSL_get_cipher_name(ssl.get())
+          << ", block size: " << block_size
+          << ", received: " << recv_bytes / 1024 / 1024 << "MB"
+          << ", throughput: " << recv_bytes / 1024.0 / 1024 * 1000 / elapsed_ms << "MB/s"
+          << ", cpu: " << cpu_us / 1000 << "ms (" << cpu_us / 10.0 / elapsed_ms << "%)";
+    close(fd);
+    close(listen_fd);
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t total_mb = argc > 1 ? atoi(argv[1]) : 1024;
+    auto cert = makeCertificate();
+    if (!KTls::setCertificates({ cert })) {
+        ErrorL << "load certificate failed";
+        return -1;
+    }
+    auto supported = KTls::isSupported();
+    if (!supported) {
+        WarnL << "Kernel tls is not supported(modprobe tls), only test user mode tls";
+    }
+    for (auto block_size : { 16 * 1024, 256 * 1024 }) {
+        testThroughput(false, total_mb * 1024 * 1024, block_size);
+        if (supported) {
+            testThroughput(true, total_mb * 1024 * 1024, block_size);
+        }
+    }
+    File::delete_file(cert);
+    sleep(1);
+    return 0;
+}
+
+#else
+int main(int argc, char *argv[]) {
+    cout << "kTLS requires ENABLE_OPENSSL on linux" << endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,265 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Poller/EventPoller.h"
+#include "Network/Buffer.h"
+#include "Common/JemallocUtil.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public BenchCMD {
+public:
+    CMD_main() {
+        (*_parser) << Option('t', "threads", Option::ArgRequired, to_string(thread::hardware_concurrency()).data(), false, "poller线程数", nullptr);
+        (*_parser) << Option('i', "ingest", Option::ArgRequired, "4", false, "推流个数，每个推流位于不同的poller线程", nullptr);
+        (*_parser) << Option('v', "viewers", Option::ArgRequired, "1000", false, "每个推流的播放器个数，平均分布在全部poller线程", nullptr);
+        (*_parser) << Option('n', "batches", Option::ArgRequired, "20000", false, "每个推流分发的批次数，每批相当于一帧", nullptr);
+        (*_parser) << Option('b', "batch", Option::ArgRequired, "16", false, "每批的rtp包个数", nullptr);
+    }
+
+    const char *description() const override {
+        return "多播放器扇出时，对比poller线程绑定独立jemalloc arena前后，内存分配释放占用的cpu比例";
+    }
+};
+
+using Batch = std::shared_ptr<vector<Buffer::Ptr>>;
+
+// 本线程调用malloc/free的耗时与次数，只计入rtp负载的分配释放，不含引用计数拷贝等开销
+// Time and count of malloc/free calls of this thread, only the allocation and release of the rtp payload are counted, excluding the overhead such as reference count copies
+static thread_local uint64_t s_alloc_ns = 0;
+static thread_local uint64_t s_alloc_calls = 0;
+
+// 与RtpPacket一致每个包单独分配负载内存
+// The payload memory of each packet is allocated separately consistent with RtpPacket
+class BenchPacket : public Buffer {
+public:
+    BenchPacket(size_t size) : _size(size) {
+        auto start = nowNS();
+        _data = (char *)malloc(size);
+        s_alloc_ns += nowNS() - start;
+        ++s_alloc_calls;
+    }
+
+    ~BenchPacket() override {
+        auto start = nowNS();
+        free(_data);
+        s_alloc_ns += nowNS() - start;
+        ++s_alloc_calls;
+    }
+
+    char *data() const override { return _data; }
+    size_t size() const override { return _size; }
+
+private:
+    char *_data;
+    size_t _size;
+};
+
+struct BenchStats {
+    // 分配与释放内存的耗时
+    // Time spent allocating and freeing memory
+    atomic<uint64_t> alloc_ns { 0 };
+    atomic<uint64_t> alloc_calls { 0 };
+    atomic<uint64_t> packets { 0 };
+    atomic<uint64_t> checksum { 0 };
+    atomic<int64_t> pending { 0 };
+};
+
+// 任务结束时汇总本线程的malloc/free耗时
+// Summarize the malloc/free time of this thread when the task ends
+static void flushAllocStats(BenchStats &stats) {
+    stats.alloc_ns += s_alloc_ns;
+    stats.alloc_calls += s_alloc_calls;
+    s_alloc_ns = s_alloc_calls = 0;
+}
+
+// 推流线程生成一批rtp包
+// The push stream thread generates a batch of rtp packets
+static Batch makeBatch(size_t batch_size, size_t index) {
+    auto ret = std::make_shared<vector<Buffer::Ptr>>();
+    ret->reserve(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+        auto packet = std::make_shared<BenchPacket>(1400);
+        memset(packet->data(), (int)index, packet->size());
+        ret->emplace_back(std::move(packet));
+    }
+    return ret;
+}
+
+// 与RingBuffer分发一致，每个poller线程投递一次，再由该线程遍历其播放器；每个播放器发送时打包一份列表
+// Consistent with RingBuffer dispatch, deliver once to each poller thread, and then traverse its players in this thread; each player packs a list when sending
+static void dispatchBatch(Batch batch, const vector<EventPoller::Ptr> &pollers, size_t viewers, BenchStats &stats) {
+    stats.pending += pollers.size();
+    for (size_t i = 0; i < pollers.size(); ++i) {
+        auto count = viewers / pollers.size() + (i < viewers % pollers.size());
+        pollers[i]->async([batch, count, &stats]() mutable {
+            uint64_t sum = 0;
+            for (size_t viewer = 0; viewer < count; ++viewer) {
+                auto list = std::make_shared<vector<Buffer::Ptr>>(*batch);
+                for (auto &buffer : *list) {
+                    sum += (uint8_t)buffer->data()[viewer % buffer->size()];
+                }
+            }
+            // 最后一个持有者在播放线程中释放推流线程分配的内存
+            // The last holder releases the memory allocated by the push stream thread in the player thread
+            batch = nullptr;
+            flushAllocStats(stats);
+            stats.checksum += sum;
+            --stats.pending;
+        });
+    }
+}
+
+struct CaseResult {
+    uint64_t wall_ns = 0;
+    uint64_t cpu_ns = 0;
+    uint64_t alloc_ns = 0;
+    uint64_t packets = 0;
+    uint64_t bin_lock_wait = 0;
+};
+
+static uint64_t binLockWait() {
+    uint64_t ret = 0;
+    JemallocUtil::get_arena_stats([&](const JemallocUtil::ArenaStats &stats) { ret += stats.bin_lock_wait; });
+    return ret;
+}
+
+// 一次计时(两次读取时钟)本身的耗时，从malloc/free耗时中扣除
+// The time of one timing (reading the clock twice) itself, deducted from the malloc/free time
+static uint64_t timerOverheadNS() {
+    static constexpr size_t kLoops = 1000000;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kLoops; ++i) {
+        auto start = nowNS();
+        total += nowNS() - start;
+    }
+    return total / kLoops;
+}
+
+static CaseResult runCase(const vector<EventPoller::Ptr> &pollers, size_t ingest, size_t viewers, size_t batches, size_t batch_size) {
+    BenchStats stats;
+    auto lock_wait = binLockWait();
+    auto cpu = cpuNS();
+    auto start = nowNS();
+    for (size_t index = 0; index < batches; ++index) {
+        for (size_t i = 0; i < ingest; ++i) {
+            // 限制积压，防止任务队列无限增长
+            // Limit the backlog to prevent the task queue from growing indefinitely
+            while (stats.pending > (int64_t)(pollers.size() * ingest * 8)) {
+                this_thread::yield();
+            }
+            auto &poller = pollers[i % pollers.size()];
+            ++stats.pending;
+            poller->async([&, index]() {
+                auto batch = makeBatch(batch_size, index);
+                stats.packets += batch_size;
+                dispatchBatch(std::move(batch), pollers, viewers, stats);
+                // 包括分配，以及播放线程先于本任务结束时在此处的释放
+                // Including the allocation, and the release here when the player tasks finish before this task
+                flushAllocStats(stats);
+                --stats.pending;
+            });
+        }
+    }
+    while (stats.pending) {
+        this_thread::yield();
+    }
+    // 等待最后的任务退出
+    // Wait for the last tasks to exit
+    for (auto &poller : pollers) {
+        poller->sync([]() {});
+    }
+    CaseResult ret;
+    ret.wall_ns = nowNS() - start;
+    ret.cpu_ns = cpuNS() - cpu;
+    auto overhead = timerOverheadNS() * stats.alloc_calls;
+    ret.alloc_ns = stats.alloc_ns > overhead ? stats.alloc_ns - overhead : 0;
+    ret.packets = stats.packets;
+    ret.bin_lock_wait = binLockWait() - lock_wait;
+    return ret;
+}
+
+static void report(const char *name, const CaseResult &result, size_t viewers) {
+    auto packets = MAX(result.packets, (uint64_t)1);
+    cout << name << ": " << result.packets << " rtp x " << viewers << " viewers in " << result.wall_ns / 1000000 << "ms" << endl
+         << "  cpu: " << result.cpu_ns / 1000000 << "ms, " << result.cpu_ns / packets << "ns/rtp" << endl
+         << "  malloc/free: " << result.alloc_ns / 1000000 << "ms, " << result.alloc_ns / packets << "ns/rtp, cpu share: "
+         << 100.0 * result.alloc_ns / MAX(result.cpu_ns, (uint64_t)1) << "%" << endl
+         << "  bin lock wait: " << result.bin_lock_wait << endl;
+}
+
+static void printArenaStats() {
+    JemallocUtil::get_arena_stats([](const JemallocUtil::ArenaStats &stats) {
+        if (!stats.small_nmalloc && !stats.large_nmalloc) {
+            return;
+        }
+        cout << "  arena " << stats.index << ": threads: " << stats.threads << ", small malloc/free: " << stats.small_nmalloc << "/"
+             << stats.small_ndalloc << ", bin lock wait: " << stats.bin_lock_wait << endl;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    int ret = 0;
+    if (!initBench(cmd_main, argc, argv, ret)) {
+        return ret;
+    }
+
+    auto threads = (size_t)MAX(cmd_main["threads"].as<int>(), 1);
+    auto ingest = (size_t)MAX(cmd_main["ingest"].as<int>(), 1);
+    auto viewers = (size_t)MAX(cmd_main["viewers"].as<int>(), 1);
+    auto batches = (size_t)MAX(cmd_main["batches"].as<int>(), 1);
+    auto batch_size = (size_t)MAX(cmd_main["batch"].as<int>(), 1);
+
+    EventPollerPool::setPoolSize(threads);
+    vector<EventPoller::Ptr> pollers;
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        pollers.emplace_back(static_pointer_cast<EventPoller>(executor));
+    });
+
+    // 预热，让各线程缓存与arena进入稳定状态
+    // Warm up to make the thread caches and arenas stable
+    runCase(pollers, ingest, viewers, MAX(batches / 10, (size_t)1), batch_size);
+
+    auto shared = runCase(pollers, ingest, viewers, batches, batch_size);
+    report("shared arenas", shared, viewers);
+    printArenaStats();
+
+    bool bound = true;
+    for (auto &poller : pollers) {
+        poller->sync([&]() { bound = JemallocUtil::bind_thread_arena() >= 0 && bound; });
+    }
+    if (!bound) {
+        WarnL << "jemalloc is not enabled or binding arena failed, the following result is the same as the default allocator";
+    }
+    runCase(pollers, ingest, viewers, MAX(batches / 10, (size_t)1), batch_size);
+
+    auto own = runCase(pollers, ingest, viewers, batches, batch_size);
+    report("per-poller arenas", own, viewers);
+    printArenaStats();
+
+    cout << "malloc/free cpu share: " << 100.0 * shared.alloc_ns / MAX(shared.cpu_ns, (uint64_t)1) << "% -> "
+         << 100.0 * own.alloc_ns / MAX(own.cpu_ns, (uint64_t)1) << "%" << endl
+         << "bin lock wait: " << shared.bin_lock_wait << " -> " << own.bin_lock_wait << endl;
+    // 绑定arena只隔离各线程的分配，播放线程释放推流线程分配的负载时仍需获取推流线程arena的bin锁
+    // Binding arenas only isolates the allocations of each thread, the player thread still takes the bin lock of the push stream thread's arena when freeing the payload allocated by the push stream thread
+    cout << "note: a cross-arena free still takes the owner arena's bin lock, the remaining bin lock wait comes from freeing payloads in the player pollers" << endl;
+    return 0;
+}
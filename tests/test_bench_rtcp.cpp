@@ -0,0 +1,254 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstring>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Rtcp/Rtcp.h"
+#include "Rtcp/RtcpFCI.h"
+#include "Rtcp/RtcpView.h"
+#include "Rtcp/RtcpBuilder.h"
+
+// 统计内存分配次数
+// Count memory allocations
+#define BENCH_COUNT_ALLOC
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public BenchCMD {
+public:
+    CMD_main() {
+        (*_parser) << Option('n', "count", Option::ArgRequired, "1000000", false, "每种场景的循环次数", nullptr);
+    }
+
+    const char *description() const override {
+        return "rtcp解析与构造性能测试，对比loadFromBytes/create与RtcpCompoundView/RtcpBuilder的耗时与内存分配次数";
+    }
+};
+
+struct BenchResult {
+    uint64_t ns = 0;
+    uint64_t allocs = 0;
+    uint64_t checksum = 0;
+};
+
+template <typename FUNC>
+static BenchResult runBench(size_t count, FUNC &&func) {
+    BenchResult ret;
+    auto allocs = s_alloc_count;
+    auto start = nowNS();
+    for (size_t i = 0; i < count; ++i) {
+        ret.checksum += func(i);
+    }
+    ret.ns = nowNS() - start;
+    ret.allocs = s_alloc_count - allocs;
+    return ret;
+}
+
+static bool report(const char *name, size_t count, const BenchResult &legacy, const BenchResult &fast) {
+    cout << name << ":" << endl
+         << "  legacy: " << legacy.ns / count << "ns/op, " << (double)legacy.allocs / count << " allocs/op" << endl
+         << "  view:   " << fast.ns / count << "ns/op, " << (double)fast.allocs / count << " allocs/op, speedup: "
+         << (double)legacy.ns / MAX(fast.ns, (uint64_t)1) << "x" << endl;
+    if (legacy.checksum != fast.checksum) {
+        ErrorL << name << " result mismatch: " << legacy.checksum << " != " << fast.checksum;
+        return false;
+    }
+    return true;
+}
+
+// rtsp/rtp推流常见的SR+SDES复合包
+// SR+SDES compound packet common in rtsp/rtp push stream
+static string makeSenderReport() {
+    auto sr = RtcpSR::create(0);
+    sr->ssrc = htonl(0x12345678);
+    sr->setNtpStamp(getCurrentMillisecond(true));
+    sr->rtpts = htonl(90000);
+    sr->packet_count = htonl(1000);
+    sr->octet_count = htonl(1000000);
+    auto sdes = RtcpSdes::create({ kServerName });
+    auto &chunk = sdes->chunks;
+    chunk.type = (uint8_t)SdesType::RTCP_SDES_CNAME;
+    chunk.ssrc = htonl(0x12345678);
+    return string((char *)sr.get(), sr->getSize()) + string((char *)sdes.get(), sdes->getSize());
+}
+
+// webrtc播放器常见的RR+XR RRTR复合包
+// RR+XR RRTR compound packet common in webrtc players
+static string makeReceiverReport() {
+    auto rr = RtcpRR::create(1);
+    rr->ssrc = htonl(1);
+    rr->items.ssrc = htonl(0x12345678);
+    rr->items.cumulative = htonl(12) >> 8;
+    rr->items.seq_cycles = htons(1);
+    rr->items.seq_max = htons(1000);
+    rr->items.jitter = htonl(30);
+    rr->items.last_sr_stamp = htonl(0x11223344);
+    rr->items.delay_since_last_sr = htonl(65536);
+    auto xr = RtcpXRDLRR::create(1);
+    xr->setSize(sizeof(RtcpXRRRTR));
+    auto rrtr = (RtcpXRRRTR *)xr.get();
+    rrtr->ssrc = htonl(1);
+    rrtr->bt = 4;
+    rrtr->block_length = htons(2);
+    rrtr->ntpmsw = htonl(0x11223344);
+    rrtr->ntplsw = htonl(0x55667788);
+    return string((char *)rr.get(), rr->getSize()) + string((char *)rrtr, rrtr->getSize());
+}
+
+// 与RtcpContext/RtspSession一致，读取ntp时间戳与rr统计信息
+// Consistent with RtcpContext/RtspSession, read the ntp timestamp and rr statistics
+static uint64_t legacyParse(const string &packet, string &work) {
+    // 旧版就地转换字节序，每次需要拷贝一份原始数据
+    // The legacy version converts the byte order in place, a copy of the original data is required each time
+    memcpy(&work[0], packet.data(), packet.size());
+    uint64_t ret = 0;
+    for (auto rtcp : RtcpHeader::loadFromBytes(&work[0], packet.size())) {
+        switch ((RtcpType)rtcp->pt) {
+            case RtcpType::RTCP_SR: {
+                auto sr = (RtcpSR *)rtcp;
+                ret += sr->ssrc + sr->rtpts + sr->getNtpUnixStampMS();
+                break;
+            }
+            case RtcpType::RTCP_RR: {
+                auto rr = (RtcpRR *)rtcp;
+                for (auto item : rr->getItemList()) {
+                    ret += item->ssrc + item->last_sr_stamp + item->delay_since_last_sr;
+                }
+                break;
+            }
+            case RtcpType::RTCP_XR: {
+                auto xr = (RtcpXRRRTR *)rtcp;
+                ret += xr->ssrc + xr->ntpmsw + xr->ntplsw;
+                break;
+            }
+            default: ret += rtcp->pt; break;
+        }
+    }
+    return ret;
+}
+
+static uint64_t viewParse(const string &packet, string &work) {
+    // 保持与旧版相同的拷贝开销
+    // Keep the same copy overhead as the legacy version
+    memcpy(&work[0], packet.data(), packet.size());
+    uint64_t ret = 0;
+    for (auto &rtcp : RtcpCompoundView(work.data(), packet.size())) {
+        switch (rtcp.type()) {
+            case RtcpType::RTCP_SR: {
+                RtcpSRView sr(rtcp);
+                ret += sr.ssrc() + sr.rtpts() + sr.getNtpUnixStampMS();
+                break;
+            }
+            case RtcpType::RTCP_RR: {
+                RtcpRRView rr(rtcp);
+                for (size_t i = 0; i < rr.itemCount(); ++i) {
+                    auto item = rr.getItem(i);
+                    ret += item.ssrc() + item.lastSrStamp() + item.delaySinceLastSr();
+                }
+                break;
+            }
+            case RtcpType::RTCP_XR: {
+                RtcpXRView xr(rtcp);
+                ret += xr.ssrc() + xr.ntpmsw() + xr.ntplsw();
+                break;
+            }
+            default: ret += (uint8_t)rtcp.type(); break;
+        }
+    }
+    return ret;
+}
+
+// 旧版create不会清零内存，所有字段都需要赋值
+// The legacy create does not zero the memory, all fields need to be assigned
+static void fillReceiverReport(RtcpRR *rtcp, size_t index) {
+    rtcp->ssrc = htonl(1);
+    auto &item = rtcp->items;
+    item.ssrc = htonl(0x12345678);
+    item.fraction = 0;
+    item.cumulative = htonl(12) >> 8;
+    item.seq_cycles = htons(1);
+    item.seq_max = htons((uint16_t)index);
+    item.jitter = htonl(30);
+    item.last_sr_stamp = htonl(0x11223344);
+    item.delay_since_last_sr = htonl(65536);
+}
+
+static uint64_t checksum(const char *data, size_t size) {
+    uint64_t ret = size;
+    for (size_t i = 0; i < size; ++i) {
+        ret = ret * 31 + (uint8_t)data[i];
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    int ret = 0;
+    if (!initBench(cmd_main, argc, argv, ret)) {
+        return ret;
+    }
+
+    auto count = (size_t)MAX(cmd_main["count"].as<int>(), 1);
+    bool ok = true;
+
+    string work(1500, '\0');
+    for (auto &pr : { make_pair("parse SR+SDES", makeSenderReport()), make_pair("parse RR+XR RRTR", makeReceiverReport()) }) {
+        auto &packet = pr.second;
+        auto legacy = runBench(count, [&](size_t) { return legacyParse(packet, work); });
+        auto fast = runBench(count, [&](size_t) { return viewParse(packet, work); });
+        ok = report(pr.first, count, legacy, fast) && ok;
+    }
+
+    // 与RtcpContextForRecv::createRtcpRR一致，构造后交给socket发送，发送完毕后释放
+    // Consistent with RtcpContextForRecv::createRtcpRR, hand over to the socket for sending after construction, and release after sending
+    {
+        auto legacy = runBench(count, [&](size_t i) {
+            auto rtcp = RtcpRR::create(1);
+            fillReceiverReport(rtcp.get(), i);
+            auto buffer = RtcpHeader::toBuffer(std::move(rtcp));
+            return checksum(buffer->data(), buffer->size());
+        });
+        RtcpBuilder builder;
+        auto fast = runBench(count, [&](size_t i) {
+            auto rtcp = builder.addRR(1);
+            fillReceiverReport(rtcp, i);
+            auto buffer = builder.finish();
+            return checksum(buffer->data(), buffer->size());
+        });
+        ok = report("build RR", count, legacy, fast) && ok;
+    }
+
+    // 与WebRtcTransportImp::onSendNack一致
+    // Consistent with WebRtcTransportImp::onSendNack
+    {
+        FCI_NACK nack(1000, vector<bool>(16, true));
+        auto legacy = runBench(count, [&](size_t i) {
+            auto rtcp = RtcpFB::create(RTPFBType::RTCP_RTPFB_NACK, &nack, FCI_NACK::kSize);
+            rtcp->ssrc = htonl(1);
+            rtcp->ssrc_media = htonl((uint32_t)i);
+            return checksum((char *)rtcp.get(), rtcp->getSize());
+        });
+        RtcpBuilder builder;
+        auto fast = runBench(count, [&](size_t i) {
+            auto rtcp = builder.addFB(RTPFBType::RTCP_RTPFB_NACK, &nack, FCI_NACK::kSize);
+            rtcp->ssrc = htonl(1);
+            rtcp->ssrc_media = htonl((uint32_t)i);
+            auto buffer = builder.finish();
+            return checksum(buffer->data(), buffer->size());
+        });
+        ok = report("build NACK", count, legacy, fast) && ok;
+    }
+    return ok ? 0 : -1;
+}
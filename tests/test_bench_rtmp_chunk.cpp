@@ -0,0 +1,119 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Rtmp/RtmpProtocol.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+// 模拟一个rtmp播放会话，只统计待发送的数据，不真正写socket
+// Simulate a rtmp play session, only count the data to be sent, do not really write to the socket
+class RtmpViewer : public RtmpProtocol {
+public:
+    RtmpViewer(size_t chunk_size) { sendChunkSize(chunk_size); }
+
+    void sendMedia(const RtmpPacket::Ptr &pkt, bool shared) {
+        if (shared) {
+            sendRtmp(pkt, STREAM_MEDIA);
+        } else {
+            sendRtmp(pkt->type_id, STREAM_MEDIA, pkt, pkt->time_stamp, pkt->chunk_id);
+        }
+    }
+
+    void onSendRawData(Buffer::Ptr buffer) override {
+        _bytes += buffer->size();
+        ++_buffers;
+    }
+
+    void onRtmpChunk(RtmpPacket::Ptr chunk_data) override {}
+
+public:
+    uint64_t _bytes = 0;
+    uint64_t _buffers = 0;
+};
+
+static RtmpPacket::Ptr makePacket(uint8_t type, uint32_t stamp, size_t size) {
+    auto pkt = RtmpPacket::create();
+    pkt->type_id = type;
+    pkt->time_stamp = stamp;
+    pkt->chunk_id = type == MSG_VIDEO ? CHUNK_VIDEO : CHUNK_AUDIO;
+    pkt->stream_index = STREAM_MEDIA;
+    pkt->buffer.assign(size, 'r');
+    pkt->body_size = pkt->buffer.size();
+    return pkt;
+}
+
+// 把seconds秒的流发送给所有观看者，返回耗时(毫秒)
+// Send seconds of stream to all viewers, return the time consumed (milliseconds)
+static uint64_t testFanOut(size_t viewers, size_t seconds, size_t kbps, size_t chunk_size, bool shared) {
+    static constexpr size_t kFps = 25;
+    static constexpr size_t kAudioKbps = 128;
+    static constexpr size_t kAudioFps = 43;
+    size_t video_size = (kbps > kAudioKbps ? kbps - kAudioKbps : kbps) * 1000 / 8 / kFps;
+    size_t audio_size = kAudioKbps * 1000 / 8 / kAudioFps;
+
+    vector<std::shared_ptr<RtmpViewer>> players;
+    for (size_t i = 0; i < viewers; ++i) {
+        players.emplace_back(std::make_shared<RtmpViewer>(chunk_size));
+    }
+
+    uint64_t elapsed_ms = 0;
+    size_t audio_index = 0;
+    for (size_t frame = 0; frame < seconds * kFps; ++frame) {
+        uint32_t stamp = (uint32_t)(frame * 1000 / kFps);
+        vector<RtmpPacket::Ptr> pkts { makePacket(MSG_VIDEO, stamp, video_size) };
+        for (; audio_index * 1000 / kAudioFps <= stamp; ++audio_index) {
+            pkts.emplace_back(makePacket(MSG_AUDIO, (uint32_t)(audio_index * 1000 / kAudioFps), audio_size));
+        }
+        // 只统计扇出耗时，不包括生成数据源的耗时
+        // Only count the fan-out time, not including the time to generate the source data
+        Ticker ticker;
+        for (auto &player : players) {
+            for (auto &pkt : pkts) {
+                player->sendMedia(pkt, shared);
+            }
+        }
+        elapsed_ms += ticker.elapsedTime();
+    }
+
+    uint64_t bytes = 0, buffers = 0;
+    for (auto &player : players) {
+        bytes += player->_bytes;
+        buffers += player->_buffers;
+    }
+    InfoL << (shared ? "shared chunk cache" : "per session chunking") << ", viewers: " << viewers << ", chunk size: " << chunk_size
+          << ", elapsed: " << elapsed_ms << "ms, sent: " << bytes / 1024 / 1024 << "MB, buffers per viewer per second: " << buffers / viewers / seconds;
+    InfoL << "cpu per viewer: " << elapsed_ms * 1000.0 / viewers / seconds << "us/s"
+          << ", viewers per core: " << (elapsed_ms ? viewers * seconds * 1000.0 / elapsed_ms : 0);
+    return elapsed_ms;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", LInfo));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t viewers = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t seconds = argc > 2 ? atoi(argv[2]) : 10;
+    size_t kbps = argc > 3 ? atoi(argv[3]) : 4000;
+
+    // 服务器默认协商的chunk size为60000，推流客户端常用4096
+    // The default chunk size negotiated by the server is 60000, and 4096 is commonly used by push clients
+    for (auto chunk_size : { 60000, 4096 }) {
+        testFanOut(viewers, seconds, kbps, chunk_size, false);
+        testFanOut(viewers, seconds, kbps, chunk_size, true);
+    }
+    sleep(1);
+    return 0;
+}
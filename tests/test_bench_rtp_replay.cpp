@@ -0,0 +1,478 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <atomic>
+#include <random>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Poller/EventPoller.h"
+#include "Thread/semaphore.h"
+#include "Common/config.h"
+#include "Common/MultiMediaSourceMuxer.h"
+#include "Rtp/GB28181Process.h"
+
+#if defined(ENABLE_RTPPROXY)
+// 统计内存分配次数
+// Count memory allocations
+#define BENCH_COUNT_ALLOC
+#endif
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_RTPPROXY)
+
+class CMD_main : public BenchCMD {
+public:
+    CMD_main() {
+        (*_parser) << Option('t', "threads", Option::ArgRequired, to_string(thread::hardware_concurrency()).data(), false,
+                             "回放线程数，每个线程独立回放全部输入", nullptr);
+        (*_parser) << Option('c', "loops", Option::ArgRequired, "10", false, "每个线程回放全部输入的次数", nullptr);
+        (*_parser) << Option('i', "inputs", Option::ArgRequired, "", false,
+                             "输入文件列表，以逗号分隔，支持rtp_proxy.dumpDir导出的.rtp文件(2字节长度+rtp)和.pcap文件(udp)，为空时使用内置生成的ps流", nullptr);
+        (*_parser) << Option('s', "seconds", Option::ArgRequired, "60", false, "内置生成的ps流时长(秒)", nullptr);
+        (*_parser) << Option('m', "mp4", Option::ArgNone, nullptr, false, "是否开启mp4录制(写磁盘)", nullptr);
+        (*_parser) << Option('p', "passthrough", Option::ArgNone, nullptr, false, "模拟存在ps透传转发，每个ps rtp包都判断关键帧并回调", nullptr);
+    }
+
+    const char *description() const override {
+        return "rtp/ps推流回放性能测试，无网络io，尽快回放并统计各阶段耗时与内存分配次数";
+    }
+};
+
+struct ReplayStream {
+    string name;
+    vector<string> packets;
+};
+
+// 读取rtp_proxy.dumpDir导出的.rtp文件，格式为2字节长度+rtp
+// Read the .rtp file exported by rtp_proxy.dumpDir, the format is 2 bytes length + rtp
+static bool loadRtpFile(const string &path, vector<ReplayStream> &out) {
+    auto data = File::loadFile(path.data());
+    ReplayStream stream { path, {} };
+    for (size_t pos = 0; pos + 2 <= data.size();) {
+        size_t len = ((uint8_t)data[pos] << 8) | (uint8_t)data[pos + 1];
+        pos += 2;
+        if (len < 12 || pos + len > data.size()) {
+            break;
+        }
+        stream.packets.emplace_back(data.substr(pos, len));
+        pos += len;
+    }
+    if (stream.packets.empty()) {
+        return false;
+    }
+    out.emplace_back(std::move(stream));
+    return true;
+}
+
+static inline uint32_t load32(const uint8_t *ptr, bool swap) {
+    uint32_t ret;
+    memcpy(&ret, ptr, 4);
+    return swap ? ((ret >> 24) | ((ret >> 8) & 0xFF00) | ((ret << 8) & 0xFF0000) | (ret << 24)) : ret;
+}
+
+// 读取pcap文件中的udp rtp包，按ssrc拆分为多路流，不依赖libpcap
+// Read the udp rtp packets in the pcap file, split into multiple streams by ssrc, does not depend on libpcap
+static bool loadPcapFile(const string &path, vector<ReplayStream> &out) {
+    auto data = File::loadFile(path.data());
+    if (data.size() < 24) {
+        return false;
+    }
+    auto ptr = (const uint8_t *)data.data();
+    auto magic = load32(ptr, false);
+    bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+    if (!swap && magic != 0xa1b2c3d4 && magic != 0xa1b23c4d) {
+        WarnL << "Unsupported pcap format(pcapng?): " << path;
+        return false;
+    }
+    auto link_type = load32(ptr + 20, swap);
+
+    map<uint32_t, ReplayStream> streams;
+    for (size_t pos = 24; pos + 16 <= data.size();) {
+        size_t caplen = load32(ptr + pos + 8, swap);
+        pos += 16;
+        if (pos + caplen > data.size()) {
+            break;
+        }
+        auto pkt = ptr + pos;
+        auto end = pkt + caplen;
+        pos += caplen;
+
+        int proto = 0;
+        switch (link_type) {
+            case 0: proto = pkt + 4 <= end ? 0x0800 : 0; pkt += 4; break; // BSD loopback
+            case 1: { // Ethernet
+                if (pkt + 14 > end) {
+                    continue;
+                }
+                proto = (pkt[12] << 8) | pkt[13];
+                pkt += 14;
+                if (proto == 0x8100 && pkt + 4 <= end) {
+                    proto = (pkt[2] << 8) | pkt[3];
+                    pkt += 4;
+                }
+                break;
+            }
+            case 113: { // Linux cooked
+                if (pkt + 16 > end) {
+                    continue;
+                }
+                proto = (pkt[14] << 8) | pkt[15];
+                pkt += 16;
+                break;
+            }
+            case 12:
+            case 101: proto = pkt < end && (pkt[0] >> 4) == 6 ? 0x86DD : 0x0800; break; // Raw ip
+            default: WarnL << "Unsupported pcap link type: " << link_type; return false;
+        }
+
+        if (proto == 0x0800) {
+            if (pkt + 20 > end || pkt[9] != 17 || ((pkt[6] & 0x3F) | pkt[7])) {
+                // 不是udp或者是ip分片
+                // Not udp or ip fragment
+                continue;
+            }
+            pkt += (pkt[0] & 0x0F) * 4;
+        } else if (proto == 0x86DD) {
+            if (pkt + 40 > end || pkt[6] != 17) {
+                continue;
+            }
+            pkt += 40;
+        } else {
+            continue;
+        }
+        if (pkt + 8 > end) {
+            continue;
+        }
+        size_t udp_len = (pkt[4] << 8) | pkt[5];
+        pkt += 8;
+        if (udp_len < 8 + 12 || pkt + udp_len - 8 > end) {
+            continue;
+        }
+        size_t len = udp_len - 8;
+        if ((pkt[0] >> 6) != 2 || (pkt[1] >= 192 && pkt[1] <= 223)) {
+            // 不是rtp，或者是rtcp
+            // Not rtp, or rtcp
+            continue;
+        }
+        uint32_t ssrc = ((uint32_t)pkt[8] << 24) | (pkt[9] << 16) | (pkt[10] << 8) | pkt[11];
+        auto &stream = streams[ssrc];
+        if (stream.name.empty()) {
+            stream.name = path + ":" + to_string(ssrc);
+        }
+        stream.packets.emplace_back((const char *)pkt, len);
+    }
+    for (auto &pr : streams) {
+        out.emplace_back(std::move(pr.second));
+    }
+    return !streams.empty();
+}
+
+static void writeStamp(string &out, int64_t stamp) {
+    out.push_back((char)(0x21 | ((stamp >> 29) & 0x0E)));
+    out.push_back((char)(stamp >> 22));
+    out.push_back((char)(((stamp >> 14) & 0xFE) | 1));
+    out.push_back((char)(stamp >> 7));
+    out.push_back((char)(((stamp << 1) & 0xFE) | 1));
+}
+
+static void writePES(string &out, int stream_id, int64_t pts, const char *data, size_t size) {
+    auto pes_len = 3 + 5 + size;
+    out += string { 0, 0, 1, (char)stream_id, (char)(pes_len >> 8), (char)pes_len, (char)0x80, (char)0x80, 5 };
+    writeStamp(out, pts);
+    out.append(data, size);
+}
+
+// 生成海康风格的国标ps流: 720p h264(25fps, 2Mbps, gop 50) + g711a
+// Generate a Hikvision style GB28181 ps stream: 720p h264 (25fps, 2Mbps, gop 50) + g711a
+static ReplayStream makeSyntheticStream(size_t seconds) {
+    static const uint8_t s_sps[] = { 0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x50, 0x05, 0xBB, 0x01, 0x10, 0x00,
+                                     0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0x20, 0xF1, 0x83, 0x19, 0x60 };
+    static const uint8_t s_pps[] = { 0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0 };
+    static const string s_pack { 0, 0, 1, (char)0xBA, 0x44, 0, 4, 0, 4, 1, 1, (char)0x89, (char)0xC3, (char)0xF8 };
+    static const string s_psm { 0, 0, 1, (char)0xBC, 0, 18, (char)0xE0, (char)0xFF, 0, 0, 0, 8,
+                                0x1B, (char)0xE0, 0, 0, (char)0x90, (char)0xC0, 0, 0, 0, 0, 0, 0 };
+
+    std::mt19937 rng(0);
+    ReplayStream ret { "synthetic", {} };
+    uint16_t seq = 0;
+    for (size_t i = 0; i < seconds * 25; ++i) {
+        int64_t pts = 90000 + i * 3600;
+        bool key = i % 50 == 0;
+        string frame;
+        if (key) {
+            frame.append((const char *)s_sps, sizeof(s_sps));
+            frame.append((const char *)s_pps, sizeof(s_pps));
+        }
+        frame += string { 0, 0, 0, 1, (char)(key ? 0x65 : 0x41) };
+        auto header_size = frame.size();
+        frame.resize(key ? 60000 : 9000 + rng() % 2000);
+        for (auto pos = header_size; pos < frame.size(); ++pos) {
+            // 负载中不出现起始码
+            // No start code in the payload
+            frame[pos] = (char)(0x11 + rng() % 0xE0);
+        }
+
+        string ps = s_pack;
+        if (key) {
+            ps += s_psm;
+        }
+        for (size_t pos = 0; pos < frame.size(); pos += 60000) {
+            writePES(ps, 0xE0, pts, frame.data() + pos, std::min<size_t>(60000, frame.size() - pos));
+        }
+        string audio(320, (char)0xD5);
+        ps += s_pack;
+        writePES(ps, 0xC0, pts, audio.data(), audio.size());
+
+        for (size_t pos = 0; pos < ps.size(); pos += 1400) {
+            auto size = std::min<size_t>(1400, ps.size() - pos);
+            bool mark = pos + size == ps.size();
+            auto stamp = (uint32_t)pts;
+            string rtp { (char)0x80, (char)(96 | (mark ? 0x80 : 0)), (char)(seq >> 8), (char)seq,
+                         (char)(stamp >> 24), (char)(stamp >> 16), (char)(stamp >> 8), (char)stamp, 0x12, 0x34, 0x56, 0x78 };
+            ++seq;
+            ret.packets.emplace_back(rtp + ps.substr(pos, size));
+        }
+    }
+    return ret;
+}
+
+struct ReplayStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t total_ns = 0;
+    uint64_t mux_ns = 0;
+    uint64_t cpu_ns = 0;
+    uint64_t allocs = 0;
+    uint64_t mux_allocs = 0;
+
+    void add(const ReplayStats &other) {
+        packets += other.packets;
+        bytes += other.bytes;
+        frames += other.frames;
+        total_ns += other.total_ns;
+        mux_ns += other.mux_ns;
+        cpu_ns += other.cpu_ns;
+        allocs += other.allocs;
+        mux_allocs += other.mux_allocs;
+    }
+};
+
+// 统计复用阶段耗时的sink，位于GB28181Process(rtp排序+ps/ts解复用)与MultiMediaSourceMuxer(各协议复用)之间
+// Sink that counts the time of the muxing stage, located between GB28181Process (rtp sorting + ps/ts demuxing) and MultiMediaSourceMuxer (muxing of each protocol)
+class ReplaySink : public MediaSinkInterface {
+public:
+    ReplaySink(const MediaTuple &tuple, const ProtocolOption &option, ReplayStats &stats) : _stats(stats) {
+        _muxer = std::make_shared<MultiMediaSourceMuxer>(tuple, 0.0f, option);
+    }
+
+    bool inputFrame(const Frame::Ptr &frame) override {
+        auto allocs = s_alloc_count;
+        auto start = nowNS();
+        auto ret = _muxer->inputFrame(frame);
+        _stats.mux_ns += nowNS() - start;
+        _stats.mux_allocs += s_alloc_count - allocs;
+        ++_stats.frames;
+        return ret;
+    }
+
+    bool addTrack(const Track::Ptr &track) override { return _muxer->addTrack(track); }
+    void addTrackCompleted() override { _muxer->addTrackCompleted(); }
+    void resetTracks() override { _muxer->resetTracks(); }
+
+private:
+    ReplayStats &_stats;
+    MultiMediaSourceMuxer::Ptr _muxer;
+};
+
+// 在一个poller线程内依次回放全部输入，每次只回放一批rtp，让出线程以便处理其他异步任务
+// Replay all inputs in turn in a poller thread, only replay a batch of rtp at a time, and yield the thread to handle other asynchronous tasks
+class ReplayWorker : public std::enable_shared_from_this<ReplayWorker> {
+public:
+    using Ptr = std::shared_ptr<ReplayWorker>;
+    using onDone = std::function<void(const ReplayStats &stats)>;
+
+    ReplayWorker(size_t index, const vector<ReplayStream> &inputs, size_t loops, const ProtocolOption &option, bool passthrough, onDone cb)
+        : _passthrough(passthrough), _index(index), _loops(loops), _inputs(inputs), _option(option), _on_done(std::move(cb)) {}
+
+    void start(const EventPoller::Ptr &poller) {
+        _poller = poller;
+        auto self = shared_from_this();
+        _poller->async([self]() { self->runBatch(); });
+    }
+
+private:
+    void runBatch() {
+        static constexpr size_t kBatchSize = 256;
+        auto &packets = _inputs[_input_index].packets;
+        if (!_process) {
+            // 每次回放都使用新的流，防止rtp序号与时间戳回退
+            // Use a new stream for each replay to prevent rtp seq and stamp from going backwards
+            MediaInfo info;
+            static_cast<MediaTuple &>(info) = MediaTuple { DEFAULT_VHOST, kRtpAppName, StrPrinter << "replay_" << _index << "_" << _input_index << "_" << _loop, "" };
+            info.schema = "rtp";
+            info.protocol = "udp";
+            _sink = std::make_shared<ReplaySink>(info, _option, _stats);
+            _process = std::make_shared<GB28181Process>(info, _sink.get());
+            if (_passthrough) {
+                // 与RtpProcess创建透传环形缓存后一致
+                // Consistent with RtpProcess after creating the passthrough ring buffer
+                _process->setOnPSRtp([this](const RtpPacket::Ptr &rtp, bool key_pos) { _key_packets += key_pos; });
+            }
+        }
+
+        auto allocs = s_alloc_count;
+        auto cpu = threadCpuNS();
+        auto start = nowNS();
+        for (size_t i = 0; i < kBatchSize && _pos < packets.size(); ++i, ++_pos) {
+            auto &rtp = packets[_pos];
+            _process->inputRtp(true, rtp.data(), rtp.size());
+            _stats.bytes += rtp.size();
+        }
+        if (_pos == packets.size()) {
+            _process->flush();
+        }
+        _stats.total_ns += nowNS() - start;
+        _stats.cpu_ns += threadCpuNS() - cpu;
+        _stats.allocs += s_alloc_count - allocs;
+
+        if (_pos == packets.size()) {
+            _stats.packets += packets.size();
+            _process = nullptr;
+            _sink = nullptr;
+            _pos = 0;
+            if (++_input_index == _inputs.size()) {
+                _input_index = 0;
+                if (++_loop == _loops) {
+                    _on_done(_stats);
+                    return;
+                }
+            }
+        }
+        auto self = shared_from_this();
+        _poller->async([self]() { self->runBatch(); }, false);
+    }
+
+private:
+    bool _passthrough;
+    size_t _key_packets = 0;
+    size_t _index;
+    size_t _loops;
+    size_t _loop = 0;
+    size_t _input_index = 0;
+    size_t _pos = 0;
+    const vector<ReplayStream> &_inputs;
+    ProtocolOption _option;
+    onDone _on_done;
+    ReplayStats _stats;
+    EventPoller::Ptr _poller;
+    std::shared_ptr<ReplaySink> _sink;
+    GB28181Process::Ptr _process;
+};
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    int ret = 0;
+    if (!initBench(cmd_main, argc, argv, ret, true)) {
+        return ret;
+    }
+
+    size_t threads = MAX(cmd_main["threads"].as<int>(), 1);
+    size_t loops = MAX(cmd_main["loops"].as<int>(), 1);
+    EventPollerPool::setPoolSize(threads);
+
+    vector<ReplayStream> inputs;
+    string files = cmd_main["inputs"];
+    for (auto &file : split(files, ",")) {
+        trim(file);
+        if (file.empty()) {
+            continue;
+        }
+        auto ok = end_with(file, ".pcap") ? loadPcapFile(file, inputs) : loadRtpFile(file, inputs);
+        if (!ok) {
+            ErrorL << "Load input file failed: " << file;
+            return -1;
+        }
+    }
+    if (inputs.empty()) {
+        inputs.emplace_back(makeSyntheticStream(cmd_main["seconds"].as<int>()));
+    }
+    for (auto &input : inputs) {
+        size_t bytes = 0;
+        for (auto &rtp : input.packets) {
+            bytes += rtp.size();
+        }
+        InfoL << "input: " << input.name << ", packets: " << input.packets.size() << ", bytes: " << bytes;
+    }
+
+    // 开启全部协议复用且不按需复用，hls与hls-fmp4开启时ts与fmp4复用器也会工作
+    // Enable all protocol muxing without on-demand muxing, the ts and fmp4 muxers also work when hls and hls-fmp4 are enabled
+    ProtocolOption option;
+    option.enable_rtsp = option.enable_rtmp = option.enable_ts = option.enable_fmp4 = true;
+    option.enable_hls = option.enable_hls_fmp4 = true;
+    option.rtsp_demand = option.rtmp_demand = option.ts_demand = option.fmp4_demand = option.hls_demand = false;
+    option.enable_mp4 = cmd_main.hasKey("mp4");
+
+    semaphore sem;
+    std::mutex mtx;
+    ReplayStats total;
+    size_t index = 0;
+    auto start = nowNS();
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        auto poller = std::dynamic_pointer_cast<EventPoller>(executor);
+        auto worker = std::make_shared<ReplayWorker>(index++, inputs, loops, option, cmd_main.hasKey("passthrough"), [&](const ReplayStats &stats) {
+            lock_guard<std::mutex> lck(mtx);
+            total.add(stats);
+            sem.post();
+        });
+        worker->start(poller);
+    });
+    for (size_t i = 0; i < index; ++i) {
+        sem.wait();
+    }
+    auto wall_ns = nowNS() - start;
+
+    auto frames = MAX(total.frames, (uint64_t)1);
+    auto demux_ns = total.total_ns - total.mux_ns;
+    auto demux_allocs = total.allocs - total.mux_allocs;
+    cout << "threads: " << index << ", loops: " << loops << ", inputs: " << inputs.size() << endl
+         << "packets: " << total.packets << ", frames: " << total.frames << ", input: " << (total.bytes >> 20) << "MB" << endl
+         << "wall time: " << wall_ns / 1000000 << "ms, frames/s: " << (uint64_t)(total.frames * 1e9 / MAX(wall_ns, (uint64_t)1))
+         << ", frames/s per core: " << (uint64_t)(total.frames * 1e9 / MAX(total.total_ns, (uint64_t)1))
+         << ", input MB/s: " << (uint64_t)((total.bytes >> 20) * 1e9 / MAX(wall_ns, (uint64_t)1)) << endl
+         << "stage rtp sort + ps/ts demux: " << demux_ns / frames << "ns/frame, " << (double)demux_allocs / frames << " allocs/frame" << endl
+         << "stage muxers: " << total.mux_ns / frames << "ns/frame, " << (double)total.mux_allocs / frames << " allocs/frame" << endl
+         << "total: " << total.total_ns / frames << "ns/frame, " << (double)total.allocs / frames << " allocs/frame" << endl
+         << "cpu time: " << total.cpu_ns / 1000000 << "ms, " << total.cpu_ns / MAX(total.packets, (uint64_t)1) << "ns/rtp" << endl;
+    sleep(1);
+    // 没有解析出任何帧说明接入链路出错了
+    // No frame is parsed out, indicating that the ingest path is broken
+    return total.frames ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_RTPPROXY is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_RTPPROXY)
@@ -0,0 +1,216 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Common/config.h"
+#include "Extension/Factory.h"
+#include "Rtp/RtpCache.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_RTPPROXY)
+
+class CMD_main : public BenchCMD {
+public:
+    CMD_main() {
+        (*_parser) << Option('n', "dests", Option::ArgRequired, "1,2,5,10,20", false, "发送目标个数列表，以逗号分隔", nullptr);
+        (*_parser) << Option('s', "seconds", Option::ArgRequired, "60", false, "生成的h264流时长(秒)", nullptr);
+        (*_parser) << Option('t', "type", Option::ArgRequired, "0", false, "打包模式，0:ps 1:ts 2:es", nullptr);
+    }
+
+    const char *description() const override {
+        return "startSendRtp多目标打包性能测试，对比每个目标独立打包与共用一份打包输出(每个目标只改写ssrc/seq)";
+    }
+};
+
+// 一个发送目标，只统计发送的rtp，不走网络
+// A sending target, only counts the sent rtp, no network
+struct Destination {
+    uint32_t ssrc = 0;
+    uint16_t seq = 0;
+    size_t packets = 0;
+    size_t bytes = 0;
+
+    void send(const Buffer::Ptr &buffer) {
+        ++packets;
+        bytes += buffer->size();
+    }
+};
+
+static MediaSinkInterface::Ptr makeEncoder(int type, uint32_t ssrc, RtpCache::onFlushed cb) {
+    switch (type) {
+        case MediaSourceEvent::SendRtpArgs::kRtpTS: return std::make_shared<RtpCachePS>(std::move(cb), ssrc, 96, false);
+        case MediaSourceEvent::SendRtpArgs::kRtpES: return std::make_shared<RtpCacheRaw>(std::move(cb), ssrc, 96, false);
+        default: return std::make_shared<RtpCachePS>(std::move(cb), ssrc, 96, true);
+    }
+}
+
+static vector<Frame::Ptr> makeFrames(size_t seconds, Track::Ptr &track) {
+    static const uint8_t s_sps[] = { 0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x50, 0x05, 0xBB, 0x01, 0x10, 0x00,
+                                     0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0x20, 0xF1, 0x83, 0x19, 0x60 };
+    static const uint8_t s_pps[] = { 0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0 };
+
+    track = Factory::getTrackByCodecId(CodecH264);
+    auto sps = Factory::getFrameFromPtr(CodecH264, (const char *)s_sps, sizeof(s_sps), 0, 0);
+    auto pps = Factory::getFrameFromPtr(CodecH264, (const char *)s_pps, sizeof(s_pps), 0, 0);
+    track->inputFrame(sps);
+    track->inputFrame(pps);
+
+    // 25fps，gop 50，约2Mbps
+    // 25fps, gop 50, about 2Mbps
+    std::mt19937 rng(0);
+    vector<Frame::Ptr> ret;
+    for (size_t i = 0; i < seconds * 25; ++i) {
+        uint64_t stamp = i * 40;
+        bool key = i % 50 == 0;
+        if (key) {
+            ret.emplace_back(Factory::getFrameFromBuffer(CodecH264, std::make_shared<BufferLikeString>(string((const char *)s_sps, sizeof(s_sps))), stamp, stamp));
+            ret.emplace_back(Factory::getFrameFromBuffer(CodecH264, std::make_shared<BufferLikeString>(string((const char *)s_pps, sizeof(s_pps))), stamp, stamp));
+        }
+        string frame { 0, 0, 0, 1, (char)(key ? 0x65 : 0x41) };
+        auto header_size = frame.size();
+        frame.resize(key ? 60000 : 9000 + rng() % 2000);
+        for (auto pos = header_size; pos < frame.size(); ++pos) {
+            // 负载中不出现起始码
+            // No start code in the payload
+            frame[pos] = (char)(0x11 + rng() % 0xE0);
+        }
+        ret.emplace_back(Factory::getFrameFromBuffer(CodecH264, std::make_shared<BufferLikeString>(std::move(frame)), stamp, stamp));
+    }
+    return ret;
+}
+
+// 与RtpSender::inputRtpList一致：最后一个目标直接改写，其他目标拷贝后改写
+// Consistent with RtpSender::inputRtpList: the last target rewrites directly, other targets copy and then rewrite
+static void rewriteAndSend(Destination &dst, const std::shared_ptr<List<Buffer::Ptr>> &rtp_list, bool reuse) {
+    rtp_list->for_each([&](Buffer::Ptr &buffer) {
+        auto rtp = std::static_pointer_cast<RtpPacket>(buffer);
+        if (!reuse) {
+            auto size = rtp->size();
+            auto packet = RtpPacket::create();
+            packet->setCapacity(size);
+            packet->setSize(size);
+            memcpy(packet->data(), rtp->data(), size);
+            packet->sample_rate = rtp->sample_rate;
+            packet->type = rtp->type;
+            packet->ntp_stamp = rtp->ntp_stamp;
+            packet->track_index = rtp->track_index;
+            rtp = std::move(packet);
+        }
+        auto header = rtp->getHeader();
+        header->ssrc = htonl(dst.ssrc);
+        header->seq = htons(dst.seq++);
+        dst.send(rtp);
+    });
+}
+
+// 每个目标独立打包(旧行为)
+// Each target packs independently (old behavior)
+static uint64_t runPrivate(int type, size_t dests, const Track::Ptr &track, const vector<Frame::Ptr> &frames, vector<Destination> &out) {
+    out.assign(dests, Destination());
+    vector<MediaSinkInterface::Ptr> encoders;
+    for (size_t i = 0; i < dests; ++i) {
+        auto &dst = out[i];
+        dst.ssrc = 10000 + i;
+        encoders.emplace_back(makeEncoder(type, dst.ssrc, [&dst](std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool) {
+            rtp_list->for_each([&](Buffer::Ptr &buffer) { dst.send(buffer); });
+        }));
+        encoders.back()->addTrack(track);
+        encoders.back()->addTrackCompleted();
+    }
+    auto start = nowNS();
+    for (auto &frame : frames) {
+        for (auto &encoder : encoders) {
+            encoder->inputFrame(frame);
+        }
+    }
+    for (auto &encoder : encoders) {
+        encoder->flush();
+    }
+    return nowNS() - start;
+}
+
+// 共用一份打包输出(RtpSenderGroup)
+// Share one packing output (RtpSenderGroup)
+static uint64_t runShared(int type, size_t dests, const Track::Ptr &track, const vector<Frame::Ptr> &frames, vector<Destination> &out) {
+    out.assign(dests, Destination());
+    for (size_t i = 0; i < dests; ++i) {
+        out[i].ssrc = 10000 + i;
+    }
+    auto encoder = makeEncoder(type, 0, [&out](std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool) {
+        for (size_t i = 0; i < out.size(); ++i) {
+            rewriteAndSend(out[i], rtp_list, i + 1 == out.size());
+        }
+    });
+    encoder->addTrack(track);
+    encoder->addTrackCompleted();
+    auto start = nowNS();
+    for (auto &frame : frames) {
+        encoder->inputFrame(frame);
+    }
+    encoder->flush();
+    return nowNS() - start;
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    int ret = 0;
+    if (!initBench(cmd_main, argc, argv, ret)) {
+        return ret;
+    }
+
+    int type = cmd_main["type"].as<int>();
+    Track::Ptr track;
+    auto frames = makeFrames(MAX(cmd_main["seconds"].as<int>(), 1), track);
+    if (!track->ready()) {
+        ErrorL << "h264 track not ready";
+        return -1;
+    }
+
+    bool ok = true;
+    string dests_str = cmd_main["dests"];
+    for (auto &str : split(dests_str, ",")) {
+        auto dests = (size_t)MAX(atoi(trim(str).data()), 1);
+        vector<Destination> private_out, shared_out;
+        auto private_ns = runPrivate(type, dests, track, frames, private_out);
+        auto shared_ns = runShared(type, dests, track, frames, shared_out);
+
+        // 两种方式每个目标收到的rtp个数与字节数应该一致
+        // The number of rtp packets and bytes received by each target should be the same in both ways
+        for (size_t i = 0; i < dests; ++i) {
+            if (private_out[i].packets != shared_out[i].packets || private_out[i].bytes != shared_out[i].bytes || !shared_out[i].packets) {
+                ErrorL << "output mismatch, dests: " << dests << ", index: " << i << ", packets: " << private_out[i].packets << " != " << shared_out[i].packets
+                       << ", bytes: " << private_out[i].bytes << " != " << shared_out[i].bytes;
+                ok = false;
+            }
+        }
+        cout << "dests: " << dests << ", frames: " << frames.size() << ", rtp per dest: " << shared_out[0].packets << endl
+             << "  private encoders: " << private_ns / frames.size() << "ns/frame" << endl
+             << "  shared encoder:   " << shared_ns / frames.size() << "ns/frame, speedup: " << (double)private_ns / MAX(shared_ns, (uint64_t)1) << "x" << endl;
+    }
+    return ok ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_RTPPROXY is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_RTPPROXY)
@@ -0,0 +1,239 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Network/sockutil.h"
+#include "Http/HttpRequestSplitter.h"
+#include "Rtp/RtpSplitter.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_RTPPROXY)
+
+class CMD_main : public BenchCMD {
+public:
+    CMD_main() {
+        (*_parser) << Option('b', "mbps", Option::ArgRequired, "100", false, "发送码率(Mbps)", nullptr);
+        (*_parser) << Option('s', "seconds", Option::ArgRequired, "10", false, "每种封装的发送时长(秒)", nullptr);
+        (*_parser) << Option('r', "recv", Option::ArgRequired, to_string(256 * 1024).data(), false, "每次recv的最大字节数(与socket读缓存一致)", nullptr);
+    }
+
+    const char *description() const override {
+        return "tcp回环rtp推流(rfc4571与$交织封装)分包性能测试，对比HttpRequestSplitter分包与RtpSplitter快速分包";
+    }
+};
+
+struct SplitStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t checksum = 0;
+    uint64_t ns = 0;
+
+    void onPacket(const char *data, size_t len) {
+        ++packets;
+        bytes += len;
+        checksum = checksum * 31 + (uint8_t)data[len - 1] + len;
+    }
+
+    bool operator==(const SplitStats &that) const { return packets == that.packets && bytes == that.bytes && checksum == that.checksum; }
+};
+
+// 修改前的分包方式：基于HttpRequestSplitter，有缓存时把整个输入追加到缓存后再分包
+// The splitting method before modification: based on HttpRequestSplitter, when there is a cache, the whole input is appended to the cache and then split
+class LegacyRtpSplitter : public HttpRequestSplitter {
+public:
+    SplitStats stats;
+
+protected:
+    ssize_t onRecvHeader(const char *data, size_t len) override {
+        data += _offset;
+        len -= _offset;
+        stats.onPacket(data, len);
+        return 0;
+    }
+
+    const char *onSearchPacketTail(const char *data, size_t len) override {
+        if (len < 4) {
+            return nullptr;
+        }
+        if (_is_rtsp_interleaved) {
+            if (data[0] == '$') {
+                _offset = 4;
+                return onSearchPacketTail_l(data + 2, len - 2);
+            }
+            _is_rtsp_interleaved = false;
+        }
+        _offset = 2;
+        return onSearchPacketTail_l(data, len);
+    }
+
+private:
+    const char *onSearchPacketTail_l(const char *data, size_t len) {
+        uint16_t length = (((uint8_t *)data)[0] << 8) | ((uint8_t *)data)[1];
+        if (len < (size_t)(length + 2)) {
+            return nullptr;
+        }
+        return data + 2 + length;
+    }
+
+private:
+    bool _is_rtsp_interleaved = true;
+    size_t _offset = 0;
+};
+
+class FastRtpSplitter : public RtpSplitter {
+public:
+    SplitStats stats;
+
+protected:
+    void onRtpPacket(const char *data, size_t len) override { stats.onPacket(data, len); }
+};
+
+// 生成rtp over tcp码流，rtp长度与国标ps推流相近，关键帧时有连续的大包
+// Generate rtp over tcp stream, the rtp length is similar to GB28181 ps push stream, there are consecutive large packets at key frames
+static string makeStream(size_t bytes, bool interleaved, uint64_t &packets) {
+    std::mt19937 rng(interleaved);
+    string ret;
+    ret.reserve(bytes + 2048);
+    uint16_t seq = 0;
+    packets = 0;
+    while (ret.size() < bytes) {
+        size_t size = seq % 300 < 40 ? 1400 : 200 + rng() % 1200;
+        string rtp(size, 0);
+        rtp[0] = (char)0x80;
+        rtp[1] = 96;
+        rtp[2] = (char)(seq >> 8);
+        rtp[3] = (char)seq;
+        for (size_t i = 12; i < size; ++i) {
+            rtp[i] = (char)rng();
+        }
+        ++seq;
+        if (interleaved) {
+            ret.append({ '$', 0, (char)(size >> 8), (char)size });
+        } else {
+            ret.append({ (char)(size >> 8), (char)size });
+        }
+        ret.append(rtp);
+        ++packets;
+    }
+    return ret;
+}
+
+static bool runCase(bool interleaved, double mbps, int seconds, size_t recv_size) {
+    uint64_t packets;
+    auto stream = makeStream((size_t)(mbps * 1000000 / 8 * seconds), interleaved, packets);
+
+    auto server = SockUtil::listen(0, "127.0.0.1");
+    if (server < 0) {
+        ErrorL << "listen failed: " << get_uv_errmsg();
+        return false;
+    }
+    auto port = SockUtil::get_local_port(server);
+    auto client = SockUtil::connect("127.0.0.1", port, false, "0.0.0.0");
+    auto peer = accept(server, nullptr, nullptr);
+    close(server);
+    if (client < 0 || peer < 0) {
+        ErrorL << "connect failed: " << get_uv_errmsg();
+        return false;
+    }
+
+    // 按码率均匀发送，每毫秒发送一次
+    // Send evenly according to the bit rate, send once every millisecond
+    thread sender([&]() {
+        auto start = nowNS();
+        size_t sent = 0;
+        while (sent < stream.size()) {
+            auto should = std::min(stream.size(), (size_t)((nowNS() - start) / 1e9 * mbps * 1000000 / 8) + 1);
+            while (sent < should) {
+                auto n = ::send(client, stream.data() + sent, should - sent, 0);
+                if (n <= 0) {
+                    return;
+                }
+                sent += n;
+            }
+            usleep(1000);
+        }
+        ::shutdown(client, SHUT_WR);
+    });
+
+    LegacyRtpSplitter legacy;
+    FastRtpSplitter fast;
+    // HttpRequestSplitter会在数据末尾写0，预留一个字节
+    // HttpRequestSplitter will write 0 at the end of the data, reserve one byte
+    string buf(recv_size + 1, '\0');
+    uint64_t reads = 0;
+    uint64_t received = 0;
+    auto start = nowNS();
+    while (true) {
+        auto n = recv(peer, &buf[0], recv_size, 0);
+        if (n <= 0) {
+            break;
+        }
+        ++reads;
+        received += n;
+        auto t0 = nowNS();
+        legacy.input(buf.data(), n);
+        auto t1 = nowNS();
+        fast.input(buf.data(), n);
+        auto t2 = nowNS();
+        legacy.stats.ns += t1 - t0;
+        fast.stats.ns += t2 - t1;
+    }
+    auto wall_ns = nowNS() - start;
+    sender.join();
+    close(client);
+    close(peer);
+
+    auto ok = legacy.stats == fast.stats && fast.stats.packets == packets;
+    cout << (interleaved ? "$ interleaved" : "rfc4571") << ": " << (received >> 20) << "MB in " << wall_ns / 1000000 << "ms ("
+         << (uint64_t)(received * 8 / 1000.0 / MAX(wall_ns / 1000000, (uint64_t)1)) << "Mbps), reads: " << reads << ", rtp: " << fast.stats.packets << "/" << packets << endl
+         << "  HttpRequestSplitter: " << legacy.stats.ns / MAX(legacy.stats.packets, (uint64_t)1) << "ns/rtp, total " << legacy.stats.ns / 1000 << "us" << endl
+         << "  RtpSplitter:         " << fast.stats.ns / MAX(fast.stats.packets, (uint64_t)1) << "ns/rtp, total " << fast.stats.ns / 1000 << "us, speedup: "
+         << (double)legacy.stats.ns / MAX(fast.stats.ns, (uint64_t)1) << "x" << endl;
+    if (!ok) {
+        ErrorL << "split result mismatch, legacy rtp: " << legacy.stats.packets << ", fast rtp: " << fast.stats.packets << ", sent rtp: " << packets;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    int ret = 0;
+    if (!initBench(cmd_main, argc, argv, ret)) {
+        return ret;
+    }
+
+    auto mbps = MAX(cmd_main["mbps"].as<double>(), 1.0);
+    auto seconds = MAX(cmd_main["seconds"].as<int>(), 1);
+    auto recv_size = (size_t)MAX(cmd_main["recv"].as<int>(), 1);
+    bool ok = runCase(false, mbps, seconds, recv_size);
+    ok = runCase(true, mbps, seconds, recv_size) && ok;
+    return ok ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_RTPPROXY is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_RTPPROXY)
@@ -0,0 +1,134 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <queue>
+#include <random>
+#include <vector>
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "srt/PacketQueue.hpp"
+
+using namespace std;
+using namespace toolkit;
+using namespace SRT;
+
+// 模拟一条带抖动与丢包的链路，发送端按nak重传，统计接收队列的处理性能
+// Simulate a link with jitter and loss, the sender retransmits according to nak, count the processing performance of the receive queue
+
+struct Arrival {
+    uint64_t time;
+    size_t index;
+    bool operator>(const Arrival &that) const { return time > that.time; }
+};
+
+static void testQueue(const char *name, PacketQueueInterface &queue, vector<DataPacket::Ptr> &packets, uint32_t init_seq,
+                      uint64_t interval_us, float loss_rate, uint64_t jitter_us) {
+    // 单向时延20ms，nak间隔20ms
+    // One-way delay 20ms, nak interval 20ms
+    static constexpr uint64_t kOneWayDelay = 20 * 1000;
+    static constexpr uint64_t kNakInterval = 20 * 1000;
+
+    mt19937 rng(1234);
+    uniform_real_distribution<float> drop(0, 100);
+    uniform_int_distribution<uint64_t> jitter(0, jitter_us);
+
+    priority_queue<Arrival, vector<Arrival>, greater<Arrival> > link;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (drop(rng) >= loss_rate) {
+            link.push(Arrival { i * interval_us + kOneWayDelay + jitter(rng), i });
+        }
+    }
+
+    PacketQueueInterface::PacketList out;
+    PacketQueueInterface::LostList lost;
+    uint64_t next_nak = kNakInterval;
+    uint64_t delivered = 0, skipped = 0, retransmit = 0, nak_count = 0;
+    uint32_t expected = init_seq;
+
+    Ticker ticker;
+    while (!link.empty()) {
+        auto arrival = link.top();
+        link.pop();
+
+        while (arrival.time >= next_nak) {
+            // 周期性nak，发送端立即重传(仍可能丢失)
+            // Periodic nak, the sender retransmits immediately (may still be lost)
+            queue.getLostSeq(lost);
+            for (auto &pr : lost) {
+                ++nak_count;
+                for (auto seq = pr.first; seq != pr.second; seq = genExpectedSeq(seq + 1)) {
+                    auto index = genExpectedSeq(seq - init_seq);
+                    if (index < packets.size() && drop(rng) >= loss_rate) {
+                        link.push(Arrival { next_nak + 2 * kOneWayDelay, index });
+                        ++retransmit;
+                    }
+                }
+            }
+            next_nak += kNakInterval;
+        }
+
+        queue.inputPacket(packets[arrival.index], out);
+        for (auto &pkt : out) {
+            if (pkt->packet_seq_number != expected) {
+                skipped += genExpectedSeq(pkt->packet_seq_number - expected);
+            }
+            expected = genExpectedSeq(pkt->packet_seq_number + 1);
+        }
+        delivered += out.size();
+        out.clear();
+    }
+    auto elapsed = ticker.elapsedTime();
+
+    InfoL << name << " loss: " << loss_rate << "%, jitter: " << jitter_us / 1000 << "ms"
+          << ", delivered: " << delivered << "/" << packets.size()
+          << ", skipped: " << skipped
+          << ", nak ranges: " << nak_count
+          << ", retransmit: " << retransmit
+          << ", elapsed: " << elapsed << "ms"
+          << ", speed: " << (elapsed ? (delivered + retransmit) / elapsed : 0) << "k pkt/s";
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", LInfo));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    // 默认模拟50Mbps码率、60秒的推流
+    // Simulate 50Mbps bitrate and 60 seconds of push stream by default
+    size_t bitrate = argc > 1 ? atoi(argv[1]) : 50 * 1000 * 1000;
+    size_t seconds = argc > 2 ? atoi(argv[2]) : 60;
+    uint32_t latency_ms = 120;
+    uint32_t buf_size = 8192;
+
+    auto pps = bitrate / (1316 * 8);
+    auto interval_us = 1000 * 1000 / pps;
+    // 起始seq靠近回环点，同时覆盖seq回环
+    // The initial seq is close to the wrap point, also covering seq wrap-around
+    uint32_t init_seq = MAX_SEQ - 1000;
+
+    vector<DataPacket::Ptr> packets(pps * seconds);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        auto pkt = std::make_shared<DataPacket>();
+        pkt->packet_seq_number = genExpectedSeq(init_seq + i);
+        pkt->timestamp = (uint32_t)(i * interval_us);
+        packets[i] = std::move(pkt);
+    }
+
+    for (auto loss_rate : { 0.0f, 1.0f, 5.0f, 10.0f }) {
+        for (auto jitter_ms : { 0, 10, 50 }) {
+            PacketRecvQueue ring(buf_size, init_seq, latency_ms * 1000);
+            testQueue("ring", ring, packets, init_seq, interval_us, loss_rate, jitter_ms * 1000);
+            PacketQueue map(buf_size, init_seq, latency_ms * 1000);
+            testQueue("map ", map, packets, init_seq, interval_us, loss_rate, jitter_ms * 1000);
+        }
+    }
+    sleep(1);
+    return 0;
+}
@@ -0,0 +1,169 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <type_traits>
+#include <iostream>
+#include <sys/resource.h>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/Timer.h"
+#include "Poller/EventPoller.h"
+#include "Thread/semaphore.h"
+#include "Common/TimerWheel.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+        (*_parser) << Option('l', "level", Option::ArgRequired, to_string(LWarn).data(), false, "日志等级,LTrace~LError(0~4)", nullptr);
+        (*_parser) << Option('t', "threads", Option::ArgRequired, to_string(thread::hardware_concurrency()).data(), false, "poller线程数", nullptr);
+        (*_parser) << Option('n', "sources", Option::ArgRequired, "10000", false, "模拟的rtp推流个数", nullptr);
+        (*_parser) << Option('i', "interval", Option::ArgRequired, "3", false, "每路超时检测定时器间隔(秒)，与RtpProcess一致", nullptr);
+        (*_parser) << Option('s', "seconds", Option::ArgRequired, "30", false, "每种定时器的空闲统计时长(秒)", nullptr);
+    }
+
+    const char *description() const override {
+        return "模拟上万路空闲rtp推流的超时检测，对比toolkit::Timer与时间轮的cpu占用与poller唤醒次数";
+    }
+};
+
+// 模拟一路rtp推流的超时检测，与RtpProcess::onManager一致：只检查最后收包时间
+// Simulate the timeout check of an rtp push stream, consistent with RtpProcess::onManager: only check the last packet receiving time
+struct FakeSource {
+    bool alive = true;
+    Ticker last_recv;
+};
+
+static atomic<uint64_t> s_callbacks { 0 };
+
+static uint64_t cpuUS() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1000000ULL + usage.ru_utime.tv_usec + usage.ru_stime.tv_sec * 1000000ULL + usage.ru_stime.tv_usec;
+}
+
+static uint64_t totalWakeups() {
+    atomic<uint64_t> total { 0 };
+    semaphore sem;
+    size_t count = 0;
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        auto poller = std::dynamic_pointer_cast<EventPoller>(executor);
+        ++count;
+        poller->async([&, poller]() {
+            total += TimerWheel::getInstance(poller)->wakeups();
+            sem.post();
+        });
+    });
+    for (size_t i = 0; i < count; ++i) {
+        sem.wait();
+    }
+    return total;
+}
+
+template <typename TimerType>
+static void runCase(const char *name, size_t sources, float interval, int seconds) {
+    vector<shared_ptr<FakeSource>> fake_sources;
+    vector<shared_ptr<TimerType>> timers;
+    fake_sources.reserve(sources);
+    timers.reserve(sources);
+
+    // 推流在一个定时周期内陆续接入，定时器触发时间分散
+    // The push streams are connected one after another within a timer period, the timer trigger time is scattered
+    auto setup_ns = 0ULL;
+    mt19937 rng(0);
+    uniform_int_distribution<int> jitter(0, (int)(interval * 1000) - 1);
+    vector<int> delays(sources);
+    for (auto &delay : delays) {
+        delay = jitter(rng);
+    }
+    sort(delays.begin(), delays.end());
+    Ticker ticker;
+    for (size_t i = 0; i < sources; ++i) {
+        auto wait = delays[i] - (int)ticker.elapsedTime();
+        if (wait > 0) {
+            usleep(wait * 1000);
+        }
+        auto source = std::make_shared<FakeSource>();
+        weak_ptr<FakeSource> weak_source = source;
+        auto begin = chrono::steady_clock::now();
+        timers.emplace_back(std::make_shared<TimerType>(interval, [weak_source]() {
+            auto strong_source = weak_source.lock();
+            if (!strong_source) {
+                return false;
+            }
+            ++s_callbacks;
+            strong_source->alive = strong_source->last_recv.elapsedTime() < 15 * 1000;
+            return true;
+        }, EventPollerPool::Instance().getPoller()));
+        setup_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count();
+        fake_sources.emplace_back(std::move(source));
+    }
+
+    s_callbacks = 0;
+    auto wakeups = totalWakeups();
+    auto cpu = cpuUS();
+    sleep(seconds);
+    cpu = cpuUS() - cpu;
+    auto callbacks = s_callbacks.load();
+    // toolkit::Timer每个回调都是一次poller延时任务唤醒
+    // Each callback of toolkit::Timer is a poller delayed task wakeup
+    wakeups = std::is_same<TimerType, WheelTimer>::value ? totalWakeups() - wakeups : callbacks;
+
+    auto begin = chrono::steady_clock::now();
+    timers.clear();
+    auto cancel_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count();
+    fake_sources.clear();
+
+    cout << name << ": sources: " << sources << ", idle seconds: " << seconds << endl
+         << "  timer callbacks: " << callbacks << ", poller timer wakeups: " << wakeups << " (" << wakeups / MAX(seconds, 1) << "/s)" << endl
+         << "  idle cpu: " << cpu / 1000 << "ms (" << cpu / 10000.0 / MAX(seconds, 1) << "% of one core)" << endl
+         << "  arm: " << setup_ns / MAX(sources, (size_t)1) << "ns/timer, disarm: " << cancel_ns / MAX(sources, (size_t)1) << "ns/timer" << endl;
+    // 等待取消操作在poller线程执行完毕
+    // Wait for the cancel operation to be executed in the poller thread
+    sleep(1);
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    LogLevel level = (LogLevel)cmd_main["level"].as<int>();
+    level = MIN(MAX(level, LTrace), LError);
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", level));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    EventPollerPool::setPoolSize(MAX(cmd_main["threads"].as<int>(), 1));
+    size_t sources = MAX(cmd_main["sources"].as<int>(), 1);
+    float interval = MAX(cmd_main["interval"].as<float>(), 0.1f);
+    int seconds = MAX(cmd_main["seconds"].as<int>(), 1);
+
+    runCase<Timer>("toolkit::Timer", sources, interval, seconds);
+    runCase<WheelTimer>("WheelTimer", sources, interval, seconds);
+    return 0;
+}
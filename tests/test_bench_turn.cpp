@@ -0,0 +1,151 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/EventPoller.h"
+#include "Network/UdpClient.h"
+#include "../webrtc/IceTransport.hpp"
+
+using namespace std;
+using namespace toolkit;
+using namespace RTC;
+
+static constexpr uint16_t kChannelNumber = 0x4000;
+
+class BenchListener : public IceTransport::Listener {
+public:
+    void onIceTransportRecvData(const Buffer::Ptr &buffer, const IceTransport::Pair::Ptr &pair) override {}
+    void onIceTransportGatheringCandidate(const IceTransport::Pair::Ptr &pair, const CandidateInfo &candidate) override {}
+    void onIceTransportDisconnected() override {}
+    void onIceTransportCompleted() override {}
+};
+
+// 跳过allocate/鉴权流程，直接建立中继分配、权限与通道绑定
+// Skip the allocate/authentication process, directly set up the relay allocation, permission and channel binding
+class BenchIceServer : public IceServer {
+public:
+    using IceServer::IceServer;
+
+    SocketHelper::Ptr allocate(const Pair::Ptr &session_pair) {
+        _session_pair = session_pair;
+        return allocateRelayed(session_pair);
+    }
+
+    void bindChannel(uint16_t channel_number, const sockaddr_storage &peer_addr) {
+        addPermission(peer_addr);
+        addChannelBind(channel_number, peer_addr);
+    }
+};
+
+static Socket::Ptr createCounterSocket(const EventPoller::Ptr &poller, atomic<uint64_t> &packets, atomic<uint64_t> &bytes) {
+    auto sock = Socket::createSocket(poller, false);
+    if (!sock->bindUdpSock(0, "127.0.0.1")) {
+        throw std::runtime_error("bind udp socket failed");
+    }
+    sock->setOnRead([&packets, &bytes](const Buffer::Ptr &buf, struct sockaddr *, int) {
+        ++packets;
+        bytes += buf->size();
+    });
+    return sock;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", LInfo));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 200000;
+    size_t payload_size = argc > 2 ? atoi(argv[2]) : 1200;
+
+    auto poller = EventPollerPool::Instance().getPoller();
+    BenchListener listener;
+
+    atomic<uint64_t> client_packets { 0 }, client_bytes { 0 }, peer_packets { 0 }, peer_bytes { 0 };
+    // 模拟TURN客户端与对端peer
+    // Simulate the TURN client and the remote peer
+    auto client = createCounterSocket(poller, client_packets, client_bytes);
+    auto peer = createCounterSocket(poller, peer_packets, peer_bytes);
+    auto peer_addr = SockUtil::make_sockaddr("127.0.0.1", peer->get_local_port());
+
+    std::shared_ptr<BenchIceServer> server;
+    IceTransport::Pair::Ptr session_pair;
+    SocketHelper::Ptr relayed;
+    poller->sync([&]() {
+        server = std::make_shared<BenchIceServer>(&listener, "bench", "bench", poller);
+        server->initialize();
+        // TURN服务端监听socket，对端为客户端
+        // The TURN server listening socket, whose peer is the client
+        auto session_sock = std::make_shared<UdpClient>(poller);
+        session_sock->startConnect("127.0.0.1", client->get_local_port());
+        session_pair = std::make_shared<IceTransport::Pair>(session_sock, "127.0.0.1", client->get_local_port());
+        relayed = server->allocate(session_pair);
+        server->bindChannel(kChannelNumber, peer_addr);
+    });
+    // 等待socket就绪
+    // Wait for the sockets to be ready
+    usleep(100 * 1000);
+
+    // 客户端->peer: ChannelData解封装后经中继socket发送
+    // client->peer: ChannelData is unwrapped and sent through the relayed socket
+    string channel_data(4 + payload_size, 'x');
+    channel_data[0] = (char)(kChannelNumber >> 8);
+    channel_data[1] = (char)(kChannelNumber & 0xFF);
+    channel_data[2] = (char)(payload_size >> 8);
+    channel_data[3] = (char)(payload_size & 0xFF);
+
+    Ticker ticker;
+    for (size_t i = 0; i < count; i += 256) {
+        // 每次事件循环模拟一批recvmmsg收到的数据
+        // Simulate a batch of data received by recvmmsg in each event loop round
+        poller->sync([&]() {
+            for (size_t j = i; j < i + 256 && j < count; ++j) {
+                server->processSocketData((const uint8_t *)channel_data.data(), channel_data.size(), session_pair);
+            }
+        });
+    }
+    auto backing_ms = ticker.elapsedTime();
+    usleep(200 * 1000);
+
+    // peer->客户端: 原始数据经中继socket接收后封装为ChannelData
+    // peer->client: raw data is received by the relayed socket and wrapped into ChannelData
+    auto relayed_addr = SockUtil::make_sockaddr(relayed->get_local_ip().data(), relayed->get_local_port());
+    auto payload = std::make_shared<BufferLikeString>(string(payload_size, 'y'));
+    ticker.resetTime();
+    for (size_t i = 0; i < count; i += 256) {
+        poller->sync([&]() {
+            for (size_t j = i; j < i + 256 && j < count; ++j) {
+                peer->send(payload, (struct sockaddr *)&relayed_addr, SockUtil::get_sock_len((struct sockaddr *)&relayed_addr), false);
+            }
+            peer->flushAll();
+        });
+    }
+    auto forwarding_ms = ticker.elapsedTime();
+    usleep(200 * 1000);
+
+    poller->sync([&]() {
+        auto &stat = server->getRelayStatistic();
+        InfoL << "payload size: " << payload_size << ", packets: " << count;
+        InfoL << "client->peer: " << count * 1000.0 / (backing_ms ? backing_ms : 1) << " pps"
+              << ", relayed: " << stat.backing_packets << ", peer received: " << peer_packets;
+        InfoL << "peer->client: " << count * 1000.0 / (forwarding_ms ? forwarding_ms : 1) << " pps"
+              << ", relayed: " << stat.forwarding_packets << ", client received: " << client_packets
+              << ", bytes: " << client_bytes;
+        InfoL << "flush count: " << stat.flush_count << ", avg packets per flush: "
+              << (stat.backing_packets + stat.forwarding_packets) * 1.0 / (stat.flush_count ? stat.flush_count : 1)
+              << ", dropped: " << stat.dropped_packets;
+        server = nullptr;
+        relayed = nullptr;
+        session_pair = nullptr;
+    });
+    sleep(1);
+    return 0;
+}
@@ -0,0 +1,135 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <random>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Common/config.h"
+#include "Common/Parser.h"
+#include "Record/HlsMaker.h"
+
+#if defined(ENABLE_OPENSSL)
+#include <openssl/evp.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_OPENSSL)
+
+// 在内存中生成hls，保存密钥、切片与m3u8
+// Generate hls in memory, save the keys, segments and m3u8
+class HlsMakerMemory : public HlsMaker {
+public:
+    using HlsMaker::HlsMaker;
+
+    map<string, string> keys;
+    map<string, string> segments;
+    string m3u8;
+
+protected:
+    string onOpenSegment(uint64_t index) override {
+        _current = to_string(index) + ".ts";
+        segments[_current].clear();
+        return _current;
+    }
+    void onDelSegment(uint64_t index) override {}
+    void onWriteInitSegment(const char *data, size_t len) override {}
+    void onWriteSegment(const char *data, size_t len) override { segments[_current].append(data, len); }
+    void onWriteHls(const string &data, bool include_delay) override { m3u8 = data; }
+    string onWriteKey(uint64_t index, const string &key) override {
+        auto uri = "key_" + to_string(index) + ".key";
+        keys[uri] = key;
+        return uri;
+    }
+
+private:
+    string _current;
+};
+
+static string decrypt(const string &key, const string &iv_hex, const string &data) {
+    uint8_t iv[16];
+    for (int i = 0; i < 16; ++i) {
+        iv[i] = (uint8_t)stoi(iv_hex.substr(i * 2, 2), nullptr, 16);
+    }
+    string out(data.size() + 16, '\0');
+    int len1 = 0, len2 = 0;
+    auto ctx = EVP_CIPHER_CTX_new();
+    EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), nullptr, (const uint8_t *)key.data(), iv);
+    EVP_DecryptUpdate(ctx, (uint8_t *)&out[0], &len1, (const uint8_t *)data.data(), (int)data.size());
+    auto ok = EVP_DecryptFinal_ex(ctx, (uint8_t *)&out[0] + len1, &len2);
+    EVP_CIPHER_CTX_free(ctx);
+    if (ok != 1) {
+        return "";
+    }
+    out.resize(len1 + len2);
+    return out;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    mINI::Instance()[Hls::kEncrypt] = 1;
+    mINI::Instance()[Hls::kKeyRotateSegNum] = 2;
+    HlsMakerMemory maker(false, 1, 10);
+
+    // 输入随机长度的数据块，每秒一个关键帧，保存明文用于校验
+    // Input data chunks with random lengths, one key frame per second, save the plaintext for verification
+    mt19937 rng(1234);
+    uniform_int_distribution<int> size_dist(1, 4000);
+    map<string, string> plain;
+    string chunk;
+    for (uint64_t stamp = 0; stamp <= 8000; stamp += 40) {
+        chunk.resize(size_dist(rng));
+        for (auto &ch : chunk) {
+            ch = (char)rng();
+        }
+        maker.inputData(chunk.data(), chunk.size(), stamp, stamp % 1000 == 0);
+        plain[to_string(stamp / 1000) + ".ts"] += chunk;
+    }
+    maker.inputData(nullptr, 0, 8000, false);
+
+    // 逐个切片按照m3u8中的EXT-X-KEY解密并比较
+    // Decrypt each segment according to the EXT-X-KEY in m3u8 and compare
+    size_t checked = 0, failed = 0;
+    string uri, iv;
+    auto lines = split(maker.m3u8, "\n");
+    for (auto &line : lines) {
+        if (start_with(line, "#EXT-X-KEY:")) {
+            uri = findSubString(line.data(), "URI=\"", "\"");
+            iv = findSubString(line.data(), "IV=0x", nullptr);
+            continue;
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        ++checked;
+        if (decrypt(maker.keys[uri], iv, maker.segments[line]) != plain[line]) {
+            ++failed;
+            WarnL << "decrypt failed: " << line;
+        }
+    }
+    InfoL << "segments: " << checked << ", failed: " << failed << ", keys: " << maker.keys.size();
+    sleep(1);
+    return failed || !checked ? -1 : 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_OPENSSL is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_OPENSSL)
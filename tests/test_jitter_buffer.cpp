@@ -0,0 +1,184 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Poller/EventPoller.h"
+#include "Extension/Factory.h"
+#include "Rtcp/RtcpContext.h"
+#include "Rtp/FrameJitterBuffer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_RTPPROXY)
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+        (*_parser) << Option('l', "level", Option::ArgRequired, to_string(LWarn).data(), false, "日志等级,LTrace~LError(0~4)", nullptr);
+        (*_parser) << Option('s', "seconds", Option::ArgRequired, "30", false, "模拟推流时长(秒)", nullptr);
+        (*_parser) << Option('m', "max", Option::ArgRequired, "1000", false, "去抖动缓存最大时长(毫秒)", nullptr);
+        (*_parser) << Option('b', "burst", Option::ArgRequired, "500", false, "网络卡顿后突发到达的最大卡顿时长(毫秒)", nullptr);
+    }
+
+    const char *description() const override {
+        return "模拟4G网络下国标推流突发到达，对比经过自适应去抖动缓存前后的帧间隔与卡顿次数";
+    }
+};
+
+// 25fps
+static constexpr uint64_t kFrameMS = 40;
+
+struct FrameTiming {
+    uint64_t dts;
+    uint64_t stamp;
+};
+
+struct TimingStats {
+    uint64_t frames = 0;
+    uint64_t stutters = 0;
+    double variance = 0;
+
+    // 帧间隔超过2个帧时长视为卡顿
+    // The frame interval exceeding 2 frame durations is regarded as a stutter
+    static TimingStats make(const vector<FrameTiming> &timings) {
+        TimingStats ret;
+        ret.frames = timings.size();
+        for (size_t i = 1; i < timings.size(); ++i) {
+            auto interval = (int64_t)(timings[i].stamp - timings[i - 1].stamp);
+            auto expect = (int64_t)(timings[i].dts - timings[i - 1].dts);
+            ret.stutters += interval > 2 * (int64_t)kFrameMS;
+            ret.variance += (double)(interval - expect) * (interval - expect);
+        }
+        ret.variance /= MAX(timings.size(), (size_t)2) - 1;
+        return ret;
+    }
+};
+
+// 模拟4G网络：平时有几十毫秒的随机延时，每隔几秒卡顿一次，卡顿期间的帧在卡顿结束后突发到达
+// Simulate 4G network: there is a random delay of tens of milliseconds usually, it stutters every few seconds, and the frames during the stutter arrive in a burst after the stutter ends
+static vector<uint64_t> makeArrival(size_t frames, uint64_t max_burst_ms) {
+    std::mt19937 rng(0);
+    vector<uint64_t> ret(frames);
+    uint64_t stall_start = 2000 + rng() % 2000;
+    uint64_t stall_end = stall_start + 100 + rng() % MAX(max_burst_ms, (uint64_t)1);
+    uint64_t last = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        auto send = i * kFrameMS;
+        auto arrival = send + 30 + rng() % 30;
+        if (arrival >= stall_end) {
+            stall_start = stall_end + 2000 + rng() % 2000;
+            stall_end = stall_start + 100 + rng() % MAX(max_burst_ms, (uint64_t)1);
+        }
+        if (arrival >= stall_start && arrival < stall_end) {
+            arrival = stall_end + rng() % 5;
+        }
+        // tcp或者udp按序到达
+        // Arrive in order with tcp or udp
+        last = arrival = MAX(arrival, last);
+        ret[i] = arrival;
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    LogLevel level = (LogLevel)cmd_main["level"].as<int>();
+    level = MIN(MAX(level, LTrace), LError);
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", level));
+
+    auto seconds = MAX(cmd_main["seconds"].as<int>(), 1);
+    auto max_delay_ms = (uint32_t)MAX(cmd_main["max"].as<int>(), 0);
+    auto frames = (size_t)(seconds * 1000 / kFrameMS);
+    auto arrival = makeArrival(frames, MAX(cmd_main["burst"].as<int>(), 0));
+
+    auto poller = EventPollerPool::Instance().getPoller();
+    vector<FrameTiming> input, output;
+    input.reserve(frames);
+    output.reserve(frames);
+    auto jitter_buffer = std::make_shared<FrameJitterBuffer>(max_delay_ms, poller, [&output](const Frame::Ptr &frame) {
+        output.emplace_back(FrameTiming { frame->dts(), getCurrentMillisecond() });
+    });
+    // 与RtpProcess一致，使用rtcp统计的到达抖动
+    // Consistent with RtpProcess, use the arrival jitter counted by rtcp
+    auto rtcp = std::make_shared<RtcpContextForRecv>();
+
+    string payload { 0, 0, 0, 1, 0x41 };
+    payload.resize(5000, 0x11);
+    auto start = getCurrentMillisecond();
+    for (size_t i = 0; i < frames; ++i) {
+        auto now = getCurrentMillisecond() - start;
+        if (arrival[i] > now) {
+            this_thread::sleep_for(chrono::milliseconds(arrival[i] - now));
+        }
+        auto dts = i * kFrameMS;
+        auto frame = Factory::getFrameFromBuffer(CodecH264, std::make_shared<BufferLikeString>(payload), dts, dts);
+        poller->async([&, frame, i]() {
+            rtcp->onRtp((uint16_t)i, (uint32_t)(frame->dts() * 90), 0, 90000, frame->size());
+            input.emplace_back(FrameTiming { frame->dts(), getCurrentMillisecond() });
+            jitter_buffer->setJitter(rtcp->getJitter() / 90);
+            jitter_buffer->inputFrame(frame);
+        });
+    }
+
+    // 等待缓存输出完毕
+    // Wait for the cache to be output
+    this_thread::sleep_for(chrono::milliseconds(max_delay_ms + 200));
+    FrameJitterBuffer::Statistic statistic;
+    poller->sync([&]() {
+        statistic = jitter_buffer->getStatistic();
+        jitter_buffer->flush();
+        jitter_buffer = nullptr;
+    });
+
+    auto in = TimingStats::make(input);
+    auto out = TimingStats::make(output);
+    cout << "frames: " << frames << ", max delay: " << max_delay_ms << "ms" << endl
+         << "  arrival: stutters: " << in.stutters << ", interval deviation: " << sqrt(in.variance) << "ms" << endl
+         << "  output:  stutters: " << out.stutters << ", interval deviation: " << sqrt(out.variance) << "ms" << endl
+         << "  jitter: " << statistic.jitter_ms << "ms, delay: " << statistic.delay_ms << "ms, target: " << statistic.target_ms
+         << "ms, late frames: " << statistic.late_frames << ", resync: " << statistic.resync_count << endl;
+
+    bool ok = out.frames == in.frames;
+    for (size_t i = 1; ok && i < output.size(); ++i) {
+        ok = output[i].dts >= output[i - 1].dts;
+    }
+    if (!ok) {
+        ErrorL << "output frames mismatch or out of order, input: " << in.frames << ", output: " << out.frames;
+    }
+    return ok ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_RTPPROXY is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_RTPPROXY)
@@ -0,0 +1,329 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstring>
+#include <iostream>
+#include "Util/File.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Thread/semaphore.h"
+#include "Common/config.h"
+#include "Record/MP4Index.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_MP4)
+
+static void putBE32(string &out, uint32_t value) {
+    char buf[4] = { (char)(value >> 24), (char)(value >> 16), (char)(value >> 8), (char)value };
+    out.append(buf, 4);
+}
+
+static void putBE16(string &out, uint16_t value) {
+    char buf[2] = { (char)(value >> 8), (char)value };
+    out.append(buf, 2);
+}
+
+static string makeBox(const char *type, const string &payload) {
+    string out;
+    putBE32(out, (uint32_t)payload.size() + 8);
+    out.append(type, 4);
+    out.append(payload);
+    return out;
+}
+
+static string makeFullBox(const char *type, const string &payload) {
+    string out;
+    putBE32(out, 0);
+    return makeBox(type, out + payload);
+}
+
+static string makeTable(const char *type, const vector<vector<uint32_t> > &entries) {
+    string out;
+    putBE32(out, (uint32_t)entries.size());
+    for (auto &entry : entries) {
+        for (auto value : entry) {
+            putBE32(out, value);
+        }
+    }
+    return makeFullBox(type, out);
+}
+
+struct TestTrack {
+    uint32_t track_id;
+    bool video;
+    uint32_t timescale;
+    uint32_t delta;
+    uint32_t samples_per_chunk;
+    vector<uint32_t> sizes;
+    vector<uint32_t> chunks;
+    vector<uint32_t> keys;
+    vector<int32_t> cts;
+};
+
+// 视频为1920x1080的avc1，音频为44100Hz双声道的aac
+// Video is avc1 of 1920x1080, audio is aac of 44100Hz stereo
+static string makeStsd(const TestTrack &track) {
+    string entry(8, '\0');
+    string config;
+    if (track.video) {
+        entry.append(16, '\0');
+        putBE16(entry, 1920);
+        putBE16(entry, 1080);
+        entry.append(50, '\0');
+        entry += makeBox("avcC", "avcC-data");
+        entry = makeBox("avc1", entry);
+    } else {
+        entry.append(8, '\0');
+        putBE16(entry, 2);
+        putBE16(entry, 16);
+        entry.append(4, '\0');
+        putBE32(entry, 44100 << 16);
+        // ES_Descriptor -> DecoderConfigDescriptor(aac) -> DecoderSpecificInfo
+        string esds("\x03\x19\x00\x02\x00\x04\x11\x40", 8);
+        esds.append(12, '\0');
+        esds.append("\x05\x02\x12\x10\x06\x01\x02", 7);
+        entry += makeFullBox("esds", esds);
+        entry = makeBox("mp4a", entry);
+    }
+    string stsd;
+    putBE32(stsd, 1);
+    return makeFullBox("stsd", stsd + entry);
+}
+
+static string makeTrak(const TestTrack &track) {
+    string tkhd(8, '\0');
+    putBE32(tkhd, track.track_id);
+    string mdhd(8, '\0');
+    putBE32(mdhd, track.timescale);
+    putBE32(mdhd, track.delta * (uint32_t)track.sizes.size());
+    string hdlr(4, '\0');
+    hdlr.append(track.video ? "vide" : "soun");
+
+    string stsz;
+    putBE32(stsz, 0);
+    putBE32(stsz, (uint32_t)track.sizes.size());
+    for (auto size : track.sizes) {
+        putBE32(stsz, size);
+    }
+    vector<vector<uint32_t> > chunks, keys, cts;
+    for (auto chunk : track.chunks) {
+        chunks.push_back({ chunk });
+    }
+    for (auto key : track.keys) {
+        keys.push_back({ key });
+    }
+    for (auto value : track.cts) {
+        cts.push_back({ 1, (uint32_t)value });
+    }
+    auto stbl = makeStsd(track)
+        + makeTable("stts", { { (uint32_t)track.sizes.size(), track.delta } })
+        + makeTable("stsc", { { 1, track.samples_per_chunk, 1 } })
+        + makeFullBox("stsz", stsz)
+        + makeTable("stco", chunks);
+    if (!keys.empty()) {
+        stbl += makeTable("stss", keys);
+    }
+    if (!cts.empty()) {
+        stbl += makeTable("ctts", cts);
+    }
+    auto minf = makeBox("minf", makeBox("stbl", stbl));
+    return makeBox("trak", makeFullBox("tkhd", tkhd) + makeBox("mdia", makeFullBox("mdhd", mdhd) + makeFullBox("hdlr", hdlr) + minf));
+}
+
+// 生成一个视频(25fps，每秒一个关键帧)+音频(每帧1024/44100秒)的mp4，视频与音频chunk交错存放
+// Generate an mp4 with video (25fps, one key frame per second) + audio (1024/44100 seconds per frame), video and audio chunks are interleaved
+static string makeMP4(int seconds, TestTrack &video, TestTrack &audio) {
+    video = { 1, true, 90000, 3600, 5, {}, {}, {}, {} };
+    audio = { 2, false, 44100, 1024, 8, {}, {}, {}, {} };
+    auto video_count = seconds * 25;
+    auto audio_count = seconds * 44100 / 1024;
+    for (int i = 0; i < video_count; ++i) {
+        video.sizes.emplace_back(1000 + i % 7 * 100);
+        video.cts.emplace_back(i % 25 == 0 ? 0 : 7200);
+        if (i % 25 == 0) {
+            video.keys.emplace_back(i + 1);
+        }
+    }
+    for (int i = 0; i < audio_count; ++i) {
+        audio.sizes.emplace_back(200 + i % 3);
+    }
+
+    string ftyp = makeBox("ftyp", string("isom\0\0\0\0isom", 12));
+    string mdat;
+    uint32_t base = (uint32_t)ftyp.size() + 8;
+    size_t vi = 0, ai = 0;
+    while (vi < video.sizes.size() || ai < audio.sizes.size()) {
+        if (vi < video.sizes.size()) {
+            video.chunks.emplace_back(base + (uint32_t)mdat.size());
+            for (uint32_t j = 0; j < video.samples_per_chunk && vi < video.sizes.size(); ++j, ++vi) {
+                mdat.append(video.sizes[vi], (char)('v' + vi));
+            }
+        }
+        if (ai < audio.sizes.size()) {
+            audio.chunks.emplace_back(base + (uint32_t)mdat.size());
+            for (uint32_t j = 0; j < audio.samples_per_chunk && ai < audio.sizes.size(); ++j, ++ai) {
+                mdat.append(audio.sizes[ai], (char)('a' + ai));
+            }
+        }
+    }
+    string mvhd(8, '\0');
+    putBE32(mvhd, 1000);
+    putBE32(mvhd, seconds * 1000);
+    auto moov = makeBox("moov", makeFullBox("mvhd", mvhd) + makeTrak(video) + makeTrak(audio));
+    return ftyp + makeBox("mdat", mdat) + moov;
+}
+
+#define CHECK_RET(exp)                                          \
+    if (!(exp)) {                                               \
+        WarnL << "check failed: " << #exp;                      \
+        return -1;                                              \
+    }
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    mINI::Instance()[Record::kIndexCacheSize] = 4;
+    mINI::Instance()[Record::kIndexSidecar] = 1;
+
+    int seconds = argc > 1 ? atoi(argv[1]) : 7200;
+    TestTrack video, audio;
+    auto file = File::absolutePath("test_mp4_index.mp4", "", true);
+    File::saveFile(makeMP4(seconds, video, audio), file.data());
+    File::delete_file(file + ".idx");
+
+    Ticker ticker;
+    auto index = MP4Index::get(file);
+    CHECK_RET(index);
+    InfoL << "parse " << index->getSamples().size() << " samples cost " << ticker.elapsedTime() << "ms";
+    CHECK_RET(index->getSamples().size() == video.sizes.size() + audio.sizes.size());
+    CHECK_RET(index->getDurationMS() == (uint64_t)seconds * 1000);
+    CHECK_RET(File::fileExist(file + ".idx"));
+
+    // track信息由stsd直接生成，无需mov_reader
+    // The track information is generated directly from stsd, without mov_reader
+    auto tracks = index->getTrackInfo();
+    CHECK_RET(tracks && tracks->size() == 2);
+    auto &video_info = tracks->front();
+    CHECK_RET(video_info.track_id == video.track_id && video_info.video && video_info.object == 0x21);
+    CHECK_RET(video_info.width == 1920 && video_info.height == 1080 && video_info.extra == "avcC-data");
+    auto &audio_info = tracks->back();
+    CHECK_RET(audio_info.track_id == audio.track_id && !audio_info.video && audio_info.object == 0x40);
+    CHECK_RET(audio_info.channel_count == 2 && audio_info.bit_per_sample == 16 && audio_info.sample_rate == 44100);
+    CHECK_RET(audio_info.extra == string("\x12\x10", 2));
+
+    // 按dts递增，视频样本的时间戳、大小、偏移量与关键帧标记正确
+    // Increasing by dts, the timestamp, size, offset and key frame flag of the video samples are correct
+    size_t video_index = 0;
+    uint32_t last_dts = 0;
+    auto data = File::loadFile(file.data());
+    for (auto &sample : index->getSamples()) {
+        CHECK_RET(sample.dts >= last_dts);
+        last_dts = sample.dts;
+        CHECK_RET(sample.offset + sample.size <= data.size());
+        if (index->getTrackId(sample) != video.track_id) {
+            continue;
+        }
+        CHECK_RET(sample.size == video.sizes[video_index]);
+        CHECK_RET(sample.dts == video_index * 40);
+        CHECK_RET(sample.cts == (video_index % 25 ? 80 : 0));
+        CHECK_RET(((sample.flags & MP4Index::kFlagKeyFrame) != 0) == (video_index % 25 == 0));
+        CHECK_RET(data[sample.offset] == (char)('v' + video_index));
+        ++video_index;
+    }
+    CHECK_RET(video_index == video.sizes.size());
+
+    // 关键帧列表用于快进快退
+    // Key frame list used for fast forward and rewind
+    auto &keys = index->getKeySamples();
+    CHECK_RET(keys.size() == (video.sizes.size() + 24) / 25);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        CHECK_RET(index->getSamples()[keys[i]].dts == i * 25 * 40);
+    }
+
+    // seek定位到前一个关键帧
+    // Seek locates the previous key frame
+    int64_t stamp = 3500;
+    auto pos = index->seek(stamp);
+    CHECK_RET(stamp == 3000);
+    CHECK_RET(index->getSamples()[pos].dts == 3000);
+    stamp = (seconds + 10) * 1000;
+    index->seek(stamp);
+    CHECK_RET(stamp <= seconds * 1000);
+
+    // 再次获取命中内存缓存
+    // Get again, hit the memory cache
+    CHECK_RET(MP4Index::get(file) == index);
+
+    // 保存track信息后从索引文件加载
+    // Load from the index file after saving the track information
+    MP4Index::TrackInfo info;
+    info.track_id = 1;
+    info.video = true;
+    info.object = 0x21;
+    info.width = 1920;
+    info.height = 1080;
+    info.extra = "avcC";
+    index->setTrackInfo({ info });
+    MP4Index::clearCache();
+    ticker.resetTime();
+    auto sidecar = MP4Index::get(file);
+    InfoL << "load index file cost " << ticker.elapsedTime() << "ms";
+    CHECK_RET(sidecar && sidecar != index);
+    CHECK_RET(sidecar->getSamples().size() == index->getSamples().size());
+    CHECK_RET(!memcmp(sidecar->getSamples().data(), index->getSamples().data(), index->getSamples().size() * sizeof(MP4Index::Sample)));
+    CHECK_RET(sidecar->getKeySamples() == index->getKeySamples());
+    CHECK_RET(sidecar->getTrackInfo() && sidecar->getTrackInfo()->size() == 1);
+    CHECK_RET(sidecar->getTrackInfo()->front().extra == "avcC" && sidecar->getTrackInfo()->front().width == 1920);
+
+    // 文件被修改后索引失效
+    // The index becomes invalid after the file is modified
+    File::saveFile(data.substr(0, data.size() / 2), file.data());
+    CHECK_RET(!MP4Index::get(file));
+
+    // 解析失败的结果被缓存，不会再次解析
+    // The parsing failure is cached and will not be parsed again
+    MP4Index::Ptr cached;
+    CHECK_RET(MP4Index::getCached(file, cached) && !cached);
+    bool called = false;
+    MP4Index::getAsync(file, [&](const MP4Index::Ptr &index) { called = !index; });
+    CHECK_RET(called);
+
+    // 文件恢复后缓存失效，在后台线程重新解析
+    // After the file is restored, the cache becomes invalid and it is parsed again in the background thread
+    File::saveFile(data, file.data());
+    CHECK_RET(!MP4Index::getCached(file, cached));
+    semaphore sem;
+    MP4Index::Ptr async_index;
+    MP4Index::getAsync(file, [&](const MP4Index::Ptr &index) {
+        async_index = index;
+        sem.post();
+    });
+    sem.wait();
+    CHECK_RET(async_index && async_index->getSamples().size() == index->getSamples().size());
+
+    File::delete_file(file);
+    File::delete_file(file + ".idx");
+    InfoL << "all check passed";
+    sleep(1);
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_MP4 is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_MP4)
@@ -0,0 +1,373 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Rtp/PSDecoder.h"
+#include "Rtp/PSDemuxer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_RTPPROXY)
+
+struct TestFrame {
+    int stream;
+    int64_t pts;
+    string data;
+};
+
+static void writeStamp(string &out, int prefix, int64_t stamp) {
+    out.push_back((char)((prefix << 4) | ((stamp >> 29) & 0x0E) | 1));
+    out.push_back((char)(stamp >> 22));
+    out.push_back((char)(((stamp >> 14) & 0xFE) | 1));
+    out.push_back((char)(stamp >> 7));
+    out.push_back((char)(((stamp << 1) & 0xFE) | 1));
+}
+
+static string makePES(int stream_id, bool have_pts, int64_t pts, const string &payload) {
+    string header;
+    header.push_back((char)0x80);
+    header.push_back((char)(have_pts ? 0x80 : 0x00));
+    header.push_back((char)(have_pts ? 5 : 0));
+    if (have_pts) {
+        writeStamp(header, 0x02, pts);
+    }
+    auto size = header.size() + payload.size();
+    string out { 0, 0, 1, (char)stream_id, (char)(size >> 8), (char)size };
+    return out + header + payload;
+}
+
+static string makePackHeader() {
+    return string { 0, 0, 1, (char)0xBA, 0x44, 0, 4, 0, 4, 1, 1, (char)0x89, (char)0xC3, (char)0xF8 };
+}
+
+static string makePSM() {
+    // 视频h264(0xE0)，音频g711a(0xC0)
+    // Video h264 (0xE0), audio g711a (0xC0)
+    return string { 0, 0, 1, (char)0xBC, 0, 18, (char)0xE0, (char)0xFF, 0, 0, 0, 8,
+                    0x1B, (char)0xE0, 0, 0, (char)0x90, (char)0xC0, 0, 0, 0, 0, 0, 0 };
+}
+
+static string makePayload(std::mt19937 &rng, size_t size, char nal) {
+    string out { 0, 0, 0, 1, nal };
+    while (out.size() < size) {
+        // 负载中不出现起始码
+        // No start code in the payload
+        out.push_back((char)(0x11 + rng() % 0xE0));
+    }
+    return out;
+}
+
+// 生成海康风格的ps流：关键帧前带psm、system header与私有流，大帧拆分为多个pes
+// Generate a Hikvision style ps stream: psm, system header and private stream before key frames, large frames are split into multiple pes
+static string makePS(int frames, bool pts_every_pes, vector<TestFrame> &expected, vector<size_t> *video_offsets = nullptr) {
+    std::mt19937 rng(frames);
+    string out;
+    for (int i = 0; i < frames; ++i) {
+        int64_t pts = 90000 + i * 3600;
+        bool key = i % 25 == 0;
+        out += makePackHeader();
+        string frame;
+        if (key) {
+            out += string { 0, 0, 1, (char)0xBB, 0, 6, 1, 2, 3, 4, 5, 6 };
+            out += makePSM();
+            frame = makePayload(rng, 20, 0x67) + makePayload(rng, 8, 0x68) + makePayload(rng, 80000 + rng() % 120000, 0x65);
+        } else {
+            frame = makePayload(rng, 500 + rng() % 20000, 0x41);
+        }
+        if (video_offsets) {
+            video_offsets->emplace_back(out.size());
+        }
+        for (size_t pos = 0; pos < frame.size(); pos += 60000) {
+            out += makePES(0xE0, pos == 0 || pts_every_pes, pts, frame.substr(pos, 60000));
+        }
+        if (key) {
+            out += makePES(0xBD, true, pts, string(100, 'p'));
+        }
+        expected.emplace_back(TestFrame { 0xE0, pts, frame });
+
+        auto audio = makePayload(rng, 320, (char)0xD5).substr(4);
+        out += makePackHeader() + makePES(0xC0, true, pts, audio);
+        expected.emplace_back(TestFrame { 0xC0, pts, audio });
+    }
+    return out;
+}
+
+// 按随机长度切片输入，模拟rtp负载
+// Input in random length slices to simulate rtp payloads
+static void inputSlices(PSDemuxer &demuxer, const string &data, std::mt19937 &rng, size_t drop_at = string::npos) {
+    for (size_t pos = 0; pos < data.size();) {
+        auto size = std::min<size_t>(1 + rng() % 1400, data.size() - pos);
+        if (pos <= drop_at && drop_at < pos + size) {
+            demuxer.resync();
+        } else {
+            auto buffer = BufferRaw::create();
+            buffer->setCapacity(size + 12);
+            buffer->setSize(size + 12);
+            memcpy(buffer->data() + 12, data.data() + pos, size);
+            demuxer.input(buffer, 12, size);
+        }
+        pos += size;
+    }
+}
+
+#define CHECK_RET(exp)                                          \
+    if (!(exp)) {                                               \
+        WarnL << "check failed: " << #exp;                      \
+        return -1;                                              \
+    }
+
+static int testSynthetic(bool pts_every_pes) {
+    vector<TestFrame> expected;
+    auto data = makePS(100, pts_every_pes, expected);
+
+    vector<TestFrame> frames;
+    map<int, int> streams;
+    bool finished = false;
+    PSDemuxer demuxer;
+    demuxer.setOnStream([&](int stream, int codecid, bool finish) {
+        streams[stream] = codecid;
+        finished = finished || finish;
+    });
+    demuxer.setOnFrame([&](int stream, int codecid, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        frames.emplace_back(TestFrame { stream, pts, string(buffer->data(), buffer->size()) });
+    });
+
+    std::mt19937 rng(pts_every_pes);
+    Ticker ticker;
+    inputSlices(demuxer, data, rng);
+    demuxer.flush();
+    InfoL << "demux " << (data.size() >> 10) << "KB cost " << ticker.elapsedTime() << "ms";
+
+    CHECK_RET(finished && streams.size() == 2 && streams[0xE0] == 0x1B && streams[0xC0] == 0x90);
+    // 视频帧在下一帧到来(或flush)时才输出，所以顺序按流分别比较
+    // The video frame is output when the next frame arrives (or flush), so the order is compared separately by stream
+    for (auto stream : { 0xE0, 0xC0 }) {
+        vector<const TestFrame *> lhs, rhs;
+        for (auto &frame : expected) {
+            if (frame.stream == stream) {
+                lhs.emplace_back(&frame);
+            }
+        }
+        for (auto &frame : frames) {
+            if (frame.stream == stream) {
+                rhs.emplace_back(&frame);
+            }
+        }
+        CHECK_RET(lhs.size() == rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            CHECK_RET(lhs[i]->pts == rhs[i]->pts && lhs[i]->data == rhs[i]->data);
+        }
+    }
+
+    // 丢失一段数据后从下一个起始码恢复
+    // Recover from the next start code after losing a piece of data
+    frames.clear();
+    PSDemuxer demuxer2;
+    demuxer2.setOnFrame([&](int stream, int codecid, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        frames.emplace_back(TestFrame { stream, pts, string(buffer->data(), buffer->size()) });
+    });
+    inputSlices(demuxer2, data, rng, data.size() / 2);
+    demuxer2.flush();
+    // 最后一个视频帧在flush时输出
+    // The last video frame is output when flush
+    auto &last_video = expected[expected.size() - 2];
+    CHECK_RET(!frames.empty() && frames.back().pts == last_video.pts && frames.back().data == last_video.data);
+    return 0;
+}
+
+// 多pes组成的帧中间丢包，该帧不输出，其他输出的帧都完整
+// Packet loss in the middle of a frame composed of multiple pes, the frame is not output, and the other output frames are complete
+static int testLossInFrame(bool pts_every_pes) {
+    vector<TestFrame> expected;
+    vector<size_t> offsets;
+    auto data = makePS(60, pts_every_pes, expected, &offsets);
+    // 第50帧是关键帧，大于60000字节，被拆分为多个pes；丢失第一个pes中间的数据
+    // The 50th frame is a key frame larger than 60000 bytes and is split into multiple pes; the data in the middle of the first pes is lost
+    auto &damaged = expected[50 * 2];
+    CHECK_RET(damaged.data.size() > 60000);
+    auto drop_at = offsets[50] + 30000;
+
+    vector<TestFrame> frames;
+    PSDemuxer demuxer;
+    demuxer.setOnFrame([&](int stream, int codecid, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        frames.emplace_back(TestFrame { stream, pts, string(buffer->data(), buffer->size()) });
+    });
+    std::mt19937 rng(2 + pts_every_pes);
+    inputSlices(demuxer, data, rng, drop_at);
+    demuxer.flush();
+
+    size_t after = 0;
+    for (auto &frame : frames) {
+        auto it = std::find_if(expected.begin(), expected.end(), [&](const TestFrame &item) {
+            return item.stream == frame.stream && item.pts == frame.pts;
+        });
+        CHECK_RET(it != expected.end() && it->data == frame.data);
+        CHECK_RET(frame.stream != damaged.stream || frame.pts != damaged.pts);
+        after += frame.stream == damaged.stream && frame.pts > damaged.pts;
+    }
+    // 下一帧开始恢复输出
+    // Output resumes from the next frame
+    CHECK_RET(after == 9);
+    return 0;
+}
+
+// 关键帧rtp包判断，用于ps透传转发
+// Key frame rtp packet judgment, used for ps passthrough forwarding
+static int testKeyPacket() {
+    std::mt19937 rng(0);
+    vector<TestFrame> expected;
+    auto data = makePS(2, false, expected);
+    CHECK_RET(PSDemuxer::isKeyPacket((const uint8_t *)data.data(), 1400));
+    for (auto nal : { 0x41, 0x06, 0x02 }) {
+        auto packet = makePackHeader() + makePES(0xE0, true, 0, makePayload(rng, 100, (char)nal));
+        CHECK_RET(!PSDemuxer::isKeyPacket((const uint8_t *)packet.data(), packet.size()));
+    }
+    for (auto nal : { 0x65, 0x67, 0x26, 0x40 }) {
+        // aud之后的关键帧
+        // Key frame after aud
+        auto packet = makePackHeader() + makePES(0xE0, true, 0, string { 0, 0, 0, 1, 0x09, (char)0xF0 } + makePayload(rng, 100, (char)nal));
+        CHECK_RET(PSDemuxer::isKeyPacket((const uint8_t *)packet.data(), packet.size()));
+    }
+    // 音频包、pes中间的分片
+    // Audio packets, fragments in the middle of pes
+    auto audio = makePackHeader() + makePES(0xC0, true, 0, string(160, (char)0xD5));
+    CHECK_RET(!PSDemuxer::isKeyPacket((const uint8_t *)audio.data(), audio.size()));
+    CHECK_RET(!PSDemuxer::isKeyPacket((const uint8_t *)data.data() + 1400, 1400));
+    return 0;
+}
+
+struct StreamDigest {
+    size_t frames = 0;
+    size_t bytes = 0;
+    uint64_t hash = 14695981039346656037ULL;
+
+    void input(const void *data, size_t size) {
+        ++frames;
+        bytes += size;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ ((const uint8_t *)data)[i]) * 1099511628211ULL;
+        }
+    }
+};
+
+// 读取ps文件(rtp_proxy.dumpDir导出的.mpeg)或者rtp文件(2字节长度+rtp，test_rtp使用的格式)，按rtp负载切片
+// Read a ps file (.mpeg exported by rtp_proxy.dumpDir) or an rtp file (2 bytes length + rtp, the format used by test_rtp), slice by rtp payload
+static vector<string> loadSlices(const string &path) {
+    vector<string> ret;
+    auto data = File::loadFile(path.data());
+    if (!end_with(path, ".rtp")) {
+        for (size_t pos = 0; pos < data.size(); pos += 1400) {
+            ret.emplace_back(data.substr(pos, 1400));
+        }
+        return ret;
+    }
+    for (size_t pos = 0; pos + 2 <= data.size();) {
+        size_t len = ((uint8_t)data[pos] << 8) | (uint8_t)data[pos + 1];
+        pos += 2;
+        if (len < 12 || pos + len > data.size()) {
+            break;
+        }
+        auto rtp = (const uint8_t *)data.data() + pos;
+        size_t offset = 12 + (rtp[0] & 0x0F) * 4;
+        size_t end = len;
+        if ((rtp[0] & 0x10) && offset + 4 <= len) {
+            offset += 4 + ((rtp[offset + 2] << 8) | rtp[offset + 3]) * 4;
+        }
+        if ((rtp[0] & 0x20) && end > offset) {
+            end -= std::min<size_t>(rtp[len - 1], end - offset);
+        }
+        if (offset < end) {
+            ret.emplace_back(data.substr(pos + offset, end - offset));
+        }
+        pos += len;
+    }
+    return ret;
+}
+
+// 与基于libmpeg的PSDecoder对比输出
+// Compare the output with PSDecoder based on libmpeg
+static int testFile(const string &path) {
+    auto slices = loadSlices(path);
+    CHECK_RET(!slices.empty());
+
+    map<int, StreamDigest> lhs, rhs;
+    Ticker ticker;
+    {
+        PSDecoder decoder;
+        decoder.setOnDecode([&](int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes) {
+            lhs[stream].input(data, bytes);
+        });
+        for (auto &slice : slices) {
+            decoder.input((const uint8_t *)slice.data(), slice.size());
+        }
+    }
+    auto lhs_ms = ticker.elapsedTime();
+
+    ticker.resetTime();
+    {
+        PSDemuxer demuxer;
+        demuxer.setOnFrame([&](int stream, int codecid, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+            rhs[stream].input(buffer->data(), buffer->size());
+        });
+        for (auto &slice : slices) {
+            auto buffer = std::make_shared<BufferString>(slice);
+            demuxer.input(buffer, 0, slice.size());
+        }
+        demuxer.flush();
+    }
+    auto rhs_ms = ticker.elapsedTime();
+
+    InfoL << path << ", slices: " << slices.size() << ", libmpeg cost " << lhs_ms << "ms, PSDemuxer cost " << rhs_ms << "ms";
+    bool same = true;
+    for (auto &pr : lhs) {
+        auto &other = rhs[pr.first];
+        InfoL << "stream " << pr.first << ": " << pr.second.frames << "/" << other.frames << " frames, "
+              << pr.second.bytes << "/" << other.bytes << " bytes";
+        same = same && pr.second.bytes == other.bytes && pr.second.hash == other.hash;
+    }
+    CHECK_RET(same && lhs.size() == rhs.size());
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    if (testSynthetic(false) || testSynthetic(true) || testLossInFrame(false) || testLossInFrame(true) || testKeyPacket()) {
+        return -1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (testFile(argv[i])) {
+            return -1;
+        }
+    }
+    InfoL << "all check passed";
+    sleep(1);
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    cout << "ENABLE_RTPPROXY is not defined" << endl;
+    return 0;
+}
+
+#endif // defined(ENABLE_RTPPROXY)
@@ -0,0 +1,145 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <deque>
+#include <random>
+#include <iostream>
+#include "Util/logger.h"
+#include "../webrtc/Fec.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static constexpr uint8_t kVideoPt = 96;
+static constexpr uint8_t kRedPt = 116;
+static constexpr uint8_t kUlpfecPt = 117;
+
+// 开启fec后，丢失的媒体包至少需要恢复的比例；丢包率越高，同一fec分组内丢失多个包的概率越大
+// The minimum ratio of lost media packets that need to be recovered after fec is enabled; the higher the loss rate, the greater the probability of losing multiple packets in the same fec group
+static constexpr double kMinRecoveredRatio = 0.5;
+
+// 模拟丢包链路，统计fec恢复率与带宽开销
+// Simulate a lossy link, count the fec recovery ratio and bandwidth overhead
+static bool testLossRate(float loss_rate, size_t count) {
+    mt19937 rng(1234);
+    uniform_real_distribution<float> drop(0, 100);
+    uniform_int_distribution<int> size_dist(200, 1200);
+
+    FecEncoder encoder(kRedPt, kUlpfecPt);
+    encoder.setFractionLost((uint8_t)(loss_rate * 256 / 100));
+    FecDecoder decoder;
+
+    // 以发送seq为key保存原始数据，用于校验恢复结果
+    // Save the original data with the sent seq as the key, used to verify the recovery result
+    // 发送seq经过重映射会回环，按发送顺序淘汰
+    // The sent seq is remapped and will wrap around, evict in sending order
+    map<uint16_t, string> origin;
+    deque<uint16_t> origin_order;
+    size_t media_bytes = 0, fec_bytes = 0, lost = 0, recovered = 0, mismatch = 0;
+
+    decoder.setOnRecovered([&](char *buf, size_t len) {
+        auto seq = ntohs(((RtpHeader *)buf)->seq);
+        auto it = origin.find(seq);
+        if (it == origin.end() || it->second != string(buf, len)) {
+            ++mismatch;
+            return;
+        }
+        ++recovered;
+    });
+
+    auto on_recv = [&](char *buf, size_t len) {
+        if (drop(rng) < loss_rate) {
+            if (((RtpHeader *)buf)->pt == kRedPt && ((uint8_t *)buf)[RtpPacket::kRtpHeaderSize] != kUlpfecPt) {
+                ++lost;
+            }
+            return;
+        }
+        if (!RedPacker::unwrap(buf, len)) {
+            return;
+        }
+        auto header = (RtpHeader *)buf;
+        if (header->pt == kUlpfecPt) {
+            decoder.inputFec(header, header->getPayloadData(), header->getPayloadSize(len));
+        } else {
+            decoder.inputRtp(buf, len);
+        }
+    };
+
+    char buf[1500];
+    for (size_t i = 0; i < count; ++i) {
+        auto header = (RtpHeader *)buf;
+        memset(buf, 0, RtpPacket::kRtpHeaderSize);
+        header->version = RtpPacket::kRtpVersion;
+        header->pt = kVideoPt;
+        // 大约每8个包为一帧
+        // About 8 packets per frame
+        header->mark = (i % 8 == 7);
+        header->seq = htons((uint16_t)i);
+        header->stamp = htonl((uint32_t)(i / 8 * 3600));
+        header->ssrc = htonl(0x12345678);
+        int len = size_dist(rng);
+        for (int j = RtpPacket::kRtpHeaderSize; j < len; ++j) {
+            buf[j] = (char)rng();
+        }
+
+        encoder.inputRtp(header, len);
+        origin[ntohs(header->seq)].assign(buf, len);
+        origin_order.emplace_back(ntohs(header->seq));
+        media_bytes += len;
+        RedPacker::wrap(buf, len, kRedPt);
+        on_recv(buf, len);
+
+        encoder.flush([&](const char *fec, size_t size) {
+            fec_bytes += size;
+            string copy(fec, size);
+            on_recv((char *)copy.data(), copy.size());
+        });
+        if (origin_order.size() > 1024) {
+            origin.erase(origin_order.front());
+            origin_order.pop_front();
+        }
+    }
+
+    InfoL << "loss rate: " << loss_rate << "%"
+          << ", group size: " << (int)encoder.getGroupSize()
+          << ", media lost: " << lost
+          << ", recovered: " << recovered
+          << ", recovered ratio: " << (lost ? recovered * 100.0 / lost : 0) << "%"
+          << ", mismatch: " << mismatch
+          << ", added bandwidth: " << fec_bytes * 100.0 / media_bytes << "%";
+
+    if (mismatch) {
+        ErrorL << "loss rate: " << loss_rate << "%, recovered packets mismatch: " << mismatch;
+        return false;
+    }
+    // 丢包率低于阈值时不开启fec
+    // Fec is not enabled when the loss rate is lower than the threshold
+    auto expected = encoder.getGroupSize() ? (size_t)(lost * kMinRecoveredRatio) : 0;
+    if (recovered < expected) {
+        ErrorL << "loss rate: " << loss_rate << "%, recovered packets: " << recovered << " < expected: " << expected;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 100000;
+    bool ok = true;
+    for (auto loss_rate : { 1.0f, 2.0f, 5.0f, 10.0f, 20.0f }) {
+        ok = testLossRate(loss_rate, count) && ok;
+    }
+    sleep(1);
+    return ok ? 0 : -1;
+}
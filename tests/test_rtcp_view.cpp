@@ -0,0 +1,441 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Rtcp/Rtcp.h"
+#include "Rtcp/RtcpFCI.h"
+#include "Rtcp/RtcpView.h"
+#include "Rtcp/RtcpBuilder.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+        (*_parser) << Option('l', "level", Option::ArgRequired, to_string(LError).data(), false, "日志等级,LTrace~LError(0~4)", nullptr);
+        (*_parser) << Option('n', "count", Option::ArgRequired, "200000", false, "随机rtcp复合包个数", nullptr);
+        (*_parser) << Option('s', "seed", Option::ArgRequired, "0", false, "随机数种子", nullptr);
+    }
+
+    const char *description() const override {
+        return "rtcp视图解析与构造器模糊测试，与原地转换字节序的RtcpHeader::loadFromBytes及RtcpXX::create的结果对比";
+    }
+};
+
+// 旧版解析可能越界读取，多预留一些0
+// The legacy parsing may read out of bounds, reserve some more 0
+static constexpr size_t kSlack = 64;
+
+// 旧版xr dlrr/target bitrate按block length打印与转换子块，不检查包长度，需要预留更多空间
+// The legacy xr dlrr/target bitrate prints and converts sub-blocks according to the block length without checking the packet length, more space needs to be reserved
+static size_t legacySlack(const string &data) {
+    size_t ret = kSlack;
+    auto ptr = (const uint8_t *)data.data();
+    size_t remain = data.size();
+    while (remain > 4) {
+        size_t size = (1 + ((ptr[2] << 8) | ptr[3])) << 2;
+        if (remain < size) {
+            break;
+        }
+        // 旧版不检查长度就读取bt与block_length，可能越过本包读取到后续数据
+        // The legacy version reads bt and block_length without checking the length, which may read beyond this packet
+        if (ptr[1] == (uint8_t)RtcpType::RTCP_XR) {
+            size_t block_length = ((remain > 10 ? ptr[10] : 0) << 8) | (remain > 11 ? ptr[11] : 0);
+            ret = MAX(ret, block_length * 4 + kSlack);
+        }
+        ptr += size;
+        remain -= size;
+    }
+    return ret;
+}
+
+struct Stats {
+    uint64_t cases = 0;
+    uint64_t packets = 0;
+    uint64_t skipped = 0;
+    uint64_t errors = 0;
+};
+
+#define EXPECT_EQ(a, b)                                                                                                \
+    if ((a) != (b)) {                                                                                                  \
+        ErrorL << "mismatch: " #a " = " << (a) << ", " #b " = " << (b);                                                \
+        return false;                                                                                                  \
+    }
+
+static void fill(std::mt19937 &rng, void *ptr, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        ((uint8_t *)ptr)[i] = (uint8_t)rng();
+    }
+}
+
+// 生成一个合法的rtcp复合包
+// Generate a legal rtcp compound packet
+static string makeCompound(std::mt19937 &rng) {
+    string ret;
+    auto count = 1 + rng() % 5;
+    for (size_t i = 0; i < count; ++i) {
+        std::shared_ptr<RtcpHeader> rtcp;
+        size_t body = sizeof(RtcpHeader);
+        switch (rng() % 8) {
+            case 0: rtcp = RtcpSR::create(rng() % 4); break;
+            case 1: rtcp = RtcpRR::create(rng() % 4); break;
+            case 2: {
+                rtcp = RtcpSdes::create({ string(rng() % 32, 'a') });
+                body = rtcp->getSize();
+                break;
+            }
+            case 3: {
+                vector<uint32_t> ssrcs(rng() % 4);
+                fill(rng, ssrcs.data(), ssrcs.size() * 4);
+                rtcp = RtcpBye::create(ssrcs, rng() % 2 ? "" : string(rng() % 32, 'b'));
+                body = rtcp->getSize();
+                break;
+            }
+            case 4: {
+                string fci(rng() % 64, '\0');
+                fill(rng, &fci[0], fci.size());
+                rtcp = RtcpFB::create(RTPFBType::RTCP_RTPFB_TWCC, fci.data(), fci.size());
+                break;
+            }
+            case 5: {
+                rtcp = RtcpFB::create(rng() % 2 ? PSFBType::RTCP_PSFB_PLI : PSFBType::RTCP_PSFB_REMB);
+                break;
+            }
+            case 6: {
+                rtcp = RtcpXRDLRR::create(rng() % 3);
+                ((RtcpXRDLRR *)rtcp.get())->bt = rng() % 2 ? 5 : 42;
+                ((RtcpXRDLRR *)rtcp.get())->block_length = htons(rng() % 8);
+                body = sizeof(RtcpXRDLRR) - sizeof(RtcpXRDLRRReportItem);
+                break;
+            }
+            default: {
+                rtcp = RtcpXRDLRR::create(1);
+                rtcp->setSize(sizeof(RtcpXRRRTR));
+                body = 0;
+                auto xr = (RtcpXRRRTR *)rtcp.get();
+                xr->ssrc = (uint32_t)rng();
+                xr->bt = 4;
+                xr->block_length = htons(2);
+                break;
+            }
+        }
+        string bytes((char *)rtcp.get(), rtcp->getSize());
+        if (body && body < bytes.size()) {
+            // 除了头部等已赋值的字段，其余随机填充(保留padding长度)
+            // Except for the assigned fields such as the header, the rest are filled randomly (keep the padding length)
+            fill(rng, &bytes[body], bytes.size() - body - (rtcp->padding ? 1 : 0));
+        }
+        if (!body && bytes.size() > 12) {
+            fill(rng, &bytes[12], bytes.size() - 12);
+        }
+        ret.append(bytes);
+    }
+    return ret;
+}
+
+// 随机破坏：改写字节、长度字段、report count、截断或追加
+// Random corruption: rewrite bytes, length field, report count, truncate or append
+static void mutate(std::mt19937 &rng, string &data) {
+    auto times = rng() % 4;
+    for (size_t i = 0; i < times && !data.empty(); ++i) {
+        auto pos = rng() % data.size();
+        switch (rng() % 6) {
+            case 0: data[pos] = (char)rng(); break;
+            case 1: {
+                // 改写report count
+                // Rewrite the report count
+                auto base = pos & ~(size_t)3;
+                data[base] = (char)((data[base] & 0xE0) | (rng() % 32));
+                break;
+            }
+            case 2: {
+                // 改写length字段低字节
+                // Rewrite the low byte of the length field
+                auto base = pos & ~(size_t)3;
+                data[MIN(base + 3, data.size() - 1)] = (char)(rng() % 16);
+                break;
+            }
+            case 3: data.resize(pos); break;
+            case 4: data.append(rng() % 16, (char)rng()); break;
+            default: data[pos] ^= 0x20; break;
+        }
+    }
+}
+
+static bool compareItem(ReportItem *item, const RtcpReportItemView &view) {
+    EXPECT_EQ(item->ssrc, view.ssrc());
+    EXPECT_EQ((uint32_t)item->fraction, (uint32_t)view.fraction());
+    EXPECT_EQ((uint32_t)item->cumulative, view.cumulative());
+    EXPECT_EQ(item->seq_cycles, view.seqCycles());
+    EXPECT_EQ(item->seq_max, view.seqMax());
+    EXPECT_EQ(item->jitter, view.jitter());
+    EXPECT_EQ(item->last_sr_stamp, view.lastSrStamp());
+    EXPECT_EQ(item->delay_since_last_sr, view.delaySinceLastSr());
+    return true;
+}
+
+// 对比旧版解析结果与视图
+// Compare the legacy parsing result with the view
+static bool compare(RtcpHeader *rtcp, const RtcpView &view) {
+    EXPECT_EQ((int)rtcp->pt, (int)view.type());
+    EXPECT_EQ(rtcp->getSize(), view.size());
+    switch (view.type()) {
+        case RtcpType::RTCP_SR: {
+            auto sr = (RtcpSR *)rtcp;
+            RtcpSRView sr_view(view);
+            EXPECT_EQ(sr->ssrc, sr_view.ssrc());
+            EXPECT_EQ(sr->ntpmsw, sr_view.ntpmsw());
+            EXPECT_EQ(sr->ntplsw, sr_view.ntplsw());
+            EXPECT_EQ(sr->rtpts, sr_view.rtpts());
+            EXPECT_EQ(sr->packet_count, sr_view.packetCount());
+            EXPECT_EQ(sr->octet_count, sr_view.octetCount());
+            EXPECT_EQ(sr->getNtpUnixStampMS(), sr_view.getNtpUnixStampMS());
+            auto items = sr->getItemList();
+            EXPECT_EQ(items.size(), sr_view.itemCount());
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (!compareItem(items[i], sr_view.getItem(i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case RtcpType::RTCP_RR: {
+            auto rr = (RtcpRR *)rtcp;
+            RtcpRRView rr_view(view);
+            EXPECT_EQ(rr->ssrc, rr_view.ssrc());
+            auto items = rr->getItemList();
+            EXPECT_EQ(items.size(), rr_view.itemCount());
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (!compareItem(items[i], rr_view.getItem(i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case RtcpType::RTCP_RTPFB:
+        case RtcpType::RTCP_PSFB: {
+            auto fb = (RtcpFB *)rtcp;
+            RtcpFBView fb_view(view);
+            EXPECT_EQ((int)fb->report_count, (int)fb_view.reportCount());
+            EXPECT_EQ(fb->ssrc, fb_view.ssrc());
+            EXPECT_EQ(fb->ssrc_media, fb_view.ssrcMedia());
+            if (fb->getSize() >= fb->getPaddingSize() + sizeof(RtcpFB)) {
+                EXPECT_EQ(fb->getFciSize(), fb_view.getFciSize());
+                EXPECT_EQ(memcmp(fb->getFciPtr(), fb_view.getFciPtr(), fb_view.getFciSize()), 0);
+            } else {
+                EXPECT_EQ(fb_view.getFciSize(), (size_t)0);
+            }
+            return true;
+        }
+        case RtcpType::RTCP_BYE: {
+            auto bye = (RtcpBye *)rtcp;
+            RtcpByeView bye_view(view);
+            auto ssrcs = bye->getSSRC();
+            // 旧版通过ssrc[1]数组越界访问后续ssrc，开启优化后编译器可能认为只有一个ssrc，此时只对比第一个
+            // The legacy version accesses subsequent ssrcs by out-of-bounds access of the ssrc[1] array, after optimization is enabled,
+            // the compiler may think there is only one ssrc, in this case only the first one is compared
+            EXPECT_EQ(MIN(ssrcs.size(), (size_t)1), MIN(bye_view.ssrcCount(), (size_t)1));
+            for (size_t i = 0; i < ssrcs.size() && i < bye_view.ssrcCount(); ++i) {
+                EXPECT_EQ(*ssrcs[i], bye_view.getSSRC(i));
+            }
+            if (ssrcs.size() == bye_view.ssrcCount()) {
+                EXPECT_EQ(bye->getReason(), bye_view.getReason());
+            }
+            return true;
+        }
+        case RtcpType::RTCP_XR: {
+            auto xr = (RtcpXRRRTR *)rtcp;
+            RtcpXRView xr_view(view);
+            EXPECT_EQ(xr->ssrc, xr_view.ssrc());
+            EXPECT_EQ((int)xr->bt, (int)xr_view.bt());
+            if (xr->bt == 4) {
+                EXPECT_EQ(xr->block_length, xr_view.blockLength());
+                EXPECT_EQ(xr->ntpmsw, xr_view.ntpmsw());
+                EXPECT_EQ(xr->ntplsw, xr_view.ntplsw());
+            }
+            return true;
+        }
+        default: return true;
+    }
+}
+
+static bool checkParse(const string &data, Stats &stats) {
+    auto slack = legacySlack(data);
+    if (slack > 4096) {
+        // 旧版会逐个打印上万个dlrr子块，耗时过长，跳过
+        // The legacy version will print tens of thousands of dlrr sub-blocks one by one, which takes too long, skip
+        ++stats.skipped;
+        return true;
+    }
+    string legacy_data = data;
+    legacy_data.resize(data.size() + slack, '\0');
+    auto legacy = RtcpHeader::loadFromBytes(&legacy_data[0], data.size());
+
+    vector<RtcpView> views;
+    for (auto &view : RtcpCompoundView(data.data(), data.size())) {
+        views.emplace_back(view);
+    }
+
+    size_t index = 0;
+    for (auto rtcp : legacy) {
+        auto offset = (size_t)((char *)rtcp - legacy_data.data());
+        if ((RtcpType)rtcp->pt == RtcpType::RTCP_XR && rtcp->getSize() < RtcpXRView::kMinSize) {
+            // 旧版未检查长度就读取了bt并越过包尾转换字节序，视图会丢弃该包，后面的结果没有对比意义
+            // The legacy version read bt without checking the length and converted the byte order beyond the end of the packet,
+            // the view will discard this packet, the subsequent results are meaningless to compare
+            stats.skipped += 1 + views.size() - MIN(index, views.size());
+            return true;
+        }
+        if (index >= views.size()) {
+            ErrorL << "view missing rtcp at offset " << offset << ": " << rtcpTypeToStr((RtcpType)rtcp->pt);
+            return false;
+        }
+        auto &view = views[index++];
+        EXPECT_EQ(offset, (size_t)(view.data() - (const uint8_t *)data.data()));
+        if (!compare(rtcp, view)) {
+            ErrorL << "offset " << offset << ", " << rtcpTypeToStr(view.type()) << ", size " << view.size() << "\r\n" << hexdump(data.data(), data.size());
+            return false;
+        }
+        ++stats.packets;
+        if ((RtcpType)rtcp->pt == RtcpType::RTCP_XR && ((RtcpXRRRTR *)rtcp)->bt != 4) {
+            // 旧版dlrr/target bitrate会越过包尾转换字节序，破坏后续rtcp包，后面的结果没有对比意义
+            // The legacy dlrr/target bitrate will convert the byte order beyond the end of the packet, destroying the subsequent rtcp packets, the subsequent results are meaningless to compare
+            stats.skipped += views.size() - index;
+            return true;
+        }
+    }
+    if (index != views.size()) {
+        ErrorL << "legacy rtcp count: " << index << ", view rtcp count: " << views.size() << "\r\n" << hexdump(data.data(), data.size());
+        return false;
+    }
+    return true;
+}
+
+// 对比构造器与create的输出，padding中间的字节未初始化，不参与对比
+// Compare the output of the builder and create, the bytes in the middle of the padding are not initialized and do not participate in the comparison
+static bool compareBuild(const char *built, const RtcpHeader *legacy, size_t real_size) {
+    auto size = legacy->getSize();
+    EXPECT_EQ(memcmp(built, legacy, real_size), 0);
+    EXPECT_EQ(built[size - 1], ((const char *)legacy)[size - 1]);
+    return true;
+}
+
+static bool checkBuild(std::mt19937 &rng, RtcpBuilder &builder) {
+    string expect;
+    vector<size_t> real_sizes;
+    auto append = [&](const std::shared_ptr<RtcpHeader> &rtcp, size_t real_size) {
+        expect.append((char *)rtcp.get(), rtcp->getSize());
+        real_sizes.emplace_back(real_size);
+    };
+
+    auto count = 1 + rng() % 4;
+    for (size_t i = 0; i < count; ++i) {
+        switch (rng() % 4) {
+            case 0: {
+                auto items = rng() % 3;
+                auto legacy = RtcpSR::create(items);
+                auto real_size = legacy->getSize() - legacy->getPaddingSize();
+                fill(rng, (char *)legacy.get() + 4, real_size - 4);
+                memcpy((char *)builder.addSR(items) + 4, (char *)legacy.get() + 4, real_size - 4);
+                append(legacy, real_size);
+                break;
+            }
+            case 1: {
+                auto items = rng() % 3;
+                auto legacy = RtcpRR::create(items);
+                auto real_size = legacy->getSize() - legacy->getPaddingSize();
+                fill(rng, (char *)legacy.get() + 4, real_size - 4);
+                memcpy((char *)builder.addRR(items) + 4, (char *)legacy.get() + 4, real_size - 4);
+                append(legacy, real_size);
+                break;
+            }
+            case 2: {
+                string fci(rng() % 40, '\0');
+                fill(rng, &fci[0], fci.size());
+                auto ssrc = (uint32_t)rng();
+                auto legacy = RtcpFB::create(RTPFBType::RTCP_RTPFB_TWCC, fci.data(), fci.size());
+                auto fb = builder.addFB(RTPFBType::RTCP_RTPFB_TWCC, fci.data(), fci.size());
+                legacy->ssrc = fb->ssrc = ssrc;
+                legacy->ssrc_media = fb->ssrc_media = ~ssrc;
+                append(legacy, sizeof(RtcpFB) + fci.size());
+                break;
+            }
+            default: {
+                auto legacy = RtcpXRDLRR::create(1);
+                auto real_size = legacy->getSize() - legacy->getPaddingSize();
+                fill(rng, (char *)legacy.get() + 4, real_size - 4);
+                legacy->bt = 5;
+                memcpy((char *)builder.addXRDLRR(1) + 4, (char *)legacy.get() + 4, real_size - 4);
+                append(legacy, real_size);
+                break;
+            }
+        }
+    }
+
+    auto buffer = builder.finish();
+    EXPECT_EQ(buffer->size(), expect.size());
+    size_t offset = 0;
+    for (auto real_size : real_sizes) {
+        auto legacy = (RtcpHeader *)(expect.data() + offset);
+        if (!compareBuild(buffer->data() + offset, legacy, real_size)) {
+            return false;
+        }
+        offset += legacy->getSize();
+    }
+    // 构造的复合包应能被视图完整解析
+    // The constructed compound packet should be fully parsed by the view
+    size_t parsed = 0;
+    for (auto &view : RtcpCompoundView(buffer->data(), buffer->size())) {
+        parsed += view.size();
+    }
+    EXPECT_EQ(parsed, buffer->size());
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    LogLevel level = (LogLevel)cmd_main["level"].as<int>();
+    level = MIN(MAX(level, LTrace), LError);
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", level));
+
+    auto count = (uint64_t)MAX(cmd_main["count"].as<int>(), 1);
+    std::mt19937 rng(cmd_main["seed"].as<int>());
+    Stats stats;
+    RtcpBuilder builder;
+    for (; stats.cases < count; ++stats.cases) {
+        auto data = makeCompound(rng);
+        mutate(rng, data);
+        if (!checkParse(data, stats) || !checkBuild(rng, builder)) {
+            ++stats.errors;
+            break;
+        }
+    }
+    cout << "cases: " << stats.cases << ", compared rtcp: " << stats.packets << ", skipped rtcp: " << stats.skipped
+         << ", errors: " << stats.errors << endl;
+    return stats.errors ? -1 : 0;
+}
@@ -0,0 +1,113 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "DatachannelSender.h"
+#include "WebRtcTransport.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+DatachannelSender::DatachannelSender(EventPoller::Ptr poller, onSend on_send) {
+    _poller = std::move(poller);
+    _on_send = std::move(on_send);
+}
+
+void DatachannelSender::setOnFlush(std::function<void()> cb) {
+    _on_flush = std::move(cb);
+}
+
+void DatachannelSender::setOnDrain(std::function<void()> cb) {
+    _on_drain = std::move(cb);
+}
+
+bool DatachannelSender::send(uint16_t stream_id, uint32_t ppid, const Buffer::Ptr &msg) {
+    if (!tryReserve(msg->size())) {
+        return false;
+    }
+    enqueue(stream_id, ppid, msg);
+    return true;
+}
+
+bool DatachannelSender::tryReserve(size_t size) {
+    GET_CONFIG(size_t, max_buffer, Rtc::kDataChannelMaxBuffer);
+    auto buffered = _buffered.load();
+    do {
+        if (buffered + size > max_buffer) {
+            return false;
+        }
+    } while (!_buffered.compare_exchange_weak(buffered, buffered + size));
+    return true;
+}
+
+void DatachannelSender::sendReserved(uint16_t stream_id, uint32_t ppid, const Buffer::Ptr &msg) {
+    weak_ptr<DatachannelSender> weak_self = shared_from_this();
+    _poller->async([weak_self, stream_id, ppid, msg]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->enqueue(stream_id, ppid, msg);
+        }
+    });
+}
+
+void DatachannelSender::resume() {
+    _blocked = false;
+    flush();
+}
+
+void DatachannelSender::enqueue(uint16_t stream_id, uint32_t ppid, const Buffer::Ptr &msg) {
+    WebRtcDatachannelMessage item;
+    item.stream_id = stream_id;
+    item.ppid = ppid;
+    item.data = msg;
+    _queue.emplace_back(std::move(item));
+    if (!_flush_scheduled) {
+        // 本轮事件循环结束后统一发送
+        // Send together after this event loop round
+        _flush_scheduled = true;
+        weak_ptr<DatachannelSender> weak_self = shared_from_this();
+        _poller->async([weak_self]() {
+            if (auto strong_self = weak_self.lock()) {
+                strong_self->_flush_scheduled = false;
+                strong_self->flush();
+            }
+        }, false);
+    }
+}
+
+void DatachannelSender::flush() {
+    if (_queue.empty() || _flush_scheduled || _blocked) {
+        return;
+    }
+
+    size_t sent = 0;
+    while (!_queue.empty()) {
+        auto &item = _queue.front();
+        if (!_on_send(item)) {
+            // 等待sctp连接建立或OnSctpAssociationBufferedAmountLow回调后继续
+            // Continue after sctp is connected or the OnSctpAssociationBufferedAmountLow callback
+            _blocked = true;
+            break;
+        }
+        _buffered -= item.data->size();
+        _queue.pop_front();
+        ++sent;
+    }
+
+    if (sent && _on_flush) {
+        _on_flush();
+    }
+    if (_queue.empty() && sent && _on_drain) {
+        _on_drain();
+    }
+}
+
+} // namespace mediakit
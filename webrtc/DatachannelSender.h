@@ -0,0 +1,112 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DATACHANNEL_SENDER_H
+#define ZLMEDIAKIT_DATACHANNEL_SENDER_H
+
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include "Network/Buffer.h"
+#include "Poller/EventPoller.h"
+
+namespace mediakit {
+
+/**
+ * 通过MediaSource::broadcastMessage扇出到该流所有webrtc播放器的datachannel消息
+ * Datachannel message fanned out to all webrtc players of the stream through MediaSource::broadcastMessage
+ * 消息内容在所有播放器间共享，不会逐个拷贝
+ * The message content is shared among all players and will not be copied one by one
+ */
+struct WebRtcDatachannelMessage {
+    uint16_t stream_id = 0;
+    // 51: 文本, 53: 二进制
+    // 51: text, 53: binary
+    uint32_t ppid = 51;
+    toolkit::Buffer::Ptr data;
+};
+
+/**
+ * datachannel发送队列：发送缓存按rtc.datachannel_max_buffer限制(背压)，同一轮事件循环内的消息合并后批量交给sctp
+ * Datachannel send queue: the send buffer is limited by rtc.datachannel_max_buffer (backpressure), messages in the same event loop round are handed to sctp in batches
+ */
+class DatachannelSender : public std::enable_shared_from_this<DatachannelSender> {
+public:
+    using Ptr = std::shared_ptr<DatachannelSender>;
+    // 把一条消息交给sctp，sctp未连接或发送缓存已满时返回false
+    // Hand a message to sctp, return false when sctp is not connected or its send buffer is full
+    using onSend = std::function<bool(const WebRtcDatachannelMessage &msg)>;
+
+    DatachannelSender(toolkit::EventPoller::Ptr poller, onSend on_send);
+
+    /**
+     * 一批消息交给sctp后回调，用于统一flush socket
+     * Callback after a batch of messages is handed to sctp, used to flush the socket once
+     */
+    void setOnFlush(std::function<void()> cb);
+
+    /**
+     * 发送缓存清空时回调，用于背压后恢复发送
+     * Callback when the send buffer is drained, used to resume sending after backpressure
+     */
+    void setOnDrain(std::function<void()> cb);
+
+    /**
+     * 排队发送，必须在poller线程调用
+     * Queue the message for sending, must be called in the poller thread
+     * @return 发送缓存超过rtc.datachannel_max_buffer时返回false，消息被丢弃
+     *         Return false when the send buffer exceeds rtc.datachannel_max_buffer, the message is discarded
+     */
+    bool send(uint16_t stream_id, uint32_t ppid, const toolkit::Buffer::Ptr &msg);
+
+    /**
+     * 原子预留发送缓存，可跨线程调用；预留成功后必须调用sendReserved投递该消息
+     * Reserve the send buffer atomically, can be called across threads; sendReserved must be called to deliver the message after a successful reservation
+     */
+    bool tryReserve(size_t size);
+
+    /**
+     * 投递已预留缓存的消息，可跨线程调用，不会被丢弃
+     * Deliver a message whose buffer has been reserved, can be called across threads, it will not be discarded
+     */
+    void sendReserved(uint16_t stream_id, uint32_t ppid, const toolkit::Buffer::Ptr &msg);
+
+    /**
+     * sctp连接建立或发送缓存清空后调用，继续发送排队的消息
+     * Called after sctp is connected or its send buffer is drained, continue sending the queued messages
+     */
+    void resume();
+
+    /**
+     * 获取尚未交给sctp的字节数，可跨线程调用
+     * Get the bytes not yet handed to sctp, can be called across threads
+     */
+    size_t getBufferedAmount() const { return _buffered; }
+
+private:
+    void enqueue(uint16_t stream_id, uint32_t ppid, const toolkit::Buffer::Ptr &msg);
+    void flush();
+
+private:
+    bool _flush_scheduled = false;
+    // sctp未连接或发送缓存已满，等待resume后再继续发送
+    // sctp is not connected or its send buffer is full, wait for resume before sending again
+    bool _blocked = false;
+    std::atomic<size_t> _buffered { 0 };
+    toolkit::EventPoller::Ptr _poller;
+    onSend _on_send;
+    std::function<void()> _on_flush;
+    std::function<void()> _on_drain;
+    std::deque<WebRtcDatachannelMessage> _queue;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DATACHANNEL_SENDER_H
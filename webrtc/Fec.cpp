@@ -0,0 +1,460 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "Fec.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// RTC配置项目
+// RTC configuration project
+namespace Rtc {
+#define RTC_FIELD "rtc."
+const string kFecEnable = RTC_FIELD "fecEnable";
+const string kFecMinLossRate = RTC_FIELD "fecMinLossRate";
+const string kFecMaxGroupSize = RTC_FIELD "fecMaxGroupSize";
+
+static onceToken token([]() {
+    mINI::Instance()[kFecEnable] = 0;
+    mINI::Instance()[kFecMinLossRate] = 1.0f;
+    mINI::Instance()[kFecMaxGroupSize] = 10;
+});
+
+} // namespace Rtc
+
+// ulpfec header(10字节) + level 0 header(short mask为4字节)
+// ulpfec header(10 bytes) + level 0 header(4 bytes with short mask)
+static constexpr size_t kFecHeaderSize = 10;
+static constexpr size_t kFecLevelHeaderSize = 4;
+static constexpr size_t kFecLevelHeaderSizeLong = 8;
+// short mask最多保护16个rtp
+// Short mask protects up to 16 rtp packets
+static constexpr uint8_t kMaxMaskBits = 16;
+
+static inline bool seqNewer(uint16_t a, uint16_t b) {
+    return a != b && (uint16_t)(a - b) < 0x8000;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void RedPacker::wrap(char *buf, int &len, uint8_t red_pt) {
+    auto header = (RtpHeader *)buf;
+    auto payload = header->getPayloadData();
+    auto tail = (uint8_t *)buf + len;
+    // 负载(含padding)后移一个字节，用于存放red primary block头
+    // Move the payload (including padding) back one byte to store the red primary block header
+    memmove(payload + 1, payload, tail - payload);
+    payload[0] = header->pt & 0x7F;
+    header->pt = red_pt;
+    len += 1;
+}
+
+bool RedPacker::unwrap(char *&buf, size_t &len) {
+    auto header = (RtpHeader *)buf;
+    auto payload_size = header->getPayloadSize(len);
+    if (payload_size < 1) {
+        return false;
+    }
+    auto payload = header->getPayloadData();
+    auto end = payload + payload_size;
+    auto ptr = payload;
+    size_t redundant_size = 0;
+    // 跳过冗余block头(4字节)，累计其数据长度
+    // Skip the redundant block headers (4 bytes) and accumulate their data length
+    while (ptr < end && (ptr[0] & 0x80)) {
+        if (ptr + 4 > end) {
+            return false;
+        }
+        redundant_size += ((ptr[2] & 0x03) << 8) | ptr[3];
+        ptr += 4;
+    }
+    if (ptr >= end) {
+        return false;
+    }
+    auto primary_pt = ptr[0] & 0x7F;
+    auto primary = ptr + 1 + redundant_size;
+    if (primary > end) {
+        return false;
+    }
+    // rtp头(含csrc、ext)后移至primary block数据之前
+    // Move the rtp header (including csrc, ext) to just before the primary block data
+    auto header_size = payload - (uint8_t *)buf;
+    auto new_buf = (char *)primary - header_size;
+    memmove(new_buf, buf, header_size);
+    len -= new_buf - buf;
+    buf = new_buf;
+    ((RtpHeader *)buf)->pt = primary_pt;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+FecEncoder::FecEncoder(uint8_t red_pt, uint8_t ulpfec_pt) {
+    _red_pt = red_pt;
+    _ulpfec_pt = ulpfec_pt;
+    _out_to_origin.resize(kSeqMapSize);
+    _origin_to_out.resize(kSeqMapSize);
+}
+
+void FecEncoder::setFractionLost(uint8_t fraction_lost) {
+    GET_CONFIG(float, min_loss_rate, Rtc::kFecMinLossRate);
+    GET_CONFIG(uint32_t, max_group_size, Rtc::kFecMaxGroupSize);
+
+    auto loss_rate = fraction_lost * 100.0f / 256;
+    uint8_t group_size = 0;
+    if (loss_rate >= min_loss_rate && loss_rate > 0) {
+        // 丢包率越高，分组越小(冗余度越高)，5%丢包时约10个rtp一个fec包
+        // The higher the loss rate, the smaller the group (the higher the redundancy), about 1 fec for 10 rtp at 5% loss
+        auto size = (uint32_t)(50 / loss_rate);
+        size = MIN(size, MIN(max_group_size, (uint32_t)kMaxMaskBits));
+        group_size = (uint8_t)MAX(size, 2u);
+    }
+    if (group_size != _group_size) {
+        DebugL << "fec group size changed: " << (int)_group_size << " -> " << (int)group_size << ", loss rate: " << loss_rate << "%";
+        _group_size = group_size;
+        if (!_group_size) {
+            // 关闭fec，丢弃未完成的分组
+            // Turn off fec and discard unfinished groups
+            _group_count = 0;
+        }
+    }
+}
+
+void FecEncoder::inputRtp(RtpHeader *header, size_t len) {
+    auto origin_seq = ntohs(header->seq);
+    uint16_t out_seq = origin_seq + _seq_offset;
+    if (_group_count && (uint16_t)(out_seq - _group_seq_base) >= kMaxMaskBits) {
+        // 超出mask保护范围，先结束当前分组
+        // Out of mask protection range, end the current group first
+        makeFec();
+        out_seq = origin_seq + _seq_offset;
+    }
+    header->seq = htons(out_seq);
+    _last_out_seq = out_seq;
+    _ssrc = header->ssrc;
+    _stamp = header->stamp;
+
+    auto &by_out = _out_to_origin[out_seq % kSeqMapSize];
+    by_out.origin = origin_seq;
+    by_out.out = out_seq;
+    by_out.valid = true;
+    _origin_to_out[origin_seq % kSeqMapSize] = by_out;
+
+    if (!_group_size || len <= RtpPacket::kRtpHeaderSize) {
+        return;
+    }
+
+    if (!_group_count) {
+        _group_seq_base = out_seq;
+        _group_mask = 0;
+        _xor_size = 0;
+        memset(_xor_header, 0, sizeof(_xor_header));
+    }
+
+    // 异或头部: P/X/CC, M/PT, 时间戳, 长度(rtp固定头以后的字节数)
+    // Xor header: P/X/CC, M/PT, timestamp, length (number of bytes after the fixed rtp header)
+    auto ptr = (uint8_t *)header;
+    auto length = (uint16_t)(len - RtpPacket::kRtpHeaderSize);
+    _xor_header[0] ^= ptr[0];
+    _xor_header[1] ^= ptr[1];
+    for (auto i = 0; i < 4; ++i) {
+        _xor_header[2 + i] ^= ptr[4 + i];
+    }
+    _xor_header[6] ^= length >> 8;
+    _xor_header[7] ^= length & 0xFF;
+
+    // 异或负载(含csrc、ext、padding)
+    // Xor payload (including csrc, ext, padding)
+    if (length > _xor_size) {
+        if (_xor_payload.size() < length) {
+            _xor_payload.resize(length);
+        }
+        memset(_xor_payload.data() + _xor_size, 0, length - _xor_size);
+        _xor_size = length;
+    }
+    auto src = ptr + RtpPacket::kRtpHeaderSize;
+    auto dst = _xor_payload.data();
+    for (size_t i = 0; i < length; ++i) {
+        dst[i] ^= src[i];
+    }
+
+    _group_mask |= 0x8000 >> (uint16_t)(out_seq - _group_seq_base);
+    ++_group_count;
+    if (_group_count >= _group_size || (header->mark && _group_count >= 2)) {
+        // 分组已满或者一帧结束，生成fec包
+        // The group is full or the frame ends, generate fec packet
+        makeFec();
+    }
+}
+
+void FecEncoder::makeFec() {
+    if (!_group_count) {
+        return;
+    }
+    _group_count = 0;
+
+    // fec包占用紧随其后的一个seq，后续媒体包seq整体后移
+    // The fec packet occupies the next seq, and the subsequent media packet seqs are shifted as a whole
+    uint16_t fec_seq = _last_out_seq + 1;
+    _last_out_seq = fec_seq;
+    ++_seq_offset;
+
+    std::string pkt;
+    pkt.resize(RtpPacket::kRtpHeaderSize + 1 + kFecHeaderSize + kFecLevelHeaderSize + _xor_size);
+    auto ptr = (uint8_t *)pkt.data();
+
+    // rtp头
+    // rtp header
+    auto header = (RtpHeader *)ptr;
+    memset(ptr, 0, RtpPacket::kRtpHeaderSize);
+    header->version = RtpPacket::kRtpVersion;
+    header->pt = _red_pt;
+    header->seq = htons(fec_seq);
+    header->stamp = _stamp;
+    header->ssrc = _ssrc;
+    ptr += RtpPacket::kRtpHeaderSize;
+
+    // red primary block头
+    // red primary block header
+    *ptr++ = _ulpfec_pt & 0x7F;
+
+    // fec header, E=0, L=0
+    ptr[0] = _xor_header[0] & 0x3F;
+    ptr[1] = _xor_header[1];
+    ptr[2] = _group_seq_base >> 8;
+    ptr[3] = _group_seq_base & 0xFF;
+    memcpy(ptr + 4, _xor_header + 2, 4);
+    ptr[8] = _xor_header[6];
+    ptr[9] = _xor_header[7];
+    ptr += kFecHeaderSize;
+
+    // level 0 header
+    ptr[0] = (_xor_size >> 8) & 0xFF;
+    ptr[1] = _xor_size & 0xFF;
+    ptr[2] = _group_mask >> 8;
+    ptr[3] = _group_mask & 0xFF;
+    ptr += kFecLevelHeaderSize;
+
+    memcpy(ptr, _xor_payload.data(), _xor_size);
+
+    ++_fec_packets;
+    _fec_bytes += pkt.size();
+    _fec_list.emplace_back(std::move(pkt));
+}
+
+void FecEncoder::flush(const onFec &cb) {
+    for (auto &pkt : _fec_list) {
+        cb(pkt.data(), pkt.size());
+    }
+    _fec_list.clear();
+}
+
+bool FecEncoder::getOriginSeq(uint16_t &seq) const {
+    auto &item = _out_to_origin[seq % kSeqMapSize];
+    if (!item.valid || item.out != seq) {
+        return false;
+    }
+    seq = item.origin;
+    return true;
+}
+
+uint16_t FecEncoder::getOutSeq(uint16_t origin_seq) const {
+    auto &item = _origin_to_out[origin_seq % kSeqMapSize];
+    if (item.valid && item.origin == origin_seq) {
+        return item.out;
+    }
+    return origin_seq + _seq_offset;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+FecDecoder::FecDecoder() {
+    _media.resize(kMediaCacheSize);
+}
+
+void FecDecoder::setOnRecovered(onRecovered cb) {
+    _cb = std::move(cb);
+}
+
+void FecDecoder::saveMedia(const char *buf, size_t len) {
+    auto seq = ntohs(((RtpHeader *)buf)->seq);
+    auto &item = _media[seq % kMediaCacheSize];
+    item.valid = true;
+    item.seq = seq;
+    // 复用vector内存，避免频繁分配
+    // Reuse vector memory to avoid frequent allocation
+    item.data.assign((uint8_t *)buf, (uint8_t *)buf + len);
+    if (!_started || seqNewer(seq, _max_seq)) {
+        _started = true;
+        _max_seq = seq;
+    }
+}
+
+const FecDecoder::MediaItem *FecDecoder::getMedia(uint16_t seq) const {
+    auto &item = _media[seq % kMediaCacheSize];
+    if (!item.valid || item.seq != seq) {
+        return nullptr;
+    }
+    return &item;
+}
+
+void FecDecoder::inputRtp(const char *buf, size_t len) {
+    if (len < RtpPacket::kRtpHeaderSize) {
+        return;
+    }
+    saveMedia(buf, len);
+    if (!_fec.empty()) {
+        tryRecover();
+    }
+}
+
+void FecDecoder::inputFec(const RtpHeader *header, const uint8_t *fec, size_t size) {
+    if (size < kFecHeaderSize + kFecLevelHeaderSize) {
+        return;
+    }
+    bool long_mask = fec[0] & 0x40;
+    auto level_header_size = long_mask ? kFecLevelHeaderSizeLong : kFecLevelHeaderSize;
+    if (size < kFecHeaderSize + level_header_size) {
+        return;
+    }
+    auto level = fec + kFecHeaderSize;
+    auto protect_len = (level[0] << 8) | level[1];
+    if (size < kFecHeaderSize + level_header_size + protect_len) {
+        WarnL << "invalid ulpfec packet, size:" << size << ", protect len:" << protect_len;
+        return;
+    }
+
+    FecItem item;
+    item.seq_base = (fec[2] << 8) | fec[3];
+    item.mask_bits = long_mask ? 48 : 16;
+    item.mask = 0;
+    for (size_t i = 0; i < item.mask_bits / 8; ++i) {
+        item.mask = (item.mask << 8) | level[2 + i];
+    }
+    item.ssrc = ntohl(header->ssrc);
+    item.data.assign(fec, fec + kFecHeaderSize + level_header_size + protect_len);
+    ++_fec_packets;
+
+    _fec.emplace_back(std::move(item));
+    if (_fec.size() > kMaxFecCount) {
+        _fec.pop_front();
+    }
+    tryRecover();
+}
+
+void FecDecoder::tryRecover() {
+    bool again = true;
+    while (again) {
+        again = false;
+        for (auto it = _fec.begin(); it != _fec.end();) {
+            auto &fec = *it;
+            size_t missing = 0;
+            uint16_t lost_seq = 0;
+            for (uint8_t i = 0; i < fec.mask_bits; ++i) {
+                if (!(fec.mask & (1ULL << (fec.mask_bits - 1 - i)))) {
+                    continue;
+                }
+                uint16_t seq = fec.seq_base + i;
+                if (!getMedia(seq)) {
+                    ++missing;
+                    lost_seq = seq;
+                }
+            }
+            if (missing == 1) {
+                // 只丢了一个包，可以恢复; 恢复后可能使其他fec包满足恢复条件
+                // Only one packet is lost, it can be recovered; after recovery, other fec packets may meet the recovery conditions
+                recover(fec, lost_seq);
+                _fec.erase(it);
+                again = true;
+                break;
+            }
+            if (missing == 0 || (uint16_t)(_max_seq - fec.seq_base) > kMediaCacheSize / 2) {
+                // 所保护的包都已收到，或者该fec包太老，媒体缓存已经被覆盖
+                // All the protected packets have been received, or the fec packet is too old and the media cache has been overwritten
+                it = _fec.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+}
+
+bool FecDecoder::recover(const FecItem &fec, uint16_t lost_seq) {
+    auto ptr = fec.data.data();
+    auto level_header_size = (ptr[0] & 0x40) ? kFecLevelHeaderSizeLong : kFecLevelHeaderSize;
+    auto level = ptr + kFecHeaderSize;
+    size_t protect_len = (level[0] << 8) | level[1];
+
+    uint8_t header[8];
+    header[0] = ptr[0];
+    header[1] = ptr[1];
+    memcpy(header + 2, ptr + 4, 4);
+    header[6] = ptr[8];
+    header[7] = ptr[9];
+
+    _recover_buf.resize(RtpPacket::kRtpHeaderSize + protect_len);
+    auto payload = _recover_buf.data() + RtpPacket::kRtpHeaderSize;
+    memcpy(payload, level + level_header_size, protect_len);
+
+    for (uint8_t i = 0; i < fec.mask_bits; ++i) {
+        if (!(fec.mask & (1ULL << (fec.mask_bits - 1 - i)))) {
+            continue;
+        }
+        uint16_t seq = fec.seq_base + i;
+        if (seq == lost_seq) {
+            continue;
+        }
+        auto media = getMedia(seq);
+        auto src = media->data.data();
+        auto length = (uint16_t)(media->data.size() - RtpPacket::kRtpHeaderSize);
+        header[0] ^= src[0];
+        header[1] ^= src[1];
+        for (auto j = 0; j < 4; ++j) {
+            header[2 + j] ^= src[4 + j];
+        }
+        header[6] ^= length >> 8;
+        header[7] ^= length & 0xFF;
+        auto xor_len = MIN((size_t)length, protect_len);
+        src += RtpPacket::kRtpHeaderSize;
+        for (size_t j = 0; j < xor_len; ++j) {
+            payload[j] ^= src[j];
+        }
+    }
+
+    size_t length = (header[6] << 8) | header[7];
+    if (length > protect_len) {
+        // level 0未保护全部负载，无法恢复
+        // Level 0 does not protect the entire payload, cannot recover
+        WarnL << "recover rtp failed, seq:" << lost_seq << ", length:" << length << ", protect len:" << protect_len;
+        return false;
+    }
+
+    auto rtp = _recover_buf.data();
+    rtp[0] = (RtpPacket::kRtpVersion << 6) | (header[0] & 0x3F);
+    rtp[1] = header[1];
+    rtp[2] = lost_seq >> 8;
+    rtp[3] = lost_seq & 0xFF;
+    memcpy(rtp + 4, header + 2, 4);
+    auto ssrc = htonl(fec.ssrc);
+    memcpy(rtp + 8, &ssrc, 4);
+    _recover_buf.resize(RtpPacket::kRtpHeaderSize + length);
+
+    ++_recovered;
+    saveMedia((char *)_recover_buf.data(), _recover_buf.size());
+    if (_cb) {
+        _cb((char *)_recover_buf.data(), _recover_buf.size());
+    }
+    return true;
+}
+
+} // namespace mediakit
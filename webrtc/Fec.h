@@ -0,0 +1,216 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_FEC_H
+#define ZLMEDIAKIT_FEC_H
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "Rtsp/Rtsp.h"
+
+namespace mediakit {
+
+// RTC配置项目
+// RTC configuration project
+namespace Rtc {
+// 是否开启red/ulpfec前向纠错(仅视频)
+// Whether to enable red/ulpfec forward error correction (video only)
+extern const std::string kFecEnable;
+// 丢包率(百分比)大于该值时才发送fec包
+// Only send fec packets when the loss rate (percent) is greater than this value
+extern const std::string kFecMinLossRate;
+// 单个fec包最多保护的rtp个数，最大16
+// Maximum number of rtp protected by a single fec packet, up to 16
+extern const std::string kFecMaxGroupSize;
+} // namespace Rtc
+
+/**
+ * red(rfc2198)封装工具
+ * red(rfc2198) encapsulation tools
+ */
+class RedPacker {
+public:
+    /**
+     * 在rtp负载前插入red primary block头(1字节)，调用者必须确保buf尾部至少有1字节的空余
+     * Insert red primary block header (1 byte) before the rtp payload, the caller must ensure that there is at least 1 byte of free space at the end of buf
+     */
+    static void wrap(char *buf, int &len, uint8_t red_pt);
+
+    /**
+     * 就地解封装red包，丢弃冗余block，返回primary block对应的普通rtp包
+     * Unwrap red packet in place, discard the redundant blocks, and return the plain rtp of the primary block
+     * @param buf red包，解封装后指向普通rtp包起始位置
+     * @param len red包长度，解封装后为普通rtp包长度
+     * @return 失败返回false
+     */
+    static bool unwrap(char *&buf, size_t &len);
+};
+
+/**
+ * ulpfec(rfc5109)编码器，只实现level 0保护
+ * ulpfec(rfc5109) encoder, only level 0 protection is implemented
+ * 由于fec包与媒体包共享seq空间，本对象同时负责媒体包seq的重映射
+ * Since fec packets share the seq space with media packets, this object is also responsible for remapping the seq of media packets
+ */
+class FecEncoder {
+public:
+    using Ptr = std::shared_ptr<FecEncoder>;
+    using onFec = std::function<void(const char *buf, size_t len)>;
+
+    FecEncoder(uint8_t red_pt, uint8_t ulpfec_pt);
+
+    /**
+     * 根据对端rr汇报的丢包率调整保护强度
+     * Adjust the protection level according to the loss rate reported by the peer's rr
+     * @param fraction_lost rr中的fraction lost字段(x/256)
+     */
+    void setFractionLost(uint8_t fraction_lost);
+
+    /**
+     * 输入即将发送的媒体包(pt/ssrc已修改为目标值，尚未red封装)
+     * Input the media packet to be sent (pt/ssrc has been modified to the target value, not yet red encapsulated)
+     * 该函数会修改rtp seq为重映射后的值
+     * This function will modify the rtp seq to the remapped value
+     */
+    void inputRtp(RtpHeader *header, size_t len);
+
+    /**
+     * 生成已经凑够的fec包(含rtp头与red头)
+     * Generate the fec packets that are ready (including rtp header and red header)
+     */
+    void flush(const onFec &cb);
+
+    /**
+     * 重映射后的seq转换为原始seq，用于处理nack
+     * Convert the remapped seq to the original seq, used to handle nack
+     */
+    bool getOriginSeq(uint16_t &seq) const;
+
+    /**
+     * 原始seq转换为重映射后的seq，用于rtx osn字段
+     * Convert the original seq to the remapped seq, used for rtx osn field
+     */
+    uint16_t getOutSeq(uint16_t origin_seq) const;
+
+    uint8_t getGroupSize() const { return _group_size; }
+    uint64_t getFecPackets() const { return _fec_packets; }
+    uint64_t getFecBytes() const { return _fec_bytes; }
+
+private:
+    void makeFec();
+
+private:
+    static constexpr size_t kSeqMapSize = 2048;
+
+    uint8_t _red_pt;
+    uint8_t _ulpfec_pt;
+    // 0代表不发送fec包
+    // 0 means no fec packets are sent
+    uint8_t _group_size = 0;
+    uint16_t _seq_offset = 0;
+    uint16_t _last_out_seq = 0;
+    uint32_t _ssrc = 0;
+    uint32_t _stamp = 0;
+    uint64_t _fec_packets = 0;
+    uint64_t _fec_bytes = 0;
+
+    struct SeqPair {
+        uint16_t origin = 0;
+        uint16_t out = 0;
+        bool valid = false;
+    };
+    // 分别以out seq和origin seq为下标的seq映射表
+    // Seq mapping tables indexed by out seq and origin seq respectively
+    std::vector<SeqPair> _out_to_origin;
+    std::vector<SeqPair> _origin_to_out;
+
+    // 当前分组的异或中间结果
+    // Intermediate xor result of the current group
+    uint8_t _group_count = 0;
+    uint16_t _group_seq_base = 0;
+    uint16_t _group_mask = 0;
+    uint8_t _xor_header[10];
+    size_t _xor_size = 0;
+    std::vector<uint8_t> _xor_payload;
+    // 待发送的fec包
+    // Fec packets to be sent
+    std::list<std::string> _fec_list;
+};
+
+/**
+ * ulpfec(rfc5109)解码器，使用已收到的媒体包与fec包恢复丢失的媒体包
+ * ulpfec(rfc5109) decoder, recovers lost media packets using the received media packets and fec packets
+ */
+class FecDecoder {
+public:
+    using Ptr = std::shared_ptr<FecDecoder>;
+    using onRecovered = std::function<void(char *buf, size_t len)>;
+
+    FecDecoder();
+
+    void setOnRecovered(onRecovered cb);
+
+    /**
+     * 输入收到的媒体包(已red解封装)
+     * Input the received media packet (red unwrapped)
+     */
+    void inputRtp(const char *buf, size_t len);
+
+    /**
+     * 输入收到的ulpfec包
+     * Input the received ulpfec packet
+     * @param header fec包的rtp头
+     * @param fec ulpfec负载(fec header开始)
+     * @param size ulpfec负载长度
+     */
+    void inputFec(const RtpHeader *header, const uint8_t *fec, size_t size);
+
+    uint64_t getRecovered() const { return _recovered; }
+    uint64_t getFecPackets() const { return _fec_packets; }
+
+private:
+    struct MediaItem {
+        bool valid = false;
+        uint16_t seq = 0;
+        std::vector<uint8_t> data;
+    };
+
+    struct FecItem {
+        uint16_t seq_base;
+        uint64_t mask;
+        uint8_t mask_bits;
+        uint32_t ssrc;
+        std::vector<uint8_t> data;
+    };
+
+    void tryRecover();
+    bool recover(const FecItem &fec, uint16_t lost_seq);
+    const MediaItem *getMedia(uint16_t seq) const;
+    void saveMedia(const char *buf, size_t len);
+
+private:
+    static constexpr size_t kMediaCacheSize = 512;
+    static constexpr size_t kMaxFecCount = 64;
+
+    bool _started = false;
+    uint16_t _max_seq = 0;
+    uint64_t _recovered = 0;
+    uint64_t _fec_packets = 0;
+    onRecovered _cb;
+    std::vector<MediaItem> _media;
+    std::list<FecItem> _fec;
+    std::vector<uint8_t> _recover_buf;
+};
+
+} // namespace mediakit
+
+#endif // ZLMEDIAKIT_FEC_H
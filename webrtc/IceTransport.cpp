@@ -28,11 +28,19 @@ namespace RTC {
 #define RTC_FIELD "rtc."
 const string kPortRange = RTC_FIELD "port_range";
 const string kMaxStunRetry = RTC_FIELD "max_stun_retry";
+// 单个TURN分配的带宽配额(kbps)，0为不限制
+// Bandwidth quota of a single TURN allocation (kbps), 0 means unlimited
+const string kTurnMaxBitrate = RTC_FIELD "turnMaxBitrate";
 static onceToken token([]() {
     mINI::Instance()[kPortRange] = "49152-65535";
     mINI::Instance()[kMaxStunRetry] = 7;
+    mINI::Instance()[kTurnMaxBitrate] = 0;
 });
 
+// 中继数据批量发送时，最多积攒的包个数
+// Maximum number of packets accumulated when relay data is sent in batches
+static constexpr size_t kMaxRelayBatch = 32;
+
 static uint32_t calIceCandidatePriority(CandidateInfo::AddressType type, uint32_t component_id = 1) {
     uint32_t type_preference;
     switch (type) {
@@ -149,6 +157,7 @@ IceTransport::IceTransport(Listener* listener, std::string ufrag, std::string pa
 : _poller(std::move(poller)), _listener(listener), _ufrag(std::move(ufrag)), _password(std::move(password)) {
     TraceL;
     _identifier = makeRandStr(32);
+    _packet_pool.setSize(64);
     _request_handlers.emplace(std::make_pair(StunPacket::Class::REQUEST, StunPacket::Method::BINDING), 
                               std::bind(&IceTransport::handleBindingRequest, this, std::placeholders::_1, std::placeholders::_2));
 }
@@ -175,12 +184,18 @@ void IceTransport::sendSocketData_l(const Buffer::Ptr& buf, const Pair::Ptr& pai
         throw std::invalid_argument("pair should not be nullptr");
     }
 
+    auto sock = pair->_socket->getSock();
+    if (!sock) {
+        return;
+    }
+
     // 一次性发送一帧的rtp数据，提高网络io性能  [AUTO-TRANSLATED:fbab421e]
     // Send one frame of rtp data at a time to improve network io performance
-    if (pair->_socket->getSock()->sockType() == SockNum::Sock_TCP) {
+    if (sock->sockType() == SockNum::Sock_TCP) {
         // 增加tcp两字节头
+        // Add the tcp two-byte header
         uint16_t len = htons(buf->size());
-        pair->_socket->SockSender::send((char *)&len, 2);
+        sock->send((char *)&len, 2, nullptr, 0, false);
     }
 
 #if 0
@@ -191,10 +206,9 @@ void IceTransport::sendSocketData_l(const Buffer::Ptr& buf, const Pair::Ptr& pai
     sockaddr_storage peer_addr;
     pair->get_peer_addr(peer_addr);
     auto addr_len = SockUtil::get_sock_len((const struct sockaddr*)&peer_addr);
-    pair->_socket->sendto(buf, (struct sockaddr*)&peer_addr, addr_len);
-    if (flush) {
-        pair->_socket->flushAll();
-    }
+    // 由调用方决定是否flush，不依赖也不修改session的flush标记
+    // The caller decides whether to flush, neither relying on nor modifying the session's flush flag
+    sock->send(buf, (struct sockaddr*)&peer_addr, addr_len, flush);
 }
 
 bool IceTransport::processSocketData(const uint8_t* data, size_t len, const Pair::Ptr& pair) {
@@ -372,29 +386,31 @@ void IceTransport::handleBindingRequest(const StunPacket::Ptr& packet, const Pai
 }
 
 void IceTransport::sendChannelData(uint16_t channel_number, const Buffer::Ptr& buffer, const Pair::Ptr& pair) {
-    // TraceL;
+#if 0
+    TraceL << pair->dumpString(1) << " send channel " << channel_number << " data " << buffer->size();
+    TraceL << "data: " << hexdump(buffer->data(), buffer->size());
+#endif
+
+    sendSocketData(packChannelData(channel_number, buffer->data(), buffer->size()), pair);
+}
 
+Buffer::Ptr IceTransport::packChannelData(uint16_t channel_number, const char *data, size_t data_len) {
     // ChannelData不是STUN消息，需要单独实现
     // ChannelData格式：2字节Channel Number + 2字节数据长度 + 数据内容
-    auto data_len = buffer->size();
     size_t total_len = 4 + data_len;
-    // 分配缓冲区：头部4字节 + 数据长度
-    auto channel_data = toolkit::BufferRaw::create(total_len);
+    // 从缓存池获取缓冲区：头部4字节 + 数据长度
+    auto channel_data = _packet_pool.obtain2();
+    channel_data->setCapacity(total_len + 1);
     auto header = reinterpret_cast<ChannelDataHeader *>(channel_data->data());
     // 设置Channel Number (前两字节，网络字节序)
     header->channel_number = htons(channel_number);
     // 设置数据长度 (中间两字节，网络字节序)
     header->data_length = htons(data_len);
-    // 拷贝数据
-    memcpy(channel_data->data() + 4, buffer->data(), data_len);
+    // 拷贝数据，udp下头部和负载必须位于同一个Buffer(一个数据报)中
+    // Copy the payload, with udp the header and payload must be in the same Buffer (one datagram)
+    memcpy(channel_data->data() + 4, data, data_len);
     channel_data->setSize(total_len);
-
-#if 0
-    TraceL << pair->dumpString(1) << " send channel " << channel_number << " data " << data_len;
-    TraceL << "data: " << hexdump(buffer->data(), buffer->size());
-#endif
-
-    sendSocketData(channel_data, pair);
+    return channel_data;
 }
 
 void IceTransport::sendUnauthorizedResponse(const StunPacket::Ptr& packet, const Pair::Ptr& pair) {
@@ -449,21 +465,35 @@ bool IceTransport::hasChannelBind(uint16_t channel_number) {
 }
 
 bool IceTransport::hasChannelBind(const sockaddr_storage& addr, uint16_t& channel_number) {
-    for (const auto& binding : _channel_bindings) {
-        if (SockUtil::is_same_addr(reinterpret_cast<const struct sockaddr*>(&binding.second),
-                                   reinterpret_cast<const struct sockaddr*>(&addr))) {
-            channel_number = binding.first;
-            return true;
-        }
+    auto it = _channel_numbers.find(addr);
+    if (it == _channel_numbers.end()) {
+        return false;
     }
-    return false;
+    channel_number = it->second;
+    return true;
 }
 
 void IceTransport::addChannelBind(uint16_t channel_number, const sockaddr_storage& addr) {
+    auto it = _channel_bindings.find(channel_number);
+    if (it != _channel_bindings.end()) {
+        // 通道重新绑定到其他地址，移除旧的反向索引
+        // The channel is rebound to another address, remove the old reverse index
+        _channel_numbers.erase(it->second);
+    }
     _channel_bindings[channel_number] = addr;
+    _channel_numbers[addr] = channel_number;
     _channel_binding_times[channel_number] = toolkit::getCurrentMillisecond();
 }
 
+void IceTransport::removeChannelBind(uint16_t channel_number) {
+    auto it = _channel_bindings.find(channel_number);
+    if (it == _channel_bindings.end()) {
+        return;
+    }
+    _channel_numbers.erase(it->second);
+    _channel_bindings.erase(it);
+}
+
 SocketHelper::Ptr IceTransport::createSocket(CandidateTuple::TransportType type, const std::string &peer_host, uint16_t peer_port, const std::string &local_ip, uint16_t local_port) {
     if (type != CandidateTuple::TransportType::UDP) {
         throw std::invalid_argument("not support transport type: TCP");
@@ -682,10 +712,24 @@ IceServer::IceServer(Listener* listener, std::string ufrag, std::string password
                                   std::bind(&IceServer::handleChannelBindRequest, this, placeholders::_1, placeholders::_2));
         _request_handlers.emplace(std::make_pair(StunPacket::Class::INDICATION, StunPacket::Method::SEND), 
                                   std::bind(&IceServer::handleSendIndication, this, placeholders::_1, placeholders::_2));
+        // 每分钟清理一次过期的权限和通道绑定
+        // Clean up expired permissions and channel bindings every minute
+        _expire_timer = std::make_shared<Timer>(60.0f, [this]() {
+            expirePeers();
+            return true;
+        }, getPoller());
     }
 
 }
 
+IceServer::~IceServer() {
+    if (_relay_stat.backing_packets || _relay_stat.forwarding_packets) {
+        InfoL << "turn relay backing: " << _relay_stat.backing_packets << " packets/" << _relay_stat.backing_bytes << " bytes"
+              << ", forwarding: " << _relay_stat.forwarding_packets << " packets/" << _relay_stat.forwarding_bytes << " bytes"
+              << ", dropped: " << _relay_stat.dropped_packets << ", flush count: " << _relay_stat.flush_count;
+    }
+}
+
 bool IceServer::processSocketData(const uint8_t* data, size_t len, const Pair::Ptr& pair) {
     if (!_session_pair) {
         _session_pair = pair;
@@ -693,24 +737,156 @@ bool IceServer::processSocketData(const uint8_t* data, size_t len, const Pair::P
     return IceTransport::processSocketData(data, len, pair);
 }
 
-void IceServer::processRelayPacket(const Buffer::Ptr &buffer, const Pair::Ptr& pair) {
-    // TraceL << pair->dumpString(0);
+void IceServer::processRelayPacket(const Buffer::Ptr &buffer, const struct sockaddr *addr, int addr_len) {
+    // TraceL << addrToStr(peer_addr);
 
     sockaddr_storage peer_addr;
-    pair->get_peer_addr(peer_addr);
+    memset(&peer_addr, 0, sizeof(peer_addr));
+    memcpy(&peer_addr, addr, std::min<size_t>(addr_len, sizeof(peer_addr)));
 
     if (!hasPermission(peer_addr)) {
-        WarnL << "No permission exists for peer: " << pair->get_peer_ip() << ":" << pair->get_peer_port();
+        WarnL << "No permission exists for peer: " << addrToStr(peer_addr);
+        return;
+    }
+
+    if (!_session_pair || !consumeQuota(buffer->size())) {
         return;
     }
 
-    auto forward_pair = std::make_shared<Pair>(_session_pair->_socket, pair->_socket->get_peer_ip(), pair->_socket->get_peer_port());
+    ++_relay_stat.forwarding_packets;
+    _relay_stat.forwarding_bytes += buffer->size();
+
     uint16_t channel_number;
     if (hasChannelBind(peer_addr, channel_number)) {
-        sendChannelData(channel_number, buffer, forward_pair);
+        // 热路径：ChannelData在缓存池缓冲区中组装(负载拷贝一次)后批量发送，
+        // toolkit会复用socket接收缓冲区且每个Buffer对应一个udp数据报，因此无法引用原始负载
+        // Hot path: ChannelData is assembled in a pooled buffer (one payload copy) and sent in batches,
+        // the toolkit reuses socket receive buffers and each Buffer is one udp datagram, so the original payload can't be referenced
+        sendRelayData(packChannelData(channel_number, buffer->data(), buffer->size()), getClientPair(_session_pair->_socket));
     } else {
-        sendDataIndication(peer_addr, buffer, forward_pair);
+        sendDataIndication(peer_addr, buffer, getClientPair(_session_pair->_socket));
+    }
+}
+
+const IceTransport::Pair::Ptr &IceServer::getClientPair(const SocketHelper::Ptr &session_socket) {
+    if (!_client_pair || _client_pair->_socket != session_socket) {
+        _client_pair = std::make_shared<Pair>(session_socket, session_socket->get_peer_ip(), session_socket->get_peer_port());
     }
+    return _client_pair;
+}
+
+const IceTransport::Pair::Ptr &IceServer::getPeerPair(const Pair::Ptr &relayed_pair, const sockaddr_storage &peer_addr) {
+    auto &pair = _peer_pairs[peer_addr];
+    if (!pair || pair->_socket != relayed_pair->_socket) {
+        pair = std::make_shared<Pair>(relayed_pair->_socket, SockUtil::inet_ntoa((const struct sockaddr *)&peer_addr),
+                                      SockUtil::inet_port((const struct sockaddr *)&peer_addr));
+    }
+    return pair;
+}
+
+void IceServer::expirePeers() {
+    uint64_t now = toolkit::getCurrentMillisecond();
+    // 通道绑定有效期为10分钟
+    // Channel bindings are valid for 10 minutes
+    for (auto it = _channel_binding_times.begin(); it != _channel_binding_times.end();) {
+        if (now - it->second > 10 * 60 * 1000) {
+            removeChannelBind(it->first);
+            it = _channel_binding_times.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // 权限有效期为5分钟
+    // Permissions are valid for 5 minutes
+    for (auto it = _permissions.begin(); it != _permissions.end();) {
+        if (now - it->second > 5 * 60 * 1000) {
+            it = _permissions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // 没有权限的peer不会再被转发数据，释放其发送对
+    // Peers without permission will not be relayed anymore, release their pairs
+    for (auto it = _peer_pairs.begin(); it != _peer_pairs.end();) {
+        if (_permissions.find(it->first) == _permissions.end()) {
+            it = _peer_pairs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool IceServer::consumeQuota(size_t bytes) {
+    GET_CONFIG(uint32_t, max_bitrate, RTC::kTurnMaxBitrate);
+    if (!max_bitrate) {
+        return true;
+    }
+    // 令牌桶容量为1秒的配额
+    // The token bucket capacity is the quota of 1 second
+    double bytes_per_ms = max_bitrate / 8.0;
+    auto now = getCurrentMillisecond();
+    if (!_quota_stamp) {
+        _quota_tokens = bytes_per_ms * 1000;
+    } else {
+        _quota_tokens = std::min(bytes_per_ms * 1000, _quota_tokens + bytes_per_ms * (now - _quota_stamp));
+    }
+    _quota_stamp = now;
+    if (_quota_tokens < bytes) {
+        if (++_relay_stat.dropped_packets % 1000 == 1) {
+            WarnL << "turn allocation exceeds bandwidth quota: " << max_bitrate << "kbps, dropped packets: " << _relay_stat.dropped_packets;
+        }
+        return false;
+    }
+    _quota_tokens -= bytes;
+    return true;
+}
+
+void IceServer::sendRelayData(const Buffer::Ptr &buffer, const Pair::Ptr &pair) {
+    auto sock = pair->_socket->getSock();
+    if (!sock) {
+        return;
+    }
+    // 显式指定本次发送不flush，不修改socket的flush标记，同一socket上的stun/rtc数据仍然立即发送
+    // Explicitly specify not to flush this send without modifying the flush flag of the socket, stun/rtc data on the same socket is still sent immediately
+    if (sock->sockType() == SockNum::Sock_TCP) {
+        uint16_t len = htons(buffer->size());
+        sock->send((char *)&len, 2, nullptr, 0, false);
+    }
+    sockaddr_storage peer_addr;
+    pair->get_peer_addr(peer_addr);
+    sock->send(buffer, (struct sockaddr *)&peer_addr, SockUtil::get_sock_len((const struct sockaddr *)&peer_addr), false);
+    if (std::find(_dirty_sockets.begin(), _dirty_sockets.end(), pair->_socket) == _dirty_sockets.end()) {
+        _dirty_sockets.emplace_back(pair->_socket);
+    }
+    if (++_pending_packets >= kMaxRelayBatch) {
+        flushRelayData();
+        return;
+    }
+    if (_flush_scheduled) {
+        return;
+    }
+    // 本轮事件循环结束后统一flush，同一次recvmmsg收到的数据合并发送
+    // Flush after this event loop round, data received by the same recvmmsg are sent together
+    _flush_scheduled = true;
+    weak_ptr<IceServer> weak_self = static_pointer_cast<IceServer>(shared_from_this());
+    getPoller()->async([weak_self]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->_flush_scheduled = false;
+            strong_self->flushRelayData();
+        }
+    }, false);
+}
+
+void IceServer::flushRelayData() {
+    if (!_pending_packets) {
+        return;
+    }
+    for (auto &socket : _dirty_sockets) {
+        socket->flushAll();
+    }
+    _dirty_sockets.clear();
+    _pending_packets = 0;
+    ++_relay_stat.flush_count;
 }
 
 void IceServer::handleAllocateRequest(const StunPacket::Ptr& packet, const Pair::Ptr& pair) {
@@ -792,8 +968,10 @@ void IceServer::handleChannelBindRequest(const StunPacket::Ptr& packet, const Pa
         return;
     }
 
-    // 添加或更新通道绑定
+    // 添加或更新通道绑定，同时刷新该peer的权限(RFC 5766 11.2)
+    // Add or refresh the channel binding, and refresh the permission of the peer as well (RFC 5766 11.2)
     addChannelBind(number, addr);
+    addPermission(addr);
 
     auto response = packet->createSuccessResponse();
     response->setUfrag(_ufrag);
@@ -821,7 +999,7 @@ void IceServer::handleSendIndication(const StunPacket::Ptr& packet, const Pair::
     }
 
     auto buffer = data->getData();
-    auto send_buffer = BufferRaw::create(buffer.size());
+    auto send_buffer = _packet_pool.obtain2();
     send_buffer->assign(buffer.data(), buffer.size());
     return relayBackingData(send_buffer, pair, addr);
 }
@@ -835,16 +1013,14 @@ void IceServer::handleChannelData(uint16_t channel_number, const char* data, siz
         WarnL << "No binding found for channel number: " << channel_number;
         return;
     }
- 
-    // 获取目标地址
-    sockaddr_storage peer_addr = it->second;
- 
-    // 创建一个新的缓冲区用于转发
-    auto buffer = BufferRaw::create(len);
+
+    // 从缓存池获取缓冲区用于转发，data指向会被复用的接收缓冲区，必须拷贝
+    // Obtain a buffer from the pool for relaying, data points into a reused receive buffer and must be copied
+    auto buffer = _packet_pool.obtain2();
     buffer->assign(data, len);
 
     // 转发数据到目标地址
-    relayBackingData(buffer, pair, peer_addr);
+    relayBackingData(buffer, pair, it->second);
 }
 
 void IceServer::sendUnauthorizedResponse(const StunPacket::Ptr& packet, const Pair::Ptr& pair) {
@@ -1008,10 +1184,14 @@ void IceServer::relayBackingData(const toolkit::Buffer::Ptr& buffer, const Pair:
         return;
     }
 
-    auto forward_pair = std::make_shared<Pair>(it->second.second->_socket,
-        SockUtil::inet_ntoa((const struct sockaddr *)&peer_addr), SockUtil::inet_port((const struct sockaddr *)&peer_addr));
+    if (!consumeQuota(buffer->size())) {
+        return;
+    }
+    ++_relay_stat.backing_packets;
+    _relay_stat.backing_bytes += buffer->size();
 
-    sendSocketData(buffer, forward_pair);
+    auto &forward_pair = getPeerPair(it->second.second, peer_addr);
+    sendRelayData(buffer, forward_pair);
 #if 0
     DebugL << "relay backing " << forward_pair->dumpString(1);
 #endif
@@ -1021,16 +1201,12 @@ SocketHelper::Ptr IceServer::createRelayedUdpSocket(const std::string &peer_host
     auto socket = std::make_shared<UdpClient>(getPoller());
 
     weak_ptr<IceServer> weak_self = static_pointer_cast<IceServer>(shared_from_this());
-    auto ptr = socket.get();
-    socket->setOnRecvFrom([weak_self, ptr](const Buffer::Ptr &buffer, struct sockaddr *addr, int addr_len) {
+    socket->setOnRecvFrom([weak_self](const Buffer::Ptr &buffer, struct sockaddr *addr, int addr_len) {
         auto strong_self = weak_self.lock();
         if (!strong_self) {
             return;
         }
-        auto peer_host = SockUtil::inet_ntoa(addr);
-        auto peer_port = SockUtil::inet_port(addr);
-        auto pair = std::make_shared<Pair>(ptr->shared_from_this(), std::move(peer_host), peer_port);
-        strong_self->processRelayPacket(buffer, pair);
+        strong_self->processRelayPacket(buffer, addr, addr_len);
     });
 
     socket->setOnError([weak_self](const SockException &err) {
@@ -1788,7 +1964,7 @@ void IceAgent::refreshChannelBindings() {
     // 遍历所有通道绑定，删除过期的绑定
     for (auto it = _channel_binding_times.begin(); it != _channel_binding_times.end();) {
         if (now - it->second > 10 * 60 * 1000) { // 通道绑定有效期为10分钟
-            _channel_bindings.erase(it->first);
+            removeChannelBind(it->first);
             it = _channel_binding_times.erase(it);
         } else {
             ++it;
@@ -20,6 +20,7 @@
 #include <unordered_map>
 #include "json/json.h"
 #include "Util/Byte.hpp"
+#include "Util/ResourcePool.h"
 #include "Poller/Timer.h"
 #include "Poller/EventPoller.h"
 #include "Network/Socket.h"
@@ -365,6 +366,9 @@ protected:
     virtual void handleChannelData(uint16_t channel_number, const char* data, size_t len, const Pair::Ptr& pair) {};
 
     void sendChannelData(uint16_t channel_number, const toolkit::Buffer::Ptr &buffer, const Pair::Ptr& pair);
+    // 在缓存池缓冲区中构造ChannelData
+    // Construct ChannelData in a pooled buffer
+    toolkit::Buffer::Ptr packChannelData(uint16_t channel_number, const char *data, size_t len);
     virtual void sendUnauthorizedResponse(const StunPacket::Ptr& packet, const Pair::Ptr& pair);
     void sendErrorResponse(const StunPacket::Ptr& packet, const Pair::Ptr& pair, StunAttrErrorCode::Code errorCode);
     void sendRequest(const StunPacket::Ptr& packet, const Pair::Ptr& pair, MsgHandler handler);
@@ -378,6 +382,7 @@ protected:
     bool hasChannelBind(uint16_t channel_number);
     bool hasChannelBind(const sockaddr_storage& addr, uint16_t& channel_number);
     void addChannelBind(uint16_t channel_number, const sockaddr_storage& addr);
+    void removeChannelBind(uint16_t channel_number);
 
     toolkit::SocketHelper::Ptr createSocket(CandidateTuple::TransportType type, const std::string &peer_host, uint16_t peer_port, const std::string &local_ip, uint16_t local_port = 0);
     toolkit::SocketHelper::Ptr createUdpSocket(const std::string &target_host, uint16_t peer_port, const std::string &local_ip, uint16_t local_port);
@@ -403,7 +408,15 @@ protected:
     // For Channel Bind
     std::unordered_map<uint16_t /*channel number*/, sockaddr_storage /*peer ip:port*/> _channel_bindings;
     std::unordered_map<uint16_t /*channel number*/, uint64_t /*bind or fresh time*/> _channel_binding_times;
-    
+    // 通道绑定反向索引，避免转发时遍历_channel_bindings
+    // Reverse index of channel bindings, avoid traversing _channel_bindings when relaying
+    std::unordered_map<sockaddr_storage /*peer ip:port*/, uint16_t /*channel number*/,
+        toolkit::SockUtil::SockAddrHash, toolkit::SockUtil::SockAddrEqual> _channel_numbers;
+
+    // 转发数据包缓存池，避免每个包都申请内存
+    // Packet pool for relayed data, avoid allocating memory for every packet
+    toolkit::ResourcePool<toolkit::BufferRaw> _packet_pool;
+
     // For STUN request retry
     std::shared_ptr<toolkit::Timer> _retry_timer;
 };
@@ -413,14 +426,35 @@ public:
     using Ptr = std::shared_ptr<IceServer>;
     using WeakPtr = std::weak_ptr<IceServer>;
     IceServer(Listener* listener, std::string ufrag, std::string password, toolkit::EventPoller::Ptr poller);
-    virtual ~IceServer() {}
-    
+    ~IceServer() override;
+
+    // TURN中继统计
+    // TURN relay statistics
+    struct RelayStatistic {
+        // 客户端->peer
+        // client->peer
+        uint64_t backing_packets = 0;
+        uint64_t backing_bytes = 0;
+        // peer->客户端
+        // peer->client
+        uint64_t forwarding_packets = 0;
+        uint64_t forwarding_bytes = 0;
+        // 超出带宽配额被丢弃的包
+        // Packets dropped for exceeding the bandwidth quota
+        uint64_t dropped_packets = 0;
+        // 批量发送时flush的次数
+        // Flush count of batched sending
+        uint64_t flush_count = 0;
+    };
+
     bool processSocketData(const uint8_t* data, size_t len, const Pair::Ptr& pair) override;
     void relayForwordingData(const toolkit::Buffer::Ptr& buffer, const sockaddr_storage& peer_addr);
     void relayBackingData(const toolkit::Buffer::Ptr& buffer, const Pair::Ptr& pair, const sockaddr_storage& peer_addr);
 
+    const RelayStatistic &getRelayStatistic() const { return _relay_stat; }
+
 protected:
-    void processRelayPacket(const toolkit::Buffer::Ptr &buffer, const Pair::Ptr& pair);
+    void processRelayPacket(const toolkit::Buffer::Ptr &buffer, const struct sockaddr *addr, int addr_len);
     void handleAllocateRequest(const StunPacket::Ptr& packet, const Pair::Ptr& pair);
     void handleRefreshRequest(const StunPacket::Ptr& packet, const Pair::Ptr& pair);
     void handleCreatePermissionRequest(const StunPacket::Ptr& packet, const Pair::Ptr& pair);
@@ -436,12 +470,60 @@ protected:
     toolkit::SocketHelper::Ptr allocateRelayed(const Pair::Ptr& pair);
     toolkit::SocketHelper::Ptr createRelayedUdpSocket(const std::string &peer_host, uint16_t peer_port, const std::string &local_ip, uint16_t local_port);
 
+    /**
+     * 检查并扣除本分配的带宽配额(令牌桶)
+     * Check and consume the bandwidth quota of this allocation (token bucket)
+     * @return 超出配额返回false
+     */
+    bool consumeQuota(size_t bytes);
+
+    /**
+     * 不立即flush的发送中继数据，同一轮事件循环中的数据合并flush
+     * Send relay data without flushing immediately, the data in the same event loop round is flushed together
+     */
+    void sendRelayData(const toolkit::Buffer::Ptr &buffer, const Pair::Ptr &pair);
+    void flushRelayData();
+
+    const Pair::Ptr &getClientPair(const toolkit::SocketHelper::Ptr &session_socket);
+    const Pair::Ptr &getPeerPair(const Pair::Ptr &relayed_pair, const sockaddr_storage &peer_addr);
+
+    /**
+     * 清理过期的权限和通道绑定，并释放已失效peer的发送对缓存
+     * Clean up expired permissions and channel bindings, and release the cached pairs of expired peers
+     */
+    void expirePeers();
+
 protected:
     std::vector<toolkit::BufferLikeString> _nonce_list;
 
     std::unordered_map<sockaddr_storage /*peer ip:port*/, std::pair<std::shared_ptr<uint16_t> /* port */, Pair::Ptr /*relayed_pairs*/>,
         toolkit::SockUtil::SockAddrHash, toolkit::SockUtil::SockAddrEqual> _relayed_pairs;
     Pair::Ptr _session_pair;
+
+    // 中继socket->peer的发送对缓存，避免每个包都构造Pair
+    // Cache of the relayed socket->peer pairs, avoid constructing Pair for every packet
+    std::unordered_map<sockaddr_storage /*peer ip:port*/, Pair::Ptr,
+        toolkit::SockUtil::SockAddrHash, toolkit::SockUtil::SockAddrEqual> _peer_pairs;
+    // 会话socket->客户端的发送对缓存
+    // Cache of the session socket->client pair
+    Pair::Ptr _client_pair;
+
+    // 待flush的socket
+    // Sockets waiting to be flushed
+    std::vector<toolkit::SocketHelper::Ptr> _dirty_sockets;
+    size_t _pending_packets = 0;
+    bool _flush_scheduled = false;
+
+    // 定期清理过期peer的定时器
+    // Timer for cleaning up expired peers periodically
+    std::shared_ptr<toolkit::Timer> _expire_timer;
+
+    // 带宽配额令牌桶
+    // Bandwidth quota token bucket
+    double _quota_tokens = 0;
+    uint64_t _quota_stamp = 0;
+
+    RelayStatistic _relay_stat;
 };
 
 class IceAgent : public IceTransport {
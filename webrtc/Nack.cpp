@@ -88,13 +88,14 @@ void NackList::pushBack(RtpPacket::Ptr rtp) {
     }
 }
 
-void NackList::forEach(const FCI_NACK &nack, const function<void(const RtpPacket::Ptr &rtp)> &func) {
+void NackList::forEach(const FCI_NACK &nack, const function<void(const RtpPacket::Ptr &rtp)> &func, const SeqMap &seq_map) {
     auto seq = nack.getPid();
     for (auto bit : nack.getBitArray()) {
         if (bit) {
             // 丢包  [AUTO-TRANSLATED:ac2c9d55]
             // Packet loss
-            RtpPacket::Ptr *ptr = getRtp(seq);
+            auto origin_seq = seq;
+            RtpPacket::Ptr *ptr = (!seq_map || seq_map(origin_seq)) ? getRtp(origin_seq) : nullptr;
             if (ptr) {
                 func(*ptr);
             }
@@ -36,7 +36,10 @@ extern const std::string kNackMaxMS;
 class NackList {
 public:
     void pushBack(RtpPacket::Ptr rtp);
-    void forEach(const FCI_NACK &nack, const std::function<void(const RtpPacket::Ptr &rtp)> &cb);
+    // seq_map用于把nack中的seq转换为缓存rtp的seq(例如开启fec后seq被重映射)，转换失败返回false
+    // seq_map is used to convert the seq in nack to the seq of cached rtp (e.g. seq is remapped after fec is enabled), returns false if conversion fails
+    using SeqMap = std::function<bool(uint16_t &seq)>;
+    void forEach(const FCI_NACK &nack, const std::function<void(const RtpPacket::Ptr &rtp)> &cb, const SeqMap &seq_map = nullptr);
 
 private:
     void popFront();
@@ -67,6 +67,7 @@ public:
     uint8_t getAudioLevel(bool *vad) const;
     uint32_t getAbsSendTime() const;
     uint16_t getTransportCCSeq() const;
+    void setTransportCCSeq(uint16_t seq);
     std::string getSdesMid() const;
     std::string getRtpStreamId() const;
     std::string getRepairedRtpStreamId() const;
@@ -124,6 +125,9 @@ public:
     std::string getRid(uint32_t ssrc) const;
     void setRid(uint32_t ssrc, const std::string &rid);
     RtpExt changeRtpExtId(const RtpHeader *header, bool is_recv, std::string *rid_ptr = nullptr, RtpExtType type = RtpExtType::padding);
+    // 获取对端sdp中该扩展的id，未协商时返回0
+    // Get the id of the extension in the peer sdp, return 0 if not negotiated
+    uint8_t getExtId(RtpExtType type) const;
 
 private:
     void onGetRtp(uint8_t pt, uint32_t ssrc, const std::string &rid);
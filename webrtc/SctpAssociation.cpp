@@ -29,6 +29,7 @@ static constexpr uint16_t EventTypes[] =
     SCTP_REMOTE_ERROR,
     SCTP_SHUTDOWN_EVENT,
     SCTP_SEND_FAILED_EVENT,
+    SCTP_SENDER_DRY_EVENT,
     SCTP_STREAM_RESET_EVENT,
     SCTP_STREAM_CHANGE_EVENT
 };
@@ -324,7 +325,7 @@ namespace RTC
         usrsctp_conninput(static_cast<void*>(this), data, len, 0);
     }
 
-    void SctpAssociation::SendSctpMessage(
+    bool SctpAssociation::SendSctpMessage(
         const RTC::SctpStreamParameters &parameters, uint32_t ppid, const uint8_t* msg, size_t len)
     {
         MS_TRACE();
@@ -374,6 +375,9 @@ namespace RTC
 
         if (ret < 0)
         {
+            if (errno == EWOULDBLOCK || errno == EAGAIN || errno == ENOBUFS)
+                return false;
+
             MS_WARN_TAG(
               sctp,
               "error sending SCTP message [sid:%" PRIu16 ", ppid:%" PRIu32 ", message size:%zu]: %s",
@@ -382,6 +386,8 @@ namespace RTC
               len,
               std::strerror(errno));
         }
+
+        return true;
     }
 
     void SctpAssociation::HandleDataConsumer(const RTC::SctpStreamParameters &params)
@@ -819,6 +825,15 @@ namespace RTC
                 break;
             }
 
+            case SCTP_SENDER_DRY_EVENT:
+            {
+                // 发送缓存已清空，通知上层继续发送
+                // The send buffer is drained, notify the upper layer to continue sending
+                this->listener->OnSctpAssociationBufferedAmountLow(this);
+
+                break;
+            }
+
             case SCTP_SEND_FAILED_EVENT:
             {
                 static const size_t BufferSize{ 1024 };
@@ -53,6 +53,9 @@ namespace RTC
               uint32_t ppid,
               const uint8_t* msg,
               size_t len) = 0;
+            // SendSctpMessage因发送缓存已满返回false后，缓存清空时回调
+            // Called when the send buffer is drained after SendSctpMessage returned false because the buffer was full
+            virtual void OnSctpAssociationBufferedAmountLow(RTC::SctpAssociation* sctpAssociation) = 0;
         };
 
     public:
@@ -84,7 +87,9 @@ namespace RTC
             return this->state;
         }
         void ProcessSctpData(const uint8_t* data, size_t len);
-        void SendSctpMessage(const RTC::SctpStreamParameters &params, uint32_t ppid, const uint8_t* msg, size_t len);
+        // 发送缓存已满(EWOULDBLOCK)时返回false，调用者应稍后重试
+        // Return false when the send buffer is full (EWOULDBLOCK), the caller should retry later
+        bool SendSctpMessage(const RTC::SctpStreamParameters &params, uint32_t ppid, const uint8_t* msg, size_t len);
         void HandleDataConsumer(const RTC::SctpStreamParameters &params);
         void DataProducerClosed(const RTC::SctpStreamParameters &params);
         void DataConsumerClosed(const RTC::SctpStreamParameters &params);
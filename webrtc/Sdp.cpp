@@ -9,6 +9,7 @@
  */
 
 #include "Sdp.h"
+#include "Fec.h"
 #include "Rtsp/Rtsp.h"
 #include "Common/config.h"
 #include <cinttypes>
@@ -1478,6 +1479,12 @@ void RtcConfigure::RtcTrackConfigure::setDefaultSetting(TrackType type) {
             CHECK(!s_preferred_codec.empty(), "rtc视频偏好codec不能为空");
             preferred_codec = s_preferred_codec;
 
+            // 视频支持red/ulpfec前向纠错
+            // Video supports red/ulpfec forward error correction
+            GET_CONFIG(bool, fec_enable, Rtc::kFecEnable);
+            support_red = fec_enable;
+            support_ulpfec = fec_enable;
+
             rtcp_fb = { SdpConst::kTWCCRtcpFb, SdpConst::kRembRtcpFb, "nack", "ccm fir", "nack pli" };
             extmap = { { RtpExtType::abs_send_time, RtpDirection::sendrecv },
                        { RtpExtType::transport_cc, RtpDirection::sendrecv },
@@ -183,6 +183,21 @@ WebRtcPlayer::Ptr WebRtcPlayer::create(const EventPoller::Ptr &poller,
     return ret;
 }
 
+bool WebRtcPlayer::broadcastDatachannel(const RtspMediaSource::Ptr &src, uint16_t streamId, uint32_t ppid, const Buffer::Ptr &msg) {
+    // 经由该流的环形缓存扇出，只会投递到该流的播放器所在的poller线程，由各播放器自行预留发送缓存
+    // Fan out through the ring buffer of the stream, only delivered to the poller threads of its players, each player reserves its own send buffer
+    if (!src->getRing()) {
+        return false;
+    }
+    WebRtcDatachannelMessage item;
+    item.stream_id = streamId;
+    item.ppid = ppid;
+    item.data = msg;
+    Any any;
+    any.set<WebRtcDatachannelMessage>(std::move(item));
+    return src->broadcastMessage(any);
+}
+
 WebRtcPlayer::WebRtcPlayer(const EventPoller::Ptr &poller,
                            const RtspMediaSource::Ptr &src,
                            const MediaInfo &info) : WebRtcTransportImp(poller) {
@@ -233,8 +248,15 @@ void WebRtcPlayer::onStartWebRTC() {
                 if (strong_self->_bfliter_flag) {
                     if (TrackVideo == rtp->type && strong_self->_is_h264) {
                         auto rtp_filter = strong_self->_bfilter->processPacket(rtp);
+                        auto flush = ++i == pkt->size();
                         if (rtp_filter) {
-                            strong_self->onSendRtp(rtp_filter, ++i == pkt->size());
+                            strong_self->onSendRtp(rtp_filter, flush);
+                        } else if (flush) {
+                            // 最后一个包被过滤时，也要flush之前发送的包
+                            // Flush the previously sent packets even if the last packet is filtered
+                            if (auto session = strong_self->getSession()) {
+                                session->flushAll();
+                            }
                         }
                     } else {
                         strong_self->onSendRtp(rtp, ++i == pkt->size());
@@ -264,6 +286,14 @@ void WebRtcPlayer::onStartWebRTC() {
                 // PPID 53: 二进制  [AUTO-TRANSLATED:faf00c3e]
                 // PPID 53: Binary
                 strong_self->sendDatachannel(0, 51, buffer.data(), buffer.size());
+            } else if (data.is<WebRtcDatachannelMessage>()) {
+                // 消息内容在所有播放器间共享，排队批量发送，发送缓存满时丢弃
+                // The message content is shared among all players, queued for batched sending, discarded when the send buffer is full
+                auto &msg = data.get<WebRtcDatachannelMessage>();
+                if (!strong_self->sendDatachannel(msg.stream_id, msg.ppid, msg.data)) {
+                    WarnL << "Datachannel send buffer is full, drop message: " << msg.data->size() << " bytes, buffered: "
+                          << strong_self->getDatachannelBufferedAmount();
+                }
             } else {
                 WarnL << "Send unknown message type to webrtc player: " << data.type_name();
             }
@@ -335,4 +365,4 @@ void WebRtcPlayer::sendConfigFrames(uint32_t before_seq, uint32_t sample_rate, u
     }
 }
 
-}// namespace mediakit
\ No newline at end of file
+}// namespace mediakit
\ No newline at end of file
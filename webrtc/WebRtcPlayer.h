@@ -129,6 +129,16 @@ public:
                       WebRtcTransport::Role role, WebRtcTransport::SignalingProtocols signaling_protocols);
     MediaInfo getMediaInfo() { return _media_info; }
 
+    /**
+     * 向播放该源的全部webrtc播放器发送datachannel消息，消息内容在所有播放器间共享，可跨线程调用
+     * Send a datachannel message to all webrtc players of the source, the message content is shared among all players, can be called across threads
+     * 通过该源的MediaSource::broadcastMessage扇出，各播放器在自己的poller线程排队发送，发送缓存满(背压)的播放器丢弃本条消息
+     * Fanned out through MediaSource::broadcastMessage of the source, each player queues it in its own poller thread, players whose send buffer is full (backpressure) drop this message
+     * @return 该源还没有环形缓存(尚未产生数据)时返回false
+     *         Return false when the source has no ring buffer yet (no data produced)
+     */
+    static bool broadcastDatachannel(const RtspMediaSource::Ptr &src, uint16_t streamId, uint32_t ppid, const toolkit::Buffer::Ptr &msg);
+
 protected:
     ///////WebRtcTransportImp override///////
     void onStartWebRTC() override;
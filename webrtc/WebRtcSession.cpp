@@ -10,6 +10,7 @@
 
 #include "WebRtcSession.h"
 #include "Util/util.h"
+#include "Network/sockutil.h"
 #include "Network/TcpServer.h"
 #include "Common/config.h"
 #include "IceTransport.hpp"
@@ -35,13 +36,27 @@ static string getUserName(const char *buf, size_t len) {
     return vec[0];
 }
 
-EventPoller::Ptr WebRtcSession::queryPoller(const Buffer::Ptr &buffer) {
+EventPoller::Ptr WebRtcSession::queryPoller(const Buffer::Ptr &buffer, const struct sockaddr *addr, const EventPoller::Ptr &poller) {
+    auto &manager = WebRtcTransportManager::Instance();
+    WebRtcTransportImp::Ptr ret;
     auto user_name = getUserName(buffer->data(), buffer->size());
-    if (user_name.empty()) {
+    if (!user_name.empty()) {
+        ret = manager.getItem(user_name);
+    } else if (addr) {
+        // 非stun包(dtls/srtp)，可能是udp会话超时后transport仍然存活，根据对端地址找回
+        // Non-stun packets (dtls/srtp), the transport may still be alive after the udp session timed out, find it by peer address
+        ret = manager.getItem(addr);
+        if (ret) {
+            ++manager._addr_hit;
+        }
+    }
+    if (!ret) {
         return nullptr;
     }
-    auto ret = WebRtcTransportManager::Instance().getItem(user_name);
-    return ret ? ret->getPoller() : nullptr;
+    if (poller && poller != ret->getPoller()) {
+        ++manager._migrated_packets;
+    }
+    return ret->getPoller();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,13 +69,25 @@ void WebRtcSession::attachServer(const Server &server) {
     _server = std::static_pointer_cast<toolkit::TcpServer>(const_cast<Server &>(server).shared_from_this());
 }
 
+WebRtcTransportImp::Ptr WebRtcSession::findTransport(const char *data, size_t len) {
+    auto &manager = WebRtcTransportManager::Instance();
+    auto user_name = getUserName(data, len);
+    if (!user_name.empty()) {
+        return manager.getItem(user_name);
+    }
+    if (_over_tcp) {
+        return nullptr;
+    }
+    auto addr = SockUtil::make_sockaddr(get_peer_ip().data(), get_peer_port());
+    return manager.getItem((struct sockaddr *)&addr);
+}
+
 void WebRtcSession::onRecv_l(const char *data, size_t len) {
     if (_find_transport) {
         // 只允许寻找一次transport  [AUTO-TRANSLATED:446fae53]
         // Only allow searching for transport once
         _find_transport = false;
-        auto user_name = getUserName(data, len);
-        auto transport = WebRtcTransportManager::Instance().getItem(user_name);
+        auto transport = findTransport(data, len);
         CHECK(transport);
 
         // WebRtcTransport在其他poller线程上，需要切换poller线程并重新创建WebRtcSession对象  [AUTO-TRANSLATED:7e5534cf]
@@ -81,10 +108,24 @@ void WebRtcSession::onRecv_l(const char *data, size_t len) {
                     session->onRecv_l(str.data(), str.size());
                 }
             });
+            ++WebRtcTransportManager::Instance()._migrated_packets;
             // 3、销毁原先的socket和WebRtcSession(原先的对象跟WebRtcTransport不在同一条线程)  [AUTO-TRANSLATED:a6d6d63f]
             // 3. Destroy the original socket and WebRtcSession (the original object is not on the same thread as WebRtcTransport)
             throw std::runtime_error("webrtc over tcp change poller: " + getPoller()->getThreadName() + " -> " + sock->getPoller()->getThreadName());
         }
+        if (!_over_tcp) {
+            // 记录对端地址，后续该地址的非stun包也能直接分配到transport所在poller
+            // Record the peer address, so that subsequent non-stun packets from this address can also be directly assigned to the poller of the transport
+            auto &manager = WebRtcTransportManager::Instance();
+            auto session = transport->getSession();
+            if (session && session.get() != this) {
+                // 网络切换，transport迁移到新的udp会话
+                // Network switching, transport migrates to the new udp session
+                ++manager._peer_migrations;
+            }
+            auto addr = SockUtil::make_sockaddr(get_peer_ip().data(), get_peer_port());
+            transport->bindPeerAddr((struct sockaddr *)&addr);
+        }
         _transport = std::move(transport);
         InfoP(this);
     }
@@ -116,6 +157,8 @@ void WebRtcSession::onError(const SockException &err) {
     }
     auto self = static_pointer_cast<WebRtcSession>(shared_from_this());
     auto transport = std::move(_transport);
+    // 对端地址的登记保留到transport销毁，udp会话超时后该地址的非stun包仍能找回transport
+    // The registration of the peer address is kept until the transport is destroyed, non-stun packets from this address can still find the transport after the udp session times out
     getPoller()->async([transport, self]() mutable {
         // 延时减引用，防止使用transport对象时，销毁对象  [AUTO-TRANSLATED:09dd6609]
         // Delay decrementing the reference count to prevent the object from being destroyed when using the transport object
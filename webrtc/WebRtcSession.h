@@ -32,7 +32,15 @@ public:
     void onRecv(const toolkit::Buffer::Ptr &) override;
     void onError(const toolkit::SockException &err) override;
     void onManager() override;
-    static toolkit::EventPoller::Ptr queryPoller(const toolkit::Buffer::Ptr &buffer);
+    /**
+     * 单端口udp服务器根据首包查找其对应transport所在的poller
+     * The single-port udp server finds the poller of the transport corresponding to the first packet
+     * @param buffer 首包数据，stun包根据ufrag查找，其他包根据对端地址查找
+     * @param addr 对端地址
+     * @param poller 数据包当前到达的poller，用于统计跨线程迁移
+     */
+    static toolkit::EventPoller::Ptr queryPoller(const toolkit::Buffer::Ptr &buffer, const struct sockaddr *addr = nullptr,
+                                                 const toolkit::EventPoller::Ptr &poller = nullptr);
 
 protected:
     WebRtcTransportImp::Ptr _transport;
@@ -43,6 +51,7 @@ private:
     const char *onSearchPacketTail(const char *data, size_t len) override;
 
     void onRecv_l(const char *data, size_t len);
+    WebRtcTransportImp::Ptr findTransport(const char *data, size_t len);
 
 private:
     bool _over_tcp = false;
@@ -81,6 +81,9 @@ const string kMinBitrate = RTC_FIELD "min_bitrate";
 // 数据通道设置  [AUTO-TRANSLATED:2dc48bc3]
 // Data channel setting
 const string kDataChannelEcho = RTC_FIELD "datachannel_echo";
+// 单个连接datachannel发送缓存上限(字节)，超过后新消息被丢弃
+// The upper limit of the datachannel send buffer of a single connection (bytes), new messages are discarded after exceeding
+const string kDataChannelMaxBuffer = RTC_FIELD "datachannel_max_buffer";
 
 static onceToken token([]() {
     mINI::Instance()[kTimeOutSec] = 15;
@@ -95,6 +98,7 @@ static onceToken token([]() {
     mINI::Instance()[kMinBitrate] = 0;
 
     mINI::Instance()[kDataChannelEcho] = true;
+    mINI::Instance()[kDataChannelMaxBuffer] = 1024 * 1024;
 
     mINI::Instance()[kSignalingPort] = 3000;
     mINI::Instance()[kSignalingSslPort] = 3001;
@@ -273,6 +277,30 @@ WebRtcTransport::WebRtcTransport(const EventPoller::Ptr &poller) {
     static auto prefix = getServerPrefix();
     _identifier = prefix + to_string(++s_key);
     _packet_pool.setSize(64);
+    _datachannel = std::make_shared<DatachannelSender>(poller, [this](const WebRtcDatachannelMessage &msg) {
+#ifdef ENABLE_SCTP
+        if (!_sctp || _sctp->GetState() != RTC::SctpAssociation::SctpState::CONNECTED) {
+            return false;
+        }
+        // 批量发送，由setOnFlush统一flush；只修改本对象的标记，不改动session的flush标记
+        // Send in batches and flush once in setOnFlush; only this object's flag is changed, the session's flush flag is left untouched
+        auto sock_flush = _sock_flush;
+        _sock_flush = false;
+        RTC::SctpStreamParameters params;
+        params.streamId = msg.stream_id;
+        auto ret = _sctp->SendSctpMessage(params, msg.ppid, (uint8_t *)msg.data->data(), msg.data->size());
+        _sock_flush = sock_flush;
+        return ret;
+#else
+        WarnL << "WebRTC datachannel disabled!";
+        return true;
+#endif
+    });
+    _datachannel->setOnFlush([this]() {
+        if (auto session = getSession()) {
+            session->flushAll();
+        }
+    });
 }
 
 void WebRtcTransport::onCreate() {
@@ -514,6 +542,9 @@ void WebRtcTransport::OnSctpAssociationConnected(RTC::SctpAssociation *sctpAssoc
     } catch (std::exception &ex) {
         WarnL << "Exception occurred: " << ex.what();
     }
+    // 发送连接建立前排队的消息
+    // Send the messages queued before the connection is established
+    _datachannel->resume();
 }
 
 void WebRtcTransport::OnSctpAssociationFailed(RTC::SctpAssociation *sctpAssociation) {
@@ -544,9 +575,15 @@ void WebRtcTransport::OnSctpAssociationSendData(
     _dtls_transport->SendApplicationData(data, len);
 }
 
+void WebRtcTransport::OnSctpAssociationBufferedAmountLow(RTC::SctpAssociation *sctpAssociation) {
+    // sctp发送缓存已清空，继续发送排队的消息
+    // The sctp send buffer is drained, continue sending the queued messages
+    _datachannel->resume();
+}
+
 void WebRtcTransport::OnSctpAssociationMessageReceived(
     RTC::SctpAssociation *sctpAssociation, uint16_t streamId, uint32_t ppid, const uint8_t *msg, size_t len) {
-    InfoL << getIdentifier() << " " << streamId << " " << ppid << " " << len << " " << string((char *)msg, len);
+    TraceL << getIdentifier() << " " << streamId << " " << ppid << " " << len;
     RTC::SctpStreamParameters params;
     params.streamId = streamId;
 
@@ -557,6 +594,10 @@ void WebRtcTransport::OnSctpAssociationMessageReceived(
         _sctp->SendSctpMessage(params, ppid, msg, len);
     }
 
+    if (_on_datachannel_message) {
+        _on_datachannel_message(streamId, ppid, msg, len);
+    }
+
     try {
         NOTICE_EMIT(BroadcastRtcSctpReceivedArgs, Broadcast::kBroadcastRtcSctpReceived, *this, streamId, ppid, msg, len);
     } catch (std::exception &ex) {
@@ -577,12 +618,32 @@ void WebRtcTransport::sendDatachannel(uint16_t streamId, uint32_t ppid, const ch
 #endif
 }
 
+bool WebRtcTransport::sendDatachannel(uint16_t streamId, uint32_t ppid, const Buffer::Ptr &msg) {
+    return _datachannel->send(streamId, ppid, msg);
+}
+
+bool WebRtcTransport::tryReserveDatachannelBuffer(size_t size) {
+    return _datachannel->tryReserve(size);
+}
+
+void WebRtcTransport::sendReservedDatachannel(uint16_t streamId, uint32_t ppid, const Buffer::Ptr &msg) {
+    _datachannel->sendReserved(streamId, ppid, msg);
+}
+
+void WebRtcTransport::setOnDatachannelMessage(onDatachannelMessage cb) {
+    _on_datachannel_message = std::move(cb);
+}
+
+void WebRtcTransport::setOnDatachannelDrain(std::function<void()> cb) {
+    _datachannel->setOnDrain(std::move(cb));
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void WebRtcTransport::sendSockData(const char *buf, size_t len, const IceTransport::Pair::Ptr &pair) {
     auto pkt = _packet_pool.obtain2();
     pkt->assign(buf, len);
-    onSendSockData(std::move(pkt), true, pair);
+    onSendSockData(std::move(pkt), _sock_flush, pair);
 }
 
 Session::Ptr WebRtcTransport::getSession() const {
@@ -614,17 +675,19 @@ void WebRtcTransport::onShutdown(const SockException &ex) {
 
 void WebRtcTransport::sendRtcpRemb(uint32_t ssrc, size_t bit_rate) {
     auto remb = FCI_REMB::create({ ssrc }, (uint32_t)bit_rate);
-    auto fb = RtcpFB::create(PSFBType::RTCP_PSFB_REMB, remb.data(), remb.size());
+    auto fb = _rtcp_builder.addFB(PSFBType::RTCP_PSFB_REMB, remb.data(), remb.size());
     fb->ssrc = htonl(0);
     fb->ssrc_media = htonl(ssrc);
-    sendRtcpPacket((char *)fb.get(), fb->getSize(), true);
+    auto buffer = _rtcp_builder.finish();
+    sendRtcpPacket(buffer->data(), buffer->size(), true);
 }
 
 void WebRtcTransport::sendRtcpPli(uint32_t ssrc) {
-    auto pli = RtcpFB::create(PSFBType::RTCP_PSFB_PLI);
+    auto pli = _rtcp_builder.addFB(PSFBType::RTCP_PSFB_PLI);
     pli->ssrc = htonl(0);
     pli->ssrc_media = htonl(ssrc);
-    sendRtcpPacket((char *)pli.get(), pli->getSize(), true);
+    auto buffer = _rtcp_builder.finish();
+    sendRtcpPacket(buffer->data(), buffer->size(), true);
 }
 
 string getFingerprint(const string &algorithm_str, const std::shared_ptr<RTC::DtlsTransport> &transport) {
@@ -849,6 +912,19 @@ WebRtcTransportImp::~WebRtcTransportImp() {
 void WebRtcTransportImp::onDestory() {
     WebRtcTransport::onDestory();
     unregisterSelf();
+    for (auto &track : _type_to_track) {
+        if (track && track->fec_encoder) {
+            InfoL << getIdentifier() << " fec packets sent: " << track->fec_encoder->getFecPackets()
+                  << ", bytes: " << track->fec_encoder->getFecBytes();
+        }
+    }
+    for (auto &pr : _pt_to_track) {
+        auto red = dynamic_cast<WrappedRedTrack *>(pr.second.get());
+        if (red) {
+            InfoL << getIdentifier() << " fec packets received: " << red->_fec_decoder.getFecPackets()
+                  << ", rtp recovered: " << red->_fec_decoder.getRecovered();
+        }
+    }
 }
 
 void WebRtcTransportImp::onSendSockData(Buffer::Ptr buf, bool flush, const IceTransport::Pair::Ptr& pair) {
@@ -904,6 +980,19 @@ void WebRtcTransportImp::onStartWebRTC() {
         track->plan_rtp = &m_answer.plan[0];
         track->plan_rtx = m_answer.getRelatedRtxPlan(track->plan_rtp->pt);
         track->rtcp_context_send = std::make_shared<RtcpContextForSend>();
+        if (m_answer.type == TrackVideo) {
+            // red与ulpfec同时协商成功才启用fec
+            // Fec is enabled only when both red and ulpfec are negotiated
+            auto plan_red = m_answer.getPlan("red");
+            auto plan_ulpfec = m_answer.getPlan("ulpfec");
+            if (plan_red && plan_ulpfec) {
+                track->plan_red = plan_red;
+                track->plan_ulpfec = plan_ulpfec;
+                if (canSendRtp(m_answer)) {
+                    track->fec_encoder = std::make_shared<FecEncoder>(plan_red->pt, plan_ulpfec->pt);
+                }
+            }
+        }
 
         // rtp track type --> MediaTrack
         if (canSendRtp(m_answer)) {
@@ -926,6 +1015,10 @@ void WebRtcTransportImp::onStartWebRTC() {
             // rtx pt --> MediaTrack
             _pt_to_track.emplace(track->plan_rtx->pt, std::unique_ptr<WrappedMediaTrack>(new WrappedRtxTrack(track)));
         }
+        if (track->plan_red) {
+            // red pt --> MediaTrack
+            _pt_to_track.emplace(track->plan_red->pt, std::unique_ptr<WrappedMediaTrack>(new WrappedRedTrack(track, _twcc_ctx, *this)));
+        }
         // 记录rtp ext类型与id的关系，方便接收或发送rtp时修改rtp ext id  [AUTO-TRANSLATED:5736bd34]
         // Record the relationship between rtp ext type and id, which is convenient for modifying rtp ext id when receiving or sending rtp
         track->rtp_ext_ctx = std::make_shared<RtpExtContext>(m_answer);
@@ -1127,7 +1220,7 @@ public:
         }
         return rtp;
     }
-    void onRtcp(RtcpHeader *sr) { 
+    void onRtcp(const RtcpView &sr) {
         _rtcp_context.onRtcp(sr);
     }
     Buffer::Ptr createRtcpRR(uint32_t ssrc) {
@@ -1198,28 +1291,27 @@ float WebRtcTransportImp::getLossRate(TrackType type) {
 
 void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
     _bytes_usage += len;
-    auto rtcps = RtcpHeader::loadFromBytes((char *)buf, len);
-    for (auto rtcp : rtcps) {
-        switch ((RtcpType)rtcp->pt) {
+    for (auto &rtcp : RtcpCompoundView(buf, len)) {
+        switch (rtcp.type()) {
         case RtcpType::RTCP_SR: {
             _alive_ticker.resetTime();
             // 对方汇报rtp发送情况  [AUTO-TRANSLATED:1389b0c8]
             // The other party reports the rtp sending situation
-            RtcpSR *sr = (RtcpSR *)rtcp;
-            auto it = _ssrc_to_track.find(sr->ssrc);
+            RtcpSRView sr(rtcp);
+            auto it = _ssrc_to_track.find(sr.ssrc());
             if (it != _ssrc_to_track.end()) {
                 auto &track = it->second;
-                auto rtp_chn = track->getRtpChannel(sr->ssrc);
+                auto rtp_chn = track->getRtpChannel(sr.ssrc());
                 if (!rtp_chn) {
-                    WarnL << "未识别的sr rtcp包:" << rtcp->dumpString();
+                    WarnL << "未识别的sr rtcp包:" << rtcp.dumpString();
                 } else {
                     // 设置rtp时间戳与ntp时间戳的对应关系  [AUTO-TRANSLATED:e92f4749]
                     // Set the correspondence between rtp timestamp and ntp timestamp
-                    rtp_chn->setNtpStamp(sr->rtpts, sr->getNtpUnixStampMS());
+                    rtp_chn->setNtpStamp(sr.rtpts(), sr.getNtpUnixStampMS());
                     rtp_chn->onRtcp(sr);
                 }
             } else {
-                WarnL << "未识别的sr rtcp包:" << rtcp->dumpString();
+                WarnL << "未识别的sr rtcp包:" << rtcp.dumpString();
             }
             break;
         }
@@ -1227,14 +1319,20 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
             _alive_ticker.resetTime();
             // 对方汇报rtp接收情况  [AUTO-TRANSLATED:77f50a28]
             // The other party reports the rtp receiving situation
-            RtcpRR *rr = (RtcpRR *)rtcp;
-            for (auto item : rr->getItemList()) {
-                auto it = _ssrc_to_track.find(item->ssrc);
+            RtcpRRView rr(rtcp);
+            for (size_t i = 0; i < rr.itemCount(); ++i) {
+                auto item = rr.getItem(i);
+                auto it = _ssrc_to_track.find(item.ssrc());
                 if (it != _ssrc_to_track.end()) {
                     auto &track = it->second;
                     track->rtcp_context_send->onRtcp(rtcp);
+                    if (track->fec_encoder && item.ssrc() == track->answer_ssrc_rtp) {
+                        // 根据对端汇报的丢包率调整fec冗余度
+                        // Adjust fec redundancy according to the loss rate reported by the peer
+                        track->fec_encoder->setFractionLost(item.fraction());
+                    }
                 } else {
-                    WarnL << "未识别的rr rtcp包:" << rtcp->dumpString();
+                    WarnL << "未识别的rr rtcp包:" << rtcp.dumpString();
                 }
             }
             break;
@@ -1242,11 +1340,11 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
         case RtcpType::RTCP_BYE: {
             // 对方汇报停止发送rtp  [AUTO-TRANSLATED:96ad0cf3]
             // The other party reports the stop sending rtp
-            RtcpBye *bye = (RtcpBye *)rtcp;
-            for (auto ssrc : bye->getSSRC()) {
-                auto it = _ssrc_to_track.find(*ssrc);
+            RtcpByeView bye(rtcp);
+            for (size_t i = 0; i < bye.ssrcCount(); ++i) {
+                auto it = _ssrc_to_track.find(bye.getSSRC(i));
                 if (it == _ssrc_to_track.end()) {
-                    WarnL << "未识别的bye rtcp包:" << rtcp->dumpString();
+                    WarnL << "未识别的bye rtcp包:" << rtcp.dumpString();
                     continue;
                 }
                 _ssrc_to_track.erase(it);
@@ -1258,25 +1356,31 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
         }
         case RtcpType::RTCP_PSFB:
         case RtcpType::RTCP_RTPFB: {
-            if ((RtcpType)rtcp->pt == RtcpType::RTCP_PSFB) {
+            if (rtcp.type() == RtcpType::RTCP_PSFB) {
                 break;
             }
             // RTPFB
-            switch ((RTPFBType)rtcp->report_count) {
+            switch ((RTPFBType)rtcp.reportCount()) {
             case RTPFBType::RTCP_RTPFB_NACK: {
-                RtcpFB *fb = (RtcpFB *)rtcp;
-                auto it = _ssrc_to_track.find(fb->ssrc_media);
+                RtcpFBView fb(rtcp);
+                auto it = _ssrc_to_track.find(fb.ssrcMedia());
                 if (it == _ssrc_to_track.end()) {
-                    WarnL << "未识别的 rtcp包:" << rtcp->dumpString();
+                    WarnL << "未识别的 rtcp包:" << rtcp.dumpString();
                     return;
                 }
                 auto &track = it->second;
-                auto &fci = fb->getFci<FCI_NACK>();
+                auto &fci = fb.getFci<FCI_NACK>();
+                NackList::SeqMap seq_map;
+                if (track->fec_encoder) {
+                    // 开启fec后发送的seq被重映射了
+                    // The sent seq is remapped after fec is enabled
+                    seq_map = [&track](uint16_t &seq) { return track->fec_encoder->getOriginSeq(seq); };
+                }
                 track->nack_list.forEach(fci, [&](const RtpPacket::Ptr &rtp) {
                     // rtp重传  [AUTO-TRANSLATED:62a37e46]
                     // rtp retransmission
                     onSendRtp(rtp, true, true);
-                });
+                }, seq_map);
                 break;
             }
             default:
@@ -1285,13 +1389,13 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
             break;
         }
         case RtcpType::RTCP_XR: {
-            RtcpXRRRTR *xr = (RtcpXRRRTR *)rtcp;
-            if (xr->bt != 4) {
+            RtcpXRView xr(rtcp);
+            if (xr.bt() != 4) {
                 break;
             }
-            auto it = _ssrc_to_track.find(xr->ssrc);
+            auto it = _ssrc_to_track.find(xr.ssrc());
             if (it == _ssrc_to_track.end()) {
-                WarnL << "未识别的 rtcp包:" << rtcp->dumpString();
+                WarnL << "未识别的 rtcp包:" << rtcp.dumpString();
                 return;
             }
             auto &track = it->second;
@@ -1362,6 +1466,14 @@ void WebRtcTransportImp::onRtp(const char *buf, size_t len, uint64_t stamp_ms) {
 }
 
 void WrappedRtpTrack::inputRtp(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp) {
+    inputRtp_l(buf, len, stamp_ms, rtp, false);
+}
+
+void WrappedRtpTrack::inputRecoveredRtp(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp) {
+    inputRtp_l(buf, len, stamp_ms, rtp, true);
+}
+
+void WrappedRtpTrack::inputRtp_l(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp, bool recovered) {
 #if 0
     auto seq = ntohs(rtp->seq);
     if (track->media->type == TrackVideo && seq % 100 == 0) {
@@ -1378,7 +1490,7 @@ void WrappedRtpTrack::inputRtp(const char *buf, size_t len, uint64_t stamp_ms, R
     string rid;
     auto twcc_ext = track->rtp_ext_ctx->changeRtpExtId(rtp, true, &rid, RtpExtType::transport_cc);
 
-    if (twcc_ext) {
+    if (twcc_ext && !recovered) {
         _twcc_ctx.onRtp(ssrc, twcc_ext.getTransportCCSeq(), stamp_ms);
     }
 
@@ -1431,18 +1543,56 @@ void WrappedRtxTrack::inputRtp(const char *buf, size_t len, uint64_t stamp_ms, R
     ref->inputRtp(track->media->type, track->plan_rtp->sample_rate, (uint8_t *)buf, len, true);
 }
 
+WrappedRedTrack::WrappedRedTrack(MediaTrack::Ptr ptr, TwccContext &twcc, WebRtcTransportImp &t)
+    : WrappedMediaTrack(ptr)
+    , _media(ptr, twcc, t) {
+    _fec_decoder.setOnRecovered([this](char *buf, size_t len) {
+        // fec恢复的rtp包
+        // Rtp packets recovered by fec
+        _media.inputRecoveredRtp(buf, len, _stamp_ms, (RtpHeader *)buf);
+    });
+}
+
+void WrappedRedTrack::inputRtp(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp) {
+    _stamp_ms = stamp_ms;
+    auto ptr = (char *)buf;
+    if (!RedPacker::unwrap(ptr, len)) {
+        WarnL << "invalid red rtp, seq:" << ntohs(rtp->seq) << ", size:" << len;
+        return;
+    }
+    rtp = (RtpHeader *)ptr;
+    if (track->plan_ulpfec && rtp->pt == track->plan_ulpfec->pt) {
+        auto size = rtp->getPayloadSize(len);
+        if (size > 0) {
+            _fec_decoder.inputFec(rtp, rtp->getPayloadData(), size);
+        }
+        return;
+    }
+    if (rtp->pt != track->plan_rtp->pt) {
+        // 暂不支持red封装其他编码
+        // Red encapsulation of other codecs is not supported yet
+        return;
+    }
+    // 必须在修改rtp ext id前缓存，fec是基于原始数据计算的
+    // Must be cached before modifying the rtp ext id, fec is calculated based on the original data
+    _fec_decoder.inputRtp(ptr, len);
+    _media.inputRtp(ptr, len, stamp_ms, rtp);
+}
+
 void WebRtcTransportImp::onSendNack(MediaTrack &track, const FCI_NACK &nack, uint32_t ssrc) {
-    auto rtcp = RtcpFB::create(RTPFBType::RTCP_RTPFB_NACK, &nack, FCI_NACK::kSize);
+    auto rtcp = _rtcp_builder.addFB(RTPFBType::RTCP_RTPFB_NACK, &nack, FCI_NACK::kSize);
     rtcp->ssrc = htonl(track.answer_ssrc_rtp);
     rtcp->ssrc_media = htonl(ssrc);
-    sendRtcpPacket((char *)rtcp.get(), rtcp->getSize(), true);
+    auto buffer = _rtcp_builder.finish();
+    sendRtcpPacket(buffer->data(), buffer->size(), true);
 }
 
 void WebRtcTransportImp::onSendTwcc(uint32_t ssrc, const string &twcc_fci) {
-    auto rtcp = RtcpFB::create(RTPFBType::RTCP_RTPFB_TWCC, twcc_fci.data(), twcc_fci.size());
+    auto rtcp = _rtcp_builder.addFB(RTPFBType::RTCP_RTPFB_TWCC, twcc_fci.data(), twcc_fci.size());
     rtcp->ssrc = htonl(0);
     rtcp->ssrc_media = htonl(ssrc);
-    sendRtcpPacket((char *)rtcp.get(), rtcp->getSize(), true);
+    auto buffer = _rtcp_builder.finish();
+    sendRtcpPacket(buffer->data(), buffer->size(), true);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -1497,6 +1647,12 @@ void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool r
     sendRtpPacket(rtp->data() + RtpPacket::kRtpTcpHeaderSize, rtp->size() - RtpPacket::kRtpTcpHeaderSize, flush, &ctx);
     _bytes_usage += rtp->size() - RtpPacket::kRtpTcpHeaderSize;
 
+    if (track->fec_encoder) {
+        // 发送已经生成的fec包，其已经完整封装，不再需要修改
+        // Send the generated fec packets, which have been fully encapsulated and no longer need to be modified
+        track->fec_encoder->flush([&](const char *buf, size_t len) { sendFecPacket(*track, buf, len, flush); });
+    }
+
     if (_rtcp_sr_send_ticker.elapsedTime() > 5000) {
         _rtcp_sr_send_ticker.resetTime();
         if (track->rtcp_context_send) {
@@ -1508,20 +1664,71 @@ void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool r
     }
 }
 
+void WebRtcTransportImp::setTransportCCSeq(MediaTrack &track, RtpHeader *header) {
+    auto ext = track.rtp_ext_ctx->changeRtpExtId(header, false, nullptr, RtpExtType::transport_cc);
+    if (ext) {
+        // 源站的twcc序号不属于本连接，改为本连接的transport-wide序号
+        // The twcc seq of the source does not belong to this connection, change it to the transport-wide seq of this connection
+        ext.setTransportCCSeq(_twcc_send_seq++);
+    }
+}
+
+void WebRtcTransportImp::sendFecPacket(MediaTrack &track, const char *buf, size_t len, bool flush) {
+    _bytes_usage += len;
+    auto header = (const RtpHeader *)buf;
+    auto ext_id = track.rtp_ext_ctx->getExtId(RtpExtType::transport_cc);
+    if (!ext_id || ext_id >= (uint8_t)RtpExtType::reserved || header->ext || header->csrc) {
+        // 未协商transport-cc，或者id无法使用one-byte扩展存放
+        // Transport-cc is not negotiated, or the id cannot be stored in the one-byte extension
+        sendRtpPacket(buf, len, flush, nullptr);
+        return;
+    }
+    // fec包不含扩展，插入one-byte transport-cc扩展，让对端的twcc反馈覆盖fec包
+    // The fec packet has no extension, insert the one-byte transport-cc extension so that the twcc feedback of the peer covers the fec packet
+    auto seq = _twcc_send_seq++;
+    _fec_buf.resize(len + 8);
+    auto ptr = (uint8_t *)&_fec_buf[0];
+    memcpy(ptr, buf, RtpPacket::kRtpHeaderSize);
+    ((RtpHeader *)ptr)->ext = 1;
+    ptr += RtpPacket::kRtpHeaderSize;
+    uint8_t ext[8] = { 0xBE, 0xDE, 0x00, 0x01, (uint8_t)((ext_id << 4) | 0x01), (uint8_t)(seq >> 8), (uint8_t)(seq & 0xFF), 0x00 };
+    memcpy(ptr, ext, sizeof(ext));
+    memcpy(ptr + sizeof(ext), buf + RtpPacket::kRtpHeaderSize, len - RtpPacket::kRtpHeaderSize);
+    sendRtpPacket(_fec_buf.data(), _fec_buf.size(), flush, nullptr);
+}
+
 void WebRtcTransportImp::onBeforeEncryptRtp(const char *buf, int &len, void *ctx) {
     auto pr = (pair<bool /*rtx*/, MediaTrack *> *)ctx;
+    if (!pr) {
+        // fec包
+        // Fec packet
+        return;
+    }
     auto header = (RtpHeader *)buf;
+    auto &fec_encoder = pr->second->fec_encoder;
 
     if (!pr->first || !pr->second->plan_rtx) {
         // 普通的rtp,或者不支持rtx, 修改目标pt和ssrc  [AUTO-TRANSLATED:e1264971]
         // Ordinary RTP, or does not support RTX, modify the target PT and SSRC
-        pr->second->rtp_ext_ctx->changeRtpExtId(header, false);
+        setTransportCCSeq(*pr->second, header);
         header->pt = pr->second->plan_rtp->pt;
         header->ssrc = htonl(pr->second->answer_ssrc_rtp);
+        if (fec_encoder) {
+            if (!pr->first) {
+                // 计算fec并重映射seq
+                // Calculate fec and remap seq
+                fec_encoder->inputRtp(header, len);
+            } else {
+                header->seq = htons(fec_encoder->getOutSeq(ntohs(header->seq)));
+            }
+            // sendRtpPacket预留了两个字节，足够存放red头
+            // sendRtpPacket reserved two bytes, enough to store the red header
+            RedPacker::wrap((char *)buf, len, pr->second->plan_red->pt);
+        }
     } else {
         // 重传的rtp, rtx  [AUTO-TRANSLATED:e863a518]
         // Retransmitted RTP, RTX
-        pr->second->rtp_ext_ctx->changeRtpExtId(header, false);
+        setTransportCCSeq(*pr->second, header);
         header->pt = pr->second->plan_rtx->pt;
         if (pr->second->answer_ssrc_rtx) {
             // 有rtx单独的ssrc,有些情况下，浏览器支持rtx，但是未指定rtx单独的ssrc  [AUTO-TRANSLATED:181cee9a]
@@ -1534,6 +1741,11 @@ void WebRtcTransportImp::onBeforeEncryptRtp(const char *buf, int &len, void *ctx
         }
 
         auto origin_seq = ntohs(header->seq);
+        if (fec_encoder) {
+            // osn必须是对端收到的seq
+            // Osn must be the seq received by the peer
+            origin_seq = fec_encoder->getOutSeq(origin_seq);
+        }
         // seq跟原来的不一样  [AUTO-TRANSLATED:803f9a5e]
         // The sequence is different from the original
         header->seq = htons(_rtx_seq[pr->second->media->type]);
@@ -1593,6 +1805,7 @@ void WebRtcTransportImp::unregisterSelf() {
     DebugL;
     unrefSelf();
     WebRtcTransportManager::Instance().removeItem(getIdentifier());
+    unbindPeerAddrs();
 }
 
 WebRtcTransportManager &WebRtcTransportManager::Instance() {
@@ -1622,6 +1835,123 @@ void WebRtcTransportManager::removeItem(const string &key) {
     _map.erase(key);
 }
 
+void WebRtcTransportManager::forEachItem(const function<void(const WebRtcTransportImp::Ptr &)> &cb) {
+    vector<WebRtcTransportImp::Ptr> items;
+    {
+        lock_guard<mutex> lck(_mtx);
+        items.reserve(_map.size());
+        for (auto &pr : _map) {
+            if (auto item = pr.second.lock()) {
+                items.emplace_back(std::move(item));
+            }
+        }
+    }
+    for (auto &item : items) {
+        cb(item);
+    }
+}
+
+WebRtcTransportManager::WebRtcTransportManager() {}
+
+WebRtcTransportManager::AddrShard &WebRtcTransportManager::getShard(const string &key) {
+    return _addr_shards[std::hash<string>()(key) % kAddrShards];
+}
+
+static string makeAddrKey(const struct sockaddr *addr) {
+    switch (addr->sa_family) {
+        case AF_INET: {
+            auto in = (const struct sockaddr_in *)addr;
+            string ret((char *)&in->sin_port, sizeof(in->sin_port));
+            ret.append((char *)&in->sin_addr, sizeof(in->sin_addr));
+            return ret;
+        }
+        case AF_INET6: {
+            auto in6 = (const struct sockaddr_in6 *)addr;
+            string ret((char *)&in6->sin6_port, sizeof(in6->sin6_port));
+            ret.append((char *)&in6->sin6_addr, sizeof(in6->sin6_addr));
+            return ret;
+        }
+        default: return "";
+    }
+}
+
+WebRtcTransportImp::Ptr WebRtcTransportManager::getItem(const struct sockaddr *addr) {
+    if (!addr) {
+        return nullptr;
+    }
+    auto key = makeAddrKey(addr);
+    if (key.empty()) {
+        return nullptr;
+    }
+    auto &shard = getShard(key);
+    lock_guard<mutex> lck(shard.mtx);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+        return nullptr;
+    }
+    auto ret = it->second.lock();
+    if (!ret) {
+        // 顺便清理已经销毁的transport
+        // Clean up the destroyed transport by the way
+        shard.map.erase(it);
+    }
+    return ret;
+}
+
+void WebRtcTransportManager::addPeerAddr(const string &key, const WebRtcTransportImp::Ptr &ptr) {
+    auto &shard = getShard(key);
+    lock_guard<mutex> lck(shard.mtx);
+    shard.map[key] = ptr;
+}
+
+void WebRtcTransportManager::removePeerAddr(const string &key, const WebRtcTransportImp *ptr) {
+    auto &shard = getShard(key);
+    lock_guard<mutex> lck(shard.mtx);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+        return;
+    }
+    auto transport = it->second.lock();
+    if (transport && transport.get() != ptr) {
+        // 该地址已经被其他transport占用
+        // The address has been occupied by another transport
+        return;
+    }
+    shard.map.erase(it);
+}
+
+void WebRtcTransportImp::bindPeerAddr(const struct sockaddr *addr) {
+    auto key = makeAddrKey(addr);
+    if (key.empty()) {
+        return;
+    }
+    // 新的stun binding取代该地址原有的登记
+    // The new stun binding replaces the existing registration of this address
+    WebRtcTransportManager::Instance().addPeerAddr(key, static_pointer_cast<WebRtcTransportImp>(shared_from_this()));
+    _peer_addr_keys.emplace(std::move(key));
+}
+
+void WebRtcTransportImp::unbindPeerAddrs() {
+    for (auto &key : _peer_addr_keys) {
+        // 已经被其他transport占用的地址不会被移除
+        // Addresses already taken by other transports are not removed
+        WebRtcTransportManager::Instance().removePeerAddr(key, this);
+    }
+    _peer_addr_keys.clear();
+}
+
+void WebRtcTransportManager::getDemuxStatistic(Json::Value &val) const {
+    size_t size = 0;
+    for (auto &shard : _addr_shards) {
+        lock_guard<mutex> lck(shard.mtx);
+        size += shard.map.size();
+    }
+    val["addrMapSize"] = (Json::UInt64)size;
+    val["addrHit"] = (Json::UInt64)getAddrHit();
+    val["migratedPackets"] = (Json::UInt64)getMigratedPackets();
+    val["peerMigrations"] = (Json::UInt64)getPeerMigrations();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 WebRtcPluginManager &WebRtcPluginManager::Instance() {
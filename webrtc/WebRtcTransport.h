@@ -11,9 +11,11 @@
 #ifndef ZLMEDIAKIT_WEBRTC_TRANSPORT_H
 #define ZLMEDIAKIT_WEBRTC_TRANSPORT_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <functional>
+#include <unordered_set>
 #include "DtlsTransport.hpp"
 #include "IceTransport.hpp"
 #include "SrtpSession.hpp"
@@ -24,8 +26,10 @@
 #include "Network/Socket.h"
 #include "Network/Session.h"
 #include "Nack.h"
+#include "Fec.h"
 #include "TwccContext.h"
 #include "SctpAssociation.hpp"
+#include "DatachannelSender.h"
 #include "Rtcp/RtcpContext.h"
 #include "Rtsp/RtspMediaSource.h"
 
@@ -55,6 +59,7 @@ extern const std::string kIceUfrag;
 extern const std::string kIcePwd;
 extern const std::string kExternIP;
 extern const std::string kInterfaces;
+extern const std::string kDataChannelMaxBuffer;
 }//namespace RTC
 
 class WebRtcInterface {
@@ -148,6 +153,49 @@ public:
     void sendRtcpPacket(const char *buf, int len, bool flush, void *ctx = nullptr);
     void sendDatachannel(uint16_t streamId, uint32_t ppid, const char *msg, size_t len);
 
+    /**
+     * 排队批量发送datachannel消息，同一轮事件循环内的消息合并flush
+     * Queue the datachannel message for batched sending, messages in the same event loop round are flushed together
+     * 必须在本对象的poller线程调用
+     * Must be called in the poller thread of this object
+     * @return 发送缓存超过rtc.datachannel_max_buffer时返回false，消息被丢弃(背压)
+     *         Return false when the send buffer exceeds rtc.datachannel_max_buffer, the message is discarded (backpressure)
+     */
+    bool sendDatachannel(uint16_t streamId, uint32_t ppid, const toolkit::Buffer::Ptr &msg);
+
+    /**
+     * 预留datachannel发送缓存，可跨线程调用；预留成功后必须调用sendReservedDatachannel投递该消息
+     * Reserve the datachannel send buffer, can be called across threads; sendReservedDatachannel must be called to deliver the message after a successful reservation
+     * @return 发送缓存超过rtc.datachannel_max_buffer时返回false
+     *         Return false when the send buffer exceeds rtc.datachannel_max_buffer
+     */
+    bool tryReserveDatachannelBuffer(size_t size);
+
+    /**
+     * 投递已通过tryReserveDatachannelBuffer预留缓存的消息，可跨线程调用，不会被丢弃
+     * Deliver a message whose buffer was reserved by tryReserveDatachannelBuffer, can be called across threads, it will not be discarded
+     */
+    void sendReservedDatachannel(uint16_t streamId, uint32_t ppid, const toolkit::Buffer::Ptr &msg);
+
+    /**
+     * 获取尚未交给sctp的datachannel数据字节数，可跨线程调用
+     * Get the bytes of datachannel data not yet handed to sctp, can be called across threads
+     */
+    size_t getDatachannelBufferedAmount() const { return _datachannel->getBufferedAmount(); }
+
+    using onDatachannelMessage = std::function<void(uint16_t streamId, uint32_t ppid, const uint8_t *msg, size_t len)>;
+    /**
+     * 直接接收datachannel消息，不经过NoticeCenter广播
+     * Receive datachannel messages directly, without the NoticeCenter broadcast
+     */
+    void setOnDatachannelMessage(onDatachannelMessage cb);
+
+    /**
+     * datachannel发送缓存清空时回调，用于背压后恢复发送
+     * Callback when the datachannel send buffer is drained, used to resume sending after backpressure
+     */
+    void setOnDatachannelDrain(std::function<void()> cb);
+
     const toolkit::EventPoller::Ptr &getPoller() const { return _poller; }
     void setPoller(toolkit::EventPoller::Ptr poller) { _poller = std::move(poller); }
 
@@ -207,6 +255,7 @@ protected:
     void OnSctpAssociationSendData(RTC::SctpAssociation* sctpAssociation, const uint8_t* data, size_t len) override;
     void OnSctpAssociationMessageReceived(RTC::SctpAssociation *sctpAssociation, uint16_t streamId, uint32_t ppid,
                                           const uint8_t *msg, size_t len) override;
+    void OnSctpAssociationBufferedAmountLow(RTC::SctpAssociation *sctpAssociation) override;
 #endif
 
 protected:
@@ -238,6 +287,9 @@ protected:
 
     IceAgent::Ptr _ice_agent;
     onGatheringCandidateCB _on_gathering_candidate = nullptr;
+    // 复用缓存构造rtcp反馈包(pli/remb/nack/twcc)
+    // Build rtcp feedback packets (pli/remb/nack/twcc) with reused cache
+    RtcpBuilder _rtcp_builder;
 
 private:
     mutable std::string _delete_rand_str;
@@ -260,6 +312,14 @@ private:
 #ifdef ENABLE_SCTP
     RTC::SctpAssociationImp::Ptr _sctp;
 #endif
+
+    // datachannel发送队列
+    // Datachannel send queue
+    DatachannelSender::Ptr _datachannel;
+    // 批量发送datachannel时不逐包flush socket
+    // Do not flush the socket packet by packet when sending datachannel in batches
+    bool _sock_flush = true;
+    onDatachannelMessage _on_datachannel_message;
 };
 
 class RtpChannel;
@@ -268,6 +328,8 @@ public:
     using Ptr = std::shared_ptr<MediaTrack>;
     const RtcCodecPlan *plan_rtp;
     const RtcCodecPlan *plan_rtx;
+    const RtcCodecPlan *plan_red = nullptr;
+    const RtcCodecPlan *plan_ulpfec = nullptr;
     uint32_t offer_ssrc_rtp = 0;
     uint32_t offer_ssrc_rtx = 0;
     uint32_t answer_ssrc_rtp = 0;
@@ -278,6 +340,9 @@ public:
     //for send rtp
     NackList nack_list;
     RtcpContext::Ptr rtcp_context_send;
+    // 协商了red/ulpfec时才创建
+    // Created only when red/ulpfec is negotiated
+    FecEncoder::Ptr fec_encoder;
 
     //for recv rtp
     std::unordered_map<std::string/*rid*/, std::shared_ptr<RtpChannel> > rtp_channel;
@@ -307,6 +372,22 @@ struct WrappedRtpTrack : public WrappedMediaTrack {
     TwccContext& _twcc_ctx;
     WebRtcTransportImp& _transport;
     void inputRtp(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp) override;
+    // fec恢复的rtp包不计入twcc，否则发送端的带宽估计看不到真实丢包
+    // Rtp packets recovered by fec are not counted in twcc, otherwise the bandwidth estimation of the sender cannot see the real packet loss
+    void inputRecoveredRtp(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp);
+
+private:
+    void inputRtp_l(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp, bool recovered);
+};
+
+struct WrappedRedTrack : public WrappedMediaTrack {
+    explicit WrappedRedTrack(MediaTrack::Ptr ptr, TwccContext& twcc, WebRtcTransportImp& t);
+    // red解封装后的媒体包交给它处理
+    // The media packets after red unwrapping are handed over to it
+    WrappedRtpTrack _media;
+    FecDecoder _fec_decoder;
+    uint64_t _stamp_ms = 0;
+    void inputRtp(const char *buf, size_t len, uint64_t stamp_ms, RtpHeader *rtp) override;
 };
 
 class WebRtcTransportImp : public WebRtcTransport {
@@ -329,6 +410,14 @@ public:
     void setLocalIp(std::string local_ip) override;
     void setIceCandidate(std::vector<SdpAttrCandidate> cands) override;
 
+    /**
+     * 记录stun binding的对端udp地址，之后该地址的非stun包即使所属udp会话已经超时也能找回本对象；
+     * 本对象销毁或者该地址被其他transport的stun binding占用时才移除
+     * Record the peer udp address of the stun binding, so that subsequent non-stun packets from this address can find this object even if the udp session has timed out;
+     * removed only when this object is destroyed or the address is taken by the stun binding of another transport
+     */
+    void bindPeerAddr(const struct sockaddr *addr);
+
 protected:
 
     // // ice相关的回调 ///  [AUTO-TRANSLATED:30abf693]
@@ -357,15 +446,24 @@ private:
     void onSortedRtp(MediaTrack &track, const std::string &rid, RtpPacket::Ptr rtp);
     void onSendNack(MediaTrack &track, const FCI_NACK &nack, uint32_t ssrc);
     void onSendTwcc(uint32_t ssrc, const std::string &twcc_fci);
+    void sendFecPacket(MediaTrack &track, const char *buf, size_t len, bool flush);
+    void setTransportCCSeq(MediaTrack &track, RtpHeader *header);
 
     void registerSelf();
     void unregisterSelf();
+    void unbindPeerAddrs();
     void unrefSelf();
     void onCheckAnswer(RtcSession &sdp);
 
 private:
     bool _preferred_tcp = false;
     uint16_t _rtx_seq[2] = {0, 0};
+    // 发送rtp的transport-wide序号，媒体包、rtx与fec包共用
+    // Transport-wide seq of sent rtp, shared by media, rtx and fec packets
+    uint16_t _twcc_send_seq = 0;
+    // 加上transport-cc扩展后的fec包
+    // Fec packet with the transport-cc extension added
+    std::string _fec_buf;
     // 用掉的总流量  [AUTO-TRANSLATED:713b61c9]
     // Total traffic used
     uint64_t _bytes_usage = 0;
@@ -394,6 +492,9 @@ private:
     // 根据rtcp的ssrc获取相关信息，收发rtp和rtx的ssrc都会记录  [AUTO-TRANSLATED:6c57cd48]
     // Get relevant information based on the ssrc of the rtcp, the ssrc of sending and receiving rtp and rtx will be recorded
     std::unordered_map<uint32_t/*ssrc*/, MediaTrack::Ptr> _ssrc_to_track;
+    // 通过bindPeerAddr登记的对端地址
+    // Peer addresses registered through bindPeerAddr
+    std::unordered_set<std::string> _peer_addr_keys;
     // 根据接收rtp的pt获取相关信息  [AUTO-TRANSLATED:39e56d7d]
     // Get relevant information based on the pt of the received rtp
     std::unordered_map<uint8_t/*pt*/, std::unique_ptr<WrappedMediaTrack>> _pt_to_track;
@@ -403,20 +504,67 @@ private:
     std::string _local_ip;
 };
 
+class WebRtcSession;
 class WebRtcTransportManager {
 public:
     friend class WebRtcTransportImp;
+    friend class WebRtcSession;
     static WebRtcTransportManager &Instance();
     WebRtcTransportImp::Ptr getItem(const std::string &key);
 
+    /**
+     * 根据对端udp地址查找transport，用于单端口udp服务器分配poller；按地址分片加锁，不同地址的查找互不竞争
+     * Find transport according to the peer udp address, used by the single-port udp server to assign poller; locked by address shard, lookups of different addresses do not compete
+     */
+    WebRtcTransportImp::Ptr getItem(const struct sockaddr *addr);
+
+    /**
+     * 单端口udp分流统计
+     * Single-port udp demux statistics
+     */
+    void getDemuxStatistic(Json::Value &val) const;
+
+    /**
+     * 遍历全部transport，回调在锁外执行，可跨线程调用
+     * Traverse all transports, the callback is executed outside the lock, can be called across threads
+     */
+    void forEachItem(const std::function<void(const WebRtcTransportImp::Ptr &)> &cb);
+
+    uint64_t getAddrHit() const { return _addr_hit.load(); }
+    uint64_t getMigratedPackets() const { return _migrated_packets.load(); }
+    uint64_t getPeerMigrations() const { return _peer_migrations.load(); }
+
 private:
-    WebRtcTransportManager() = default;
+    WebRtcTransportManager();
     void addItem(const std::string &key, const WebRtcTransportImp::Ptr &ptr);
     void removeItem(const std::string &key);
+    void addPeerAddr(const std::string &addr_key, const WebRtcTransportImp::Ptr &ptr);
+    void removePeerAddr(const std::string &addr_key, const WebRtcTransportImp *ptr);
 
 private:
+    struct AddrShard {
+        mutable std::mutex mtx;
+        std::unordered_map<std::string/*addr key*/, std::weak_ptr<WebRtcTransportImp> > map;
+    };
+    AddrShard &getShard(const std::string &key);
+
+private:
+    static constexpr size_t kAddrShards = 64;
+
     mutable std::mutex _mtx;
     std::unordered_map<std::string, std::weak_ptr<WebRtcTransportImp> > _map;
+    // 对端地址索引按地址哈希分片，每个分片一把锁，插入删除均为O(1)
+    // The peer address index is sharded by address hash, one lock per shard, insertion and deletion are O(1)
+    AddrShard _addr_shards[kAddrShards];
+    // 通过对端地址(而非stun)找到transport的次数
+    // Number of times the transport was found by peer address (instead of stun)
+    std::atomic<uint64_t> _addr_hit { 0 };
+    // 数据包到达的poller与transport所在poller不一致，需要迁移的次数
+    // Number of times the packet arrives at a poller different from the transport's poller and needs to be migrated
+    std::atomic<uint64_t> _migrated_packets { 0 };
+    // transport对端地址变更(网络切换)次数
+    // Number of transport peer address changes (network switching)
+    std::atomic<uint64_t> _peer_migrations { 0 };
 };
 
 class WebRtcArgs : public std::enable_shared_from_this<WebRtcArgs> {